@@ -91,9 +91,9 @@ int main() {
     for (Row* r : all_rows) {
         if (count >= 10) break;
 
-        int id = std::get<int>(r->values[0]);
-        int val = std::get<int>(r->values[1]);
-        std::string country = std::get<std::string>(r->values[2]);
+        int id = r->values[0].get<int>();
+        int val = r->values[1].get<int>();
+        std::string country(r->values[2].get<std::string>());
 
         std::cout << "  Row " << count + 1 << ": id=" << id
                   << ", value=" << val
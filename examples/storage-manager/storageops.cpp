@@ -27,10 +27,9 @@ void test_naive_selection() {
     // DbFile::initialize(true);
     // auto cache = PageCache(10);
     // const Table t = Table(table_name, schema, cache);
-    // SeqScan tableScan(t, 4);
-    // NaiveSelection selector(&tableScan, condfn_generator("<")); 
-    // auto res = selector.next();
-    // tableScan.print(res);
+    // NaiveSelection selector(std::make_unique<SeqScan>(t, 4), 0, "<", datatype(10));
+    // DataChunk res;
+    // selector.next(res);
 }
 
 int main() {
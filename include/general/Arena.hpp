@@ -0,0 +1,129 @@
+#pragma once
+
+#include "general/Types.hpp"
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Bump allocator scoped to a single query.
+ * Rows and their value buffers are carved out of large blocks and released all at once
+ * when the arena dies, so operators never free individual rows.
+ * Also usable as a std::pmr::memory_resource so containers can allocate from it.
+ */
+class QueryArena : public std::pmr::memory_resource {
+    public:
+        static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+        // memoryLimit of 0 means unlimited
+        explicit QueryArena(size_t blockSize = DEFAULT_BLOCK_SIZE, size_t memoryLimit = 0) :
+            theBlockSize(blockSize),
+            theMemoryLimit(memoryLimit),
+            theCursor(nullptr),
+            theEnd(nullptr),
+            theBytesUsed(0),
+            theBytesReserved(0),
+            theNumAllocations(0) {}
+
+        ~QueryArena() override { release(); }
+
+        QueryArena(const QueryArena&) = delete;
+        QueryArena& operator=(const QueryArena&) = delete;
+
+        // construct an object inside the arena. Destructors run when the arena is released
+        template<typename T, typename... Args>
+        T* make(Args&&... args) {
+            void* mem = do_allocate(sizeof(T), alignof(T));
+            T* obj = new (mem) T(std::forward<Args>(args)...);
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                theFinalizers.push_back({obj, [](void* p) { static_cast<T*>(p)->~T(); }});
+            }
+            return obj;
+        }
+
+        // drops every object and block in one step
+        void release() {
+            for (auto it = theFinalizers.rbegin(); it != theFinalizers.rend(); ++it) {
+                it->destroy(it->obj);
+            }
+            theFinalizers.clear();
+            for (Block& b : theBlocks) {
+                ::operator delete(b.data, std::align_val_t(alignof(std::max_align_t)));
+            }
+            theBlocks.clear();
+            theCursor = nullptr;
+            theEnd = nullptr;
+            theBytesUsed = 0;
+            theBytesReserved = 0;
+            theNumAllocations = 0;
+        }
+
+        size_t bytes_used() const { return theBytesUsed; }          // bytes handed out to callers
+        size_t bytes_reserved() const { return theBytesReserved; }  // bytes held in blocks
+        size_t num_allocations() const { return theNumAllocations; }
+        size_t memory_limit() const { return theMemoryLimit; }
+
+    protected:
+        void* do_allocate(size_t bytes, size_t align) override {
+            std::byte* p = align_up(theCursor, align);
+            if (theCursor == nullptr || p + bytes > theEnd) {
+                add_block(bytes + align);
+                p = align_up(theCursor, align);
+            }
+            theBytesUsed += (p - theCursor) + bytes;
+            theCursor = p + bytes;
+            theNumAllocations++;
+            return p;
+        }
+
+        // memory only comes back when the whole arena is released
+        void do_deallocate(void*, size_t, size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+    private:
+        struct Block {
+            std::byte*  data;
+            size_t      size;
+        };
+        struct Finalizer {
+            void*   obj;
+            void    (*destroy)(void*);
+        };
+
+        const size_t            theBlockSize;
+        const size_t            theMemoryLimit;
+        std::byte*              theCursor;
+        std::byte*              theEnd;
+        size_t                  theBytesUsed;
+        size_t                  theBytesReserved;
+        size_t                  theNumAllocations;
+        std::vector<Block>      theBlocks;
+        std::vector<Finalizer>  theFinalizers;
+
+        static std::byte* align_up(std::byte* p, size_t align) {
+            uintptr_t addr = reinterpret_cast<uintptr_t>(p);
+            return reinterpret_cast<std::byte*>((addr + align - 1) & ~(uintptr_t)(align - 1));
+        }
+
+        void add_block(size_t minSize) {
+            size_t sz = minSize > theBlockSize ? minSize : theBlockSize;
+            if (theMemoryLimit != 0 && theBytesReserved + sz > theMemoryLimit) {
+                throw std::runtime_error("Query exceeded memory limit of " +
+                                         std::to_string(theMemoryLimit) + " bytes");
+            }
+            std::byte* data = static_cast<std::byte*>(
+                ::operator new(sz, std::align_val_t(alignof(std::max_align_t))));
+            theBlocks.push_back({data, sz});
+            theCursor = data;
+            theEnd = data + sz;
+            theBytesReserved += sz;
+        }
+};
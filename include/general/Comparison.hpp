@@ -3,6 +3,41 @@
 #include "general/Types.hpp"
 #include <stdexcept>
 namespace DB {
+    enum class CompareOp : u8 { EQ, NE, LT, LE, GT, GE };
+
+    inline CompareOp compare_op(const string& cond) {
+        if (cond == "=") return CompareOp::EQ;
+        if (cond == "<>" || cond == "!=") return CompareOp::NE;
+        if (cond == "<") return CompareOp::LT;
+        if (cond == "<=") return CompareOp::LE;
+        if (cond == ">") return CompareOp::GT;
+        if (cond == ">=") return CompareOp::GE;
+        throw std::invalid_argument( "received condition that doesn't exist" );
+    }
+
+    // the operator that gives the same result with its operands swapped
+    inline CompareOp flip_compare_op(CompareOp op) {
+        switch (op) {
+            case CompareOp::LT: return CompareOp::GT;
+            case CompareOp::LE: return CompareOp::GE;
+            case CompareOp::GT: return CompareOp::LT;
+            case CompareOp::GE: return CompareOp::LE;
+            default:            return op;
+        }
+    }
+
+    template <typename T>
+    inline bool compare_values(CompareOp op, const T& a, const T& b) {
+        switch (op) {
+            case CompareOp::EQ: return a == b;
+            case CompareOp::NE: return a != b;
+            case CompareOp::LT: return a < b;
+            case CompareOp::LE: return a <= b;
+            case CompareOp::GT: return a > b;
+            default:            return a >= b;
+        }
+    }
+
     inline CondFn condfn_generator(string cond) {
         if(cond == "="){
             return [=](datatype c, datatype o) { return c == o; };
@@ -6,8 +6,8 @@
 #include <cstring>
 
 
-#define PAGE_SIZE sizeof(Page) + PAGE_DATA_SIZE - sizeof(std::byte*) //4KB Page which replaces data array pointer with page size
-#define PAGE_DATA_SIZE 128 // in bytes
+#define PAGE_SIZE (sizeof(Page)) // header + 4KB of data, what the page cache reads and writes
+#define PAGE_DATA_SIZE 4096 // in bytes
 #define PAGE_FILL 90 //make sure only fill up to 90%
 
 struct Page {
@@ -16,7 +16,7 @@ struct Page {
     u16         ref_count; //how many tables reference this page or is it a database header
     u32         id;
     u32         used_bytes; //byte where stuff can get written in
-    std::byte*  data[PAGE_DATA_SIZE];
+    std::byte   data[PAGE_DATA_SIZE];
 
     Page() : dirty_bit(false), valid_bit(false), ref_count(0), id(0), used_bytes(0) {}
     Page(u32 id) : dirty_bit(false), valid_bit(false), ref_count(0), id(id) {}
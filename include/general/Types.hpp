@@ -5,13 +5,15 @@
 #include <variant>
 #include <functional>
 
+#include "general/Value.hpp"
+
 using u64 = std::uint64_t;
 using u32 = std::uint32_t;
 using u16 = std::uint16_t;
 using u8  = std::uint8_t;
 using size_t = std::size_t;
 using string = std::string;
-using datatype = std::variant<int, float, string, bool, int64_t, double>;
+using datatype = Value;
 using CondFn = std::function<bool(datatype, datatype)>;
 
 
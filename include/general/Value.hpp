@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#define VALUE_INLINE_CHARS 14 // strings up to this long are kept inside the value
+#define VALUE_LONG_STRING 0xFF // size byte of a string kept out of line
+
+/**
+ * One cell of a row in 16 bytes: the payload, a size byte and a tag.
+ * Numbers and strings of up to VALUE_INLINE_CHARS bytes live inside the
+ * value. A longer string lives in an immutable buffer shared by every copy,
+ * which copies only count references to. Copying a value therefore never
+ * allocates, and unless it holds a long string it is a plain 16 byte copy.
+ *
+ * Tags are numbered like the std::variant this replaced (int, float,
+ * string, bool, int64_t, double), index() is the tag heap slots store.
+ * holds<T>, get<T> and visit work like their variant counterparts, except
+ * that a string comes back as a std::string_view into the value.
+ *
+ * A null is the column an outer join had no row for. It is only ever in
+ * query results and the rows operators pass each other, never in a heap
+ * slot. visit sees it as the int 0, like a missing value, but it is equal
+ * only to another null.
+ */
+class Value {
+    public:
+        enum Tag : std::uint8_t { INT, FLOAT, STRING, BOOL, INT64, DOUBLE, NONE };
+
+        Value() : Value(0) {}
+        Value(int v) { store(INT, v); }
+        Value(float v) { store(FLOAT, v); }
+        Value(bool v) { store(BOOL, v); }
+        Value(std::int64_t v) { store(INT64, v); }
+        Value(double v) { store(DOUBLE, v); }
+        Value(std::string_view s) { store_string(s); }
+        Value(const std::string& s) { store_string(s); }
+        Value(const char* s) { store_string(s); }
+
+        Value(const Value& other) { copy_from(other); retain(); }
+        Value(Value&& other) noexcept { copy_from(other); other.store(INT, 0); }
+        Value& operator=(const Value& other) {
+            if (this != &other) {
+                other.retain();
+                release();
+                copy_from(other);
+            }
+            return *this;
+        }
+        Value& operator=(Value&& other) noexcept {
+            if (this != &other) {
+                release();
+                copy_from(other);
+                other.store(INT, 0);
+            }
+            return *this;
+        }
+        ~Value() { release(); }
+
+        static Value null() {
+            Value v;
+            v.theTag = NONE;
+            return v;
+        }
+
+        std::size_t index() const { return theTag; }
+        bool is_null() const { return theTag == NONE; }
+
+        template <typename T>
+        bool holds() const { return theTag == tag_of<T>(); }
+
+        // throws if the value holds another type
+        template <typename T>
+        auto get() const {
+            if (theTag != tag_of<T>()) {
+                throw std::runtime_error("Value does not hold the requested type");
+            }
+            if constexpr (std::is_same_v<T, std::string>) {
+                return str();
+            } else {
+                return load<T>();
+            }
+        }
+
+        // calls f with the value as its C++ type, a string as std::string_view
+        template <typename F>
+        decltype(auto) visit(F&& f) const {
+            switch (theTag) {
+                case FLOAT:  return f(load<float>());
+                case STRING: return f(str());
+                case BOOL:   return f(load<bool>());
+                case INT64:  return f(load<std::int64_t>());
+                case DOUBLE: return f(load<double>());
+                default:     return f(load<int>());
+            }
+        }
+
+        // same type and value, like variant comparison
+        friend bool operator==(const Value& a, const Value& b) {
+            if (a.theTag != b.theTag) {
+                return false;
+            }
+            return a.visit([&](auto v) { return v == b.load_as(v); });
+        }
+
+        // by type first, then by value, like variant comparison
+        friend bool operator<(const Value& a, const Value& b) {
+            if (a.theTag != b.theTag) {
+                return a.theTag < b.theTag;
+            }
+            return a.visit([&](auto v) { return v < b.load_as(v); });
+        }
+        friend bool operator>(const Value& a, const Value& b) { return b < a; }
+        friend bool operator<=(const Value& a, const Value& b) { return !(b < a); }
+        friend bool operator>=(const Value& a, const Value& b) { return !(a < b); }
+
+    private:
+        struct LongString {
+            std::atomic<std::uint32_t>  refs;
+            std::uint32_t               size;
+            char                        data[1];
+        };
+
+        alignas(8) char theData[VALUE_INLINE_CHARS];
+        std::uint8_t    theSize = 0; // length of an inline string, VALUE_LONG_STRING otherwise
+        std::uint8_t    theTag = INT;
+
+        template <typename T>
+        static constexpr Tag tag_of() {
+            if constexpr (std::is_same_v<T, int>) return INT;
+            else if constexpr (std::is_same_v<T, float>) return FLOAT;
+            else if constexpr (std::is_same_v<T, std::string>) return STRING;
+            else if constexpr (std::is_same_v<T, bool>) return BOOL;
+            else if constexpr (std::is_same_v<T, std::int64_t>) return INT64;
+            else {
+                static_assert(std::is_same_v<T, double>, "not a value type");
+                return DOUBLE;
+            }
+        }
+
+        template <typename T>
+        void store(Tag tag, T v) {
+            std::memcpy(theData, &v, sizeof(T));
+            theSize = 0;
+            theTag = tag;
+        }
+
+        template <typename T>
+        T load() const {
+            T v;
+            std::memcpy(&v, theData, sizeof(T));
+            return v;
+        }
+
+        // the value read as the type of like, both hold the same tag
+        template <typename T>
+        T load_as(const T&) const {
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                return str();
+            } else {
+                return load<T>();
+            }
+        }
+
+        void store_string(std::string_view s) {
+            theTag = STRING;
+            if (s.size() <= VALUE_INLINE_CHARS) {
+                std::memcpy(theData, s.data(), s.size());
+                theSize = (std::uint8_t)s.size();
+                return;
+            }
+            LongString* ls = static_cast<LongString*>(::operator new(sizeof(LongString) + s.size()));
+            new (&ls->refs) std::atomic<std::uint32_t>(1);
+            ls->size = (std::uint32_t)s.size();
+            std::memcpy(ls->data, s.data(), s.size());
+            std::memcpy(theData, &ls, sizeof(ls));
+            theSize = VALUE_LONG_STRING;
+        }
+
+        std::string_view str() const {
+            if (theSize != VALUE_LONG_STRING) {
+                return std::string_view(theData, theSize);
+            }
+            LongString* ls = load<LongString*>();
+            return std::string_view(ls->data, ls->size);
+        }
+
+        void copy_from(const Value& other) {
+            std::memcpy(theData, other.theData, sizeof(theData));
+            theSize = other.theSize;
+            theTag = other.theTag;
+        }
+
+        void retain() const {
+            if (theTag == STRING && theSize == VALUE_LONG_STRING) {
+                load<LongString*>()->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void release() {
+            if (theTag == STRING && theSize == VALUE_LONG_STRING) {
+                LongString* ls = load<LongString*>();
+                if (ls->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    ls->refs.~atomic();
+                    ::operator delete(ls);
+                }
+            }
+        }
+};
+
+static_assert(sizeof(Value) == 16, "Value must stay 16 bytes");
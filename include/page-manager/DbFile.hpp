@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include <unordered_map>
 
 #include "general/Page.hpp"
@@ -26,9 +27,14 @@ namespace DB {
             ssize_t write_at(off_t offset, Page& buffer, int fd);
             int     get_filepath(const string& path); //return fd and -1 on failure
             int     add_filepath(const string& path);
+            int     remove_filepath(const string& path); //closes and deletes the file, -1 on failure
+            int     truncate(off_t length, int fd);
+            //writes path.tmp, fsyncs it and renames it over path, then swaps the mapped fd; returns the new fd
+            int     replace_file(const string& path, const void* buffer, size_t num_bytes);
 
             //Force cached data and metadata to storage
             void sync();
+            int  sync(int fd); //fsyncs one file, -1 on failure
             void lock(LockMode mode);    
             void unlock();
             void close();
@@ -36,5 +42,6 @@ namespace DB {
         private:
             int                             theDbFd; //db fd value
             std::unordered_map<string, int> theFdMap;
+            std::mutex                      theFdLock; // LSM trees open and remove files from a background thread
     };
 }
\ No newline at end of file
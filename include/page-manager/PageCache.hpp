@@ -17,16 +17,23 @@ namespace DB {
             const u64 CACHE_SIZE;
             const u32 NUM_PAGES;
             PageCache(u32 numPages);
+            ~PageCache();
+            PageCache(const PageCache&) = delete;
+            PageCache& operator=(const PageCache&) = delete;
 
             Page&                               read(u32 pageId, Page& buffer, const string& filepath); 
             bool                                write_through(Page& page, const string& filepath); // write through
+            void                                invalidate(const string& filepath); // before the file is removed, its fd may be reused
             void                                print();
         private:
             DbFile&                             theDbFile;
-            std::unordered_map<u32, size_t>     thePageMap;
+            std::unordered_map<u64, size_t>     thePageMap; // (fd, page id) => cache slot
             std::stack<size_t>                  theUsedPages;
             Page*                               theCachePages;
+            std::vector<u64>                    theSlotKeys; // key of the page held in each slot
             std::vector<size_t>                 theFreePages;
-            void                                evict_add_page(Page& page);
+            void                                evict_add_page(Page& page, u64 key);
+            static u64                          page_key(int fd, u32 pageId) { return ((u64)(u32)fd << 32) | pageId; }
+            static constexpr u64                NO_PAGE_KEY = ~0ULL; // slot whose page was invalidated
     };
 }
\ No newline at end of file
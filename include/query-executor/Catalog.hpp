@@ -0,0 +1,75 @@
+#pragma once
+
+#include "storage-manager/Table.hpp"
+#include "storage-manager/HeapFile.hpp"
+#include "storage-manager/Partition.hpp"
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#define CATALOG_MAGIC 0x31544143 // "CAT1"
+#define CATALOG_VERSION 4
+#define CATALOG_READAHEAD_PAGES 16 // read with the header, enough for a few hundred tables
+#define CATALOG_PATH "database-files/database.db"
+
+namespace DB {
+
+// page 0 of database.db, the table records follow from page 1 as one stream
+struct CatalogHeader {
+    u32 magic;
+    u32 version;
+    u32 num_tables;
+    u32 data_pages;
+    u64 data_bytes;
+};
+
+// what the catalog keeps for a table, the table itself is opened on first use
+struct CatalogEntry {
+    Schema schema{0};
+    std::vector<IndexDef> indexes;
+    // statistics as of the last save
+    u64 row_count = 0;
+    u64 page_count = 0;
+    std::optional<TableStats> stats; // set by ANALYZE
+    std::optional<PartitionSpec> partitioning; // rows live in the partitions' tables
+    TableEngine engine = TableEngine::HEAP;
+};
+
+/**
+ * System catalog stored in database.db. Startup reads the header and records in
+ * one go and parses only the definitions, heap files and indexes of a table are
+ * opened the first time the table is asked for.
+ */
+class Catalog {
+public:
+    Catalog(); // loads whatever database.db holds, DbFile must be initialized
+    ~Catalog(); // deletes the tables it handed out, with their heap files
+    Catalog(const Catalog&) = delete;
+    Catalog& operator=(const Catalog&) = delete;
+
+    // the catalog owns the table from here on
+    void addTable(const string& name, Table* table,
+                  std::optional<PartitionSpec> partitioning = std::nullopt);
+    Table* getTable(const string& name);
+    bool hasTable(const string& name) const;
+    void removeTable(const string& name); // deletes the table, drop() its files first
+    // opens every table that hasn't been used yet
+    const std::unordered_map<string, Table*>& getAllTables();
+
+    const CatalogEntry* getEntry(const string& name) const;
+    const PartitionSpec* getPartitioning(const string& name) const;
+    void setPartitioning(const string& name, PartitionSpec partitioning); // saves
+    // rewrites the catalog, call after anything that changes a table's definition
+    void save();
+
+private:
+    std::unordered_map<string, CatalogEntry> entries_;
+    std::unordered_map<string, Table*> tables_; // opened so far
+    int fd_;
+
+    void load();
+    static void closeTable(Table* table);
+};
+
+} // namespace DB
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "sql-compiler/SqlAST.hpp"
+#include "general/Comparison.hpp"
+#include "storage-manager/StorageStructs.hpp"
+#include "storage-manager/DataChunk.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace DB {
+
+// Position of the column ref names among schema's columns [from, to), -1 if
+// none. The columns of a join are named ALIAS.COLUMN: a qualified ref matches
+// that name or a plain column of its own name, an unqualified one matches
+// either form, the first one found.
+int findColumn(const Schema& schema, const Expression& ref, size_t from = 0, size_t to = SIZE_MAX);
+
+/**
+ * An expression compiled once per query into a flat program over numbered
+ * registers, so evaluating it on a row is a loop over instructions instead of
+ * a walk of the expression tree. Column references are resolved to their
+ * position in the schema and literals converted to datatypes when the
+ * expression is compiled. A literal is put in its own register then, no
+ * instruction writes it again. AND and OR jump past their right side once the
+ * left decides the result.
+ *
+ * A column missing from the schema is the int 0. One missing from the row,
+ * or null in it, is a null: comparing a null, or looking it up with IN, is
+ * false, and only IS NULL is true of it. AND, OR and NOT treat anything but
+ * a bool as false, so NOT of a comparison with a null is true. Unary minus
+ * negates a number and is null of anything else, operators it doesn't know
+ * evaluate to false.
+ * Evaluating writes the registers, so a compiled expression is used by one
+ * thread at a time.
+ */
+class CompiledExpr {
+public:
+    CompiledExpr() : CompiledExpr(nullptr, Schema(0)) {}
+    CompiledExpr(const ExprPtr& expr, const Schema& schema);
+
+    const datatype& evaluate(const Row* row);
+    const datatype& evaluate(const DataChunk& chunk, u32 row);
+    // on the row a join makes of left and right, right's columns start at left_width
+    const datatype& evaluate(const Row* left, const Row* right, size_t left_width);
+
+    // whether the expression is the bool true
+    bool test(const Row* row) { return isTrue(evaluate(row)); }
+    bool test(const DataChunk& chunk, u32 row) { return isTrue(evaluate(chunk, row)); }
+    bool test(const Row* left, const Row* right, size_t left_width) {
+        return isTrue(evaluate(left, right, left_width));
+    }
+
+    // a literal expression as the value it evaluates to
+    static datatype literalValue(const ExprPtr& expr);
+
+private:
+    enum class OpCode : u8 {
+        COLUMN,         // dst = column a of the row
+        COMPARE,        // dst = a cmp b, false if either is null
+        TRUTH,          // dst = a is the bool true
+        NOT,            // dst = a is not the bool true
+        IS_NULL,        // dst = a is null
+        IS_NOT_NULL,    // dst = a is not null
+        NEGATE,         // dst = -a, null unless a is a number
+        IN,             // dst = a equals one of the n registers listed from operands_[b], false if a is null
+        JUMP_IF_FALSE,  // go to b when the bool a is false
+        JUMP_IF_TRUE,   // go to b when the bool a is true
+    };
+
+    struct Instruction {
+        OpCode code;
+        CompareOp cmp;
+        u32 dst;
+        u32 a;
+        u32 b;
+        u32 n;
+    };
+
+    std::vector<Instruction> code_;
+    std::vector<u32> operands_;
+    std::vector<datatype> registers_; // literals and the result of every instruction
+    u32 result_;
+
+    static bool isTrue(const datatype& val) { return val.holds<bool>() && val.get<bool>(); }
+    static datatype negate(const datatype& val);
+
+    u32 compile(const ExprPtr& expr, const Schema& schema);
+    u32 constant(datatype val);
+    u32 allocate();
+    void emit(OpCode code, u32 dst, u32 a = 0, u32 b = 0, u32 n = 0, CompareOp cmp = CompareOp::EQ);
+
+    template <typename Load>
+    const datatype& run(const Load& load);
+};
+
+} // namespace DB
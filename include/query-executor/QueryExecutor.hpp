@@ -1,14 +1,19 @@
 #pragma once
 
 #include "sql-compiler/SqlAST.hpp"
+#include "query-executor/Catalog.hpp"
 #include "sql-compiler/Parser.hpp"
 #include "storage-manager/Table.hpp"
 #include "storage-manager/HeapFile.hpp"
 #include "storage-manager/ops/StorageOps.hpp"
 #include "storage-manager/ops/Selection.hpp"
+#include "query-executor/CompiledExpr.hpp"
 
+#include <deque>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
+#include <optional>
 #include <functional>
 #include <stdexcept>
 
@@ -16,11 +21,14 @@ namespace DB {
 
 struct QueryResult {
     std::vector<string> column_names;
-    std::vector<Row*> rows;
+    std::vector<Row*> rows; // owned by arena, valid for as long as the result (or a copy) lives
+    std::shared_ptr<QueryArena> arena;
     bool success = true;
     string error_message;
     int64_t rows_affected = 0;
 
+    size_t memory_used() const { return arena ? arena->bytes_used() : 0; }
+
     void print() const {
         if (!success) {
             std::cout << "Error: " << error_message << std::endl;
@@ -42,16 +50,20 @@ struct QueryResult {
         for (const auto& row : rows) {
             for (size_t i = 0; i < row->values.size(); i++) {
                 if (i > 0) std::cout << " | ";
-                std::visit([](auto&& val) {
+                if (row->values[i].is_null()) {
+                    std::cout << "NULL";
+                    continue;
+                }
+                row->values[i].visit([](auto&& val) {
                     using T = std::decay_t<decltype(val)>;
-                    if constexpr (std::is_same_v<T, string>) {
+                    if constexpr (std::is_same_v<T, std::string_view>) {
                         std::cout << val;
                     } else if constexpr (std::is_same_v<T, bool>) {
                         std::cout << (val ? "true" : "false");
                     } else {
                         std::cout << val;
                     }
-                }, row->values[i]);
+                });
             }
             std::cout << std::endl;
         }
@@ -59,99 +71,128 @@ struct QueryResult {
     }
 };
 
-class Catalog {
-public:
-    void addTable(const string& name, Table* table) {
-        tables_[name] = table;
-    }
-
-    Table* getTable(const string& name) {
-        auto it = tables_.find(name);
-        if (it == tables_.end()) {
-            return nullptr;
-        }
-        return it->second;
-    }
-
-    bool hasTable(const string& name) const {
-        return tables_.find(name) != tables_.end();
-    }
-
-    void removeTable(const string& name) {
-        tables_.erase(name);
-    }
-
-    const std::unordered_map<string, Table*>& getAllTables() const {
-        return tables_;
-    }
-
-private:
-    std::unordered_map<string, Table*> tables_;
-};
-
 class QueryExecutor {
 public:
     QueryExecutor(Catalog& catalog);
     QueryResult execute(const string& sql);
     QueryResult executeRA(const RANodePtr& ra_tree);
 
+    // caps the arena of each query, 0 means unlimited
+    void setQueryMemoryLimit(size_t bytes) { query_memory_limit_ = bytes; }
+
 private:
     Catalog& catalog_;
-
-    StorageOps* buildOperatorTree(const RANodePtr& node);
+    size_t query_memory_limit_ = 0;
+    bool scan_all_columns_ = true;
+    std::unordered_set<string> scan_columns_; // columns the current query reads
+    std::deque<Schema> join_schemas_; // schemas of the joins in the current query
+
+    StorageOpsPtr buildOperatorTree(const RANodePtr& node, QueryArena* arena);
+    const Schema* outputSchema(const RANodePtr& node);
+    StorageOpsPtr planJoin(const RANodePtr& node, StorageOpsPtr left, StorageOpsPtr right,
+                           const Schema& schema, size_t left_width, QueryArena* arena);
+    StorageOpsPtr planScan(Table* table, const RANodePtr& scan_node);
+    StorageOpsPtr planIndexScan(Table* table, const ExprPtr& predicate);
+    StorageOpsPtr planBitmapScan(Table* table, const ExprPtr& predicate);
     QueryResult executeSelect(const RANodePtr& node);
     QueryResult executeInsert(const RANodePtr& node);
     QueryResult executeUpdate(const RANodePtr& node);
     QueryResult executeDelete(const RANodePtr& node);
     QueryResult executeCreateTable(const RANodePtr& node);
     QueryResult executeDropTable(const RANodePtr& node);
+    QueryResult executeCreateIndex(const RANodePtr& node);
+    QueryResult executeVacuum(const RANodePtr& node);
+    QueryResult executeAnalyze(const RANodePtr& node);
+    QueryResult executeAlterTable(const RANodePtr& node);
+    Table* createStorage(const string& name, Schema& schema, TableEngine engine);
+    void createPartitionedTable(const RANodePtr& node, Schema& schema, TableEngine engine);
+    Table* createPartition(const string& name, const PartitionSpec& spec, size_t i, const Schema& parent,
+                           TableEngine engine);
+    Table* storageTable(const string& name, const PartitionSpec& spec, size_t i);
+    std::vector<Table*> storageTables(const string& name, const ExprPtr& predicate);
+    std::vector<std::pair<Table*, std::vector<Row*>>> routeRows(const string& name, Table* table,
+                                                                const std::vector<Row*>& rows);
+    void refreshStatistics(Table* table);
     datatype evaluateExpression(const ExprPtr& expr, Row* row, const Schema& schema);
     bool evaluatePredicate(const ExprPtr& pred, Row* row, const Schema& schema);
+    std::vector<Row*> scanMatching(Table* table, const ExprPtr& predicate, QueryArena* arena);
     int getColumnIndex(const Schema& schema, const string& column_name);
 };
 
 class ProjectOp : public StorageOps {
 public:
-    ProjectOp(StorageOps* child, const std::vector<ExprPtr>& projections,
+    ProjectOp(StorageOpsPtr child, const std::vector<ExprPtr>& projections,
               const Schema& schema);
 
     void open() override;
-    std::vector<Row*> next() override;
+    bool next(DataChunk& out) override;
     void close() override;
 
 private:
-    StorageOps* child_;
+    StorageOpsPtr child_;
     std::vector<ExprPtr> projections_;
     const Schema& schema_;
+    std::vector<size_t> columns_; // schema position of each projected column
 };
 
 class FilterOp : public StorageOps {
 public:
-    FilterOp(StorageOps* child, const ExprPtr& predicate, const Schema& schema);
+    FilterOp(StorageOpsPtr child, const ExprPtr& predicate, const Schema& schema);
 
     void open() override;
-    std::vector<Row*> next() override;
+    bool next(DataChunk& out) override;
     void close() override;
 
+    // for single rows, outside an operator tree
+    bool evaluatePredicate(Row* row);
+    datatype evaluateExpression(const ExprPtr& expr, Row* row);
+
 private:
-    StorageOps* child_;
+    struct ColumnComparison {
+        size_t column;
+        CompareOp op;
+        datatype value;
+    };
+
+    StorageOpsPtr child_;
     ExprPtr predicate_;
     const Schema& schema_;
+    std::vector<ColumnComparison> comparisons_; // run before predicate_, a chunk column at a time
+    CompiledExpr compiled_; // predicate_, compiled again whenever it changes
+    bool pushed_down_ = false;
+
+    void pushdownZoneRanges();
+    void pushdownStringPredicates();
+    bool toStringPredicate(const ExprPtr& expr, StringPredicate& out);
+    void extractComparisons();
+    bool toComparison(const ExprPtr& expr, ColumnComparison& out);
+};
 
-    bool evaluatePredicate(Row* row);
-    datatype evaluateExpression(const ExprPtr& expr, Row* row);
+// Rows of several inputs one after the other, the partitions of a partitioned
+// table. Each input is opened when the one before it is exhausted
+class AppendOp : public StorageOps {
+public:
+    AppendOp(std::vector<StorageOpsPtr> children);
+
+    void open() override;
+    bool next(DataChunk& out) override;
+    void close() override;
+
+private:
+    std::vector<StorageOpsPtr> children_;
+    size_t current_;
 };
 
 class LimitOp : public StorageOps {
 public:
-    LimitOp(StorageOps* child, int64_t limit, int64_t offset);
+    LimitOp(StorageOpsPtr child, int64_t limit, int64_t offset);
 
     void open() override;
-    std::vector<Row*> next() override;
+    bool next(DataChunk& out) override;
     void close() override;
 
 private:
-    StorageOps* child_;
+    StorageOpsPtr child_;
     int64_t limit_;
     int64_t offset_;
     int64_t current_offset_;
@@ -160,47 +201,124 @@ private:
 
 class CrossProductOp : public StorageOps {
 public:
-    CrossProductOp(StorageOps* left, StorageOps* right);
+    CrossProductOp(StorageOpsPtr left, StorageOpsPtr right, size_t left_width, QueryArena* arena = nullptr);
 
     void open() override;
-    std::vector<Row*> next() override;
+    bool next(DataChunk& out) override;
     void close() override;
 
 private:
-    StorageOps* left_;
-    StorageOps* right_;
+    StorageOpsPtr left_;
+    StorageOpsPtr right_;
+    size_t left_width_; // columns of the left input, the right one's start after them
     std::vector<Row*> left_rows_;
     std::vector<Row*> right_rows_;
     size_t left_idx_;
     size_t right_idx_;
     bool initialized_;
+    QueryArena* arena_;
 };
 
+// Joins on a condition without an equality between the inputs' columns, every
+// pair of rows is tested. schema is the join's, the left input's columns and
+// then the right one's
 class NestedLoopJoin : public StorageOps {
 public:
-    NestedLoopJoin(StorageOps* left, StorageOps* right,
+    NestedLoopJoin(StorageOpsPtr left, StorageOpsPtr right,
                    const ExprPtr& condition, RANodeType join_type,
-                   const Schema& left_schema, const Schema& right_schema);
+                   const Schema& schema, size_t left_width,
+                   QueryArena* arena = nullptr);
 
     void open() override;
-    std::vector<Row*> next() override;
+    bool next(DataChunk& out) override;
     void close() override;
 
 private:
-    StorageOps* left_;
-    StorageOps* right_;
+    StorageOpsPtr left_;
+    StorageOpsPtr right_;
     ExprPtr condition_;
+    CompiledExpr compiled_;
     RANodeType join_type_;
-    const Schema& left_schema_;
-    const Schema& right_schema_;
+    const Schema& schema_;
+    size_t left_width_;
     std::vector<Row*> left_rows_;
     std::vector<Row*> right_rows_;
+    std::vector<bool> right_matched_; // for RIGHT and FULL joins
+    bool left_matched_;               // whether the current left row matched
     size_t left_idx_;
     size_t right_idx_;
+    size_t unmatched_idx_;
     bool initialized_;
+    QueryArena* arena_;
+    Row empty_row_{0, std::vector<datatype>{}}; // the missing side of an outer join's row
 
     bool evaluateCondition(Row* left_row, Row* right_row);
-    Row* combineRows(Row* left_row, Row* right_row);
+};
+
+/**
+ * Equi-join of two inputs on left_keys[i] = right_keys[i], for every join type.
+ * The input that ends first when both are read a chunk at a time in turns is
+ * the smaller one, its rows go in a hash table on their keys. The other input
+ * is then streamed through in chunks, the rows already read of it first, and
+ * only the rows of its current chunk are kept. residual holds the rest of the
+ * ON condition, tested on the pairs whose keys match.
+ *
+ * Keys compare like `=` does. A missing value, and the columns of the side
+ * an outer join has no row for, are nulls and a null key matches nothing.
+ */
+class HashJoinOp : public StorageOps {
+public:
+    HashJoinOp(StorageOpsPtr left, StorageOpsPtr right,
+               std::vector<size_t> left_keys, std::vector<size_t> right_keys,
+               const ExprPtr& residual, RANodeType join_type,
+               const Schema& schema, size_t left_width,
+               QueryArena* arena = nullptr);
+
+    void open() override;
+    bool next(DataChunk& out) override;
+    void close() override;
+
+private:
+    static constexpr u32 NO_ROW = UINT32_MAX;
+
+    StorageOpsPtr left_;
+    StorageOpsPtr right_;
+    std::vector<size_t> left_keys_;
+    std::vector<size_t> right_keys_;
+    ExprPtr residual_;
+    CompiledExpr compiled_;
+    RANodeType join_type_;
+    size_t width_;      // columns of the joined rows
+    size_t left_width_;
+    QueryArena* arena_;
+    QueryArena scratch_; // rows of the probe chunk being joined
+
+    bool initialized_;
+    bool build_left_;       // whether the left input is the one hashed
+    bool preserve_build_;   // outer join rows for the build rows nothing matched
+    bool preserve_probe_;   // and for the probe rows nothing matched
+    std::vector<Row*> build_rows_;
+    std::vector<u64> build_hashes_;
+    std::vector<bool> build_matched_;
+    std::vector<u32> buckets_;  // first build row of each bucket, NO_ROW if empty
+    std::vector<u32> chain_;    // next build row in the same bucket
+    u64 mask_;
+
+    std::vector<Row*> probe_rows_;
+    size_t probe_idx_;
+    bool probing_;          // whether the current probe row's bucket was looked up
+    bool probe_matched_;
+    bool probe_done_;
+    u64 probe_hash_;
+    u32 match_;             // next build row to compare the current probe row with
+    size_t unmatched_idx_;
+    DataChunk probe_chunk_;
+    Row empty_row_{0, std::vector<datatype>{}};
+
+    void build();
+    bool fetchProbe();
+    bool keysEqual(const Row* build, const Row* probe) const;
+    void emit(DataChunk& out, const Row* build, const Row* probe);
 };
 
 } // namespace DB
@@ -37,6 +37,13 @@ private:
   RANodePtr parse_delete_statement();
   RANodePtr parse_create_table_statement();
   RANodePtr parse_drop_table_statement();
+  RANodePtr parse_vacuum_statement();
+  RANodePtr parse_analyze_statement();
+  void parse_tablesample(RANodePtr &scan);
+  void parse_partition_by(RANodePtr &node);
+  PartitionClause parse_range_partition();
+  RANodePtr parse_alter_table_statement();
+  RANodePtr parse_create_index_statement();
 
   struct SelectInfo {
     bool is_distinct = false;
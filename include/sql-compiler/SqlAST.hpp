@@ -5,6 +5,7 @@
 #include <deque>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <variant>
 #include <vector>
@@ -213,7 +214,12 @@ enum class RANodeType {
   DELETE_OP,
 
   CREATE_TABLE_OP,
-  DROP_TABLE_OP
+  DROP_TABLE_OP,
+  CREATE_INDEX_OP,
+  ALTER_TABLE_OP,
+
+  VACUUM_OP,
+  ANALYZE_OP
 };
 
 struct SortSpec {
@@ -228,9 +234,15 @@ struct ColumnDef {
   string type_name;
   bool nullable = true;
   bool primary_key = false;
+  bool unique = false;
   ExprPtr default_value;
 };
 
+struct PartitionClause {
+  string name;
+  ExprPtr upper; // VALUES LESS THAN, null means MAXVALUE or a HASH partition
+};
+
 struct RANode;
 using RANodePtr = std::shared_ptr<RANode>;
 
@@ -265,6 +277,23 @@ struct RANode {
 
   std::vector<ColumnDef> column_defs;
 
+  string index_name;
+  std::vector<string> index_columns;
+  string index_method; // BTREE, HASH or BITMAP, empty means BTREE
+
+  string sample_method; // TABLESAMPLE SYSTEM or BERNOULLI, empty means no sampling
+  double sample_percent = 100;
+  std::optional<int64_t> sample_seed; // REPEATABLE (seed)
+
+  string table_engine; // ENGINE of CREATE TABLE, HEAP, LSM or CLUSTERED, empty means HEAP
+  string cluster_column; // CLUSTERED BY (col), the rows are kept in its order
+
+  // PARTITION BY of CREATE TABLE, or the partition ALTER TABLE adds or drops
+  string partition_method; // RANGE or HASH, empty means not partitioned
+  string partition_column;
+  std::vector<PartitionClause> partitions;
+  string alter_action; // ADD PARTITION or DROP PARTITION
+
   RANodePtr left;
   RANodePtr right;
 
@@ -422,6 +451,14 @@ inline string ra_type_to_string(RANodeType type) {
     return "CreateTable";
   case RANodeType::DROP_TABLE_OP:
     return "DropTable";
+  case RANodeType::CREATE_INDEX_OP:
+    return "CreateIndex";
+  case RANodeType::ALTER_TABLE_OP:
+    return "AlterTable";
+  case RANodeType::VACUUM_OP:
+    return "Vacuum";
+  case RANodeType::ANALYZE_OP:
+    return "Analyze";
   default:
     return "Unknown";
   }
@@ -550,6 +587,9 @@ inline void ra_tree_print_helper(const RANodePtr &node,
     std::cout << " [" << node->table_name;
     if (!node->table_alias.empty() && node->table_alias != node->table_name)
       std::cout << " AS " << node->table_alias;
+    if (!node->sample_method.empty())
+      std::cout << " TABLESAMPLE " << node->sample_method << " ("
+                << node->sample_percent << ")";
     std::cout << "]";
     break;
   case RANodeType::PROJECT:
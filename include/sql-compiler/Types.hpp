@@ -16,7 +16,8 @@ namespace DB {
         "EXISTS", "ANY", "ALL", "WITH", "EXCEPT", "UNION",
         "CAST", "CASE", "WHEN", "THEN", "ELSE", "END",
         "ASC", "DESC", "LIMIT", "CROSS", "NATURAL", "LIKE",
-        "TRUE", "FALSE", "AND", "OR", "NULLS"
+        "TRUE", "FALSE", "AND", "OR", "NULLS", "VACUUM", "INDEX", "ANALYZE",
+        "TABLESAMPLE", "REPEATABLE"
     };
 
     const std::unordered_set<string> sql_ops = {
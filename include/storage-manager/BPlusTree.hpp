@@ -0,0 +1,79 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "general/Page.hpp"
+#include "storage-manager/StorageStructs.hpp"
+#include "storage-manager/Index.hpp"
+#include "page-manager/PageCache.hpp"
+
+#include <vector>
+
+#define BTREE_MAGIC 0x31545042 // "BPT1"
+#define BTREE_NULL_PAGE 0 // page 0 is the index header, so it is never a node
+
+namespace DB {
+    /**
+     * Disk based B+tree mapping column values to row ids, one node per page
+     * read and written through a PageCache. Leaves are chained left to right
+     * for range scans. Deletes don't merge underfull nodes, emptied leaves
+     * stay in the chain and are skipped by iterators.
+     */
+    class BPlusTree : public Index {
+        public:
+            struct Node {
+                bool                    leaf = true;
+                u32                     next = BTREE_NULL_PAGE;  // right sibling of a leaf
+                std::vector<IndexEntry> entries;                 // separators for internal nodes
+                std::vector<u32>        children;                // entries.size() + 1 for internal nodes
+            };
+
+            class Iterator {
+                public:
+                    bool                valid() const { return theTree != nullptr && thePos < theLeaf.entries.size(); }
+                    void                next();
+                    const IndexKey&     key() const { return theLeaf.entries[thePos].key; }
+                    const RowId&        rid() const { return theLeaf.entries[thePos].rid; }
+
+                private:
+                    friend class BPlusTree;
+                    const BPlusTree*    theTree = nullptr;
+                    Node                theLeaf;
+                    size_t              thePos = 0;
+
+                    void                skip_empty();
+            };
+
+            BPlusTree(const string& path, ColumnType keyType, PageCache& cache);
+
+            void                create() override;
+            bool                open() override;
+            void                bulk_build(std::vector<IndexEntry>& entries) override;
+            void                insert(const IndexKey& key, const RowId& rid) override;
+            bool                remove(const IndexKey& key, const RowId& rid) override;
+            std::vector<RowId>  lookup(const IndexKey& key) const override;
+            std::vector<std::vector<RowId>> lookup_many(const std::vector<IndexKey>& keys) const override;
+            IndexType           type() const override { return IndexType::BTREE; }
+            Iterator            seek(const IndexKey& key) const; // first entry with key >= key
+            Iterator            begin() const;
+
+            ColumnType          key_type() const { return theKeyType; }
+            u32                 height() const { return theHeight; }
+            u32                 num_pages() const { return theNumPages; }
+            const string&       path() const { return thePath; }
+
+        private:
+            const string    thePath;
+            ColumnType      theKeyType;
+            PageCache&      theCache;
+            u32             theRoot = BTREE_NULL_PAGE;
+            u32             theNumPages = 1;
+            u32             theHeight = 0;
+
+            Node            read_node(u32 pageId) const;
+            void            write_node(u32 pageId, const Node& node);
+            void            write_header();
+            u32             alloc_page() { return theNumPages++; }
+            u32             find_leaf(const IndexEntry& entry) const;
+            bool            insert_into(u32 pageId, const IndexEntry& entry, IndexEntry& sep, u32& newPage);
+    };
+}
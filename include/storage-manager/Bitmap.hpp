@@ -0,0 +1,50 @@
+#pragma once
+
+#include "general/Types.hpp"
+
+#include <vector>
+
+#define ROARING_ARRAY_MAX 4096    // containers holding more values switch to a bitset
+#define ROARING_BITSET_WORDS 1024 // 65536 bits, one per low 16 bit value
+
+namespace DB {
+    /**
+     * Compressed set of u32 positions (roaring layout). Positions are split by
+     * their high 16 bits into containers, a sparse container is a sorted u16
+     * array and a dense one a 8KB bitset. Bitset against bitset AND, OR and
+     * AND NOT run a whole vector register of words at a time.
+     */
+    class RoaringBitmap {
+        public:
+            void                add(u32 pos);
+            bool                remove(u32 pos);
+            bool                contains(u32 pos) const;
+            u64                 cardinality() const;
+            bool                empty() const { return theContainers.empty(); }
+
+            RoaringBitmap&      operator&=(const RoaringBitmap& other);
+            RoaringBitmap&      operator|=(const RoaringBitmap& other);
+            RoaringBitmap&      operator-=(const RoaringBitmap& other); // AND NOT
+
+            std::vector<u32>    to_vector() const; // ascending
+            void                serialize(std::vector<u8>& out) const;
+            size_t              deserialize(const u8* data, size_t size); // bytes read, 0 if malformed
+
+        private:
+            struct Container {
+                u16                 key;
+                bool                bitset = false;
+                u32                 card = 0;
+                std::vector<u16>    values; // sorted, for array containers
+                std::vector<u64>    words;  // ROARING_BITSET_WORDS, for bitset containers
+            };
+
+            std::vector<Container>  theContainers; // sorted by key
+
+            Container*          find(u16 key);
+            const Container*    find(u16 key) const;
+            static void         to_bitset(Container& c);
+            static void         to_array(Container& c);
+            static void         normalize(Container& c);
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "storage-manager/Index.hpp"
+#include "storage-manager/Bitmap.hpp"
+#include "storage-manager/HeapFile.hpp"
+
+#include <map>
+#include <optional>
+#include <vector>
+
+#define BITMAP_INDEX_MAGIC 0x31504d42 // "BMP1"
+#define BITMAP_LOG_COMPACT 16384 // logged changes before the snapshot is rewritten
+
+namespace DB {
+    /**
+     * Bitmap index for low cardinality columns, one RoaringBitmap of row
+     * positions (page * SLOTS_PER_PAGE + slot) per distinct value, all held in
+     * memory. The file is a snapshot of every bitmap followed by a log of the
+     * single row changes made since, [op u8][key][position u32] each, which is
+     * folded back into a new snapshot once it gets long.
+     */
+    class BitmapIndex : public Index {
+        public:
+            BitmapIndex(const string& path, ColumnType keyType);
+
+            void                create() override;
+            bool                open() override;
+            void                bulk_build(std::vector<IndexEntry>& entries) override;
+            void                insert(const IndexKey& key, const RowId& rid) override;
+            bool                remove(const IndexKey& key, const RowId& rid) override;
+            std::vector<RowId>  lookup(const IndexKey& key) const override;
+            IndexType           type() const override { return IndexType::BITMAP; }
+
+            // rows whose value is in [low, high], either bound may be open
+            RoaringBitmap       match(const std::optional<IndexKey>& low,
+                                      const std::optional<IndexKey>& high) const;
+            RoaringBitmap       all() const; // every indexed row, what NOT is taken against
+            size_t              num_values() const { return theBitmaps.size(); }
+            ColumnType          key_type() const { return theKeyType; }
+
+            static u32          position(const RowId& rid);
+            RowId               row_id(u32 pos) const;
+
+        private:
+            struct KeyLess {
+                bool operator()(const IndexKey& a, const IndexKey& b) const { return compare_keys(a, b) < 0; }
+            };
+
+            const string        thePath;
+            ColumnType          theKeyType;
+            int                 theFd = -1;
+            u64                 theHeapId = 0;
+            off_t               theLogEnd = 0;
+            u32                 theLogRecords = 0;
+            std::map<IndexKey, RoaringBitmap, KeyLess> theBitmaps;
+
+            void                write_snapshot();
+            void                append_log(u8 op, const IndexKey& key, u32 pos);
+            void                apply(u8 op, const IndexKey& key, u32 pos);
+    };
+}
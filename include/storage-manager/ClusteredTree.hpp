@@ -0,0 +1,71 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "general/Page.hpp"
+#include "storage-manager/KeyedStore.hpp"
+#include "page-manager/PageCache.hpp"
+
+#include <vector>
+
+#define CLUSTERED_MAGIC 0x31544f49 // "IOT1"
+#define CLUSTERED_NULL_PAGE 0 // page 0 is the header, so it is never a node
+#define CLUSTERED_CACHE_PAGES 256
+#define CLUSTERED_MAX_KEY 256 // bytes of an encoded key
+#define CLUSTERED_MAX_RECORD (PAGE_DATA_SIZE / 4) // key and row together, so a split always leaves both halves room
+
+namespace DB {
+    /**
+     * Index organized table: a B+tree on the primary key whose leaves hold
+     * the rows themselves, so rows are stored in key order. A point lookup
+     * ends in the leaf that holds the row and a key range is read by
+     * following the leaf chain. Nodes hold variable length records and split
+     * by bytes. Like BPlusTree, deletes don't merge nodes, VACUUM rebuilds the
+     * tree with every page filled to PAGE_FILL.
+     *
+     * The file is database-files/heapfiles/<name>.clustered.
+     */
+    class ClusteredTree : public KeyedStore {
+        public:
+            struct Node {
+                bool                            leaf = true;
+                u32                             next = CLUSTERED_NULL_PAGE; // right sibling of a leaf
+                std::vector<string>             keys;     // separators for internal nodes
+                std::vector<std::vector<u8>>    values;   // rows of a leaf
+                std::vector<u32>                children; // keys.size() + 1 for internal nodes
+
+                size_t                          bytes() const; // size once written to a page
+            };
+
+            // create starts out empty, removing what an earlier table of that name left
+            ClusteredTree(const string& name, bool create);
+
+            void                            write(const std::vector<KeyedWrite>& batch) override;
+            std::optional<std::vector<u8>>  get(const string& key) const override;
+            void                            scan(const std::optional<string>& low, const std::optional<string>& high,
+                                                 const std::function<bool(const string&, const std::vector<u8>&)>& visit) const override;
+            // rebuilds the tree from its rows, dropping emptied leaves
+            u64                             compact_all() override;
+            void                            drop() override;
+
+            u32                             height() const { return theHeight; }
+            u32                             num_pages() const { return theNumPages; }
+
+        private:
+            const string            thePath;
+            mutable PageCache       theCache;
+            u32                     theRoot = CLUSTERED_NULL_PAGE;
+            u32                     theNumPages = 1;
+            u32                     theHeight = 0;
+
+            Node                    read_node(u32 pageId) const;
+            void                    write_node(u32 pageId, const Node& node);
+            void                    write_header();
+            u32                     alloc_page() { return theNumPages++; }
+            u32                     find_leaf(const string& key) const;
+            u32                     first_leaf() const;
+            bool                    insert_into(u32 pageId, const string& key, const std::vector<u8>& value,
+                                                string& sep, u32& newPage);
+            bool                    remove(const string& key);
+            void                    build(const std::vector<std::pair<string, std::vector<u8>>>& rows);
+    };
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "general/Arena.hpp"
+#include "storage-manager/StorageStructs.hpp"
+
+#include <vector>
+
+#define CHUNK_CAPACITY 1024 // rows a scan puts in one chunk
+
+namespace DB {
+    /**
+     * The values of one column of a chunk. A column whose values all carry
+     * the same tag keeps them as a packed array of that C++ type, strings
+     * are kept as values so long ones stay shared. A column that gets values
+     * of more than one tag, say ints and floats written through SQL literals
+     * into a DOUBLE column, turns MIXED and keeps every value as it came.
+     *
+     * Missing values and null values are nulls, a bit each in the null mask.
+     * A null still takes its place in the array so row i is always at index i.
+     */
+    class ColumnVector {
+        public:
+            // numbered like the value tags, UNTYPED until the first non null value
+            enum Kind : u8 { INT, FLOAT, STRING, BOOL, INT64, DOUBLE, MIXED, UNTYPED };
+
+            void        reset();
+            void        append(const datatype& val);
+            void        append_null();
+
+            datatype    get(size_t row) const;
+            bool        is_null(size_t row) const {
+                return row / 64 < theNulls.size() && (theNulls[row / 64] >> (row % 64)) & 1;
+            }
+            bool        has_nulls() const { return !theNulls.empty(); }
+            size_t      size() const { return theSize; }
+            Kind        kind() const { return theKind; }
+
+            // the packed values of an INT, FLOAT, BOOL, INT64 or DOUBLE column
+            template <typename T>
+            const T*    data() const { return reinterpret_cast<const T*>(theData.data()); }
+            // the values of a STRING or MIXED column
+            const std::vector<datatype>& values() const { return theValues; }
+            // bit i of word i / 64 set means row i is null, empty when none is
+            const std::vector<u64>& nulls() const { return theNulls; }
+
+        private:
+            Kind                    theKind = UNTYPED;
+            size_t                  theSize = 0;
+            std::vector<u8>         theData;
+            std::vector<datatype>   theValues;
+            std::vector<u64>        theNulls;
+
+            static size_t   width(Kind kind);
+            void            set_kind(Kind kind);
+            void            promote();
+    };
+
+    /**
+     * A batch of rows passed between operators, stored column by column.
+     * Operators that only drop rows, a filter or a limit, don't copy
+     * anything: they narrow the selection, the positions of the rows that
+     * are still in the batch. Without a selection every row is.
+     */
+    class DataChunk {
+        public:
+            // empties the chunk for numCols columns, buffers keep their capacity
+            void        reset(size_t numCols);
+            // a row with more values than columns adds columns, fewer leaves nulls
+            void        append_row(const Row& row);
+            // the values of left followed by those of right from column rightFirst
+            // on, the columns left's row doesn't fill are nulls
+            void        append_joined(const Row& left, const Row& right, size_t rightFirst);
+
+            size_t      num_cols() const { return theColumns.size(); }
+            size_t      count() const { return theCount; } // rows held, selected or not
+            size_t      selected() const { return theSelected ? theSelection.size() : theCount; }
+            // position of the i-th selected row
+            u32         row(size_t i) const { return theSelected ? theSelection[i] : (u32)i; }
+            const RowId& row_id(u32 row) const { return theIds[row]; }
+
+            ColumnVector&       column(size_t col) { return theColumns[col]; }
+            const ColumnVector& column(size_t col) const { return theColumns[col]; }
+            datatype    get(size_t col, u32 row) const { return theColumns[col].get(row); }
+            bool        is_null(size_t col, u32 row) const { return theColumns[col].is_null(row); }
+
+            // keeps only the rows at the given positions, ascending and selected now
+            void        select(std::vector<u32> rows);
+            // keeps the selected rows [offset, offset + n)
+            void        slice(size_t offset, size_t n);
+            // columns become the given ones of this chunk, in that order
+            void        project(const std::vector<size_t>& cols);
+
+            // the values up to the row's last non null one, like the row they came
+            // from, or every column with allColumns. Nulls before that are null values
+            Row*        to_row(u32 row, QueryArena* arena = nullptr, bool allColumns = false) const;
+
+        private:
+            std::vector<ColumnVector>   theColumns;
+            std::vector<RowId>          theIds;
+            std::vector<u32>            theSelection;
+            bool                        theSelected = false;
+            size_t                      theCount = 0;
+
+            void    append_values(const Row& row, size_t first);
+            void    finish_row(const RowId& id);
+    };
+}
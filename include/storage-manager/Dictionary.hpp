@@ -0,0 +1,46 @@
+#pragma once
+
+#include "general/Types.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+#define DICT_MAX_ENTRIES 4096 // past this a column is high cardinality and new values stay inline
+#define DICT_MAX_VALUE_LEN 32 // longer strings are unlikely to repeat, keep them out of the dictionary
+#define DICT_NO_CODE -1
+
+namespace DB {
+    // Maps the distinct values of one STRING column to dense u16 codes
+    class StringDictionary {
+        public:
+            int             lookup(const string& val) const; // DICT_NO_CODE if absent
+            int             insert(const string& val);       // DICT_NO_CODE if full
+            const string&   decode(u16 code) const { return theValues[code]; }
+            size_t          size() const { return theValues.size(); }
+            bool            full() const { return theValues.size() >= DICT_MAX_ENTRIES; }
+
+        private:
+            std::vector<string>             theValues;
+            std::unordered_map<string, u16> theCodes;
+    };
+
+    /**
+     * Dictionaries for every STRING column of a heapfile segment.
+     * New codes are appended to a side file (<table>.dict) as [col u8][len u16][bytes]
+     * so codes written into rows stay valid across restarts.
+     */
+    class SegmentDictionary {
+        public:
+            void            open(const string& path);
+            int             encode(u8 col, const string& val); // assigns and persists new codes
+            int             lookup(u8 col, const string& val) const;
+            const string*   decode(u8 col, u16 code) const;
+            size_t          num_entries(u8 col) const;
+
+        private:
+            string                                  thePath;
+            int                                     theFd = -1;
+            off_t                                   theEndOffset = 0;
+            std::unordered_map<u8, StringDictionary> theColumns;
+    };
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "general/Page.hpp"
+#include "storage-manager/Index.hpp"
+#include "page-manager/PageCache.hpp"
+
+#include <vector>
+
+#define HASH_INDEX_MAGIC 0x32584948 // "HIX2"
+#define HASH_INDEX_NULL_PAGE 0 // page 0 is the index header, so it is never a bucket
+
+namespace DB {
+    /**
+     * Disk based extendible hash index mapping column values to row ids.
+     * The directory (2^global depth bucket page ids) is kept in memory and
+     * persisted to its own pages, so a lookup reads a single bucket page.
+     * A full bucket splits on its own and the directory only doubles when the
+     * bucket is already at the global depth, nothing else is rehashed. Entries
+     * that share one hash can't be split apart and go to overflow pages chained
+     * off the bucket. Overflow pages a bucket no longer needs go on a free list
+     * and are reused before the file grows.
+     */
+    class HashIndex : public Index {
+        public:
+            HashIndex(const string& path, ColumnType keyType, PageCache& cache);
+
+            void                create() override;
+            bool                open() override;
+            void                bulk_build(std::vector<IndexEntry>& entries) override;
+            void                insert(const IndexKey& key, const RowId& rid) override;
+            bool                remove(const IndexKey& key, const RowId& rid) override;
+            std::vector<RowId>  lookup(const IndexKey& key) const override;
+            IndexType           type() const override { return IndexType::HASH; }
+
+            ColumnType          key_type() const { return theKeyType; }
+            u32                 global_depth() const { return theGlobalDepth; }
+            u32                 num_pages() const { return theNumPages; }
+
+        private:
+            struct Bucket {
+                u32                     localDepth = 0;
+                std::vector<u32>        pages;   // primary page then its overflow chain
+                std::vector<IndexEntry> entries;
+            };
+
+            const string        thePath;
+            ColumnType          theKeyType;
+            PageCache&          theCache;
+            u32                 theGlobalDepth = 0;
+            u32                 theNumPages = 1;
+            u32                 theFreeHead = HASH_INDEX_NULL_PAGE; // freed pages, each holds the next one's id
+            std::vector<u32>    theDirectory;     // bucket page for each hash suffix
+            std::vector<u32>    theDirectoryPages;
+
+            Bucket              read_bucket(u32 pageId) const;
+            void                write_bucket(Bucket& bucket);
+            void                split_bucket(u32 dirIdx);
+            void                write_directory(); // every directory page and the header
+            void                write_directory_page(size_t i);
+            void                write_header();
+            u32                 alloc_page();
+            void                free_page(u32 pageId);
+    };
+}
@@ -2,10 +2,19 @@
 
 #include "general/Page.hpp"
 #include "storage-manager/StorageStructs.hpp"
+#include "storage-manager/Dictionary.hpp"
+#include "storage-manager/Overflow.hpp"
+#include "storage-manager/RowCache.hpp"
+#include "storage-manager/ZoneMap.hpp"
 
+#include <chrono>
 #include <cstring>
+#include <functional>
 #include <iostream>
+#include <optional>
+#include <shared_mutex>
 #include <stdint.h>
+#include <type_traits>
 #include <vector>
 #include <unordered_map>
 
@@ -14,49 +23,42 @@
 #define ROW_HEADER_SIZE (sizeof(u8) + sizeof(u8))
 #define GET_PAGE_OFFSET(page_num) ((off_t)(page_num) * PAGE_DATA_SIZE)
 #define GET_SLOT_OFFSET(page_num, slot_num) (GET_PAGE_OFFSET(page_num) + ((slot_num) * SLOT_SIZE))
+// value type tags 0-5 follow the datatype variant index
+#define ROW_TAG_DICT_STRING 6 // STRING stored as a u16 code into the segment dictionary
+#define ROW_TAG_TOAST_STRING 7 // STRING stored out of line in the overflow file
+#define TOAST_PREFIX_SIZE 16
+#define TOAST_POINTER_SIZE (sizeof(u32) + sizeof(u32) + TOAST_PREFIX_SIZE)
+#define HEAPFILE_MAGIC 0x50414548 // "HEAP"
+#define HEAPFILE_VERSION 1
+#define HEAPFILE_IDENTIFIER_SIZE 64
+#define VACUUM_BATCH_PAUSE_MS 1 // VACUUM sleeps this long between batches, latch released
 
 namespace DB {
 /**
  * Only allow fixed sized pages
  * Page Directory implementation of heapfiles
+ *
+ * Page 0 starts with this header and the page directory follows right after it,
+ * so opening a heapfile is a single page read. The header is written and read
+ * as raw bytes, keep it trivially copyable and bump HEAPFILE_VERSION whenever
+ * the layout changes.
  */
 struct HeapFile_Metadata {
-  string identifier; // type heapfile and is always at page 0
-  u64 heap_id;       // local to table
+  u32 magic;              // HEAPFILE_MAGIC
+  u16 version;            // HEAPFILE_VERSION
+  u16 header_size;        // sizeof(HeapFile_Metadata), where the directory starts
+  u32 page_size;          // PAGE_DATA_SIZE the file was written with
+  u32 directory_page;     // page holding the page directory
+  u64 heap_id;            // local to table
   u64 table_id;
   u64 num_pages;
   u64 num_records;
-  u8 next_heapfile; // 0 means null
-  ssize_t size = identifier.size() + 1 + sizeof(heap_id) + sizeof(table_id) +
-                 sizeof(num_pages) + sizeof(num_records) +
-                 sizeof(next_heapfile);
-} __attribute__((packed));
-inline u8 *to_bytes(HeapFile_Metadata *metadata) {
-  u8 *buffer = new u8[metadata->size];
-  size_t offset = 0;
-
-  // string contents
-  std::memcpy(buffer + offset, metadata->identifier.data(),
-              metadata->identifier.size() + 1);
-  offset += metadata->identifier.size() + 1;
-  // integers
-  std::memcpy(buffer + offset, &(metadata->heap_id), sizeof(metadata->heap_id));
-  offset += sizeof(metadata->heap_id);
-  std::memcpy(buffer + offset, &(metadata->table_id),
-              sizeof(metadata->table_id));
-  offset += sizeof(metadata->table_id);
-  std::memcpy(buffer + offset, &(metadata->num_pages),
-              sizeof(metadata->num_pages));
-  offset += sizeof(metadata->num_pages);
-  std::memcpy(buffer + offset, &(metadata->num_records),
-              sizeof(metadata->num_records));
-  offset += sizeof(metadata->num_records);
-  std::memcpy(buffer + offset, &(metadata->next_heapfile),
-              sizeof(metadata->next_heapfile));
-  offset += sizeof(metadata->next_heapfile);
-
-  return buffer;
-}
+  u8 next_heapfile;       // 0 means null
+  u8 reserved[7];
+  char identifier[HEAPFILE_IDENTIFIER_SIZE]; // NUL terminated, may be cut short
+};
+static_assert(std::is_trivially_copyable_v<HeapFile_Metadata>);
+static_assert(sizeof(HeapFile_Metadata) % sizeof(u64) == 0);
 
 struct HeapPageEntry {
   u32 page_id;
@@ -73,20 +75,115 @@ struct HeapFile {
   HeapFile_Metadata metadata;
   int heap_fd;
   int num_heapfiles;
+  SegmentDictionary dictionary;
+  OverflowFile overflow;
+  ZoneMap zones; // per page min/max so scans can skip pages
+  RowCache row_cache; // hot rows of get_row, every slot write invalidates its row
+  // free space map, free slots per page indexed by page number (0 unused).
+  // Mirrors the page directory on page 0 so inserts never scan for space
+  std::vector<u16> free_slots;
+  u32 fsm_hint; // no page before this one has a free slot
+  // scans share it, inserts/deletes and vacuum batches take it exclusively
+  std::shared_mutex latch;
+  // bumped, under the latch, by every vacuum batch that moves rows
+  u64 vacuum_epoch = 0;
   HeapFile(int table_id, string tablename, bool if_missing);
 };
 
+// Equality / IN test on one STRING column, checked on the encoded slot before the
+// row is decoded. Dictionary coded values are compared by code.
+struct StringPredicate {
+  u8 col;
+  std::vector<string> values;
+  bool negate = false;
+};
+
+struct HeapScanOptions {
+  std::vector<StringPredicate> predicates;
+  // columns the query reads, empty means all. Out of line values of other
+  // columns are never fetched and decode to their inline prefix
+  std::vector<bool> columns;
+  // pages whose zone can't overlap every range are never read
+  std::vector<ZoneRange> ranges;
+  // when set only these pages are read, in the order given
+  std::optional<std::vector<u32>> pages;
+};
+
+// where a batched scan of a heap stands: the next page to visit, an index
+// into HeapScanOptions::pages when that is set, and the next slot on it.
+// epoch is the heap's vacuum_epoch when the scan started
+struct HeapCursor {
+  u64 visit = 0;
+  u64 slot = 0;
+  bool started = false;
+  u64 epoch = 0;
+  bool done = false;
+};
+
+struct VacuumOptions {
+  u32 pages_per_batch = 8; // tail pages emptied per latch acquisition
+  // slept between batches with the latch released, so queries get in
+  std::chrono::milliseconds pause{VACUUM_BATCH_PAUSE_MS};
+  // called for every row that changes location, for index maintenance.
+  // Runs with the heapfile latch held, so it must not call back into the heap
+  std::function<void(const Row &row, const RowId &from, const RowId &to)>
+      on_move;
+};
+
+struct VacuumStats {
+  u64 rows_moved;
+  u64 pages_compacted;
+  u64 pages_truncated;
+  u64 pages_before;
+  u64 pages_after;
+};
+
 HeapFile *create_heapfile(string tablename);
 HeapFile *initalize_heapfile(string tablename);
 HeapFile *read_heapfile();
+// reads an existing heapfile back from disk, NULL if there is none
+HeapFile *open_heapfile(const string &tablename);
+// deletes the heapfile and its side files, the HeapFile must not be used after
+void delete_heapfile(const string &tablename);
 
 void print_heapfile_metadata(HeapFile *heapfile);
 void print_table(HeapFile heapfile);
 
-Row *get_row(HeapFile *heapfile, RowId id);
+// rows come from the arena when one is given, otherwise the caller must delete them
+Row *get_row(HeapFile *heapfile, RowId id, QueryArena *arena = nullptr);
+size_t serialize_row(HeapFile *heapfile, Row *row, u8 *buffer, size_t buffer_size);
+Row *deserialize_row(HeapFile *heapfile, u8 *buffer, size_t size,
+                     QueryArena *arena = nullptr,
+                     const std::vector<bool> *columns = nullptr);
 RowId insert_row(HeapFile *heapfile, Row *row, u32 page);
 RowId delete_row(HeapFile *heapfile, RowId rid);
-std::vector<Row *> scan_heap(HeapFile *heapfile);
+// rewrite rows[i] over the row at rids[i] in place, one read and write per page.
+// Returns the indices i that were updated, rows deleted since they were read
+// are skipped. Throws, with nothing written, if any row is too big for a slot
+std::vector<size_t> update_rows(HeapFile *heapfile,
+                                const std::vector<RowId> &rids,
+                                const std::vector<Row *> &rows);
+// clears the slots of every row id, one read and write per page
+size_t delete_rows(HeapFile *heapfile, const std::vector<RowId> &rids);
+std::vector<Row *> scan_heap(HeapFile *heapfile, QueryArena *arena = nullptr,
+                             const HeapScanOptions *opts = nullptr);
+// the next rows of a scan, at most max_rows, from where cursor stands. The
+// latch is only held during the call, rows written in between may be missed.
+// Throws if a vacuum moved rows since the scan started, they may have moved
+// behind the cursor
+std::vector<Row *> scan_heap_next(HeapFile *heapfile, HeapCursor &cursor,
+                                  size_t max_rows, QueryArena *arena = nullptr,
+                                  const HeapScanOptions *opts = nullptr);
+// every live slot with its row id, page by page under the shared latch, for
+// readers that decode slots themselves (TypedTable)
+void scan_heap_slots(HeapFile *heapfile,
+                     const std::function<void(const RowId &, const u8 *)> &visit);
+size_t directory_capacity(HeapFile *heapfile);
+void write_heapfile_metadata(HeapFile *heapfile);
+// compacts live rows toward the front of the file and truncates empty tail
+// pages. Runs to completion, the latch is only held a few pages at a time and
+// released for opts.pause in between. Batched scans open across it fail
+VacuumStats vacuum_heap(HeapFile *heapfile, const VacuumOptions &opts = {});
 
 std::unordered_map<u64, HeapFile *> &get_heapfile_registry();
 void register_heapfile(HeapFile *heapfile);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "storage-manager/StorageStructs.hpp"
+
+#include <vector>
+
+#define INDEX_KEY_SIZE 32 // strings longer than this are indexed by their prefix
+
+namespace DB {
+    enum class IndexType {
+        BTREE,
+        HASH,
+        BITMAP
+    };
+
+    // Fixed width key whose memcmp order matches the order of the column values
+    struct IndexKey {
+        u8 bytes[INDEX_KEY_SIZE];
+    };
+
+    // keys are made unique by the row id, so duplicate column values are fine
+    struct IndexEntry {
+        IndexKey    key;
+        RowId       rid;
+    };
+
+    IndexKey make_index_key(const datatype& val, ColumnType type);
+    int      compare_keys(const IndexKey& a, const IndexKey& b);
+    u64      hash_index_key(const IndexKey& key);
+    bool     entry_less(const IndexEntry& a, const IndexEntry& b);
+    bool     same_row(const RowId& a, const RowId& b);
+
+    // what Table needs to keep any kind of index in sync with the heap
+    class Index {
+        public:
+            virtual ~Index() = default;
+
+            virtual void                create() = 0; // truncates any existing index
+            virtual bool                open() = 0;   // false if the file isn't this kind of index
+            virtual void                bulk_build(std::vector<IndexEntry>& entries) = 0;
+            virtual void                insert(const IndexKey& key, const RowId& rid) = 0;
+            virtual bool                remove(const IndexKey& key, const RowId& rid) = 0;
+            virtual std::vector<RowId>  lookup(const IndexKey& key) const = 0;
+            // keys must be sorted, result i holds the rows of keys[i]
+            virtual std::vector<std::vector<RowId>> lookup_many(const std::vector<IndexKey>& keys) const;
+            virtual IndexType           type() const = 0;
+    };
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "general/Types.hpp"
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace DB {
+    // a put, or a delete when value is empty
+    struct KeyedWrite {
+        string                          key;
+        std::optional<std::vector<u8>>  value;
+    };
+
+    /**
+     * What Table needs of an engine that keeps rows by primary key rather
+     * than in a heap. Keys compare as bytes, values are encoded rows.
+     */
+    class KeyedStore {
+        public:
+            virtual ~KeyedStore() = default;
+
+            // applied in order, a later write to a key replaces an earlier one
+            virtual void                            write(const std::vector<KeyedWrite>& batch) = 0;
+            virtual std::optional<std::vector<u8>>  get(const string& key) const = 0;
+            // every live key in [low, high] in order until visit returns false, either bound may be open
+            virtual void                            scan(const std::optional<string>& low, const std::optional<string>& high,
+                                                         const std::function<bool(const string&, const std::vector<u8>&)>& visit) const = 0;
+            // reclaims the space of deleted and overwritten rows, returns the live keys
+            virtual u64                             compact_all() = 0;
+            // deletes every file, the store must not be used after
+            virtual void                            drop() = 0;
+    };
+}
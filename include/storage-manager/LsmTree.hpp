@@ -0,0 +1,143 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "storage-manager/KeyedStore.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#define LSM_MANIFEST_MAGIC 0x314d534c // "LSM1"
+#define LSM_RUN_MAGIC 0x314e5552 // "RUN1"
+#define LSM_MEMTABLE_BYTES (4 * 1024 * 1024) // memtable size that starts a flush
+#define LSM_BLOCK_BYTES 4096 // target size of a run's data blocks
+#define LSM_L0_RUNS 4 // L0 runs that start a compaction into L1
+#define LSM_L1_BYTES (32 * 1024 * 1024) // target size of L1, each level below is LSM_LEVEL_FANOUT times bigger
+#define LSM_LEVEL_FANOUT 10
+#define LSM_RUN_BYTES (8 * 1024 * 1024) // compaction output is split into runs of about this size
+#define LSM_MAX_LEVELS 7
+#define LSM_BLOOM_BITS_PER_KEY 10 // about 1% false positives
+
+namespace DB {
+    // Bloom filter over the keys of one run, so a lookup skips runs that can't hold its key
+    class BloomFilter {
+        public:
+            BloomFilter() = default;
+            BloomFilter(size_t numKeys, u32 bitsPerKey);
+
+            void    add(std::string_view key);
+            bool    may_contain(std::string_view key) const;
+            void    serialize(std::vector<u8>& out) const;
+            size_t  deserialize(const u8* data, size_t size); // bytes read, 0 if malformed
+
+        private:
+            std::vector<u64>    theBits;
+            u32                 theProbes = 0;
+    };
+
+    struct LsmEntry {
+        bool                deleted = false; // tombstone, hides older versions of the key
+        std::vector<u8>     value;
+    };
+
+    using LsmMemtable = std::map<string, LsmEntry>;
+
+    // An immutable sorted run file, only its block index and bloom filter are kept in memory
+    struct LsmRun {
+        u64                 id;
+        u32                 level;
+        string              path;
+        int                 fd = -1;
+        string              smallest;
+        string              largest;
+        u64                 entries = 0;
+        u64                 bytes = 0;
+        std::vector<string> blockKeys;    // first key of each block
+        std::vector<u64>    blockOffsets; // one more than blockKeys, the last is where blocks end
+        BloomFilter         bloom;
+    };
+
+    /**
+     * Log structured merge tree for write heavy tables. Writes go to an
+     * append-only log and a sorted in-memory memtable, nothing else is touched.
+     * A full memtable is written out as a sorted run into L0 by a background
+     * thread, which also merges runs down the levels: L0 runs may overlap, the
+     * runs of every level below cover disjoint key ranges and each level holds
+     * LSM_LEVEL_FANOUT times more than the one above. A lookup checks the
+     * memtables and then one run per level (all of L0), each run's bloom filter
+     * first. Keys compare as bytes, values are opaque.
+     *
+     * Files are database-files/lsm/<name>.manifest (levels and runs),
+     * <name>.<n>.log and <name>.<id>.run.
+     */
+    class LsmTree : public KeyedStore {
+        public:
+            // create starts out empty, removing what an earlier table of that name left
+            LsmTree(const string& name, bool create);
+            ~LsmTree() override;
+
+            // one log append for the whole batch
+            void                            write(const std::vector<KeyedWrite>& batch) override;
+            std::optional<std::vector<u8>>  get(const string& key) const override;
+            void                            scan(const std::optional<string>& low, const std::optional<string>& high,
+                                                 const std::function<bool(const string&, const std::vector<u8>&)>& visit) const override;
+
+            // writes the memtable out and merges everything into the last level
+            u64                             compact_all() override;
+            // waits until no flush or compaction is pending
+            void                            wait_idle();
+            void                            drop() override;
+
+            size_t                          num_runs(u32 level) const;
+
+        private:
+            const string                    theName;
+            mutable std::shared_mutex       theLatch; // memtables and levels
+            LsmMemtable                     theMemtable;
+            size_t                          theMemtableBytes = 0;
+            std::shared_ptr<const LsmMemtable> theImmutable; // being flushed
+            std::vector<std::vector<std::shared_ptr<LsmRun>>> theLevels; // L0 newest first, others by key
+            u64                             theNextRunId = 1;
+            u64                             theLogNumber = 1;  // log of the memtable
+            u64                             theOldestLog = 1;  // logs from here on are not flushed yet
+            int                             theLogFd = -1;
+            off_t                           theLogEnd = 0;
+
+            std::thread                     theWorker;
+            std::condition_variable_any     theWork;    // flush or compaction may be due
+            std::condition_variable_any     theFlushed; // the immutable memtable is written out
+            std::condition_variable_any     theIdle;    // a flush or compaction finished
+            bool                            theStop = false;
+            bool                            theBusy = false;
+
+            string                          file_path(const string& suffix) const;
+            string                          log_path(u64 number) const;
+            string                          run_path(u64 id) const;
+            void                            open_log(u64 number);
+            void                            replay_logs();
+            void                            write_manifest();
+            bool                            read_manifest();
+            void                            remove_files();
+
+            void                            stop_worker();
+            void                            background();
+            void                            rotate_memtable();
+            bool                            work_due() const;
+            void                            flush_immutable();
+            int                             pick_compaction() const;
+            void                            compact(u32 level);
+            std::vector<std::shared_ptr<LsmRun>> write_runs(std::vector<std::shared_ptr<LsmRun>>& inputs,
+                                                             const LsmMemtable* memtable, u32 level,
+                                                             bool dropTombstones, u64 maxRunBytes);
+            std::shared_ptr<LsmRun>         open_run(u64 id, u32 level);
+            u64                             level_target(u32 level) const;
+            u64                             level_bytes(u32 level) const;
+    };
+}
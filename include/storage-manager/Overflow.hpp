@@ -0,0 +1,35 @@
+#pragma once
+
+#include "general/Types.hpp"
+
+#include <vector>
+
+#define OVERFLOW_PAGE_SIZE 4096
+#define OVERFLOW_PAGE_HEADER_SIZE (sizeof(u32) + sizeof(u32)) // next page + used bytes
+#define OVERFLOW_PAGE_PAYLOAD (OVERFLOW_PAGE_SIZE - OVERFLOW_PAGE_HEADER_SIZE)
+#define OVERFLOW_NULL_PAGE 0 // page 0 is the file header, so it never appears in a chain
+
+namespace DB {
+    /**
+     * Out of line storage for values too large for a heap slot (like Postgres TOAST).
+     * Each value is a chain of pages in <table>.toast, the heap row only keeps a pointer
+     * and a short prefix. Page 0 holds [num_pages u32][free_head u32], freed chains are
+     * pushed onto the free list and reused before the file grows.
+     */
+    class OverflowFile {
+        public:
+            void    open(const string& path);
+            u32     write_value(const string& val);       // returns first page of the chain
+            string  read_value(u32 firstPage, u32 length) const;
+            void    free_value(u32 firstPage);
+            u32     num_pages() const { return theNumPages; }
+
+        private:
+            int     theFd = -1;
+            u32     theNumPages = 1;
+            u32     theFreeHead = OVERFLOW_NULL_PAGE;
+
+            u32     alloc_page();
+            void    write_header();
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "storage-manager/Index.hpp"
+#include "storage-manager/Table.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace DB {
+    enum class PartitionMethod { RANGE, HASH };
+
+    struct PartitionDef {
+        string                      name;
+        std::optional<datatype>     upper; // RANGE keys below this bound, none means MAXVALUE
+    };
+
+    /**
+     * How a partitioned table spreads its rows. Every partition is a table of its
+     * own named <table>_<partition>, with its own heapfile, indexes and stats, so
+     * dropping a partition is deleting its files.
+     */
+    struct PartitionSpec {
+        PartitionMethod             method;
+        string                      column;
+        ColumnType                  keyType;
+        std::vector<PartitionDef>   partitions; // RANGE ones ascending by bound
+        std::vector<IndexDef>       indexes;    // built on every partition as <index>_<partition>
+
+        string                      table_name(const string& parent, size_t i) const;
+        // partition holding key, -1 if no RANGE partition covers it
+        int                         route(const datatype& key) const;
+        // partitions that can hold a key in [low, high], either bound may be open
+        std::vector<size_t>         prune(const std::optional<datatype>& low,
+                                          const std::optional<datatype>& high) const;
+        // partitions that can hold one of keys
+        std::vector<size_t>         prune(const std::vector<datatype>& keys) const;
+
+        void                        serialize(std::vector<u8>& out) const;
+        size_t                      deserialize(const u8* data, size_t size); // bytes read, 0 if malformed
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "general/Arena.hpp"
+#include "storage-manager/StorageStructs.hpp"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#define ROW_CACHE_ROWS 4096 // decoded rows kept per heapfile
+#define ROW_CACHE_SHARDS 16 // each with its own lock
+#define ROW_CACHE_SKETCH_DEPTH 4
+#define ROW_CACHE_SAMPLE_FACTOR 10 // counters are halved after this many accesses per cached row
+
+namespace DB {
+    /**
+     * Decoded rows of one heapfile by row id, so a hot point read skips the
+     * slot read and the decode. Rows are split over shards by id, each shard
+     * an LRU list under its own mutex.
+     *
+     * Admission is TinyLFU: every lookup counts the id in a count-min sketch
+     * of 4 bit counters, and a full shard only takes a new row if its id was
+     * asked for more often than the id it would evict. One-off reads of a
+     * scan-like access pattern then can't push out the hot rows. Counters are
+     * halved every ROW_CACHE_SAMPLE_FACTOR * capacity accesses so old
+     * popularity fades.
+     *
+     * The heapfile invalidates a row whenever its slot is written, callers
+     * insert with the heapfile latch held so a stale version never gets in.
+     */
+    class RowCache {
+        public:
+            explicit RowCache(size_t capacity = ROW_CACHE_ROWS);
+
+            // a copy of the cached row, null on a miss
+            Row*    get(const RowId& rid, QueryArena* arena = nullptr);
+            void    put(const RowId& rid, const Row& row);
+            void    invalidate(const RowId& rid);
+            void    clear();
+
+            u64     hits() const { return theHits.load(std::memory_order_relaxed); }
+            u64     misses() const { return theMisses.load(std::memory_order_relaxed); }
+
+        private:
+            struct Entry {
+                u64                     key;
+                u8                      numCols;
+                std::vector<datatype>   values;
+            };
+
+            struct Shard {
+                std::mutex              lock;
+                std::list<Entry>        lru; // most recently used first
+                std::unordered_map<u64, std::list<Entry>::iterator> map;
+                std::vector<u8>         sketch; // ROW_CACHE_SKETCH_DEPTH rows of counters
+                u64                     sketchMask = 0;
+                u64                     samples = 0;
+
+                void    count(u64 hash, u64 resetAfter);
+                u8      frequency(u64 hash) const;
+            };
+
+            const size_t                theShardCapacity;
+            std::unique_ptr<Shard[]>    theShards;
+            std::atomic<u64>            theHits{0};
+            std::atomic<u64>            theMisses{0};
+
+            static u64  row_key(const RowId& rid) { return ((u64)(u32)rid.pageId.page_num << 32) | (u32)rid.record_num; }
+    };
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "general/Structs.hpp"
+#include "storage-manager/StorageStructs.hpp"
+
+#include <vector>
+
+#define HLL_PRECISION 10                  // 1024 registers, about 3% error
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+#define STATS_HISTOGRAM_BUCKETS 32
+#define STATS_MCV_COUNT 16
+#define ANALYZE_SAMPLE_PAGES 300          // tables up to this many pages are read whole
+#define ANALYZE_THRESHOLD_ROWS 50         // changed rows before stats go stale,
+#define ANALYZE_THRESHOLD_FRACTION 0.1    // on top of this fraction of the table
+
+namespace DB {
+    struct HeapFile;
+
+    /**
+     * HyperLogLog distinct value sketch. Each value hashes to a register and the
+     * register keeps the longest run of leading zeros seen, so a sketch never
+     * grows and two sketches merge by taking the larger register.
+     */
+    class HyperLogLog {
+        public:
+            HyperLogLog();
+
+            void                add(const datatype& val);
+            void                merge(const HyperLogLog& other);
+            double              estimate() const;
+
+            const std::vector<u8>& registers() const { return theRegisters; }
+            std::vector<u8>&    registers() { return theRegisters; }
+
+        private:
+            std::vector<u8>     theRegisters;
+    };
+
+    struct ColumnStats {
+        double                  null_frac = 0;
+        double                  ndv = 0;        // distinct non-null values, as estimated by ANALYZE
+        std::vector<datatype>   mcv;            // most common values, most common first
+        std::vector<double>     mcv_freq;       // fraction of all rows holding each
+        // equi-depth bucket bounds over the values that aren't in mcv, each bucket
+        // holds about the same number of rows
+        std::vector<datatype>   histogram;
+        HyperLogLog             sketch;         // sampled values plus everything inserted since
+
+        // max of the ANALYZE estimate and the sketch, which only sees what it was fed
+        double                  distinct() const;
+    };
+
+    struct TableStats {
+        u64                     row_count = 0;
+        u64                     page_count = 0;
+        u64                     sampled_pages = 0;
+        u64                     sampled_rows = 0;
+        u64                     modified = 0;   // rows inserted, updated or deleted since
+        std::vector<ColumnStats> columns;
+
+        void                    observe_insert(const Row* row);
+        void                    observe_change(u64 rows, bool deleted);
+        bool                    stale() const;
+
+        void                    serialize(std::vector<u8>& out) const;
+        size_t                  deserialize(const u8* data, size_t size); // bytes read, 0 if malformed
+    };
+
+    // a single value tagged with its type, used wherever the catalog stores values
+    void serialize_value(std::vector<u8>& out, const datatype& val);
+    bool deserialize_value(const u8* data, size_t size, size_t& offset, datatype& out); // false if malformed
+
+    // reads up to samplePages random pages (every page of smaller tables)
+    TableStats analyze_heap(HeapFile* heapfile, const Schema& schema,
+                            u32 samplePages = ANALYZE_SAMPLE_PAGES);
+    // statistics of a table whose rows were all read
+    TableStats analyze_rows(const std::vector<Row*>& rows, const Schema& schema);
+}
@@ -2,7 +2,9 @@
 
 #include "general/Types.hpp"
 #include "general/Structs.hpp"
+#include "general/Arena.hpp"
 #include <vector>
+#include <memory_resource>
 
 struct PageId {
     u64     heapId;
@@ -14,16 +16,40 @@ struct RowId {
     u64         record_num; // index in page
 };
 
+// values allocate from whatever resource they were built with (a QueryArena during queries)
+using RowValues = std::pmr::vector<datatype>;
+
 struct Row {
-    //RowId       id; // for lazy allocation when needed
+    RowId       id; // where the row was read from, zero for rows not read from a heap
     u8          numCols;
-    std::vector<datatype>   values;
-    Row(int n, std::vector<datatype>&& v) : numCols(n), values(std::move(v)) {}
+    RowValues   values;
+    Row(int n, std::vector<datatype>&& v) :
+        id{},
+        numCols(n),
+        values(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end())) {}
+    Row(int n, RowValues&& v) : id{}, numCols(n), values(std::move(v)) {}
 };
+
+// heap allocated row, caller owns it
 inline Row* create_row(int n, std::vector<datatype> v) {
     return new Row(n, std::move(v));
 }
 
+// arena owned row when an arena is given, otherwise caller owns it
+inline Row* create_row(QueryArena* arena, int n, RowValues&& v) {
+    if (arena == nullptr) {
+        return new Row(n, std::move(v));
+    }
+    return arena->make<Row>(n, std::move(v));
+}
+
+inline RowValues make_row_values(QueryArena* arena, size_t reserveCount) {
+    RowValues values(arena != nullptr ? static_cast<std::pmr::memory_resource*>(arena)
+                                      : std::pmr::get_default_resource());
+    values.reserve(reserveCount);
+    return values;
+}
+
 struct TableId {
     u64 id;
 };
@@ -5,28 +5,106 @@
 #include "general/Structs.hpp"
 #include "storage-manager/StorageStructs.hpp"
 #include "storage-manager/HeapFile.hpp"
+#include "storage-manager/BPlusTree.hpp"
+#include "storage-manager/HashIndex.hpp"
+#include "storage-manager/BitmapIndex.hpp"
+#include "storage-manager/Statistics.hpp"
+#include "storage-manager/KeyedStore.hpp"
 #include "page-manager/PageCache.hpp"
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <optional>
+
+#define INDEX_CACHE_PAGES 256
 
 namespace DB {
     void create_table();
     void load_table();
     void load_schema();
 
+    struct TableIndex {
+        string                      name;
+        int                         column;
+        IndexType                   type;
+        bool                        unique = false; // backs a PRIMARY KEY or UNIQUE column
+        std::unique_ptr<Index>      impl;
+    };
+
+    // what the catalog keeps of an index to reopen it
+    struct IndexDef {
+        string                      name;
+        string                      column;
+        IndexType                   type;
+        bool                        unique = false;
+    };
+
+    // where a table keeps its rows
+    enum class TableEngine : u8 {
+        HEAP,      // slotted heap pages, any column can be indexed
+        LSM,       // LsmTree keyed by the primary key, for write heavy tables
+        CLUSTERED, // ClusteredTree, rows in primary key order in B+tree leaves
+    };
+
+    // where a batched scan of a table stands, see Table::scan_next
+    struct TableCursor {
+        HeapCursor              heap;
+        std::optional<string>   after; // key of the last row a keyed store returned
+        bool                    done = false;
+    };
+
+    const char* engine_name(TableEngine engine);
+    // store of a table kept by key, create starts it out empty
+    std::unique_ptr<KeyedStore> make_keyed_store(const string& name, TableEngine engine, bool create);
+
     class Table {
         public:
             Table(const string& name, Schema& schema, HeapFile& heapfile, PageCache* pageCache = nullptr);
+            // reopens a table whose index files already exist, indexes that can't be read are rebuilt
+            Table(const string& name, Schema& schema, HeapFile& heapfile, const std::vector<IndexDef>& indexes);
+            // parent of a partitioned table, its rows live in the partitions' own tables
+            Table(const string& name, Schema& schema);
+            // rows live in store keyed by the schema's primary key
+            Table(const string& name, Schema& schema, TableEngine engine, std::unique_ptr<KeyedStore> store);
 
             static Table* get_table(const string& name, HeapFile& bufPool);
 
             RowId               insert_row();
             RowId               insert_row(Row* row);
+            // nothing is written unless every row passes the unique checks
+            std::vector<RowId>  insert_rows(const std::vector<Row*>& rows);
             Row*                read_row();
-            Row*                read_row(const RowId& rid);
-            std::vector<Row*>   scan() const;
+            Row*                read_row(const RowId& rid, QueryArena* arena = nullptr);
+            // the row whose primary key is key, through the store or the primary key index
+            Row*                find_row(const datatype& key, QueryArena* arena = nullptr) const;
+            std::vector<Row*>   scan(QueryArena* arena = nullptr,
+                                     const HeapScanOptions* opts = nullptr) const;
+            // the next rows of a scan from where cursor stands, at most maxRows, empty once it is done
+            std::vector<Row*>   scan_next(TableCursor& cursor, size_t maxRows, QueryArena* arena = nullptr,
+                                          const HeapScanOptions* opts = nullptr) const;
+            // rows must come from a scan of this table so their ids are set
+            size_t              update_rows(const std::vector<Row*>& oldRows, const std::vector<Row*>& newRows);
+            size_t              delete_rows(const std::vector<Row*>& rows);
+            VacuumStats         vacuum();
+            // deletes the heapfile and index files, the table must not be used after
+            void                drop();
+            // samples the heap and replaces the statistics, inserts, updates and
+            // deletes keep them roughly current until they go stale
+            const TableStats&   analyze(u32 samplePages = ANALYZE_SAMPLE_PAGES);
+            const TableStats*   statistics() const { return theStats ? &*theStats : nullptr; }
+            void                set_statistics(const TableStats& stats) { theStats = stats; }
+
+            Index*              create_index(const string& name, const string& column,
+                                             IndexType type = IndexType::BTREE);
+            BPlusTree*          get_btree(int column) const;
+            HashIndex*          get_hash_index(int column) const;
+            BitmapIndex*        get_bitmap_index(int column) const;
+            const std::vector<std::unique_ptr<TableIndex>>& getIndexes() const { return theIndexes; }
+            std::vector<IndexDef> index_defs() const;
+            // throws if a row would duplicate a unique key, rows in replacing are being overwritten
+            void                check_unique(const std::vector<Row*>& rows,
+                                             const std::vector<RowId>& replacing = {}) const;
 
             u64                 read(u64 pageNum, u16 rowNum);
             string              print_metadata();
@@ -34,7 +112,8 @@ namespace DB {
 
             const string&       getName() const { return theFileName; }
             const Schema&       getSchema() const { return theSchema; }
-            HeapFile*           getHeapFile() { return theHeapFile; }
+            HeapFile*           getHeapFile() const { return theHeapFile; }
+            TableEngine         engine() const { return theEngine; }
 
         private:
             const string            theFileName;
@@ -43,8 +122,24 @@ namespace DB {
             Schema                  theSchema;
             HeapFile*               theHeapFile;
             PageCache*              thePageCache;
+            std::vector<std::unique_ptr<TableIndex>> theIndexes;
+            std::optional<TableStats> theStats; // none until the first ANALYZE
+            TableEngine             theEngine = TableEngine::HEAP;
+            std::unique_ptr<KeyedStore> theStore; // set for every engine but the heap
+            int                     theKeyColumn = -1; // primary key column, set with theStore
 
             u64 allocPage();
+            void index_row(Row* row, const RowId& rid);
+            void create_key_indexes();
+            int column_index(const string& column) const;
+            std::unique_ptr<Index> make_index(const string& name, int column, IndexType type);
+            RowId store_row(Row* row);
             Page* getPageFromCache(u32 pageId);
+
+            string store_key(const datatype& val) const;
+            Row* stored_row(const std::vector<u8>& value, QueryArena* arena) const;
+            std::vector<Row*> store_scan(QueryArena* arena, const HeapScanOptions* opts,
+                                         TableCursor* cursor = nullptr, size_t maxRows = SIZE_MAX) const;
+            void store_check_unique(const std::vector<Row*>& rows, const std::vector<Row*>& replacing = {}) const;
     };
 }
\ No newline at end of file
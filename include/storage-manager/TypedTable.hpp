@@ -0,0 +1,272 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "general/Arena.hpp"
+#include "general/Page.hpp"
+#include "storage-manager/StorageStructs.hpp"
+#include "storage-manager/HeapFile.hpp"
+#include "storage-manager/Table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace DB {
+    // how a fixed width C++ type is declared in a schema and tagged in a heap slot
+    template <typename T> struct FixedColumn;
+    template <> struct FixedColumn<int>     { static constexpr ColumnType type = ColumnType::INT;    static constexpr u8 tag = 0; };
+    template <> struct FixedColumn<float>   { static constexpr ColumnType type = ColumnType::FLOAT;  static constexpr u8 tag = 1; };
+    template <> struct FixedColumn<bool>    { static constexpr ColumnType type = ColumnType::BOOL;   static constexpr u8 tag = 3; };
+    template <> struct FixedColumn<int64_t> { static constexpr ColumnType type = ColumnType::INT64;  static constexpr u8 tag = 4; };
+    template <> struct FixedColumn<double>  { static constexpr ColumnType type = ColumnType::DOUBLE; static constexpr u8 tag = 5; };
+
+    template <typename T>
+    concept FixedWidth = requires { FixedColumn<T>::tag; };
+
+    /**
+     * Record layout of a schema made only of fixed width columns, worked out
+     * at compile time. In memory each column sits at its natural alignment in
+     * declaration order, like the members of a struct. In a heap slot every
+     * column is [tag u8][value] after the row header, so with no variable
+     * length column before it each value is at a constant slot offset too.
+     */
+    template <FixedWidth... Cols>
+    struct RowLayout {
+        static_assert(sizeof...(Cols) > 0, "a row needs at least one column");
+
+        static constexpr size_t num_cols = sizeof...(Cols);
+        static constexpr std::array<size_t, num_cols> sizes{sizeof(Cols)...};
+        static constexpr std::array<u8, num_cols> tags{FixedColumn<Cols>::tag...};
+        static constexpr size_t align = std::max({alignof(Cols)...});
+
+        static constexpr std::array<size_t, num_cols> offsets = [] {
+            constexpr std::array<size_t, num_cols> aligns{alignof(Cols)...};
+            std::array<size_t, num_cols> out{};
+            size_t at = 0;
+            for (size_t i = 0; i < num_cols; i++) {
+                at = (at + aligns[i] - 1) / aligns[i] * aligns[i];
+                out[i] = at;
+                at += sizes[i];
+            }
+            return out;
+        }();
+        static constexpr size_t size = (offsets[num_cols - 1] + sizes[num_cols - 1] + align - 1) / align * align;
+
+        // where each value starts in a heap slot, its tag is the byte before
+        static constexpr std::array<size_t, num_cols> slot_offsets = [] {
+            std::array<size_t, num_cols> out{};
+            size_t at = ROW_HEADER_SIZE;
+            for (size_t i = 0; i < num_cols; i++) {
+                out[i] = at + 1;
+                at += 1 + sizes[i];
+            }
+            return out;
+        }();
+        static constexpr size_t slot_size = slot_offsets[num_cols - 1] + sizes[num_cols - 1];
+        static_assert(slot_size <= SLOT_SIZE, "row does not fit a heap slot");
+
+        template <size_t I>
+        using type = std::tuple_element_t<I, std::tuple<Cols...>>;
+    };
+
+    /**
+     * One row of a fixed width schema as plain bytes in RowLayout order.
+     * get<I> and set<I> are a copy at a constant offset, so reading a column
+     * compiles to a single load.
+     */
+    template <FixedWidth... Cols>
+    class TypedRow {
+        public:
+            using Layout = RowLayout<Cols...>;
+
+            RowId   id{}; // where the row was read from, zero for rows not read from a heap
+
+            TypedRow() : theBytes{} {}
+            TypedRow(Cols... values) : theBytes{} {
+                set_all(std::index_sequence_for<Cols...>{}, values...);
+            }
+
+            template <size_t I>
+            typename Layout::template type<I> get() const {
+                typename Layout::template type<I> value;
+                std::memcpy(&value, theBytes + Layout::offsets[I], sizeof(value));
+                return value;
+            }
+
+            template <size_t I>
+            void set(typename Layout::template type<I> value) {
+                std::memcpy(theBytes + Layout::offsets[I], &value, sizeof(value));
+            }
+
+            // copies the values of a heap slot, which must hold Layout::tags
+            void load_slot(const u8* slot) {
+                load_all(std::index_sequence_for<Cols...>{}, slot);
+            }
+
+            // whether a heap slot holds this layout, rows written before a
+            // column type change or through SQL literals may be tagged otherwise
+            static bool matches_slot(const u8* slot) {
+                return slot[1] == Layout::num_cols && tags_match(std::index_sequence_for<Cols...>{}, slot);
+            }
+
+            Row* to_row(QueryArena* arena = nullptr) const {
+                return to_row_impl(std::index_sequence_for<Cols...>{}, arena);
+            }
+
+            // converts each value to its column's type, throws on a string
+            static TypedRow from_row(const Row& row) {
+                if (row.values.size() != Layout::num_cols) {
+                    throw std::runtime_error("Row has " + std::to_string(row.values.size()) +
+                                             " columns, typed row expects " + std::to_string(Layout::num_cols));
+                }
+                TypedRow out;
+                out.from_row_impl(std::index_sequence_for<Cols...>{}, row);
+                out.id = row.id;
+                return out;
+            }
+
+        private:
+            alignas(Layout::align) u8 theBytes[Layout::size];
+
+            template <size_t... I>
+            void set_all(std::index_sequence<I...>, Cols... values) {
+                (set<I>(values), ...);
+            }
+
+            template <size_t... I>
+            void load_all(std::index_sequence<I...>, const u8* slot) {
+                (std::memcpy(theBytes + Layout::offsets[I], slot + Layout::slot_offsets[I], Layout::sizes[I]), ...);
+            }
+
+            template <size_t... I>
+            static bool tags_match(std::index_sequence<I...>, const u8* slot) {
+                return ((slot[Layout::slot_offsets[I] - 1] == Layout::tags[I]) && ...);
+            }
+
+            template <size_t... I>
+            Row* to_row_impl(std::index_sequence<I...>, QueryArena* arena) const {
+                RowValues values = make_row_values(arena, Layout::num_cols);
+                (values.emplace_back(get<I>()), ...);
+                return create_row(arena, Layout::num_cols, std::move(values));
+            }
+
+            template <size_t... I>
+            void from_row_impl(std::index_sequence<I...>, const Row& row) {
+                (set<I>(convert<typename Layout::template type<I>>(row.values[I])), ...);
+            }
+
+            template <typename T>
+            static T convert(const datatype& val) {
+                return val.visit([](auto&& v) -> T {
+                    using V = std::decay_t<decltype(v)>;
+                    if constexpr (std::is_same_v<V, std::string_view>) {
+                        throw std::runtime_error("String value in a fixed width column");
+                    } else {
+                        return static_cast<T>(v);
+                    }
+                });
+            }
+    };
+
+    /**
+     * Typed access to a table whose columns are all fixed width, for C++
+     * code that embeds the database. Cols name the column types in schema
+     * order and are checked against the schema once, when the wrapper is made.
+     *
+     * A scan of a heap table reads each slot straight into a TypedRow at the
+     * layout's constant offsets, no Row or datatype is built. Slots tagged
+     * differently from the layout and tables of the other engines go through
+     * the generic decode and are converted. Inserts are turned into rows and
+     * go through the table, so unique checks, indexes and statistics stay as
+     * they are for SQL inserts.
+     */
+    template <FixedWidth... Cols>
+    class TypedTable {
+        public:
+            using Record = TypedRow<Cols...>;
+            using Layout = RowLayout<Cols...>;
+
+            explicit TypedTable(Table& table) : theTable(table) {
+                const Schema& schema = table.getSchema();
+                if (schema.columns.size() != Layout::num_cols) {
+                    throw std::runtime_error("Table " + table.getName() + " has " +
+                                             std::to_string(schema.columns.size()) + " columns, typed table expects " +
+                                             std::to_string(Layout::num_cols));
+                }
+                constexpr std::array<ColumnType, Layout::num_cols> types{FixedColumn<Cols>::type...};
+                for (size_t i = 0; i < Layout::num_cols; i++) {
+                    if (schema.columns[i].type != types[i]) {
+                        throw std::runtime_error("Column " + schema.columns[i].name + " of " + table.getName() +
+                                                 " does not have the typed table's column type");
+                    }
+                }
+            }
+
+            RowId insert(const Record& record) {
+                return insert(std::vector<Record>{record})[0];
+            }
+
+            // nothing is written unless every row passes the unique checks
+            std::vector<RowId> insert(const std::vector<Record>& records) {
+                QueryArena arena;
+                std::vector<Row*> rows;
+                rows.reserve(records.size());
+                for (const Record& record : records) {
+                    rows.push_back(record.to_row(&arena));
+                }
+                return theTable.insert_rows(rows);
+            }
+
+            // calls visit with every row, a heap table in slot order
+            template <typename Visit>
+            void scan(Visit&& visit) const {
+                HeapFile* heapfile = theTable.getHeapFile();
+                if (heapfile == nullptr || theTable.engine() != TableEngine::HEAP) {
+                    QueryArena arena;
+                    for (Row* row : theTable.scan(&arena)) {
+                        visit(static_cast<const Record&>(Record::from_row(*row)));
+                    }
+                    return;
+                }
+
+                Record record;
+                scan_heap_slots(heapfile, [&](const RowId& rid, const u8* slot) {
+                    if (Record::matches_slot(slot)) {
+                        record.load_slot(slot);
+                        record.id = rid;
+                    } else {
+                        QueryArena arena;
+                        Row* row = deserialize_row(heapfile, const_cast<u8*>(slot), SLOT_SIZE, &arena);
+                        record = Record::from_row(*row);
+                        record.id = rid;
+                    }
+                    visit(static_cast<const Record&>(record));
+                });
+            }
+
+            std::vector<Record> scan() const {
+                std::vector<Record> out;
+                scan([&](const Record& record) { out.push_back(record); });
+                return out;
+            }
+
+            std::optional<Record> get(const RowId& rid) const {
+                QueryArena arena;
+                Row* row = theTable.read_row(rid, &arena);
+                if (row == nullptr) {
+                    return std::nullopt;
+                }
+                return Record::from_row(*row);
+            }
+
+            Table& table() const { return theTable; }
+
+        private:
+            Table& theTable;
+    };
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "storage-manager/StorageStructs.hpp"
+
+#include <optional>
+#include <vector>
+
+#define ZONE_MAX_COLUMNS 16 // columns past this are never used to skip pages
+#define ZONE_KIND_EMPTY 0   // no non null value seen yet
+#define ZONE_KIND_STRING 2
+#define ZONE_KIND_MIXED 3   // values of more than one tag, which compare by tag
+#define ZONE_KIND_NUMBER 4  // plus the value's tag. Files older than that used 1
+                            // for numbers of any tag, which no range matches
+
+namespace DB {
+    // min and max as order preserving 64 bit keys. Numbers of one tag are
+    // compared as doubles, strings by their first 8 bytes, so bounds may be
+    // loose but never too tight. Values of different tags compare by tag, so
+    // only a range of the zone's own kind is checked against it
+    struct ColumnZone {
+        u64 min;
+        u64 max;
+        u16 null_count;
+        u8  kind;
+        u8  pad[5];
+    };
+
+    struct PageZone {
+        u32         rows; // rows added since the page was last empty, 0 means unknown
+        u32         pad;
+        ColumnZone  columns[ZONE_MAX_COLUMNS];
+    };
+
+    // Inclusive bounds on one column, either may be open. A page is skipped
+    // when none of its values can fall inside them.
+    struct ZoneRange {
+        u8                      col;
+        std::optional<datatype> low;
+        std::optional<datatype> high;
+    };
+
+    /**
+     * Min, max and null count of every column for each heap page, kept in
+     * <table>.zone at page_num * sizeof(PageZone). Zones only ever widen on
+     * insert and update, deletes leave them as they are, so they always cover
+     * the live rows. A page's zone starts over once the page is empty again.
+     */
+    class ZoneMap {
+        public:
+            void    open(const string& path);
+            void    add_row(u32 page, const Row* row);
+            void    merge(u32 dst, u32 src); // rows of src were moved into dst
+            void    reset(u32 page);
+            void    truncate(u32 numPages);  // drops the zones of pages past numPages
+            bool    may_match(u32 page, const std::vector<ZoneRange>& ranges) const;
+
+            static u64 zone_key(const datatype& val, u8& kind);
+
+        private:
+            int                     theFd = -1;
+            std::vector<PageZone>   theZones; // indexed by page number, 0 unused
+
+            PageZone&   zone(u32 page);
+            void        write_zone(u32 page);
+    };
+}
@@ -5,25 +5,39 @@
 #include "storage-manager/ops/StorageOps.hpp"
 
 namespace DB {
+    // Narrows the selection of chunk to the rows whose column col compares true
+    // against value, with the semantics of comparing datatypes. A packed INT,
+    // INT64, FLOAT or DOUBLE column compared to a value of its own type goes
+    // through the SIMD kernels, anything else is compared value by value. A
+    // null, or a column the chunk doesn't have, matches nothing
+    void select_compare(DataChunk& chunk, size_t col, CompareOp op, const datatype& value);
+
+    // Rows whose column col compares true against value, cond is one of
+    // = <> != < <= > >=
     class Selection : public StorageOps {
         public: 
-            Selection(StorageOps* child, CondFn cond);
+            Selection(StorageOpsPtr child, size_t col, string cond, datatype value);
             void open() override;
             void close() override;
         protected:
-            StorageOps*     childOp;
+            StorageOpsPtr   childOp;
+            size_t          column;
             CondFn          condition;
+            CompareOp       op;
+            datatype        value;
     };
 
+    // calls condition once a row
     struct NaiveSelection : public Selection {
-        NaiveSelection(StorageOps* child, CondFn cond)
-            : Selection(child, cond) {}
-        std::vector<Row*> next() override;
+        NaiveSelection(StorageOpsPtr child, size_t col, string cond, datatype value)
+            : Selection(std::move(child), col, cond, value) {}
+        bool next(DataChunk& out) override;
     };
 
+    // compares a whole column of the chunk at a time with select_compare
     struct VectorizedSelection : public Selection {
-        VectorizedSelection(StorageOps* child, CondFn cond)
-            : Selection(child, cond) {}
-        std::vector<Row*> next() override;
+        VectorizedSelection(StorageOpsPtr child, size_t col, string cond, datatype value)
+            : Selection(std::move(child), col, cond, value) {}
+        bool next(DataChunk& out) override;
     };
 }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "general/Types.hpp"
+#include "general/Comparison.hpp"
+
+namespace DB {
+    /**
+     * Comparison kernels over a packed column. Each writes the positions i
+     * in [0, n) where data[i] op value holds to sel, ascending, and returns
+     * how many it wrote. sel needs room for n positions.
+     *
+     * They run with AVX2 or SSE4.2 when the cpu has them, picked once on the
+     * first call, and fall back to a branchless scalar loop otherwise. The
+     * results are the same as the C++ comparison operators, NaN included.
+     */
+    size_t  select_values(const int* data, size_t n, CompareOp op, int value, u32* sel);
+    size_t  select_values(const int64_t* data, size_t n, CompareOp op, int64_t value, u32* sel);
+    size_t  select_values(const float* data, size_t n, CompareOp op, float value, u32* sel);
+    size_t  select_values(const double* data, size_t n, CompareOp op, double value, u32* sel);
+
+    enum class SelectionIsa { SCALAR, SSE42, AVX2 };
+
+    // the instruction set the kernels run with
+    SelectionIsa    selection_isa();
+    // forces the kernels onto isa, or the best one the cpu has if it has not got it
+    void            set_selection_isa(SelectionIsa isa);
+}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "storage-manager/Table.hpp"
+#include "storage-manager/DataChunk.hpp"
 
+#include <memory>
+#include <optional>
 #include <tuple>
 #include <vector>
 
@@ -19,28 +22,131 @@ namespace DB {
     };
 
     // Vectorized model of Operations
-    // Operations act on the return of next() from other operations
+    // Operations act on the chunks next() gets from other operations
     struct StorageOps {
         virtual ~StorageOps() = default;
         //set to 0 means pure virtual function
         virtual void open() = 0; // initializes resources
-        virtual std::vector<Row*> next() = 0; // produces block of tuples (size of cacheline and does operation on it)
+        virtual bool next(DataChunk& out) = 0; // fills out with a batch of at least one selected row, false once there are none left
         virtual void close() = 0 ;// closes all the resources
         void print(std::vector<Row*>& output);
     };
 
+    // an operator owns its inputs, deleting the root of a tree deletes all of it
+    using StorageOpsPtr = std::unique_ptr<StorageOps>;
+
+    // Reads the table batchSize rows at a time from a page and slot (or key)
+    // cursor, so the scan itself never holds more than one batch.
+    // Every scan decodes a batch into its scratch arena and copies it into the
+    // chunk, the arena is emptied by the next batch
     class SeqScan : public StorageOps {
         public:
             SeqScan(const Table& table, size_t batchSize);
 
             void open() override;
-            std::vector<Row*> next() override;
+            bool next(DataChunk& out) override;
+            void close() override;
+
+            // checked on encoded slots so rows that cannot match are never decoded
+            void pushdown(StringPredicate pred) { options.predicates.push_back(std::move(pred)); }
+            // pages whose zone map rules the range out are never read
+            void pushdownRange(ZoneRange range) { options.ranges.push_back(std::move(range)); }
+            // columns the query reads, out of line values of the others are never fetched
+            void setColumns(std::vector<bool> columns) { options.columns = std::move(columns); }
+            const Table& getTable() const { return table; }
+
+        private:
+            const Table& table;
+            HeapScanOptions options;
+            size_t batchSize;
+            TableCursor cursor;
+            QueryArena scratch; // decoded rows of the current batch
+    };
+
+    // Rows whose indexed column falls in [low, high], either bound may be open.
+    // Bounds are inclusive, the filter above rechecks the exact predicate
+    class IndexScan : public StorageOps {
+        public:
+            IndexScan(const Table& table, const BPlusTree& index, std::optional<IndexKey> low,
+                      std::optional<IndexKey> high, size_t batchSize);
+
+            void open() override;
+            bool next(DataChunk& out) override;
             void close() override;
 
         private:
             const Table& table;
+            const BPlusTree& index;
+            std::optional<IndexKey> low;
+            std::optional<IndexKey> high;
+            BPlusTree::Iterator it;
             size_t batchSize;
+            QueryArena scratch;
+    };
+
+    // Rows whose hash indexed column equals key, the bucket is read once in open()
+    class HashIndexLookup : public StorageOps {
+        public:
+            HashIndexLookup(const Table& table, const HashIndex& index, IndexKey key,
+                            size_t batchSize);
+
+            void open() override;
+            bool next(DataChunk& out) override;
+            void close() override;
+
+        private:
+            const Table& table;
+            const HashIndex& index;
+            IndexKey key;
+            std::vector<RowId> rids;
             size_t cursor;
+            size_t batchSize;
+            QueryArena scratch;
+    };
+
+    // Rows at the positions of a bitmap built from bitmap indexes, in heap order
+    class BitmapScan : public StorageOps {
+        public:
+            BitmapScan(const Table& table, RoaringBitmap rows, size_t batchSize);
+
+            void open() override;
+            bool next(DataChunk& out) override;
+            void close() override;
+
+        private:
+            const Table& table;
+            RoaringBitmap rows;
+            std::vector<u32> positions;
+            size_t cursor;
+            size_t batchSize;
+            QueryArena scratch;
+    };
+
+    enum class SampleMethod { SYSTEM, BERNOULLI };
+
+    // TABLESAMPLE. SYSTEM keeps each page with the sample probability and returns
+    // all of its rows, BERNOULLI keeps each row with it. The pages to read are
+    // picked by id from the free space map in open(), BERNOULLI only reads pages
+    // that got at least one row picked. Nothing else of the table is read
+    class SampleScan : public StorageOps {
+        public:
+            SampleScan(const Table& table, SampleMethod method, double percent,
+                       std::optional<u64> seed, size_t batchSize);
+
+            void open() override;
+            bool next(DataChunk& out) override;
+            void close() override;
+
+        private:
+            const Table& table;
+            SampleMethod method;
+            double fraction;
+            std::optional<u64> seed; // same seed, same sample while the table is unchanged
+            std::vector<u32> pages;  // ascending
+            std::vector<u32> slots;  // BERNOULLI, bit i set keeps slot i of pages[k]
+            size_t cursor;
+            size_t batchSize;
+            QueryArena scratch;
     };
 
     // struct Join : StorageOps {
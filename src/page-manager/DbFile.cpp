@@ -52,6 +52,20 @@ namespace DB {
                 throw std::system_error(errno, std::generic_category(), "Error creating HeapFile directory\n");
             } 
         }
+
+        path = db_path + "/indexes";
+        if (mkdir(path.c_str(), 0755) == -1) {
+            if (errno != EEXIST) {
+                throw std::system_error(errno, std::generic_category(), "Error creating Index directory\n");
+            } 
+        }
+
+        path = db_path + "/lsm";
+        if (mkdir(path.c_str(), 0755) == -1) {
+            if (errno != EEXIST) {
+                throw std::system_error(errno, std::generic_category(), "Error creating LSM directory\n");
+            }
+        }
         theDbFd = add_filepath(db_path+"/database.db");
     }
 
@@ -134,14 +148,17 @@ namespace DB {
     }
 
     int DbFile::get_filepath(const string& path) {
-        if(!theFdMap.contains(path)) {
+        std::lock_guard lock(theFdLock);
+        auto it = theFdMap.find(path);
+        if(it == theFdMap.end()) {
             return -1;
         }
-        return theFdMap[path];
+        return it->second;
     }
 
     int DbFile::add_filepath(const string& path) {
-        if(get_filepath(path) != -1) {
+        std::lock_guard lock(theFdLock);
+        if(theFdMap.contains(path)) {
             std::cout << "file descriptor already exists in map" << std::endl;
             return -1;
         }
@@ -155,9 +172,92 @@ namespace DB {
         return fd;
     }
 
+    int DbFile::remove_filepath(const string& path) {
+        std::lock_guard lock(theFdLock);
+        auto it = theFdMap.find(path);
+        if (it != theFdMap.end()) {
+            ::close(it->second);
+            theFdMap.erase(it);
+        }
+        if (::unlink(path.c_str()) != 0 && errno != ENOENT) {
+            perror("Could not remove file");
+            return -1;
+        }
+        return 0;
+    }
+
+    int DbFile::truncate(off_t length, int fd) {
+        checkIfFileDescriptorValid(fd);
+        if(ftruncate(fd, length) != 0) {
+            perror("Could not truncate file");
+            return -1;
+        }
+        return 0;
+    }
+
+    // A crash leaves either the old or the new contents at path, never a
+    // partial write: the bytes go to path.tmp, reach the disk, and only then
+    // does the rename publish them. The fd held for path would still point
+    // at the replaced inode, so it is swapped for the new file's.
+    int DbFile::replace_file(const string& path, const void* buffer, size_t num_bytes) {
+        string tmp_path = path + ".tmp";
+        int fd = ::open(tmp_path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "File " + tmp_path + " could not be created");
+        }
+        const char* bytes = static_cast<const char*>(buffer);
+        size_t written = 0;
+        while (written < num_bytes) {
+            ssize_t n = pwrite(fd, bytes + written, num_bytes - written, written);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                int err = errno;
+                ::close(fd);
+                throw std::system_error(err, std::generic_category(), "Could not write " + tmp_path);
+            }
+            written += n;
+        }
+        if (::fsync(fd) != 0 || ::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "Could not replace " + path);
+        }
+        // the rename itself lives in the directory entry
+        string dir = std::filesystem::path(path).parent_path().string();
+        int dir_fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dir_fd >= 0) {
+            ::fsync(dir_fd);
+            ::close(dir_fd);
+        }
+
+        std::lock_guard lock(theFdLock);
+        auto it = theFdMap.find(path);
+        if (it != theFdMap.end()) {
+            if (theDbFd == it->second) {
+                theDbFd = fd;
+            }
+            ::close(it->second);
+            it->second = fd;
+        } else {
+            theFdMap[path] = fd;
+        }
+        return fd;
+    }
+
     void DbFile::sync() {
 
     }
+
+    int DbFile::sync(int fd) {
+        checkIfFileDescriptorValid(fd);
+        if (::fsync(fd) != 0) {
+            perror("Could not sync file");
+            return -1;
+        }
+        return 0;
+    }
     
     void lock(DbFile::LockMode mode) {
 
@@ -19,32 +19,40 @@ namespace DB {
     
         // fill cache with pages 
         theCachePages = new Page[numPages];
+        theSlotKeys.resize(numPages);
         for(int i = 0; i < numPages; i++) {
             theFreePages.push_back(i);
         }
     };
 
-    void PageCache::evict_add_page(Page& page) {
-        if(theUsedPages.size() < NUM_PAGES) {
+    PageCache::~PageCache() {
+        delete[] theCachePages;
+    }
+
+    void PageCache::evict_add_page(Page& page, u64 key) {
+        auto cached = thePageMap.find(key);
+        if(cached != thePageMap.end()) {
+            theCachePages[cached->second] = page;
+        } //page already cached, refresh it in place
+        else if(theUsedPages.size() < NUM_PAGES) {
             // place page into cache
             size_t idx = theFreePages[theFreePages.size()-1];
 
             theFreePages.pop_back();
             theCachePages[idx] = page;
+            theSlotKeys[idx] = key;
             theUsedPages.push(idx);
-            thePageMap[page.id] = idx;
+            thePageMap[key] = idx;
 
         } //cache has space 
         else {
             size_t evicted_idx = theUsedPages.top();
-            Page evicted_page = theCachePages[evicted_idx];
-            theUsedPages.pop();
-            thePageMap.erase(evicted_page.id);
+            thePageMap.erase(theSlotKeys[evicted_idx]);
 
-            //place page into cache
+            //place page into cache, the slot stays in use
             theCachePages[evicted_idx] = page;
-            thePageMap[page.id] = evicted_idx;
-            std::cout << "evicted page " << evicted_page.id << std::endl;
+            theSlotKeys[evicted_idx] = key;
+            thePageMap[key] = evicted_idx;
         } //cache is full
     }
 
@@ -54,41 +62,51 @@ namespace DB {
         if(fd == -1) {
             fd = theDbFile.add_filepath(filepath);
         }
-        ssize_t bytes_written = theDbFile.write_at(page.id, page, fd);
-        std::cout << bytes_written << " bytes were written into " << filepath << std::endl;
-        
+        theDbFile.write_at(page.id, page, fd);
+
         //add page to cache
-        evict_add_page(page);
+        evict_add_page(page, page_key(fd, page.id));
         return true;
     }
 
     Page& PageCache::read(u32 pageId, Page& buffer, const string& filepath) {
+        int fd = theDbFile.get_filepath(filepath);
+
         //check cache to see if page exists
-        if(thePageMap.contains(pageId)) {
-            std::cout << "cache read hit" << std::endl;
-            size_t idx = thePageMap[pageId];
-            buffer = theCachePages[idx];
+        auto cached = thePageMap.find(page_key(fd, pageId));
+        if(cached != thePageMap.end()) {
+            buffer = theCachePages[cached->second];
             return buffer;
         }
-        else {
-            std::cout << "cache read miss" << std::endl;
-        }
 
         //read page into buffer from disk
-        int fd = theDbFile.get_filepath(filepath);
         if(fd == -1) {
             std::cout << "path is invalid" << std::endl;
         }
         //need to read from an address
-        ssize_t bytes_read = theDbFile.read_at(pageId, buffer, fd);
-
-        evict_add_page(buffer);
-        std::cout << bytes_read << " bytes were read from " << filepath << std::endl;
+        theDbFile.read_at(pageId, buffer, fd);
 
+        evict_add_page(buffer, page_key(fd, pageId));
 
         return buffer;
     }
 
+    void PageCache::invalidate(const string& filepath) {
+        int fd = theDbFile.get_filepath(filepath);
+        if(fd == -1) {
+            return;
+        }
+        // the slots stay on the used stack and get reused when they are next evicted
+        for(auto it = thePageMap.begin(); it != thePageMap.end();) {
+            if((u32)(it->first >> 32) == (u32)fd) {
+                theSlotKeys[it->second] = NO_PAGE_KEY;
+                it = thePageMap.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
     void PageCache::print() {
         std::cout << "----------PageCache----------" << std::endl;
         std::cout << "Cache Size: " << CACHE_SIZE << " bytes" << std::endl;
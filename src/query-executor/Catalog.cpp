@@ -0,0 +1,299 @@
+#include "query-executor/Catalog.hpp"
+#include "page-manager/DbFile.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace DB {
+
+namespace {
+
+void putBytes(std::vector<u8>& out, const void* data, size_t size) {
+    const u8* bytes = static_cast<const u8*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+void putString(std::vector<u8>& out, const string& s) {
+    u16 len = static_cast<u16>(s.size());
+    putBytes(out, &len, sizeof(len));
+    putBytes(out, s.data(), len);
+}
+
+// bounds checked reads over the record stream, a short record means a torn catalog
+struct Reader {
+    const u8* data;
+    size_t size;
+    size_t offset = 0;
+
+    void get(void* dst, size_t n) {
+        if (offset + n > size) {
+            throw std::runtime_error("Catalog is truncated");
+        }
+        std::memcpy(dst, data + offset, n);
+        offset += n;
+    }
+
+    template <typename T>
+    T get() {
+        T value;
+        get(&value, sizeof(T));
+        return value;
+    }
+
+    string getString() {
+        u16 len = get<u16>();
+        string s(len, '\0');
+        get(s.data(), len);
+        return s;
+    }
+};
+
+} // namespace
+
+Catalog::Catalog() {
+    DbFile& dbfile = DbFile::getInstance();
+    fd_ = dbfile.get_filepath(CATALOG_PATH);
+    if (fd_ == -1) {
+        fd_ = dbfile.add_filepath(CATALOG_PATH);
+    }
+    load();
+}
+
+Catalog::~Catalog() {
+    for (auto& [name, table] : tables_) {
+        closeTable(table);
+    }
+}
+
+void Catalog::closeTable(Table* table) {
+    delete table->getHeapFile();
+    delete table;
+}
+
+// [name][num cols u16] then [name][type u8][flags u8] per column,
+// [num indexes u16] then [name][column][type u8][unique u8] per index,
+// [row count u64][page count u64][has stats u8] then TableStats if set,
+// [partitioned u8] then the PartitionSpec if set, [engine u8].
+// Strings are [len u16][bytes]
+void Catalog::load() {
+    DbFile& dbfile = DbFile::getInstance();
+    std::vector<u8> buffer((size_t)CATALOG_READAHEAD_PAGES * PAGE_DATA_SIZE);
+    ssize_t bytes = dbfile.read_at(0, buffer.data(), buffer.size(), fd_);
+    if (bytes < (ssize_t)sizeof(CatalogHeader)) {
+        return; // new database
+    }
+
+    CatalogHeader header;
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    if (header.magic != CATALOG_MAGIC) {
+        return;
+    }
+    if (header.version != CATALOG_VERSION) {
+        throw std::runtime_error("Unsupported catalog version " + std::to_string(header.version));
+    }
+
+    // only catalogs past the readahead need a second read
+    size_t total = PAGE_DATA_SIZE + header.data_bytes;
+    if (total > (size_t)bytes) {
+        size_t have = (size_t)bytes;
+        buffer.resize(total);
+        if (dbfile.read_at(have, buffer.data() + have, total - have, fd_) != (ssize_t)(total - have)) {
+            throw std::runtime_error("Catalog is truncated");
+        }
+    }
+
+    Reader in{buffer.data() + PAGE_DATA_SIZE, header.data_bytes};
+    for (u32 t = 0; t < header.num_tables; t++) {
+        string name = in.getString();
+        CatalogEntry entry;
+        u16 numCols = in.get<u16>();
+        entry.schema.columns.reserve(numCols);
+        for (u16 c = 0; c < numCols; c++) {
+            string colName = in.getString();
+            ColumnType type = static_cast<ColumnType>(in.get<u8>());
+            u8 flags = in.get<u8>();
+            entry.schema.add_col(colName, type, flags & 1, flags & 2, flags & 4);
+        }
+        u16 numIndexes = in.get<u16>();
+        for (u16 i = 0; i < numIndexes; i++) {
+            IndexDef def;
+            def.name = in.getString();
+            def.column = in.getString();
+            def.type = static_cast<IndexType>(in.get<u8>());
+            def.unique = in.get<u8>() != 0;
+            entry.indexes.push_back(def);
+        }
+        entry.row_count = in.get<u64>();
+        entry.page_count = in.get<u64>();
+        if (in.get<u8>() != 0) {
+            TableStats stats;
+            size_t used = stats.deserialize(in.data + in.offset, in.size - in.offset);
+            if (used == 0) {
+                throw std::runtime_error("Catalog statistics are malformed for table: " + name);
+            }
+            in.offset += used;
+            entry.stats = std::move(stats);
+        }
+        if (in.get<u8>() != 0) {
+            PartitionSpec spec;
+            size_t used = spec.deserialize(in.data + in.offset, in.size - in.offset);
+            if (used == 0) {
+                throw std::runtime_error("Catalog partitioning is malformed for table: " + name);
+            }
+            in.offset += used;
+            entry.partitioning = std::move(spec);
+        }
+        entry.engine = static_cast<TableEngine>(in.get<u8>());
+        entries_[name] = std::move(entry);
+    }
+}
+
+void Catalog::save() {
+    // definitions and statistics of open tables may have moved on since they were recorded
+    for (auto& [name, table] : tables_) {
+        CatalogEntry& entry = entries_[name];
+        entry.indexes = table->index_defs();
+        HeapFile* heapfile = table->getHeapFile();
+        if (heapfile != nullptr) {
+            entry.row_count = heapfile->metadata.num_records;
+            entry.page_count = heapfile->metadata.num_pages;
+        }
+        if (table->statistics() != nullptr) {
+            entry.stats = *table->statistics();
+        }
+    }
+
+    std::vector<u8> buffer(PAGE_DATA_SIZE, 0);
+    for (const auto& [name, entry] : entries_) {
+        putString(buffer, name);
+        u16 numCols = static_cast<u16>(entry.schema.columns.size());
+        putBytes(buffer, &numCols, sizeof(numCols));
+        for (const SchemaCol& col : entry.schema.columns) {
+            putString(buffer, col.name);
+            u8 type = static_cast<u8>(col.type);
+            u8 flags = (col.nullable ? 1 : 0) | (col.is_primary_key ? 2 : 0) | (col.is_unique ? 4 : 0);
+            putBytes(buffer, &type, sizeof(type));
+            putBytes(buffer, &flags, sizeof(flags));
+        }
+        u16 numIndexes = static_cast<u16>(entry.indexes.size());
+        putBytes(buffer, &numIndexes, sizeof(numIndexes));
+        for (const IndexDef& def : entry.indexes) {
+            putString(buffer, def.name);
+            putString(buffer, def.column);
+            u8 type = static_cast<u8>(def.type);
+            u8 unique = def.unique ? 1 : 0;
+            putBytes(buffer, &type, sizeof(type));
+            putBytes(buffer, &unique, sizeof(unique));
+        }
+        putBytes(buffer, &entry.row_count, sizeof(entry.row_count));
+        putBytes(buffer, &entry.page_count, sizeof(entry.page_count));
+        u8 hasStats = entry.stats ? 1 : 0;
+        putBytes(buffer, &hasStats, sizeof(hasStats));
+        if (entry.stats) {
+            entry.stats->serialize(buffer);
+        }
+        u8 partitioned = entry.partitioning ? 1 : 0;
+        putBytes(buffer, &partitioned, sizeof(partitioned));
+        if (entry.partitioning) {
+            entry.partitioning->serialize(buffer);
+        }
+        u8 engine = static_cast<u8>(entry.engine);
+        putBytes(buffer, &engine, sizeof(engine));
+    }
+
+    CatalogHeader header;
+    header.magic = CATALOG_MAGIC;
+    header.version = CATALOG_VERSION;
+    header.num_tables = static_cast<u32>(entries_.size());
+    header.data_bytes = buffer.size() - PAGE_DATA_SIZE;
+    header.data_pages = static_cast<u32>((header.data_bytes + PAGE_DATA_SIZE - 1) / PAGE_DATA_SIZE);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    buffer.resize((size_t)(header.data_pages + 1) * PAGE_DATA_SIZE, 0);
+
+    DbFile& dbfile = DbFile::getInstance();
+    fd_ = dbfile.replace_file(CATALOG_PATH, buffer.data(), buffer.size());
+}
+
+void Catalog::addTable(const string& name, Table* table, std::optional<PartitionSpec> partitioning) {
+    tables_[name] = table;
+    CatalogEntry& entry = entries_[name];
+    entry.schema = table->getSchema();
+    entry.partitioning = std::move(partitioning);
+    entry.engine = table->engine();
+    save();
+}
+
+Table* Catalog::getTable(const string& name) {
+    auto it = tables_.find(name);
+    if (it != tables_.end()) {
+        return it->second;
+    }
+    auto entry = entries_.find(name);
+    if (entry == entries_.end()) {
+        return nullptr;
+    }
+
+    if (entry->second.partitioning) {
+        Table* parent = new Table(name, entry->second.schema);
+        tables_[name] = parent;
+        return parent;
+    }
+
+    Table* table;
+    if (entry->second.engine != TableEngine::HEAP) {
+        table = new Table(name, entry->second.schema, entry->second.engine,
+                          make_keyed_store(name, entry->second.engine, false));
+    } else {
+        HeapFile* heapfile = open_heapfile(name);
+        if (heapfile == NULL) {
+            throw std::runtime_error("Heap file missing for table: " + name);
+        }
+        table = new Table(name, entry->second.schema, *heapfile, entry->second.indexes);
+    }
+    if (entry->second.stats) {
+        table->set_statistics(*entry->second.stats);
+    }
+    tables_[name] = table;
+    return table;
+}
+
+bool Catalog::hasTable(const string& name) const {
+    return entries_.find(name) != entries_.end();
+}
+
+void Catalog::removeTable(const string& name) {
+    auto it = tables_.find(name);
+    if (it != tables_.end()) {
+        closeTable(it->second);
+        tables_.erase(it);
+    }
+    entries_.erase(name);
+    save();
+}
+
+const std::unordered_map<string, Table*>& Catalog::getAllTables() {
+    for (const auto& [name, entry] : entries_) {
+        getTable(name);
+    }
+    return tables_;
+}
+
+const CatalogEntry* Catalog::getEntry(const string& name) const {
+    auto it = entries_.find(name);
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+const PartitionSpec* Catalog::getPartitioning(const string& name) const {
+    auto it = entries_.find(name);
+    if (it == entries_.end() || !it->second.partitioning) {
+        return nullptr;
+    }
+    return &*it->second.partitioning;
+}
+
+void Catalog::setPartitioning(const string& name, PartitionSpec partitioning) {
+    entries_[name].partitioning = std::move(partitioning);
+    save();
+}
+
+} // namespace DB
@@ -0,0 +1,228 @@
+#include "query-executor/CompiledExpr.hpp"
+
+#include <algorithm>
+
+namespace DB {
+
+int findColumn(const Schema& schema, const Expression& ref, size_t from, size_t to) {
+    const string& name = ref.column_name;
+    to = std::min(to, schema.columns.size());
+    for (size_t i = from; i < to; i++) {
+        const string& col = schema.columns[i].name;
+        if (col == name) return static_cast<int>(i);
+
+        size_t dot = col.find('.');
+        if (dot == string::npos || col.compare(dot + 1, string::npos, name) != 0) continue;
+        if (ref.table_name.empty() || col.compare(0, dot, ref.table_name) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+CompiledExpr::CompiledExpr(const ExprPtr& expr, const Schema& schema) {
+    result_ = compile(expr, schema);
+}
+
+datatype CompiledExpr::literalValue(const ExprPtr& expr) {
+    switch (expr->type) {
+        case ExprType::LITERAL_INT:
+            return static_cast<int>(std::get<int64_t>(expr->literal_value));
+        case ExprType::LITERAL_FLOAT:
+            return static_cast<float>(std::get<double>(expr->literal_value));
+        case ExprType::LITERAL_STRING:
+            return std::get<string>(expr->literal_value);
+        case ExprType::LITERAL_BOOL:
+            return std::get<bool>(expr->literal_value);
+        case ExprType::LITERAL_NULL:
+            return datatype::null();
+        default:
+            return 0;
+    }
+}
+
+u32 CompiledExpr::constant(datatype val) {
+    registers_.push_back(std::move(val));
+    return static_cast<u32>(registers_.size() - 1);
+}
+
+u32 CompiledExpr::allocate() {
+    registers_.emplace_back();
+    return static_cast<u32>(registers_.size() - 1);
+}
+
+void CompiledExpr::emit(OpCode code, u32 dst, u32 a, u32 b, u32 n, CompareOp cmp) {
+    code_.push_back({code, cmp, dst, a, b, n});
+}
+
+// returns the register that holds the value of expr once its code has run
+u32 CompiledExpr::compile(const ExprPtr& expr, const Schema& schema) {
+    if (!expr) return constant(false);
+
+    switch (expr->type) {
+        case ExprType::LITERAL_INT:
+        case ExprType::LITERAL_FLOAT:
+        case ExprType::LITERAL_STRING:
+        case ExprType::LITERAL_BOOL:
+        case ExprType::LITERAL_NULL:
+            return constant(literalValue(expr));
+
+        case ExprType::COLUMN_REF: {
+            int col = findColumn(schema, *expr);
+            if (col < 0) return constant(0);
+            u32 dst = allocate();
+            emit(OpCode::COLUMN, dst, static_cast<u32>(col));
+            return dst;
+        }
+
+        case ExprType::BINARY_OP: {
+            if (expr->binary_op == BinaryOp::AND || expr->binary_op == BinaryOp::OR) {
+                u32 dst = allocate();
+                emit(OpCode::TRUTH, dst, compile(expr->children[0], schema));
+                size_t jump = code_.size();
+                emit(expr->binary_op == BinaryOp::AND ? OpCode::JUMP_IF_FALSE : OpCode::JUMP_IF_TRUE, 0, dst);
+                emit(OpCode::TRUTH, dst, compile(expr->children[1], schema));
+                code_[jump].b = static_cast<u32>(code_.size());
+                return dst;
+            }
+
+            CompareOp cmp;
+            switch (expr->binary_op) {
+                case BinaryOp::EQ: cmp = CompareOp::EQ; break;
+                case BinaryOp::NE: cmp = CompareOp::NE; break;
+                case BinaryOp::LT: cmp = CompareOp::LT; break;
+                case BinaryOp::LE: cmp = CompareOp::LE; break;
+                case BinaryOp::GT: cmp = CompareOp::GT; break;
+                case BinaryOp::GE: cmp = CompareOp::GE; break;
+                default: return constant(false);
+            }
+            u32 left = compile(expr->children[0], schema);
+            u32 right = compile(expr->children[1], schema);
+            u32 dst = allocate();
+            emit(OpCode::COMPARE, dst, left, right, 0, cmp);
+            return dst;
+        }
+
+        case ExprType::IN_LIST: {
+            u32 val = compile(expr->children[0], schema);
+            std::vector<u32> items;
+            for (const auto& item : expr->in_list) {
+                items.push_back(compile(item, schema));
+            }
+            u32 first = static_cast<u32>(operands_.size());
+            operands_.insert(operands_.end(), items.begin(), items.end());
+            u32 dst = allocate();
+            emit(OpCode::IN, dst, val, first, static_cast<u32>(items.size()));
+            return dst;
+        }
+
+        case ExprType::UNARY_OP: {
+            u32 val = compile(expr->children[0], schema);
+            OpCode code;
+            switch (expr->unary_op) {
+                case UnaryOp::NOT: code = OpCode::NOT; break;
+                case UnaryOp::IS_NULL: code = OpCode::IS_NULL; break;
+                case UnaryOp::IS_NOT_NULL: code = OpCode::IS_NOT_NULL; break;
+                case UnaryOp::MINUS: code = OpCode::NEGATE; break;
+                case UnaryOp::PLUS: return val;
+                default: return constant(false);
+            }
+            u32 dst = allocate();
+            emit(code, dst, val);
+            return dst;
+        }
+
+        default:
+            return constant(false);
+    }
+}
+
+template <typename Load>
+const datatype& CompiledExpr::run(const Load& load) {
+    datatype* r = registers_.data();
+    const Instruction* code = code_.data();
+    size_t end = code_.size();
+    for (size_t pc = 0; pc < end; pc++) {
+        const Instruction& in = code[pc];
+        switch (in.code) {
+            case OpCode::COLUMN:
+                r[in.dst] = load(in.a);
+                break;
+            case OpCode::COMPARE:
+                r[in.dst] = !r[in.a].is_null() && !r[in.b].is_null() &&
+                            compare_values(in.cmp, r[in.a], r[in.b]);
+                break;
+            case OpCode::TRUTH:
+                r[in.dst] = isTrue(r[in.a]);
+                break;
+            case OpCode::NOT:
+                r[in.dst] = !isTrue(r[in.a]);
+                break;
+            case OpCode::IS_NULL:
+                r[in.dst] = r[in.a].is_null();
+                break;
+            case OpCode::IS_NOT_NULL:
+                r[in.dst] = !r[in.a].is_null();
+                break;
+            case OpCode::NEGATE:
+                r[in.dst] = negate(r[in.a]);
+                break;
+            case OpCode::IN: {
+                bool found = false;
+                if (r[in.a].is_null()) {
+                    r[in.dst] = false;
+                    break;
+                }
+                for (u32 i = 0; i < in.n && !found; i++) {
+                    found = r[operands_[in.b + i]] == r[in.a];
+                }
+                r[in.dst] = found;
+                break;
+            }
+            case OpCode::JUMP_IF_FALSE:
+                if (!r[in.a].get<bool>()) pc = in.b - 1;
+                break;
+            case OpCode::JUMP_IF_TRUE:
+                if (r[in.a].get<bool>()) pc = in.b - 1;
+                break;
+        }
+    }
+    return r[result_];
+}
+
+datatype CompiledExpr::negate(const datatype& val) {
+    switch (val.index()) {
+        case 0: return -val.get<int>();
+        case 1: return -val.get<float>();
+        case 4: return -val.get<int64_t>();
+        case 5: return -val.get<double>();
+        default: return datatype::null();
+    }
+}
+
+// a value past the end of the row is missing, a null as it is in a chunk
+static datatype rowValue(const Row* row, size_t col) {
+    if (col >= row->values.size()) return datatype::null();
+    return row->values[col];
+}
+
+const datatype& CompiledExpr::evaluate(const Row* row) {
+    return run([&](u32 col) { return rowValue(row, col); });
+}
+
+const datatype& CompiledExpr::evaluate(const DataChunk& chunk, u32 row) {
+    return run([&](u32 col) {
+        if (col >= chunk.num_cols() || chunk.is_null(col, row)) return datatype::null();
+        return chunk.get(col, row);
+    });
+}
+
+const datatype& CompiledExpr::evaluate(const Row* left, const Row* right, size_t left_width) {
+    return run([&](u32 col) {
+        const Row* side = col < left_width ? left : right;
+        size_t i = col < left_width ? col : col - left_width;
+        return rowValue(side, i);
+    });
+}
+
+} // namespace DB
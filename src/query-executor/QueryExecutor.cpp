@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
 namespace DB {
 
@@ -65,6 +66,18 @@ QueryResult QueryExecutor::executeRA(const RANodePtr& ra_tree) {
         case RANodeType::DROP_TABLE_OP:
             return executeDropTable(ra_tree);
 
+        case RANodeType::CREATE_INDEX_OP:
+            return executeCreateIndex(ra_tree);
+
+        case RANodeType::VACUUM_OP:
+            return executeVacuum(ra_tree);
+
+        case RANodeType::ANALYZE_OP:
+            return executeAnalyze(ra_tree);
+
+        case RANodeType::ALTER_TABLE_OP:
+            return executeAlterTable(ra_tree);
+
         default:
             QueryResult result;
             result.success = false;
@@ -73,77 +86,572 @@ QueryResult QueryExecutor::executeRA(const RANodePtr& ra_tree) {
     }
 }
 
-StorageOps* QueryExecutor::buildOperatorTree(const RANodePtr& node) {
+// adds every column an expression reads, returns false if it needs all of them
+static bool collectExprColumns(const ExprPtr& expr, std::unordered_set<string>& cols) {
+    if (!expr) return true;
+    if (expr->type == ExprType::COLUMN_REF) {
+        if (expr->column_name == "*") return false;
+        cols.insert(expr->column_name);
+        return true;
+    }
+    for (const auto& child : expr->children) {
+        if (!collectExprColumns(child, cols)) return false;
+    }
+    for (const auto& item : expr->in_list) {
+        if (!collectExprColumns(item, cols)) return false;
+    }
+    return true;
+}
+
+// columns any operator in the tree reads, returns false if it needs all of them
+static bool collectReferencedColumns(const RANodePtr& node, std::unordered_set<string>& cols) {
+    if (!node) return true;
+    if (node->type == RANodeType::PROJECT && node->select_all) return false;
+
+    for (const auto& proj : node->projections) {
+        if (!proj || !collectExprColumns(proj, cols)) return false;
+    }
+    if (!collectExprColumns(node->predicate, cols) ||
+        !collectExprColumns(node->join_condition, cols) ||
+        !collectExprColumns(node->having_predicate, cols)) {
+        return false;
+    }
+    for (const auto& group : node->group_by_exprs) {
+        if (!collectExprColumns(group, cols)) return false;
+    }
+    for (const auto& spec : node->order_specs) {
+        cols.insert(spec.column);
+    }
+    return collectReferencedColumns(node->left, cols) &&
+           collectReferencedColumns(node->right, cols);
+}
+
+static void collectConjuncts(const ExprPtr& expr, std::vector<ExprPtr>& out) {
+    if (expr && expr->type == ExprType::BINARY_OP && expr->binary_op == BinaryOp::AND) {
+        collectConjuncts(expr->children[0], out);
+        collectConjuncts(expr->children[1], out);
+        return;
+    }
+    out.push_back(expr);
+}
+
+// splits `column op literal` (either way round) into its parts, op as if the column were on the left
+static bool splitComparison(const ExprPtr& expr, ExprPtr& column, ExprPtr& literal, BinaryOp& op) {
+    if (!expr || expr->type != ExprType::BINARY_OP) return false;
+    op = expr->binary_op;
+    if (op != BinaryOp::EQ && op != BinaryOp::LT && op != BinaryOp::LE &&
+        op != BinaryOp::GT && op != BinaryOp::GE) {
+        return false;
+    }
+    column = expr->children[0];
+    literal = expr->children[1];
+    if (literal->type == ExprType::COLUMN_REF && column->type != ExprType::COLUMN_REF) {
+        std::swap(column, literal);
+        if (op == BinaryOp::LT) op = BinaryOp::GT;
+        else if (op == BinaryOp::LE) op = BinaryOp::GE;
+        else if (op == BinaryOp::GT) op = BinaryOp::LT;
+        else if (op == BinaryOp::GE) op = BinaryOp::LE;
+    }
+    return column->type == ExprType::COLUMN_REF;
+}
+
+// the tag INSERT stores a literal of a column of this type with
+static size_t storedTag(ColumnType type) {
+    switch (type) {
+        case ColumnType::FLOAT:
+        case ColumnType::DOUBLE: return datatype(0.0f).index();
+        case ColumnType::CHAR:
+        case ColumnType::STRING: return datatype(string()).index();
+        case ColumnType::BOOL:   return datatype(false).index();
+        default:                 return datatype(0).index();
+    }
+}
+
+// literal side of a comparison as a value of the indexed column, if the index can
+// use it. Values of different tags compare by tag, not by number, so a literal is
+// only turned into a key when it has the tag the column's values are stored with,
+// as select_compare only runs its kernels on a column of the literal's type
+static std::optional<datatype> indexLiteral(const ExprPtr& expr, ColumnType type) {
+    if (expr->type != ExprType::LITERAL_INT && expr->type != ExprType::LITERAL_FLOAT &&
+        expr->type != ExprType::LITERAL_STRING) {
+        return std::nullopt;
+    }
+    datatype val = CompiledExpr::literalValue(expr);
+    if (val.index() != storedTag(type)) return std::nullopt;
+    return val;
+}
+
+// Turns comparisons of an indexed column against literals into index bounds.
+// Equality on a hash index is preferred, then B+tree equality, then a range.
+// The bounds are inclusive and may be looser than the predicate, which stays in the FilterOp above the scan.
+StorageOpsPtr QueryExecutor::planIndexScan(Table* table, const ExprPtr& predicate) {
+    if (!predicate || table->getIndexes().empty()) return nullptr;
+    const Schema& schema = table->getSchema();
+
+    struct Bounds {
+        std::optional<IndexKey> low;
+        std::optional<IndexKey> high;
+        bool equality = false;
+        bool hashed = false; // an equality on a hash indexed column
+    };
+    std::unordered_map<int, Bounds> bounds;
+
+    std::vector<ExprPtr> conjuncts;
+    collectConjuncts(predicate, conjuncts);
+    for (const auto& conjunct : conjuncts) {
+        ExprPtr column, literal;
+        BinaryOp op;
+        if (!splitComparison(conjunct, column, literal, op)) continue;
+
+        int col_idx = getColumnIndex(schema, column->column_name);
+        if (col_idx < 0) continue;
+        bool hashed = op == BinaryOp::EQ && table->get_hash_index(col_idx);
+        if (!hashed && !table->get_btree(col_idx)) continue;
+        std::optional<datatype> val = indexLiteral(literal, schema.columns[col_idx].type);
+        if (!val) continue;
+
+        IndexKey key = make_index_key(*val, schema.columns[col_idx].type);
+        bool tightenLow = op == BinaryOp::EQ || op == BinaryOp::GT || op == BinaryOp::GE;
+        bool tightenHigh = op == BinaryOp::EQ || op == BinaryOp::LT || op == BinaryOp::LE;
+
+        Bounds& b = bounds[col_idx];
+        if (tightenLow && (!b.low || compare_keys(key, *b.low) > 0)) b.low = key;
+        if (tightenHigh && (!b.high || compare_keys(key, *b.high) < 0)) b.high = key;
+        b.equality = b.equality || op == BinaryOp::EQ;
+        b.hashed = b.hashed || hashed;
+    }
+
+    if (bounds.empty()) return nullptr;
+    auto rank = [](const Bounds& b) { return b.hashed ? 2 : b.equality ? 1 : 0; };
+    auto best = bounds.begin();
+    for (auto it = bounds.begin(); it != bounds.end(); ++it) {
+        if (rank(it->second) > rank(best->second)) best = it;
+    }
+    const Bounds& b = best->second;
+    // the key is both bounds, unless other conjuncts made them disagree
+    if (b.hashed && compare_keys(*b.low, *b.high) == 0) {
+        return std::make_unique<HashIndexLookup>(*table, *table->get_hash_index(best->first), *b.low,
+                                                 CHUNK_CAPACITY);
+    }
+    if (!table->get_btree(best->first)) return nullptr;
+    return std::make_unique<IndexScan>(*table, *table->get_btree(best->first), best->second.low,
+                                       best->second.high, CHUNK_CAPACITY);
+}
+
+// rows a predicate can match according to the bitmap indexes. exact means the
+// bitmap holds exactly the matching rows, otherwise it may hold extra ones
+struct BitmapPlan {
+    RoaringBitmap rows;
+    bool exact;
+};
+
+static std::optional<BitmapPlan> bitmapFor(Table* table, const ExprPtr& expr, const RoaringBitmap& universe) {
+    if (!expr) return std::nullopt;
+    const Schema& schema = table->getSchema();
+
+    if (expr->type == ExprType::BINARY_OP &&
+        (expr->binary_op == BinaryOp::AND || expr->binary_op == BinaryOp::OR)) {
+        std::optional<BitmapPlan> left = bitmapFor(table, expr->children[0], universe);
+        std::optional<BitmapPlan> right = bitmapFor(table, expr->children[1], universe);
+        if (expr->binary_op == BinaryOp::AND) {
+            // a side without an index only narrows things further, the filter checks it
+            if (!left || !right) {
+                if (left) left->exact = false;
+                if (right) right->exact = false;
+                return left ? left : right;
+            }
+            left->rows &= right->rows;
+        } else {
+            if (!left || !right) return std::nullopt;
+            left->rows |= right->rows;
+        }
+        left->exact = left->exact && right->exact;
+        return left;
+    }
+
+    if (expr->type == ExprType::UNARY_OP && expr->unary_op == UnaryOp::NOT) {
+        std::optional<BitmapPlan> inner = bitmapFor(table, expr->children[0], universe);
+        if (!inner || !inner->exact) return std::nullopt;
+        RoaringBitmap rows = universe;
+        rows -= inner->rows;
+        return BitmapPlan{std::move(rows), true};
+    }
+
+    ExprPtr column;
+    std::vector<ExprPtr> literals;
+    BinaryOp op = BinaryOp::EQ;
+    if (expr->type == ExprType::IN_LIST && expr->children[0]->type == ExprType::COLUMN_REF) {
+        column = expr->children[0];
+        literals = expr->in_list;
+    } else if (expr->type == ExprType::BINARY_OP && expr->binary_op == BinaryOp::NE &&
+               expr->children[0]->type == ExprType::COLUMN_REF) {
+        column = expr->children[0];
+        literals.push_back(expr->children[1]);
+        op = BinaryOp::NE;
+    } else {
+        ExprPtr literal;
+        if (!splitComparison(expr, column, literal, op)) return std::nullopt;
+        literals.push_back(literal);
+    }
+
+    int col_idx = -1;
+    for (size_t i = 0; i < schema.columns.size(); i++) {
+        if (schema.columns[i].name == column->column_name) col_idx = static_cast<int>(i);
+    }
+    if (col_idx < 0) return std::nullopt;
+    BitmapIndex* index = table->get_bitmap_index(col_idx);
+    if (!index) return std::nullopt;
+
+    ColumnType type = schema.columns[col_idx].type;
+    BitmapPlan plan{RoaringBitmap(), true};
+    for (const auto& literal : literals) {
+        std::optional<datatype> val = indexLiteral(literal, type);
+        if (!val) return std::nullopt;
+        // strings longer than a key share it with every string of the same prefix
+        if (type == ColumnType::STRING && val->get<string>().size() >= INDEX_KEY_SIZE) {
+            plan.exact = false;
+        }
+
+        IndexKey key = make_index_key(*val, type);
+        RoaringBitmap equal = index->match(key, key);
+        switch (op) {
+            case BinaryOp::EQ: plan.rows |= equal; break;
+            case BinaryOp::LE: plan.rows |= index->match(std::nullopt, key); break;
+            case BinaryOp::GE: plan.rows |= index->match(key, std::nullopt); break;
+            case BinaryOp::LT:
+            case BinaryOp::GT:
+            case BinaryOp::NE: {
+                RoaringBitmap rows = op == BinaryOp::LT ? index->match(std::nullopt, key)
+                                   : op == BinaryOp::GT ? index->match(key, std::nullopt)
+                                   : index->all();
+                if (plan.exact) rows -= equal;
+                plan.rows |= rows;
+                break;
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+    return plan;
+}
+
+// Evaluates the predicate's tests on bitmap indexed columns as bitmap AND, OR and
+// NOT, so only rows that can match are read from the heap. Left to planIndexScan
+// when a point lookup on another index is available.
+StorageOpsPtr QueryExecutor::planBitmapScan(Table* table, const ExprPtr& predicate) {
+    if (!predicate) return nullptr;
+
+    BitmapIndex* any = nullptr;
+    for (const auto& index : table->getIndexes()) {
+        if (index->type == IndexType::BITMAP) {
+            any = static_cast<BitmapIndex*>(index->impl.get());
+            break;
+        }
+    }
+    if (!any) return nullptr;
+
+    // only equalities planIndexScan can turn into a key win over the bitmaps
+    std::vector<ExprPtr> conjuncts;
+    collectConjuncts(predicate, conjuncts);
+    for (const auto& conjunct : conjuncts) {
+        ExprPtr column, literal;
+        BinaryOp op;
+        if (!splitComparison(conjunct, column, literal, op) || op != BinaryOp::EQ) continue;
+        int col_idx = getColumnIndex(table->getSchema(), column->column_name);
+        if (col_idx >= 0 && (table->get_hash_index(col_idx) || table->get_btree(col_idx)) &&
+            indexLiteral(literal, table->getSchema().columns[col_idx].type)) {
+            return nullptr;
+        }
+    }
+
+    // every row is in every bitmap index once, so any of them gives all rows for NOT
+    std::optional<BitmapPlan> plan = bitmapFor(table, predicate, any->all());
+    if (!plan) return nullptr;
+    return std::make_unique<BitmapScan>(*table, std::move(plan->rows), CHUNK_CAPACITY);
+}
+
+// partitions of a RANGE table that can hold rows matching the predicate, from
+// comparisons and IN lists of the partition column against literals. Everything
+// else is left to the filter, so the result may keep partitions with no match
+static std::vector<size_t> prunePartitions(const PartitionSpec& spec, const ExprPtr& predicate) {
+    std::vector<size_t> keep;
+    for (size_t i = 0; i < spec.partitions.size(); i++) {
+        keep.push_back(i);
+    }
+    if (!predicate) return keep;
+
+    std::vector<ExprPtr> conjuncts;
+    collectConjuncts(predicate, conjuncts);
+    for (const auto& conjunct : conjuncts) {
+        std::vector<size_t> possible;
+        ExprPtr column, literal;
+        BinaryOp op;
+        if (splitComparison(conjunct, column, literal, op)) {
+            if (column->column_name != spec.column) continue;
+            std::optional<datatype> value = indexLiteral(literal, spec.keyType);
+            if (!value) continue;
+            if (op == BinaryOp::EQ) possible = spec.prune(std::vector<datatype>{*value});
+            else if (op == BinaryOp::LT || op == BinaryOp::LE) possible = spec.prune(std::nullopt, value);
+            else possible = spec.prune(value, std::nullopt);
+        } else if (conjunct && conjunct->type == ExprType::IN_LIST &&
+                   conjunct->children[0]->type == ExprType::COLUMN_REF &&
+                   conjunct->children[0]->column_name == spec.column) {
+            std::vector<datatype> keys;
+            bool literals = true;
+            for (const auto& item : conjunct->in_list) {
+                std::optional<datatype> value = indexLiteral(item, spec.keyType);
+                if (!value) {
+                    literals = false;
+                    break;
+                }
+                keys.push_back(*value);
+            }
+            if (!literals) continue;
+            possible = spec.prune(keys);
+        } else {
+            continue;
+        }
+
+        std::vector<size_t> both;
+        std::set_intersection(keep.begin(), keep.end(), possible.begin(), possible.end(),
+                              std::back_inserter(both));
+        keep = std::move(both);
+    }
+    return keep;
+}
+
+// the tables holding the rows of a table, for a partitioned one its partitions
+// the predicate doesn't rule out
+std::vector<Table*> QueryExecutor::storageTables(const string& name, const ExprPtr& predicate) {
+    const PartitionSpec* spec = catalog_.getPartitioning(name);
+    if (!spec) {
+        Table* table = catalog_.getTable(name);
+        if (!table) {
+            throw std::runtime_error("Table not found: " + name);
+        }
+        return {table};
+    }
+
+    std::vector<Table*> tables;
+    for (size_t i : prunePartitions(*spec, predicate)) {
+        tables.push_back(storageTable(name, *spec, i));
+    }
+    return tables;
+}
+
+StorageOpsPtr QueryExecutor::planScan(Table* table, const RANodePtr& node) {
+    if (!node->sample_method.empty()) {
+        if (table->engine() != TableEngine::HEAP) {
+            // sampling picks heap pages and slots
+            throw std::runtime_error("TABLESAMPLE is not supported on " + string(engine_name(table->engine())) +
+                                     " table " + table->getName());
+        }
+        SampleMethod method = node->sample_method == "SYSTEM" ? SampleMethod::SYSTEM
+                                                              : SampleMethod::BERNOULLI;
+        std::optional<u64> seed;
+        if (node->sample_seed) seed = static_cast<u64>(*node->sample_seed);
+        return std::make_unique<SampleScan>(*table, method, node->sample_percent, seed, CHUNK_CAPACITY);
+    }
+    auto scan = std::make_unique<SeqScan>(*table, CHUNK_CAPACITY);
+    if (!scan_all_columns_) {
+        const Schema& schema = table->getSchema();
+        std::vector<bool> columns(schema.columns.size());
+        for (size_t i = 0; i < schema.columns.size(); i++) {
+            columns[i] = scan_columns_.contains(schema.columns[i].name);
+        }
+        scan->setColumns(std::move(columns));
+    }
+    return scan;
+}
+
+StorageOpsPtr QueryExecutor::buildOperatorTree(const RANodePtr& node, QueryArena* arena) {
     if (!node) return nullptr;
 
     switch (node->type) {
         case RANodeType::TABLE_SCAN: {
-            Table* table = catalog_.getTable(node->table_name);
-            if (!table) {
-                throw std::runtime_error("Table not found: " + node->table_name);
+            std::vector<Table*> tables = storageTables(node->table_name, nullptr);
+            if (!catalog_.getPartitioning(node->table_name)) {
+                return planScan(tables[0], node);
             }
-            return new SeqScan(*table, 64);
+            std::vector<StorageOpsPtr> scans;
+            for (Table* table : tables) {
+                scans.push_back(planScan(table, node));
+            }
+            return std::make_unique<AppendOp>(std::move(scans));
         }
 
         case RANodeType::SELECT_OP: {
-            StorageOps* child = buildOperatorTree(node->left);
-            RANodePtr current = node->left;
-            while (current && current->type != RANodeType::TABLE_SCAN) {
-                current = current->left;
+            StorageOpsPtr child;
+            // a partitioned table is filtered partition by partition, so each
+            // of them can be skipped or read through its own indexes
+            if (node->left && node->left->type == RANodeType::TABLE_SCAN &&
+                catalog_.getPartitioning(node->left->table_name)) {
+                std::vector<StorageOpsPtr> partitions;
+                for (Table* table : storageTables(node->left->table_name, node->predicate)) {
+                    StorageOpsPtr scan;
+                    if (node->left->sample_method.empty()) {
+                        scan = planBitmapScan(table, node->predicate);
+                        if (!scan) scan = planIndexScan(table, node->predicate);
+                    }
+                    if (!scan) scan = planScan(table, node->left);
+                    partitions.push_back(std::make_unique<FilterOp>(std::move(scan), node->predicate,
+                                                                    table->getSchema()));
+                }
+                return std::make_unique<AppendOp>(std::move(partitions));
             }
-            if (!current) {
-                throw std::runtime_error("Could not find base table for selection");
+            // an index would return rows the sample didn't pick
+            if (node->left && node->left->type == RANodeType::TABLE_SCAN &&
+                node->left->sample_method.empty()) {
+                Table* base = catalog_.getTable(node->left->table_name);
+                if (base) child = planBitmapScan(base, node->predicate);
+                if (base && !child) child = planIndexScan(base, node->predicate);
             }
-            Table* table = catalog_.getTable(current->table_name);
-            if (!table) {
-                throw std::runtime_error("Table not found: " + current->table_name);
+            if (!child) child = buildOperatorTree(node->left, arena);
+            const Schema* schema = outputSchema(node->left);
+            if (!schema) {
+                throw std::runtime_error("Could not find base table for selection");
             }
-            return new FilterOp(child, node->predicate, table->getSchema());
+            return std::make_unique<FilterOp>(std::move(child), node->predicate, *schema);
         }
 
         case RANodeType::LIMIT_OP: {
-            StorageOps* child = buildOperatorTree(node->left);
-            return new LimitOp(child, node->limit_count, node->offset_count);
+            StorageOpsPtr child = buildOperatorTree(node->left, arena);
+            return std::make_unique<LimitOp>(std::move(child), node->limit_count, node->offset_count);
         }
 
-        case RANodeType::CROSS_PRODUCT: {
-            StorageOps* left = buildOperatorTree(node->left);
-            StorageOps* right = buildOperatorTree(node->right);
-            return new CrossProductOp(left, right);
+        case RANodeType::CROSS_PRODUCT:
+        case RANodeType::INNER_JOIN:
+        case RANodeType::LEFT_JOIN:
+        case RANodeType::RIGHT_JOIN:
+        case RANodeType::FULL_JOIN: {
+            const Schema* schema = outputSchema(node);
+            if (!schema) {
+                throw std::runtime_error("Could not find base tables for join");
+            }
+            size_t left_width = outputSchema(node->left)->columns.size();
+            StorageOpsPtr left = buildOperatorTree(node->left, arena);
+            StorageOpsPtr right = buildOperatorTree(node->right, arena);
+            if (node->type == RANodeType::CROSS_PRODUCT) {
+                return std::make_unique<CrossProductOp>(std::move(left), std::move(right), left_width, arena);
+            }
+            return planJoin(node, std::move(left), std::move(right), *schema, left_width, arena);
         }
 
         case RANodeType::PROJECT: {
-            StorageOps* child = buildOperatorTree(node->left);
-            RANodePtr current = node->left;
-            while (current && current->type != RANodeType::TABLE_SCAN) {
-                current = current->left;
+            StorageOpsPtr child = buildOperatorTree(node->left, arena);
+            if (node->select_all && node->projections.empty()) {
+                return child; // SELECT * keeps rows as they are
             }
-            if (!current) {
+            const Schema* schema = outputSchema(node->left);
+            if (!schema) {
                 throw std::runtime_error("Could not find base table for projection");
             }
-            Table* table = catalog_.getTable(current->table_name);
+            return std::make_unique<ProjectOp>(std::move(child), node->projections, *schema);
+        }
+
+        default:
+            throw std::runtime_error("Unsupported operator type: " + ra_type_to_string(node->type));
+    }
+}
+
+// Schema of the rows node produces, nullptr if there is no table under it. A
+// join's is the left input's columns and then the right one's, the columns of a
+// table named ALIAS.COLUMN so references qualified with the alias find them
+const Schema* QueryExecutor::outputSchema(const RANodePtr& node) {
+    if (!node) return nullptr;
+
+    switch (node->type) {
+        case RANodeType::TABLE_SCAN: {
+            Table* table = catalog_.getTable(node->table_name);
             if (!table) {
-                throw std::runtime_error("Table not found: " + current->table_name);
+                throw std::runtime_error("Table not found: " + node->table_name);
             }
-            return new ProjectOp(child, node->projections, table->getSchema());
+            return &table->getSchema();
+        }
+
+        case RANodeType::CROSS_PRODUCT:
+        case RANodeType::INNER_JOIN:
+        case RANodeType::LEFT_JOIN:
+        case RANodeType::RIGHT_JOIN:
+        case RANodeType::FULL_JOIN: {
+            const Schema* left = outputSchema(node->left);
+            const Schema* right = outputSchema(node->right);
+            if (!left || !right) return nullptr;
+
+            Schema& schema = join_schemas_.emplace_back(left->columns.size() + right->columns.size());
+            for (const auto& [side, input] : {std::pair{node->left, left}, std::pair{node->right, right}}) {
+                for (const SchemaCol& col : input->columns) {
+                    schema.columns.push_back(col);
+                    if (side->type == RANodeType::TABLE_SCAN) {
+                        schema.columns.back().name = side->table_alias + "." + col.name;
+                    }
+                }
+            }
+            return &schema;
         }
 
         default:
-            throw std::runtime_error("Unsupported operator type: " + ra_type_to_string(node->type));
+            return outputSchema(node->left);
+    }
+}
+
+// Equalities between a column of each input in the ON condition become the keys
+// of a hash join, the rest of the condition is tested on the pairs they match.
+// A join without any is a nested loop
+StorageOpsPtr QueryExecutor::planJoin(const RANodePtr& node, StorageOpsPtr left, StorageOpsPtr right,
+                                      const Schema& schema, size_t left_width, QueryArena* arena) {
+    std::vector<size_t> left_keys, right_keys;
+    ExprPtr residual = nullptr;
+
+    std::vector<ExprPtr> conjuncts;
+    if (node->join_condition) collectConjuncts(node->join_condition, conjuncts);
+    for (const auto& conjunct : conjuncts) {
+        if (conjunct->type == ExprType::BINARY_OP && conjunct->binary_op == BinaryOp::EQ &&
+            conjunct->children[0]->type == ExprType::COLUMN_REF &&
+            conjunct->children[1]->type == ExprType::COLUMN_REF) {
+            const Expression& a = *conjunct->children[0];
+            const Expression& b = *conjunct->children[1];
+            int l = findColumn(schema, a, 0, left_width);
+            int r = findColumn(schema, b, left_width);
+            if (l < 0 || r < 0) {
+                l = findColumn(schema, b, 0, left_width);
+                r = findColumn(schema, a, left_width);
+            }
+            if (l >= 0 && r >= 0) {
+                left_keys.push_back(static_cast<size_t>(l));
+                right_keys.push_back(static_cast<size_t>(r) - left_width);
+                continue;
+            }
+        }
+        residual = residual ? Expression::makeBinaryOp(BinaryOp::AND, residual, conjunct)
+                            : conjunct;
+    }
+
+    if (left_keys.empty()) {
+        return std::make_unique<NestedLoopJoin>(std::move(left), std::move(right), node->join_condition,
+                                                node->type, schema, left_width, arena);
     }
+    return std::make_unique<HashJoinOp>(std::move(left), std::move(right), std::move(left_keys),
+                                        std::move(right_keys), residual, node->type, schema,
+                                        left_width, arena);
 }
 
 QueryResult QueryExecutor::executeSelect(const RANodePtr& node) {
     QueryResult result;
+    result.arena = std::make_shared<QueryArena>(QueryArena::DEFAULT_BLOCK_SIZE, query_memory_limit_);
 
     try {
-        StorageOps* ops = buildOperatorTree(node);
+        scan_columns_.clear();
+        join_schemas_.clear();
+        scan_all_columns_ = !collectReferencedColumns(node, scan_columns_);
+        StorageOpsPtr ops = buildOperatorTree(node, result.arena.get());
         ops->open();
 
-        std::vector<Row*> batch;
-        while (!(batch = ops->next()).empty()) {
-            for (Row* row : batch) {
-                result.rows.push_back(row);
+        DataChunk chunk;
+        while (ops->next(chunk)) {
+            for (size_t i = 0; i < chunk.selected(); i++) {
+                // every column, so an outer join's missing side prints as NULLs
+                result.rows.push_back(chunk.to_row(chunk.row(i), result.arena.get(), true));
             }
         }
 
@@ -165,10 +673,11 @@ QueryResult QueryExecutor::executeSelect(const RANodePtr& node) {
         }
 
         result.success = true;
-        delete ops;
     } catch (const std::exception& e) {
         result.success = false;
         result.error_message = e.what();
+        result.rows.clear();
+        result.arena.reset();
     }
 
     return result;
@@ -185,6 +694,8 @@ QueryResult QueryExecutor::executeInsert(const RANodePtr& node) {
             return result;
         }
 
+        std::vector<std::unique_ptr<Row>> owned;
+        std::vector<Row*> rows;
         for (const auto& value_row : node->insert_values) {
             std::vector<datatype> values;
             for (const auto& expr : value_row) {
@@ -207,10 +718,21 @@ QueryResult QueryExecutor::executeInsert(const RANodePtr& node) {
                 }
             }
 
-            Row* row = create_row(static_cast<int>(values.size()), std::move(values));
-            table->insert_row();
-            result.rows_affected++;
-            delete row;
+            int num_cols = static_cast<int>(values.size());
+            owned.emplace_back(create_row(num_cols, std::move(values)));
+            rows.push_back(owned.back().get());
+        }
+
+        // the whole statement is checked against unique keys before any row is written
+        for (auto& [target, batch] : routeRows(node->table_name, table, rows)) {
+            std::vector<RowId> rids = target->insert_rows(batch);
+            for (const RowId& rid : rids) {
+                if (rid.pageId.page_num == 0) {
+                    throw std::runtime_error("Row is too large to store in " + node->table_name);
+                }
+                result.rows_affected++;
+            }
+            refreshStatistics(target);
         }
 
         result.success = true;
@@ -222,17 +744,191 @@ QueryResult QueryExecutor::executeInsert(const RANodePtr& node) {
     return result;
 }
 
+// rows grouped by the partition they belong in, all of them in table itself if it isn't partitioned
+std::vector<std::pair<Table*, std::vector<Row*>>> QueryExecutor::routeRows(const string& name, Table* table,
+                                                                           const std::vector<Row*>& rows) {
+    const PartitionSpec* spec = catalog_.getPartitioning(name);
+    if (!spec) {
+        return {{table, rows}};
+    }
+
+    int col_idx = getColumnIndex(table->getSchema(), spec->column);
+    std::vector<std::vector<Row*>> batches(spec->partitions.size());
+    for (Row* row : rows) {
+        int partition = spec->route(row->values[col_idx]);
+        if (partition < 0) {
+            throw std::runtime_error("No partition of " + name + " holds the row's " + spec->column);
+        }
+        batches[partition].push_back(row);
+    }
+
+    std::vector<std::pair<Table*, std::vector<Row*>>> routed;
+    for (size_t i = 0; i < batches.size(); i++) {
+        if (batches[i].empty()) continue;
+        routed.push_back({storageTable(name, *spec, i), std::move(batches[i])});
+    }
+    return routed;
+}
+
+datatype QueryExecutor::evaluateExpression(const ExprPtr& expr, Row* row, const Schema& schema) {
+    FilterOp evaluator(nullptr, expr, schema);
+    return evaluator.evaluateExpression(expr, row);
+}
+
+bool QueryExecutor::evaluatePredicate(const ExprPtr& pred, Row* row, const Schema& schema) {
+    FilterOp evaluator(nullptr, pred, schema);
+    return evaluator.evaluatePredicate(row);
+}
+
+// every row of the table the WHERE clause accepts, with their row ids. Planned
+// like the scan under a SELECT's filter, so indexes and zone maps narrow it
+std::vector<Row*> QueryExecutor::scanMatching(Table* table, const ExprPtr& predicate, QueryArena* arena) {
+    StorageOpsPtr scan = planBitmapScan(table, predicate);
+    if (!scan) scan = planIndexScan(table, predicate);
+    // the rows are written back whole, so every column is read
+    if (!scan) scan = std::make_unique<SeqScan>(*table, CHUNK_CAPACITY);
+    FilterOp where(std::move(scan), predicate, table->getSchema());
+
+    std::vector<Row*> matching;
+    where.open();
+    DataChunk chunk;
+    while (where.next(chunk)) {
+        for (size_t i = 0; i < chunk.selected(); i++) {
+            matching.push_back(chunk.to_row(chunk.row(i), arena));
+        }
+    }
+    where.close();
+    return matching;
+}
+
+// keeps the stored type of a column when SET assigns a literal of another numeric type
+static datatype coerceToColumn(const datatype& val, const datatype& current) {
+    if (val.index() == current.index()) return val;
+
+    double num;
+    if (val.holds<int>()) num = val.get<int>();
+    else if (val.holds<float>()) num = val.get<float>();
+    else if (val.holds<int64_t>()) num = static_cast<double>(val.get<int64_t>());
+    else if (val.holds<double>()) num = val.get<double>();
+    else return val;
+
+    if (current.holds<int>()) return static_cast<int>(num);
+    if (current.holds<float>()) return static_cast<float>(num);
+    if (current.holds<int64_t>()) return static_cast<int64_t>(num);
+    if (current.holds<double>()) return num;
+    return val;
+}
+
 QueryResult QueryExecutor::executeUpdate(const RANodePtr& node) {
     QueryResult result;
-    result.success = false;
-    result.error_message = "UPDATE not yet implemented";
+
+    try {
+        Table* table = catalog_.getTable(node->table_name);
+        if (!table) {
+            result.success = false;
+            result.error_message = "Table not found: " + node->table_name;
+            return result;
+        }
+        const Schema& schema = table->getSchema();
+
+        std::vector<std::pair<int, CompiledExpr>> assignments;
+        for (const auto& [column, expr] : node->update_assignments) {
+            int col_idx = getColumnIndex(schema, column);
+            if (col_idx < 0) {
+                throw std::runtime_error("Column not found: " + column);
+            }
+            assignments.push_back({col_idx, CompiledExpr(expr, schema)});
+        }
+
+        const PartitionSpec* spec = catalog_.getPartitioning(node->table_name);
+        int key_idx = spec ? getColumnIndex(schema, spec->column) : -1;
+
+        // every partition is read before any is written, a row moved into a
+        // partition that is read later must not be updated twice
+        struct PartitionUpdate {
+            Table* target;
+            std::vector<Row*> kept, updated, moved;
+        };
+        std::vector<PartitionUpdate> work;
+        std::vector<Row*> moving;
+
+        QueryArena arena(QueryArena::DEFAULT_BLOCK_SIZE, query_memory_limit_);
+        for (Table* target : storageTables(node->table_name, node->predicate)) {
+            PartitionUpdate& part = work.emplace_back();
+            part.target = target;
+            for (Row* row : scanMatching(target, node->predicate, &arena)) {
+                // every SET expression sees the old version of the row
+                RowValues values = make_row_values(&arena, row->values.size());
+                values.assign(row->values.begin(), row->values.end());
+                for (auto& [col_idx, expr] : assignments) {
+                    if (static_cast<size_t>(col_idx) < values.size()) {
+                        values[col_idx] = coerceToColumn(expr.evaluate(row),
+                                                         row->values[col_idx]);
+                    }
+                }
+                Row* newRow = create_row(&arena, row->numCols, std::move(values));
+                // a row whose new partition key belongs elsewhere moves to that partition
+                if (spec && spec->route(newRow->values[key_idx]) != spec->route(row->values[key_idx])) {
+                    part.moved.push_back(row);
+                    moving.push_back(newRow);
+                } else {
+                    part.kept.push_back(row);
+                    part.updated.push_back(newRow);
+                }
+            }
+        }
+        // moved rows are written first, a unique key they break in their new
+        // partition then fails the statement before any row is changed
+        for (auto& [destination, batch] : routeRows(node->table_name, table, moving)) {
+            if (batch.empty()) continue;
+            for (const RowId& rid : destination->insert_rows(batch)) {
+                if (rid.pageId.page_num == 0) {
+                    throw std::runtime_error("Updated row is too large to store in " + node->table_name);
+                }
+                result.rows_affected++;
+            }
+            refreshStatistics(destination);
+        }
+        for (PartitionUpdate& part : work) {
+            size_t num_updated = part.target->update_rows(part.kept, part.updated);
+            result.rows_affected += static_cast<int64_t>(num_updated);
+            part.target->delete_rows(part.moved);
+        }
+        for (PartitionUpdate& part : work) {
+            refreshStatistics(part.target);
+        }
+        result.success = true;
+    } catch (const std::exception& e) {
+        result.success = false;
+        result.error_message = e.what();
+    }
+
     return result;
 }
 
 QueryResult QueryExecutor::executeDelete(const RANodePtr& node) {
     QueryResult result;
-    result.success = false;
-    result.error_message = "DELETE not yet implemented";
+
+    try {
+        Table* table = catalog_.getTable(node->table_name);
+        if (!table) {
+            result.success = false;
+            result.error_message = "Table not found: " + node->table_name;
+            return result;
+        }
+
+        QueryArena arena(QueryArena::DEFAULT_BLOCK_SIZE, query_memory_limit_);
+        for (Table* target : storageTables(node->table_name, node->predicate)) {
+            std::vector<Row*> matching = scanMatching(target, node->predicate, &arena);
+            result.rows_affected += static_cast<int64_t>(target->delete_rows(matching));
+            refreshStatistics(target);
+        }
+        result.success = true;
+    } catch (const std::exception& e) {
+        result.success = false;
+        result.error_message = e.what();
+    }
+
     return result;
 }
 
@@ -262,12 +958,40 @@ QueryResult QueryExecutor::executeCreateTable(const RANodePtr& node) {
             }
 
             schema.add_col(col_def.name, col_type, col_def.nullable,
-                          col_def.primary_key, false);
+                          col_def.primary_key, col_def.unique);
         }
 
-        HeapFile* heapfile = create_heapfile(node->table_name);
-        Table* table = new Table(node->table_name, schema, *heapfile);
-        catalog_.addTable(node->table_name, table);
+        TableEngine engine = TableEngine::HEAP;
+        if (node->table_engine == "LSM") engine = TableEngine::LSM;
+        else if (node->table_engine == "CLUSTERED") engine = TableEngine::CLUSTERED;
+        if (engine != TableEngine::HEAP) {
+            // the store is keyed by the primary key and can't hold other indexes
+            bool keyed = false;
+            for (const SchemaCol& col : schema.columns) {
+                if (col.is_unique && !col.is_primary_key) {
+                    throw std::runtime_error("UNIQUE column " + col.name + " must be the PRIMARY KEY of " +
+                                             engine_name(engine) + " table " + node->table_name);
+                }
+                keyed = keyed || col.is_primary_key;
+            }
+            if (!keyed) {
+                throw std::runtime_error(string(engine_name(engine)) + " table " + node->table_name + " needs a PRIMARY KEY");
+            }
+        }
+        if (!node->cluster_column.empty()) {
+            int col_idx = getColumnIndex(schema, node->cluster_column);
+            if (col_idx < 0 || !schema.columns[col_idx].is_primary_key) {
+                throw std::runtime_error("CLUSTERED BY column " + node->cluster_column + " must be the PRIMARY KEY");
+            }
+        }
+
+        if (!node->partition_method.empty()) {
+            createPartitionedTable(node, schema, engine);
+            result.success = true;
+            return result;
+        }
+
+        catalog_.addTable(node->table_name, createStorage(node->table_name, schema, engine));
 
         result.success = true;
         result.rows_affected = 0;
@@ -279,6 +1003,83 @@ QueryResult QueryExecutor::executeCreateTable(const RANodePtr& node) {
     return result;
 }
 
+// bound of a RANGE partition as a value of the partition column, none for MAXVALUE
+static std::optional<datatype> partitionBound(const PartitionClause& clause, ColumnType type) {
+    if (!clause.upper) return std::nullopt;
+    std::optional<datatype> bound = indexLiteral(clause.upper, type);
+    if (!bound) {
+        throw std::runtime_error("Bound of partition " + clause.name + " must be a literal of the partition column's type");
+    }
+    return bound;
+}
+
+// a new empty table that keeps its rows in the given engine
+Table* QueryExecutor::createStorage(const string& name, Schema& schema, TableEngine engine) {
+    if (engine != TableEngine::HEAP) {
+        return new Table(name, schema, engine, make_keyed_store(name, engine, true));
+    }
+    HeapFile* heapfile = create_heapfile(name);
+    return new Table(name, schema, *heapfile);
+}
+
+Table* QueryExecutor::createPartition(const string& name, const PartitionSpec& spec, size_t i,
+                                      const Schema& parent, TableEngine engine) {
+    string partition = spec.table_name(name, i);
+    Schema schema = parent;
+    if (catalog_.hasTable(partition)) {
+        throw std::runtime_error("Table already exists: " + partition);
+    }
+    Table* table = createStorage(partition, schema, engine);
+    for (const IndexDef& def : spec.indexes) {
+        table->create_index(def.name + "_" + spec.partitions[i].name, def.column, def.type);
+    }
+    catalog_.addTable(partition, table);
+    return table;
+}
+
+// The parent only holds the schema and the PartitionSpec, each partition is a
+// table of its own that the executor routes rows to
+void QueryExecutor::createPartitionedTable(const RANodePtr& node, Schema& schema, TableEngine engine) {
+    int col_idx = getColumnIndex(schema, node->partition_column);
+    if (col_idx < 0) {
+        throw std::runtime_error("Partition column not found: " + node->partition_column);
+    }
+    // uniqueness is only checked within a partition
+    for (const SchemaCol& col : schema.columns) {
+        if ((col.is_primary_key || col.is_unique) && col.name != node->partition_column) {
+            throw std::runtime_error("Unique column " + col.name + " of a partitioned table must be its partition column");
+        }
+    }
+
+    PartitionSpec spec;
+    spec.method = node->partition_method == "HASH" ? PartitionMethod::HASH : PartitionMethod::RANGE;
+    spec.column = node->partition_column;
+    spec.keyType = schema.columns[col_idx].type;
+    std::unordered_set<string> names;
+    for (const PartitionClause& clause : node->partitions) {
+        if (!names.insert(clause.name).second) {
+            throw std::runtime_error("Duplicate partition: " + clause.name);
+        }
+        PartitionDef def{clause.name, partitionBound(clause, spec.keyType)};
+        if (spec.method == PartitionMethod::RANGE && !spec.partitions.empty()) {
+            const std::optional<datatype>& last = spec.partitions.back().upper;
+            if (!last) {
+                throw std::runtime_error("MAXVALUE partition must be the last one");
+            }
+            if (def.upper && compare_keys(make_index_key(*def.upper, spec.keyType),
+                                          make_index_key(*last, spec.keyType)) <= 0) {
+                throw std::runtime_error("Partition bounds must be strictly increasing");
+            }
+        }
+        spec.partitions.push_back(std::move(def));
+    }
+
+    for (size_t i = 0; i < spec.partitions.size(); i++) {
+        createPartition(node->table_name, spec, i, schema, engine);
+    }
+    catalog_.addTable(node->table_name, new Table(node->table_name, schema), std::move(spec));
+}
+
 QueryResult QueryExecutor::executeDropTable(const RANodePtr& node) {
     QueryResult result;
 
@@ -289,6 +1090,15 @@ QueryResult QueryExecutor::executeDropTable(const RANodePtr& node) {
             return result;
         }
 
+        if (const PartitionSpec* spec = catalog_.getPartitioning(node->table_name)) {
+            for (size_t i = 0; i < spec->partitions.size(); i++) {
+                string partition = spec->table_name(node->table_name, i);
+                if (Table* table = catalog_.getTable(partition)) {
+                    table->drop();
+                }
+                catalog_.removeTable(partition);
+            }
+        }
         catalog_.removeTable(node->table_name);
         result.success = true;
     } catch (const std::exception& e) {
@@ -299,6 +1109,203 @@ QueryResult QueryExecutor::executeDropTable(const RANodePtr& node) {
     return result;
 }
 
+QueryResult QueryExecutor::executeCreateIndex(const RANodePtr& node) {
+    QueryResult result;
+
+    try {
+        Table* table = catalog_.getTable(node->table_name);
+        if (!table) {
+            result.success = false;
+            result.error_message = "Table not found: " + node->table_name;
+            return result;
+        }
+
+        IndexType type = IndexType::BTREE;
+        if (node->index_method == "HASH") type = IndexType::HASH;
+        else if (node->index_method == "BITMAP") type = IndexType::BITMAP;
+        if (const PartitionSpec* found = catalog_.getPartitioning(node->table_name)) {
+            // every partition gets its own index, ALTER TABLE ADD PARTITION builds it on new ones
+            PartitionSpec spec = *found;
+            if (getColumnIndex(table->getSchema(), node->index_columns[0]) < 0) {
+                throw std::runtime_error("Column not found: " + node->index_columns[0]);
+            }
+            for (size_t i = 0; i < spec.partitions.size(); i++) {
+                Table* partition = storageTable(node->table_name, spec, i);
+                partition->create_index(node->index_name + "_" + spec.partitions[i].name,
+                                        node->index_columns[0], type);
+            }
+            spec.indexes.push_back({node->index_name, node->index_columns[0], type, false});
+            catalog_.setPartitioning(node->table_name, std::move(spec));
+        } else {
+            table->create_index(node->index_name, node->index_columns[0], type);
+            catalog_.save();
+        }
+        result.success = true;
+        result.rows_affected = 0;
+    } catch (const std::exception& e) {
+        result.success = false;
+        result.error_message = e.what();
+    }
+
+    return result;
+}
+
+QueryResult QueryExecutor::executeVacuum(const RANodePtr& node) {
+    QueryResult result;
+
+    try {
+        std::vector<Table*> tables;
+        if (node->table_name.empty()) {
+            // partitions are tables of their own, their parents hold no rows
+            for (const auto& [name, table] : catalog_.getAllTables()) {
+                if (!catalog_.getPartitioning(name)) tables.push_back(table);
+            }
+        } else {
+            if (!catalog_.hasTable(node->table_name)) {
+                result.success = false;
+                result.error_message = "Table not found: " + node->table_name;
+                return result;
+            }
+            tables = storageTables(node->table_name, nullptr);
+        }
+
+        // rows_affected reports how many rows were moved to fill holes
+        for (Table* table : tables) {
+            VacuumStats stats = table->vacuum();
+            result.rows_affected += stats.rows_moved;
+        }
+        result.success = true;
+    } catch (const std::exception& e) {
+        result.success = false;
+        result.error_message = e.what();
+    }
+
+    return result;
+}
+
+QueryResult QueryExecutor::executeAnalyze(const RANodePtr& node) {
+    QueryResult result;
+
+    try {
+        std::vector<Table*> tables;
+        if (node->table_name.empty()) {
+            // partitions are tables of their own, their parents hold no rows
+            for (const auto& [name, table] : catalog_.getAllTables()) {
+                if (!catalog_.getPartitioning(name)) tables.push_back(table);
+            }
+        } else {
+            if (!catalog_.hasTable(node->table_name)) {
+                result.success = false;
+                result.error_message = "Table not found: " + node->table_name;
+                return result;
+            }
+            tables = storageTables(node->table_name, nullptr);
+        }
+
+        // rows_affected reports how many rows were sampled
+        for (Table* table : tables) {
+            result.rows_affected += table->analyze().sampled_rows;
+        }
+        catalog_.save();
+        result.success = true;
+    } catch (const std::exception& e) {
+        result.success = false;
+        result.error_message = e.what();
+    }
+
+    return result;
+}
+
+// tables that were analyzed once get new statistics after enough of them has changed
+void QueryExecutor::refreshStatistics(Table* table) {
+    const TableStats* stats = table->statistics();
+    if (stats != nullptr && stats->stale()) {
+        table->analyze();
+        catalog_.save();
+    }
+}
+
+Table* QueryExecutor::storageTable(const string& name, const PartitionSpec& spec, size_t i) {
+    string partition = spec.table_name(name, i);
+    Table* table = catalog_.getTable(partition);
+    if (!table) {
+        throw std::runtime_error("Partition table missing: " + partition);
+    }
+    return table;
+}
+
+// ADD PARTITION appends a RANGE partition above the last bound, DROP PARTITION
+// deletes a partition's files along with its rows
+QueryResult QueryExecutor::executeAlterTable(const RANodePtr& node) {
+    QueryResult result;
+
+    try {
+        Table* table = catalog_.getTable(node->table_name);
+        if (!table) {
+            result.success = false;
+            result.error_message = "Table not found: " + node->table_name;
+            return result;
+        }
+        const PartitionSpec* found = catalog_.getPartitioning(node->table_name);
+        if (!found) {
+            throw std::runtime_error("Table is not partitioned: " + node->table_name);
+        }
+        PartitionSpec spec = *found;
+        const PartitionClause& clause = node->partitions[0];
+        auto position = std::find_if(spec.partitions.begin(), spec.partitions.end(),
+                                     [&](const PartitionDef& def) { return def.name == clause.name; });
+
+        if (node->alter_action == "ADD PARTITION") {
+            if (spec.method != PartitionMethod::RANGE) {
+                throw std::runtime_error("Partitions can only be added to a RANGE partitioned table");
+            }
+            if (position != spec.partitions.end()) {
+                throw std::runtime_error("Duplicate partition: " + clause.name);
+            }
+            PartitionDef def{clause.name, partitionBound(clause, spec.keyType)};
+            const std::optional<datatype>& last = spec.partitions.back().upper;
+            if (!last) {
+                throw std::runtime_error("Cannot add a partition after the MAXVALUE partition");
+            }
+            if (def.upper && compare_keys(make_index_key(*def.upper, spec.keyType),
+                                          make_index_key(*last, spec.keyType)) <= 0) {
+                throw std::runtime_error("Partition bounds must be strictly increasing");
+            }
+            // a new partition keeps its rows like the others do
+            TableEngine engine = storageTable(node->table_name, spec, 0)->engine();
+            spec.partitions.push_back(std::move(def));
+            createPartition(node->table_name, spec, spec.partitions.size() - 1, table->getSchema(), engine);
+        } else {
+            if (spec.method != PartitionMethod::RANGE) {
+                // the remaining rows would hash to other partitions than the ones holding them
+                throw std::runtime_error("Partitions of a HASH partitioned table cannot be dropped");
+            }
+            if (position == spec.partitions.end()) {
+                throw std::runtime_error("Partition not found: " + clause.name);
+            }
+            if (spec.partitions.size() == 1) {
+                throw std::runtime_error("Cannot drop the only partition of " + node->table_name);
+            }
+            size_t i = position - spec.partitions.begin();
+            Table* partition = storageTable(node->table_name, spec, i);
+            if (partition->getHeapFile() != nullptr) {
+                result.rows_affected = static_cast<int64_t>(partition->getHeapFile()->metadata.num_records);
+            }
+            partition->drop();
+            catalog_.removeTable(spec.table_name(node->table_name, i));
+            spec.partitions.erase(position);
+        }
+
+        catalog_.setPartitioning(node->table_name, std::move(spec));
+        result.success = true;
+    } catch (const std::exception& e) {
+        result.success = false;
+        result.error_message = e.what();
+    }
+
+    return result;
+}
+
 int QueryExecutor::getColumnIndex(const Schema& schema, const string& column_name) {
     for (size_t i = 0; i < schema.columns.size(); i++) {
         if (schema.columns[i].name == column_name) {
@@ -308,162 +1315,268 @@ int QueryExecutor::getColumnIndex(const Schema& schema, const string& column_nam
     return -1;
 }
 
-FilterOp::FilterOp(StorageOps* child, const ExprPtr& predicate, const Schema& schema)
-    : child_(child), predicate_(predicate), schema_(schema) {}
+FilterOp::FilterOp(StorageOpsPtr child, const ExprPtr& predicate, const Schema& schema)
+    : child_(std::move(child)), predicate_(predicate), schema_(schema), compiled_(predicate, schema) {}
 
 void FilterOp::open() {
+    if (!pushed_down_) {
+        pushdownZoneRanges();
+        pushdownStringPredicates();
+        extractComparisons();
+        compiled_ = CompiledExpr(predicate_, schema_);
+        pushed_down_ = true;
+    }
     child_->open();
 }
 
-std::vector<Row*> FilterOp::next() {
-    std::vector<Row*> result;
-    std::vector<Row*> batch = child_->next();
-
-    for (Row* row : batch) {
-        if (evaluatePredicate(row)) {
-            result.push_back(row);
+// Comparisons against literals become ranges the scan checks against each page's
+// zone map. They only skip pages, so the predicate itself stays here.
+void FilterOp::pushdownZoneRanges() {
+    SeqScan* scan = dynamic_cast<SeqScan*>(child_.get());
+    if (!scan || !predicate_) return;
+
+    std::vector<ExprPtr> conjuncts;
+    collectConjuncts(predicate_, conjuncts);
+    for (const auto& conjunct : conjuncts) {
+        ExprPtr column, literal;
+        BinaryOp op;
+        if (!splitComparison(conjunct, column, literal, op)) continue;
+
+        int col_idx = -1;
+        for (size_t i = 0; i < schema_.columns.size(); i++) {
+            if (schema_.columns[i].name == column->column_name) {
+                col_idx = static_cast<int>(i);
+                break;
+            }
         }
+        if (col_idx < 0 || col_idx > UINT8_MAX) continue;
+        std::optional<datatype> val = indexLiteral(literal, schema_.columns[col_idx].type);
+        if (!val) continue;
+
+        ZoneRange range{static_cast<u8>(col_idx), std::nullopt, std::nullopt};
+        if (op == BinaryOp::EQ || op == BinaryOp::GT || op == BinaryOp::GE) range.low = val;
+        if (op == BinaryOp::EQ || op == BinaryOp::LT || op == BinaryOp::LE) range.high = val;
+        scan->pushdownRange(std::move(range));
     }
+}
 
-    return result;
+// Equality and IN tests on STRING columns run in the scan against dictionary codes.
+// Whatever can't be pushed stays behind as this operator's predicate.
+void FilterOp::pushdownStringPredicates() {
+    SeqScan* scan = dynamic_cast<SeqScan*>(child_.get());
+    if (!scan || !predicate_) return;
+
+    std::vector<ExprPtr> conjuncts;
+    collectConjuncts(predicate_, conjuncts);
+
+    ExprPtr residual = nullptr;
+    for (const auto& conjunct : conjuncts) {
+        StringPredicate pred;
+        if (toStringPredicate(conjunct, pred)) {
+            scan->pushdown(std::move(pred));
+            continue;
+        }
+        residual = residual ? Expression::makeBinaryOp(BinaryOp::AND, residual, conjunct)
+                            : conjunct;
+    }
+    predicate_ = residual;
 }
 
-void FilterOp::close() {
-    child_->close();
+bool FilterOp::toStringPredicate(const ExprPtr& expr, StringPredicate& out) {
+    if (!expr) return false;
+
+    if (expr->type == ExprType::UNARY_OP && expr->unary_op == UnaryOp::NOT) {
+        if (!toStringPredicate(expr->children[0], out)) return false;
+        out.negate = !out.negate;
+        return true;
+    }
+
+    ExprPtr column;
+    std::vector<ExprPtr> literals;
+    if (expr->type == ExprType::BINARY_OP &&
+        (expr->binary_op == BinaryOp::EQ || expr->binary_op == BinaryOp::NE)) {
+        bool left_col = expr->children[0]->type == ExprType::COLUMN_REF;
+        column = left_col ? expr->children[0] : expr->children[1];
+        literals.push_back(left_col ? expr->children[1] : expr->children[0]);
+        out.negate = expr->binary_op == BinaryOp::NE;
+    } else if (expr->type == ExprType::IN_LIST) {
+        column = expr->children[0];
+        literals = expr->in_list;
+        out.negate = false;
+    } else {
+        return false;
+    }
+
+    if (column->type != ExprType::COLUMN_REF) return false;
+    int col_idx = -1;
+    for (size_t i = 0; i < schema_.columns.size(); i++) {
+        if (schema_.columns[i].name == column->column_name) {
+            col_idx = static_cast<int>(i);
+            break;
+        }
+    }
+    if (col_idx < 0 || col_idx > UINT8_MAX ||
+        schema_.columns[col_idx].type != ColumnType::STRING) {
+        return false;
+    }
+
+    out.values.clear();
+    for (const auto& lit : literals) {
+        if (!lit || lit->type != ExprType::LITERAL_STRING) return false;
+        out.values.push_back(std::get<string>(lit->literal_value));
+    }
+    out.col = static_cast<u8>(col_idx);
+    return true;
 }
 
-bool FilterOp::evaluatePredicate(Row* row) {
-    if (!predicate_) return true;
+// Comparisons of a column against a literal are taken out of the predicate and
+// run over a whole column of each chunk. What is left is evaluated row by row on
+// the rows they keep
+void FilterOp::extractComparisons() {
+    if (!predicate_) return;
 
-    datatype result = evaluateExpression(predicate_, row);
-    if (std::holds_alternative<bool>(result)) {
-        return std::get<bool>(result);
+    std::vector<ExprPtr> conjuncts;
+    collectConjuncts(predicate_, conjuncts);
+
+    ExprPtr residual = nullptr;
+    for (const auto& conjunct : conjuncts) {
+        ColumnComparison cmp;
+        if (toComparison(conjunct, cmp)) {
+            comparisons_.push_back(std::move(cmp));
+            continue;
+        }
+        residual = residual ? Expression::makeBinaryOp(BinaryOp::AND, residual, conjunct)
+                            : conjunct;
     }
-    return false;
+    predicate_ = residual;
 }
 
-datatype FilterOp::evaluateExpression(const ExprPtr& expr, Row* row) {
-    if (!expr) return false;
+bool FilterOp::toComparison(const ExprPtr& expr, ColumnComparison& out) {
+    if (!expr || expr->type != ExprType::BINARY_OP) return false;
+
+    CompareOp op;
+    switch (expr->binary_op) {
+        case BinaryOp::EQ: op = CompareOp::EQ; break;
+        case BinaryOp::NE: op = CompareOp::NE; break;
+        case BinaryOp::LT: op = CompareOp::LT; break;
+        case BinaryOp::LE: op = CompareOp::LE; break;
+        case BinaryOp::GT: op = CompareOp::GT; break;
+        case BinaryOp::GE: op = CompareOp::GE; break;
+        default: return false;
+    }
+    ExprPtr column = expr->children[0];
+    ExprPtr literal = expr->children[1];
+    if (column->type != ExprType::COLUMN_REF) {
+        std::swap(column, literal);
+        op = flip_compare_op(op);
+    }
+    if (column->type != ExprType::COLUMN_REF) return false;
+    if (literal->type != ExprType::LITERAL_INT && literal->type != ExprType::LITERAL_FLOAT &&
+        literal->type != ExprType::LITERAL_STRING && literal->type != ExprType::LITERAL_BOOL) {
+        return false;
+    }
 
-    switch (expr->type) {
-        case ExprType::LITERAL_INT:
-            return static_cast<int>(std::get<int64_t>(expr->literal_value));
-        case ExprType::LITERAL_FLOAT:
-            return static_cast<float>(std::get<double>(expr->literal_value));
-        case ExprType::LITERAL_STRING:
-            return std::get<string>(expr->literal_value);
-        case ExprType::LITERAL_BOOL:
-            return std::get<bool>(expr->literal_value);
-        case ExprType::LITERAL_NULL:
-            return 0;
-
-        case ExprType::COLUMN_REF: {
-            for (size_t i = 0; i < schema_.columns.size(); i++) {
-                if (schema_.columns[i].name == expr->column_name) {
-                    if (i < row->values.size()) {
-                        return row->values[i];
-                    }
-                }
-            }
-            return 0;
-        }
-
-        case ExprType::BINARY_OP: {
-            datatype left_val = evaluateExpression(expr->children[0], row);
-            datatype right_val = evaluateExpression(expr->children[1], row);
-
-            switch (expr->binary_op) {
-                case BinaryOp::EQ:
-                    return left_val == right_val;
-                case BinaryOp::NE:
-                    return left_val != right_val;
-                case BinaryOp::LT:
-                    return left_val < right_val;
-                case BinaryOp::LE:
-                    return left_val <= right_val;
-                case BinaryOp::GT:
-                    return left_val > right_val;
-                case BinaryOp::GE:
-                    return left_val >= right_val;
-                case BinaryOp::AND: {
-                    bool l = std::holds_alternative<bool>(left_val) ?
-                             std::get<bool>(left_val) : false;
-                    bool r = std::holds_alternative<bool>(right_val) ?
-                             std::get<bool>(right_val) : false;
-                    return l && r;
-                }
-                case BinaryOp::OR: {
-                    bool l = std::holds_alternative<bool>(left_val) ?
-                             std::get<bool>(left_val) : false;
-                    bool r = std::holds_alternative<bool>(right_val) ?
-                             std::get<bool>(right_val) : false;
-                    return l || r;
-                }
-                default:
-                    return false;
-            }
+    int col = findColumn(schema_, *column);
+    if (col < 0) return false;
+    out = {static_cast<size_t>(col), op, CompiledExpr::literalValue(literal)};
+    return true;
+}
+
+bool FilterOp::next(DataChunk& out) {
+    // a batch nothing passes is skipped, next() only returns rows
+    while (child_->next(out)) {
+        for (const auto& cmp : comparisons_) {
+            select_compare(out, cmp.column, cmp.op, cmp.value);
         }
 
-        case ExprType::UNARY_OP: {
-            datatype val = evaluateExpression(expr->children[0], row);
-            switch (expr->unary_op) {
-                case UnaryOp::NOT: {
-                    bool b = std::holds_alternative<bool>(val) ?
-                             std::get<bool>(val) : false;
-                    return !b;
+        if (predicate_ && out.selected() > 0) {
+            std::vector<u32> keep;
+            keep.reserve(out.selected());
+            for (size_t i = 0; i < out.selected(); i++) {
+                if (compiled_.test(out, out.row(i))) {
+                    keep.push_back(out.row(i));
                 }
-                default:
-                    return val;
             }
+            out.select(std::move(keep));
         }
-
-        default:
-            return false;
+        if (out.selected() > 0) return true;
     }
+    return false;
 }
 
-ProjectOp::ProjectOp(StorageOps* child, const std::vector<ExprPtr>& projections,
-                     const Schema& schema)
-    : child_(child), projections_(projections), schema_(schema) {}
+void FilterOp::close() {
+    child_->close();
+}
 
-void ProjectOp::open() {
-    child_->open();
+bool FilterOp::evaluatePredicate(Row* row) {
+    if (!predicate_) return true;
+    return compiled_.test(row);
 }
 
-std::vector<Row*> ProjectOp::next() {
-    std::vector<Row*> input = child_->next();
-    if (input.empty()) return input;
+// compiles expr for this one row, callers evaluating it on many rows keep a CompiledExpr
+datatype FilterOp::evaluateExpression(const ExprPtr& expr, Row* row) {
+    return CompiledExpr(expr, schema_).evaluate(row);
+}
 
-    std::vector<Row*> result;
-    for (Row* row : input) {
-        std::vector<datatype> new_values;
+ProjectOp::ProjectOp(StorageOpsPtr child, const std::vector<ExprPtr>& projections,
+                     const Schema& schema)
+    : child_(std::move(child)), projections_(projections), schema_(schema) {}
 
-        for (const auto& proj : projections_) {
-            if (proj->type == ExprType::COLUMN_REF) {
-                for (size_t i = 0; i < schema_.columns.size(); i++) {
-                    if (schema_.columns[i].name == proj->column_name) {
-                        if (i < row->values.size()) {
-                            new_values.push_back(row->values[i]);
-                        }
-                        break;
-                    }
-                }
+void ProjectOp::open() {
+    columns_.clear();
+    for (const auto& proj : projections_) {
+        if (proj->type == ExprType::COLUMN_REF) {
+            int col = findColumn(schema_, *proj);
+            if (col >= 0) {
+                columns_.push_back(static_cast<size_t>(col));
             }
         }
-
-        Row* new_row = create_row(static_cast<int>(new_values.size()), std::move(new_values));
-        result.push_back(new_row);
     }
+    child_->open();
+}
 
-    return result;
+bool ProjectOp::next(DataChunk& out) {
+    if (!child_->next(out)) return false;
+    out.project(columns_);
+    return true;
 }
 
 void ProjectOp::close() {
     child_->close();
 }
 
-LimitOp::LimitOp(StorageOps* child, int64_t limit, int64_t offset)
-    : child_(child), limit_(limit), offset_(offset),
+AppendOp::AppendOp(std::vector<StorageOpsPtr> children)
+    : children_(std::move(children)), current_(0) {}
+
+void AppendOp::open() {
+    current_ = 0;
+    if (!children_.empty()) {
+        children_[0]->open();
+    }
+}
+
+bool AppendOp::next(DataChunk& out) {
+    while (current_ < children_.size()) {
+        if (children_[current_]->next(out)) {
+            return true;
+        }
+        children_[current_]->close();
+        if (++current_ < children_.size()) {
+            children_[current_]->open();
+        }
+    }
+    return false;
+}
+
+void AppendOp::close() {
+    if (current_ < children_.size()) {
+        children_[current_]->close();
+        current_ = children_.size();
+    }
+}
+
+LimitOp::LimitOp(StorageOpsPtr child, int64_t limit, int64_t offset)
+    : child_(std::move(child)), limit_(limit), offset_(offset),
       current_offset_(0), rows_returned_(0) {}
 
 void LimitOp::open() {
@@ -472,37 +1585,34 @@ void LimitOp::open() {
     rows_returned_ = 0;
 }
 
-std::vector<Row*> LimitOp::next() {
-    if (limit_ >= 0 && rows_returned_ >= limit_) {
-        return {};
-    }
-
-    std::vector<Row*> result;
-    std::vector<Row*> batch = child_->next();
+bool LimitOp::next(DataChunk& out) {
+    // batches used up by the offset are skipped, the rest is cut down by the selection
+    while (limit_ < 0 || rows_returned_ < limit_) {
+        if (!child_->next(out)) return false;
 
-    for (Row* row : batch) {
-        if (current_offset_ < offset_) {
-            current_offset_++;
-            continue;
-        }
+        int64_t available = static_cast<int64_t>(out.selected());
+        int64_t skip = std::min(offset_ - current_offset_, available);
+        current_offset_ += skip;
+        int64_t take = available - skip;
+        if (limit_ >= 0) take = std::min(take, limit_ - rows_returned_);
+        if (take == 0) continue;
 
-        if (limit_ >= 0 && rows_returned_ >= limit_) {
-            break;
+        if (skip > 0 || take < available) {
+            out.slice(static_cast<size_t>(skip), static_cast<size_t>(take));
         }
-
-        result.push_back(row);
-        rows_returned_++;
+        rows_returned_ += take;
+        return true;
     }
-
-    return result;
+    return false;
 }
 
 void LimitOp::close() {
     child_->close();
 }
 
-CrossProductOp::CrossProductOp(StorageOps* left, StorageOps* right)
-    : left_(left), right_(right), left_idx_(0), right_idx_(0), initialized_(false) {}
+CrossProductOp::CrossProductOp(StorageOpsPtr left, StorageOpsPtr right, size_t left_width, QueryArena* arena)
+    : left_(std::move(left)), right_(std::move(right)), left_width_(left_width), left_idx_(0), right_idx_(0),
+      initialized_(false), arena_(arena) {}
 
 void CrossProductOp::open() {
     left_->open();
@@ -512,40 +1622,28 @@ void CrossProductOp::open() {
     right_idx_ = 0;
 }
 
-std::vector<Row*> CrossProductOp::next() {
-    if (!initialized_) {
-        std::vector<Row*> batch;
-        while (!(batch = left_->next()).empty()) {
-            for (Row* row : batch) {
-                left_rows_.push_back(row);
-            }
-        }
-        while (!(batch = right_->next()).empty()) {
-            for (Row* row : batch) {
-                right_rows_.push_back(row);
-            }
+// every row of an input, kept in the query arena while the join runs
+static void materialize(StorageOps* input, std::vector<Row*>& rows, QueryArena* arena) {
+    DataChunk chunk;
+    while (input->next(chunk)) {
+        for (size_t i = 0; i < chunk.selected(); i++) {
+            rows.push_back(chunk.to_row(chunk.row(i), arena));
         }
-        initialized_ = true;
     }
+}
 
-    std::vector<Row*> result;
-    const size_t BATCH_SIZE = 64;
-
-    while (result.size() < BATCH_SIZE && left_idx_ < left_rows_.size()) {
-        Row* left_row = left_rows_[left_idx_];
-        Row* right_row = right_rows_[right_idx_];
+bool CrossProductOp::next(DataChunk& out) {
+    if (!initialized_) {
+        materialize(left_.get(), left_rows_, arena_);
+        materialize(right_.get(), right_rows_, arena_);
+        initialized_ = true;
+    }
 
-        std::vector<datatype> combined_values;
-        for (const auto& val : left_row->values) {
-            combined_values.push_back(val);
-        }
-        for (const auto& val : right_row->values) {
-            combined_values.push_back(val);
-        }
+    out.reset(0);
+    if (right_rows_.empty()) return false;
 
-        Row* combined = create_row(static_cast<int>(combined_values.size()),
-                                   std::move(combined_values));
-        result.push_back(combined);
+    while (out.count() < CHUNK_CAPACITY && left_idx_ < left_rows_.size()) {
+        out.append_joined(*left_rows_[left_idx_], *right_rows_[right_idx_], left_width_);
 
         right_idx_++;
         if (right_idx_ >= right_rows_.size()) {
@@ -554,7 +1652,7 @@ std::vector<Row*> CrossProductOp::next() {
         }
     }
 
-    return result;
+    return out.count() > 0;
 }
 
 void CrossProductOp::close() {
@@ -562,56 +1660,73 @@ void CrossProductOp::close() {
     right_->close();
 }
 
-NestedLoopJoin::NestedLoopJoin(StorageOps* left, StorageOps* right,
+NestedLoopJoin::NestedLoopJoin(StorageOpsPtr left, StorageOpsPtr right,
                                const ExprPtr& condition, RANodeType join_type,
-                               const Schema& left_schema, const Schema& right_schema)
-    : left_(left), right_(right), condition_(condition), join_type_(join_type),
-      left_schema_(left_schema), right_schema_(right_schema),
-      left_idx_(0), right_idx_(0), initialized_(false) {}
+                               const Schema& schema, size_t left_width,
+                               QueryArena* arena)
+    : left_(std::move(left)), right_(std::move(right)), condition_(condition), compiled_(condition, schema),
+      join_type_(join_type), schema_(schema), left_width_(left_width),
+      left_matched_(false), left_idx_(0), right_idx_(0), unmatched_idx_(0),
+      initialized_(false), arena_(arena) {}
 
 void NestedLoopJoin::open() {
     left_->open();
     right_->open();
     initialized_ = false;
+    left_matched_ = false;
     left_idx_ = 0;
     right_idx_ = 0;
+    unmatched_idx_ = 0;
 }
 
-std::vector<Row*> NestedLoopJoin::next() {
+bool NestedLoopJoin::next(DataChunk& out) {
     if (!initialized_) {
-        std::vector<Row*> batch;
-        while (!(batch = left_->next()).empty()) {
-            for (Row* row : batch) {
-                left_rows_.push_back(row);
-            }
-        }
-        while (!(batch = right_->next()).empty()) {
-            for (Row* row : batch) {
-                right_rows_.push_back(row);
-            }
-        }
+        materialize(left_.get(), left_rows_, arena_);
+        materialize(right_.get(), right_rows_, arena_);
+        right_matched_.assign(right_rows_.size(), false);
         initialized_ = true;
     }
 
-    std::vector<Row*> result;
-    const size_t BATCH_SIZE = 64;
+    bool keep_left = join_type_ == RANodeType::LEFT_JOIN || join_type_ == RANodeType::FULL_JOIN;
+    bool keep_right = join_type_ == RANodeType::RIGHT_JOIN || join_type_ == RANodeType::FULL_JOIN;
+
+    out.reset(schema_.columns.size());
+    if (right_rows_.empty() && !keep_left) return false;
 
-    while (result.size() < BATCH_SIZE && left_idx_ < left_rows_.size()) {
+    // pairs that fail the condition are skipped, next() only returns rows
+    while (out.count() < CHUNK_CAPACITY && left_idx_ < left_rows_.size()) {
         Row* left_row = left_rows_[left_idx_];
-        Row* right_row = right_rows_[right_idx_];
+        if (right_idx_ < right_rows_.size()) {
+            Row* right_row = right_rows_[right_idx_];
+            if (evaluateCondition(left_row, right_row)) {
+                out.append_joined(*left_row, *right_row, left_width_);
+                left_matched_ = true;
+                right_matched_[right_idx_] = true;
+            }
+            right_idx_++;
+            continue;
+        }
 
-        if (evaluateCondition(left_row, right_row)) {
-            result.push_back(combineRows(left_row, right_row));
+        // a left row nothing matched keeps nulls for the right side's columns
+        if (keep_left && !left_matched_) {
+            out.append_joined(*left_row, empty_row_, left_width_);
         }
+        right_idx_ = 0;
+        left_idx_++;
+        left_matched_ = false;
+    }
 
-        right_idx_++;
-        if (right_idx_ >= right_rows_.size()) {
-            right_idx_ = 0;
-            left_idx_++;
+    // the right rows nothing matched come once every left row is done
+    if (keep_right && left_idx_ >= left_rows_.size()) {
+        while (out.count() < CHUNK_CAPACITY && unmatched_idx_ < right_rows_.size()) {
+            if (!right_matched_[unmatched_idx_]) {
+                out.append_joined(empty_row_, *right_rows_[unmatched_idx_], left_width_);
+            }
+            unmatched_idx_++;
         }
     }
 
-    return result;
+    return out.count() > 0;
 }
 
 void NestedLoopJoin::close() {
@@ -621,18 +1736,206 @@ void NestedLoopJoin::close() {
 
 bool NestedLoopJoin::evaluateCondition(Row* left_row, Row* right_row) {
     if (!condition_) return true;
+    return compiled_.test(left_row, right_row, left_width_);
+}
+
+// FNV-1a over the key values, finished with a 64 bit mixer. Keys that compare
+// equal hash the same, 0.0 and -0.0 included
+static u64 hashKey(const Row* row, const std::vector<size_t>& cols) {
+    u64 h = 14695981039346656037ULL;
+    for (size_t col : cols) {
+        datatype val = col < row->values.size() ? row->values[col] : datatype(0);
+        h = (h ^ val.index()) * 1099511628211ULL;
+        val.visit([&](auto v) {
+            using T = decltype(v);
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                for (char c : v) {
+                    h = (h ^ static_cast<u8>(c)) * 1099511628211ULL;
+                }
+            } else {
+                if constexpr (std::is_floating_point_v<T>) {
+                    if (v == 0) v = 0;
+                }
+                u64 bits = 0;
+                std::memcpy(&bits, &v, sizeof(T));
+                h = (h ^ bits) * 1099511628211ULL;
+            }
+        });
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+HashJoinOp::HashJoinOp(StorageOpsPtr left, StorageOpsPtr right,
+                       std::vector<size_t> left_keys, std::vector<size_t> right_keys,
+                       const ExprPtr& residual, RANodeType join_type,
+                       const Schema& schema, size_t left_width, QueryArena* arena)
+    : left_(std::move(left)), right_(std::move(right)), left_keys_(std::move(left_keys)),
+      right_keys_(std::move(right_keys)), residual_(residual), compiled_(residual, schema),
+      join_type_(join_type), width_(schema.columns.size()), left_width_(left_width),
+      arena_(arena), initialized_(false) {}
+
+void HashJoinOp::open() {
+    left_->open();
+    right_->open();
+    initialized_ = false;
+}
+
+// Reads both inputs a chunk at a time, in turns, until one of them ends. That
+// one is hashed, the rows read of the other are the first to probe with
+void HashJoinOp::build() {
+    std::vector<Row*> left_rows, right_rows;
+    DataChunk chunk;
+    build_left_ = true;
+    while (true) {
+        if (!left_->next(chunk)) break;
+        for (size_t i = 0; i < chunk.selected(); i++) {
+            left_rows.push_back(chunk.to_row(chunk.row(i), arena_));
+        }
+        if (!right_->next(chunk)) {
+            build_left_ = false;
+            break;
+        }
+        for (size_t i = 0; i < chunk.selected(); i++) {
+            right_rows.push_back(chunk.to_row(chunk.row(i), arena_));
+        }
+    }
+
+    bool keep_left = join_type_ == RANodeType::LEFT_JOIN || join_type_ == RANodeType::FULL_JOIN;
+    bool keep_right = join_type_ == RANodeType::RIGHT_JOIN || join_type_ == RANodeType::FULL_JOIN;
+    preserve_build_ = build_left_ ? keep_left : keep_right;
+    preserve_probe_ = build_left_ ? keep_right : keep_left;
+    build_rows_ = build_left_ ? std::move(left_rows) : std::move(right_rows);
+    probe_rows_ = build_left_ ? std::move(right_rows) : std::move(left_rows);
+
+    const std::vector<size_t>& keys = build_left_ ? left_keys_ : right_keys_;
+    size_t num_buckets = 1;
+    while (num_buckets < build_rows_.size() * 2) num_buckets <<= 1;
+    mask_ = num_buckets - 1;
+    buckets_.assign(num_buckets, NO_ROW);
+    chain_.resize(build_rows_.size());
+    build_hashes_.resize(build_rows_.size());
+    build_matched_.assign(build_rows_.size(), false);
+    // pushed front first to last, so each bucket lists its rows in input order
+    for (size_t i = build_rows_.size(); i-- > 0;) {
+        u64 h = hashKey(build_rows_[i], keys);
+        build_hashes_[i] = h;
+        chain_[i] = buckets_[h & mask_];
+        buckets_[h & mask_] = static_cast<u32>(i);
+    }
+
+    probe_idx_ = 0;
+    probing_ = false;
+    probe_done_ = false;
+    unmatched_idx_ = 0;
+}
+
+// the next chunk of the probe input, false once it has none left
+bool HashJoinOp::fetchProbe() {
+    probe_rows_.clear();
+    probe_idx_ = 0;
+    scratch_.release();
+    if (probe_done_) return false;
+
+    StorageOps* probe = build_left_ ? right_.get() : left_.get();
+    if (!probe->next(probe_chunk_)) {
+        probe_done_ = true;
+        return false;
+    }
+    for (size_t i = 0; i < probe_chunk_.selected(); i++) {
+        probe_rows_.push_back(probe_chunk_.to_row(probe_chunk_.row(i), &scratch_));
+    }
+    return true;
+}
+
+bool HashJoinOp::keysEqual(const Row* build, const Row* probe) const {
+    const std::vector<size_t>& build_keys = build_left_ ? left_keys_ : right_keys_;
+    const std::vector<size_t>& probe_keys = build_left_ ? right_keys_ : left_keys_;
+    for (size_t i = 0; i < build_keys.size(); i++) {
+        size_t b = build_keys[i];
+        size_t p = probe_keys[i];
+        datatype build_val = b < build->values.size() ? build->values[b] : datatype::null();
+        datatype probe_val = p < probe->values.size() ? probe->values[p] : datatype::null();
+        // a null key, missing or from an outer join below this one, matches nothing
+        if (build_val.is_null() || probe_val.is_null() || build_val != probe_val) return false;
+    }
     return true;
 }
 
-Row* NestedLoopJoin::combineRows(Row* left_row, Row* right_row) {
-    std::vector<datatype> combined_values;
-    for (const auto& val : left_row->values) {
-        combined_values.push_back(val);
+void HashJoinOp::emit(DataChunk& out, const Row* build, const Row* probe) {
+    if (build_left_) {
+        out.append_joined(*build, *probe, left_width_);
+    } else {
+        out.append_joined(*probe, *build, left_width_);
     }
-    for (const auto& val : right_row->values) {
-        combined_values.push_back(val);
+}
+
+bool HashJoinOp::next(DataChunk& out) {
+    if (!initialized_) {
+        build();
+        initialized_ = true;
     }
-    return create_row(static_cast<int>(combined_values.size()), std::move(combined_values));
+
+    out.reset(width_);
+    if (build_rows_.empty() && !preserve_probe_) return false;
+
+    const std::vector<size_t>& probe_keys = build_left_ ? right_keys_ : left_keys_;
+    while (out.count() < CHUNK_CAPACITY) {
+        if (probe_idx_ >= probe_rows_.size()) {
+            if (fetchProbe()) continue;
+
+            // every probe row is done, what is left are the build rows nothing matched
+            if (!preserve_build_) break;
+            while (out.count() < CHUNK_CAPACITY && unmatched_idx_ < build_rows_.size()) {
+                if (!build_matched_[unmatched_idx_]) {
+                    emit(out, build_rows_[unmatched_idx_], &empty_row_);
+                }
+                unmatched_idx_++;
+            }
+            break;
+        }
+
+        Row* probe = probe_rows_[probe_idx_];
+        if (!probing_) {
+            probe_hash_ = hashKey(probe, probe_keys);
+            match_ = buckets_.empty() ? NO_ROW : buckets_[probe_hash_ & mask_];
+            probe_matched_ = false;
+            probing_ = true;
+        }
+
+        // a probe row can match more rows than the chunk has room for
+        while (match_ != NO_ROW && out.count() < CHUNK_CAPACITY) {
+            u32 b = match_;
+            match_ = chain_[b];
+            if (build_hashes_[b] != probe_hash_ || !keysEqual(build_rows_[b], probe)) continue;
+
+            Row* left_row = build_left_ ? build_rows_[b] : probe;
+            Row* right_row = build_left_ ? probe : build_rows_[b];
+            if (residual_ && !compiled_.test(left_row, right_row, left_width_)) continue;
+
+            emit(out, build_rows_[b], probe);
+            build_matched_[b] = true;
+            probe_matched_ = true;
+        }
+        if (match_ != NO_ROW) break;
+
+        if (preserve_probe_ && !probe_matched_) {
+            if (out.count() >= CHUNK_CAPACITY) break;
+            emit(out, &empty_row_, probe);
+        }
+        probe_idx_++;
+        probing_ = false;
+    }
+
+    return out.count() > 0;
+}
+
+void HashJoinOp::close() {
+    left_->close();
+    right_->close();
+    scratch_.release();
 }
 
 } // namespace DB
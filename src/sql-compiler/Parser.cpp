@@ -88,10 +88,18 @@ RANodePtr Parser::parse() {
     return parse_update_statement();
   } else if (check("DELETE")) {
     return parse_delete_statement();
+  } else if (check("CREATE") && peek(1).value == "INDEX") {
+    return parse_create_index_statement();
   } else if (check("CREATE")) {
     return parse_create_table_statement();
   } else if (check("DROP")) {
     return parse_drop_table_statement();
+  } else if (check("ALTER")) {
+    return parse_alter_table_statement();
+  } else if (check("VACUUM")) {
+    return parse_vacuum_statement();
+  } else if (check("ANALYZE")) {
+    return parse_analyze_statement();
   }
   throw std::runtime_error("Unknown statement type: " + current().value);
 }
@@ -261,7 +269,35 @@ RANodePtr Parser::parse_table_reference() {
     advance();
   }
 
-  return RANode::makeTableScan(table_name, alias);
+  RANodePtr scan = RANode::makeTableScan(table_name, alias);
+  if (match("TABLESAMPLE")) {
+    parse_tablesample(scan);
+  }
+  return scan;
+}
+
+// TABLESAMPLE SYSTEM|BERNOULLI (percent) [REPEATABLE (seed)]
+void Parser::parse_tablesample(RANodePtr &scan) {
+  string method = consume(IDENTIFIER, "Expected sampling method").value;
+  if (method != "SYSTEM" && method != "BERNOULLI") {
+    throw std::runtime_error("Unknown sampling method: " + method);
+  }
+  consume("(", "Expected '(' after sampling method");
+  double percent =
+      std::stod(consume(NUMBER, "Expected sample percentage").value);
+  consume(")", "Expected ')' after sample percentage");
+  if (percent < 0 || percent > 100) {
+    throw std::runtime_error("Sample percentage must be between 0 and 100");
+  }
+
+  scan->sample_method = method;
+  scan->sample_percent = percent;
+  if (match("REPEATABLE")) {
+    consume("(", "Expected '(' after REPEATABLE");
+    scan->sample_seed =
+        std::stoll(consume(NUMBER, "Expected seed after REPEATABLE").value);
+    consume(")", "Expected ')' after seed");
+  }
 }
 
 RANodePtr Parser::parse_join_clause(RANodePtr left) {
@@ -819,6 +855,106 @@ RANodePtr Parser::parse_create_table_statement() {
   node->column_defs = parse_column_definitions();
   consume(")", "Expected ')' after column definitions");
 
+  // ENGINE [=] HEAP | LSM
+  if (match("ENGINE")) {
+    match("=");
+    node->table_engine = consume(IDENTIFIER, "Expected table engine").value;
+    if (node->table_engine != "HEAP" && node->table_engine != "LSM") {
+      throw std::runtime_error("Unknown table engine: " + node->table_engine);
+    }
+  }
+
+  // CLUSTERED BY (pk) keeps the rows in the leaves of a B+tree on the key
+  if (match("CLUSTERED")) {
+    if (node->table_engine == "LSM") {
+      throw std::runtime_error("CLUSTERED BY cannot be used with ENGINE LSM");
+    }
+    consume("BY", "Expected BY after CLUSTERED");
+    consume("(", "Expected '(' before clustering column");
+    node->cluster_column =
+        consume(IDENTIFIER, "Expected clustering column").value;
+    consume(")", "Expected ')' after clustering column");
+    node->table_engine = "CLUSTERED";
+  }
+
+  if (match("PARTITION")) {
+    parse_partition_by(node);
+  }
+
+  return node;
+}
+
+// PARTITION BY RANGE (col) (PARTITION p VALUES LESS THAN (v|MAXVALUE), ...)
+// PARTITION BY HASH (col) PARTITIONS n
+void Parser::parse_partition_by(RANodePtr &node) {
+  consume("BY", "Expected BY after PARTITION");
+  node->partition_method =
+      consume(IDENTIFIER, "Expected partitioning method").value;
+  if (node->partition_method != "RANGE" && node->partition_method != "HASH") {
+    throw std::runtime_error("Unknown partitioning method: " +
+                             node->partition_method);
+  }
+  consume("(", "Expected '(' before partition column");
+  node->partition_column =
+      consume(IDENTIFIER, "Expected partition column").value;
+  consume(")", "Expected ')' after partition column");
+
+  if (node->partition_method == "HASH") {
+    consume("PARTITIONS", "Expected PARTITIONS");
+    int64_t count =
+        std::stoll(consume(NUMBER, "Expected number of partitions").value);
+    if (count < 1 || count > 1024) {
+      throw std::runtime_error("Number of partitions must be between 1 and 1024");
+    }
+    for (int64_t i = 0; i < count; i++) {
+      node->partitions.push_back({"P" + std::to_string(i), nullptr});
+    }
+    return;
+  }
+
+  consume("(", "Expected '(' before partitions");
+  do {
+    node->partitions.push_back(parse_range_partition());
+  } while (match(","));
+  consume(")", "Expected ')' after partitions");
+}
+
+// PARTITION name VALUES LESS THAN (value | MAXVALUE)
+PartitionClause Parser::parse_range_partition() {
+  consume("PARTITION", "Expected PARTITION");
+  PartitionClause clause;
+  clause.name = consume(IDENTIFIER, "Expected partition name").value;
+  consume("VALUES", "Expected VALUES");
+  consume("LESS", "Expected LESS");
+  consume("THAN", "Expected THAN");
+  consume("(", "Expected '(' before partition bound");
+  if (!match("MAXVALUE")) {
+    clause.upper = parse_expression();
+  }
+  consume(")", "Expected ')' after partition bound");
+  return clause;
+}
+
+// ALTER TABLE t ADD PARTITION p VALUES LESS THAN (...) | DROP PARTITION p
+RANodePtr Parser::parse_alter_table_statement() {
+  consume("ALTER", "Expected ALTER");
+  consume("TABLE", "Expected TABLE");
+
+  auto node = std::make_shared<RANode>(RANodeType::ALTER_TABLE_OP);
+  node->table_name = consume(IDENTIFIER, "Expected table name").value;
+  if (match("ADD")) {
+    node->alter_action = "ADD PARTITION";
+    node->partitions.push_back(parse_range_partition());
+  } else if (match("DROP")) {
+    consume("PARTITION", "Expected PARTITION after DROP");
+    node->alter_action = "DROP PARTITION";
+    node->partitions.push_back(
+        {consume(IDENTIFIER, "Expected partition name").value, nullptr});
+  } else {
+    throw std::runtime_error("Expected ADD or DROP after ALTER TABLE " +
+                             node->table_name);
+  }
+
   return node;
 }
 
@@ -850,6 +986,7 @@ std::vector<ColumnDef> Parser::parse_column_definitions() {
       } else if (match("DEFAULT")) {
         def.default_value = parse_expression();
       } else if (match("UNIQUE")) {
+        def.unique = true;
       } else if (match("CHECK")) {
         consume("(", "Expected '(' after CHECK");
         parse_expression();
@@ -875,6 +1012,67 @@ RANodePtr Parser::parse_drop_table_statement() {
   return node;
 }
 
+// CREATE INDEX name ON table [USING method] (column) [USING method]
+RANodePtr Parser::parse_create_index_statement() {
+  consume("CREATE", "Expected CREATE");
+  consume("INDEX", "Expected INDEX");
+
+  auto node = std::make_shared<RANode>(RANodeType::CREATE_INDEX_OP);
+  node->index_name = consume(IDENTIFIER, "Expected index name").value;
+  consume("ON", "Expected ON after index name");
+  node->table_name = consume(IDENTIFIER, "Expected table name").value;
+  if (match("USING")) {
+    node->index_method = consume(IDENTIFIER, "Expected index method").value;
+  }
+
+  consume("(", "Expected '(' before index columns");
+  do {
+    node->index_columns.push_back(
+        consume(IDENTIFIER, "Expected column name").value);
+  } while (match(","));
+  consume(")", "Expected ')' after index columns");
+
+  if (node->index_method.empty() && match("USING")) {
+    node->index_method = consume(IDENTIFIER, "Expected index method").value;
+  }
+  if (!node->index_method.empty() && node->index_method != "BTREE" &&
+      node->index_method != "HASH" && node->index_method != "BITMAP") {
+    throw std::runtime_error("Unknown index method: " + node->index_method);
+  }
+
+  if (node->index_columns.size() != 1) {
+    throw std::runtime_error("Only single column indexes are supported");
+  }
+
+  return node;
+}
+
+// VACUUM [table], without a table every table is vacuumed
+RANodePtr Parser::parse_vacuum_statement() {
+  consume("VACUUM", "Expected VACUUM");
+
+  auto node = std::make_shared<RANode>(RANodeType::VACUUM_OP);
+  if (check(IDENTIFIER)) {
+    node->table_name = current().value;
+    advance();
+  }
+
+  return node;
+}
+
+// ANALYZE [table], without a table every table is analyzed
+RANodePtr Parser::parse_analyze_statement() {
+  consume("ANALYZE", "Expected ANALYZE");
+
+  auto node = std::make_shared<RANode>(RANodeType::ANALYZE_OP);
+  if (check(IDENTIFIER)) {
+    node->table_name = current().value;
+    advance();
+  }
+
+  return node;
+}
+
 void sql_query(SqlNode *root, std::vector<Token> &tokens,
                std::vector<string> &aliases, int st) {
   std::cout << "WARNING: Using legacy sql_query. Use parse_to_ra() instead.\n";
@@ -0,0 +1,354 @@
+#include "storage-manager/BPlusTree.hpp"
+#include "page-manager/DbFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#define BTREE_NODE_HEADER_SIZE (sizeof(u8) + sizeof(u8) + sizeof(u16) + sizeof(u32) + sizeof(u32))
+#define BTREE_LEAF_CAPACITY ((PAGE_DATA_SIZE - BTREE_NODE_HEADER_SIZE) / sizeof(IndexEntry))
+#define BTREE_INTERNAL_CAPACITY ((PAGE_DATA_SIZE - BTREE_NODE_HEADER_SIZE) / (sizeof(IndexEntry) + sizeof(u32)))
+
+namespace DB {
+    void BPlusTree::Iterator::next() {
+        thePos++;
+        skip_empty();
+    }
+
+    void BPlusTree::Iterator::skip_empty() {
+        while (thePos >= theLeaf.entries.size() && theLeaf.next != BTREE_NULL_PAGE) {
+            theLeaf = theTree->read_node(theLeaf.next);
+            thePos = 0;
+        }
+    }
+
+    BPlusTree::BPlusTree(const string& path, ColumnType keyType, PageCache& cache) :
+        thePath(path),
+        theKeyType(keyType),
+        theCache(cache)
+        {
+            DbFile& dbfile = DbFile::getInstance();
+            if (dbfile.get_filepath(path) == -1) {
+                dbfile.add_filepath(path);
+            }
+        }
+
+    BPlusTree::Node BPlusTree::read_node(u32 pageId) const {
+        Page page;
+        theCache.read(pageId, page, thePath);
+
+        Node node;
+        const u8* data = reinterpret_cast<const u8*>(page.data);
+        u16 count;
+        u32 firstChild;
+        node.leaf = data[0] != 0;
+        std::memcpy(&count, data + 2, sizeof(u16));
+        std::memcpy(&node.next, data + 4, sizeof(u32));
+        std::memcpy(&firstChild, data + 8, sizeof(u32));
+
+        const u8* ptr = data + BTREE_NODE_HEADER_SIZE;
+        node.entries.resize(count);
+        if (node.leaf) {
+            std::memcpy(node.entries.data(), ptr, count * sizeof(IndexEntry));
+        } else {
+            node.children.resize(count + 1);
+            node.children[0] = firstChild;
+            for (u16 i = 0; i < count; i++) {
+                std::memcpy(&node.entries[i], ptr, sizeof(IndexEntry));
+                std::memcpy(&node.children[i + 1], ptr + sizeof(IndexEntry), sizeof(u32));
+                ptr += sizeof(IndexEntry) + sizeof(u32);
+            }
+        }
+        return node;
+    }
+
+    void BPlusTree::write_node(u32 pageId, const Node& node) {
+        Page page(pageId);
+        page.valid_bit = true;
+        page.used_bytes = PAGE_DATA_SIZE;
+        page.clear();
+
+        u8* data = reinterpret_cast<u8*>(page.data);
+        u16 count = (u16)node.entries.size();
+        u32 firstChild = node.leaf ? BTREE_NULL_PAGE : node.children[0];
+        data[0] = node.leaf ? 1 : 0;
+        std::memcpy(data + 2, &count, sizeof(u16));
+        std::memcpy(data + 4, &node.next, sizeof(u32));
+        std::memcpy(data + 8, &firstChild, sizeof(u32));
+
+        u8* ptr = data + BTREE_NODE_HEADER_SIZE;
+        if (node.leaf) {
+            std::memcpy(ptr, node.entries.data(), count * sizeof(IndexEntry));
+        } else {
+            for (u16 i = 0; i < count; i++) {
+                std::memcpy(ptr, &node.entries[i], sizeof(IndexEntry));
+                std::memcpy(ptr + sizeof(IndexEntry), &node.children[i + 1], sizeof(u32));
+                ptr += sizeof(IndexEntry) + sizeof(u32);
+            }
+        }
+        theCache.write_through(page, thePath);
+    }
+
+    // page 0 is [magic u32][root u32][num_pages u32][height u32][key type u8]
+    void BPlusTree::write_header() {
+        Page page(0);
+        page.valid_bit = true;
+        page.used_bytes = 0;
+        page.clear();
+
+        u32 magic = BTREE_MAGIC;
+        u8 keyType = (u8)theKeyType;
+        page.write_data(&magic, sizeof(u32));
+        page.write_data(&theRoot, sizeof(u32));
+        page.write_data(&theNumPages, sizeof(u32));
+        page.write_data(&theHeight, sizeof(u32));
+        page.write_data(&keyType, sizeof(u8));
+        theCache.write_through(page, thePath);
+    }
+
+    void BPlusTree::create() {
+        DbFile& dbfile = DbFile::getInstance();
+        dbfile.truncate(0, dbfile.get_filepath(thePath));
+
+        theNumPages = 1;
+        theRoot = alloc_page();
+        theHeight = 1;
+        write_node(theRoot, Node());
+        write_header();
+    }
+
+    bool BPlusTree::open() {
+        Page page;
+        theCache.read(0, page, thePath);
+
+        const u8* data = reinterpret_cast<const u8*>(page.data);
+        u32 magic;
+        std::memcpy(&magic, data, sizeof(u32));
+        if (magic != BTREE_MAGIC) {
+            return false;
+        }
+        std::memcpy(&theRoot, data + 4, sizeof(u32));
+        std::memcpy(&theNumPages, data + 8, sizeof(u32));
+        std::memcpy(&theHeight, data + 12, sizeof(u32));
+        theKeyType = (ColumnType)data[16];
+        return true;
+    }
+
+    void BPlusTree::bulk_build(std::vector<IndexEntry>& entries) {
+        if (entries.empty()) {
+            create();
+            return;
+        }
+        std::sort(entries.begin(), entries.end(), entry_less);
+
+        DbFile& dbfile = DbFile::getInstance();
+        dbfile.truncate(0, dbfile.get_filepath(thePath));
+        theNumPages = 1;
+
+        // leaves are filled to PAGE_FILL so the first inserts don't split every page,
+        // and written in key order so each one's sibling is the next page
+        size_t leafFill = std::max<size_t>(1, BTREE_LEAF_CAPACITY * PAGE_FILL / 100);
+        size_t numLeaves = (entries.size() + leafFill - 1) / leafFill;
+        std::vector<u32> level;
+        std::vector<IndexEntry> firsts;
+        for (size_t i = 0; i < numLeaves; i++) {
+            Node leaf;
+            auto start = entries.begin() + i * leafFill;
+            auto end = entries.begin() + std::min(entries.size(), (i + 1) * leafFill);
+            leaf.entries.assign(start, end);
+
+            u32 page = alloc_page();
+            leaf.next = i + 1 < numLeaves ? page + 1 : BTREE_NULL_PAGE;
+            write_node(page, leaf);
+            level.push_back(page);
+            firsts.push_back(leaf.entries[0]);
+        }
+        theHeight = 1;
+
+        size_t fanout = std::max<size_t>(2, (BTREE_INTERNAL_CAPACITY + 1) * PAGE_FILL / 100);
+        while (level.size() > 1) {
+            std::vector<u32> parents;
+            std::vector<IndexEntry> parentFirsts;
+            for (size_t i = 0; i < level.size(); i += fanout) {
+                Node node;
+                node.leaf = false;
+                size_t end = std::min(level.size(), i + fanout);
+                for (size_t c = i; c < end; c++) {
+                    node.children.push_back(level[c]);
+                    if (c > i) {
+                        node.entries.push_back(firsts[c]);
+                    }
+                }
+                u32 page = alloc_page();
+                write_node(page, node);
+                parents.push_back(page);
+                parentFirsts.push_back(firsts[i]);
+            }
+            level = std::move(parents);
+            firsts = std::move(parentFirsts);
+            theHeight++;
+        }
+
+        theRoot = level[0];
+        write_header();
+    }
+
+    u32 BPlusTree::find_leaf(const IndexEntry& entry) const {
+        u32 page = theRoot;
+        Node node = read_node(page);
+        while (!node.leaf) {
+            size_t idx = std::upper_bound(node.entries.begin(), node.entries.end(), entry, entry_less) -
+                         node.entries.begin();
+            page = node.children[idx];
+            node = read_node(page);
+        }
+        return page;
+    }
+
+    bool BPlusTree::insert_into(u32 pageId, const IndexEntry& entry, IndexEntry& sep, u32& newPage) {
+        Node node = read_node(pageId);
+
+        if (node.leaf) {
+            auto pos = std::lower_bound(node.entries.begin(), node.entries.end(), entry, entry_less);
+            node.entries.insert(pos, entry);
+            if (node.entries.size() <= BTREE_LEAF_CAPACITY) {
+                write_node(pageId, node);
+                return false;
+            }
+
+            size_t mid = node.entries.size() / 2;
+            Node right;
+            right.entries.assign(node.entries.begin() + mid, node.entries.end());
+            right.next = node.next;
+            node.entries.resize(mid);
+            newPage = alloc_page();
+            node.next = newPage;
+            write_node(newPage, right);
+            write_node(pageId, node);
+            sep = right.entries[0];
+            return true;
+        }
+
+        size_t idx = std::upper_bound(node.entries.begin(), node.entries.end(), entry, entry_less) -
+                     node.entries.begin();
+        IndexEntry childSep;
+        u32 childPage;
+        if (!insert_into(node.children[idx], entry, childSep, childPage)) {
+            return false;
+        }
+
+        node.entries.insert(node.entries.begin() + idx, childSep);
+        node.children.insert(node.children.begin() + idx + 1, childPage);
+        if (node.entries.size() <= BTREE_INTERNAL_CAPACITY) {
+            write_node(pageId, node);
+            return false;
+        }
+
+        // the middle separator moves up instead of being copied
+        size_t mid = node.entries.size() / 2;
+        Node right;
+        right.leaf = false;
+        sep = node.entries[mid];
+        right.entries.assign(node.entries.begin() + mid + 1, node.entries.end());
+        right.children.assign(node.children.begin() + mid + 1, node.children.end());
+        node.entries.resize(mid);
+        node.children.resize(mid + 1);
+        newPage = alloc_page();
+        write_node(newPage, right);
+        write_node(pageId, node);
+        return true;
+    }
+
+    void BPlusTree::insert(const IndexKey& key, const RowId& rid) {
+        IndexEntry entry{key, rid};
+        IndexEntry sep;
+        u32 newPage;
+        u32 pagesBefore = theNumPages;
+        if (!insert_into(theRoot, entry, sep, newPage)) {
+            if (theNumPages != pagesBefore) {
+                write_header(); // a split grew the file, persist num_pages
+            }
+            return;
+        }
+
+        Node root;
+        root.leaf = false;
+        root.entries.push_back(sep);
+        root.children = {theRoot, newPage};
+        theRoot = alloc_page();
+        theHeight++;
+        write_node(theRoot, root);
+        write_header();
+    }
+
+    bool BPlusTree::remove(const IndexKey& key, const RowId& rid) {
+        IndexEntry entry{key, rid};
+        u32 page = find_leaf(entry);
+        Node leaf = read_node(page);
+
+        auto pos = std::lower_bound(leaf.entries.begin(), leaf.entries.end(), entry, entry_less);
+        if (pos == leaf.entries.end() || compare_keys(pos->key, key) != 0 || !same_row(pos->rid, rid)) {
+            return false;
+        }
+        leaf.entries.erase(pos);
+        write_node(page, leaf);
+        return true;
+    }
+
+    BPlusTree::Iterator BPlusTree::seek(const IndexKey& key) const {
+        IndexEntry entry{key, {}};
+        Iterator it;
+        it.theTree = this;
+        it.theLeaf = read_node(find_leaf(entry));
+        it.thePos = std::lower_bound(it.theLeaf.entries.begin(), it.theLeaf.entries.end(), entry, entry_less) -
+                    it.theLeaf.entries.begin();
+        it.skip_empty();
+        return it;
+    }
+
+    BPlusTree::Iterator BPlusTree::begin() const {
+        Node node = read_node(theRoot);
+        while (!node.leaf) {
+            node = read_node(node.children[0]);
+        }
+        Iterator it;
+        it.theTree = this;
+        it.theLeaf = std::move(node);
+        it.thePos = 0;
+        it.skip_empty();
+        return it;
+    }
+
+    std::vector<RowId> BPlusTree::lookup(const IndexKey& key) const {
+        std::vector<RowId> rids;
+        for (Iterator it = seek(key); it.valid() && compare_keys(it.key(), key) == 0; it.next()) {
+            rids.push_back(it.rid());
+        }
+        return rids;
+    }
+
+    // Each probe starts where the last one stopped. Sorted keys that land in
+    // the same leaf are found by a search in that leaf, not from the root.
+    std::vector<std::vector<RowId>> BPlusTree::lookup_many(const std::vector<IndexKey>& keys) const {
+        std::vector<std::vector<RowId>> found(keys.size());
+        Iterator it;
+        for (size_t i = 0; i < keys.size(); i++) {
+            const IndexKey& key = keys[i];
+            if (i > 0 && compare_keys(keys[i - 1], key) == 0) {
+                found[i] = found[i - 1];
+                continue;
+            }
+
+            if (it.valid() && compare_keys(it.theLeaf.entries.back().key, key) >= 0) {
+                IndexEntry entry{key, {}};
+                it.thePos = std::lower_bound(it.theLeaf.entries.begin() + it.thePos, it.theLeaf.entries.end(),
+                                             entry, entry_less) - it.theLeaf.entries.begin();
+            } else {
+                it = seek(key);
+            }
+            for (; it.valid() && compare_keys(it.key(), key) == 0; it.next()) {
+                found[i].push_back(it.rid());
+            }
+        }
+        return found;
+    }
+}
@@ -0,0 +1,392 @@
+#include "storage-manager/Bitmap.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace DB {
+    enum class WordOp {
+        AND,
+        OR,
+        ANDNOT
+    };
+
+    // dst = a op b over a whole bitset container, returns the bits set in dst
+    template <WordOp op>
+    static u32 combine_words(u64* dst, const u64* a, const u64* b) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 4 <= ROARING_BITSET_WORDS; i += 4) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            __m256i r;
+            if constexpr (op == WordOp::AND) r = _mm256_and_si256(x, y);
+            else if constexpr (op == WordOp::OR) r = _mm256_or_si256(x, y);
+            else r = _mm256_andnot_si256(y, x);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), r);
+        }
+#elif defined(__SSE2__)
+        for (; i + 2 <= ROARING_BITSET_WORDS; i += 2) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            __m128i r;
+            if constexpr (op == WordOp::AND) r = _mm_and_si128(x, y);
+            else if constexpr (op == WordOp::OR) r = _mm_or_si128(x, y);
+            else r = _mm_andnot_si128(y, x);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), r);
+        }
+#endif
+        for (; i < ROARING_BITSET_WORDS; i++) {
+            if constexpr (op == WordOp::AND) dst[i] = a[i] & b[i];
+            else if constexpr (op == WordOp::OR) dst[i] = a[i] | b[i];
+            else dst[i] = a[i] & ~b[i];
+        }
+
+        u32 card = 0;
+        for (i = 0; i < ROARING_BITSET_WORDS; i++) {
+            card += (u32)__builtin_popcountll(dst[i]);
+        }
+        return card;
+    }
+
+    static bool test_bit(const std::vector<u64>& words, u16 v) {
+        return (words[v >> 6] >> (v & 63)) & 1;
+    }
+
+    RoaringBitmap::Container* RoaringBitmap::find(u16 key) {
+        auto it = std::lower_bound(theContainers.begin(), theContainers.end(), key,
+                                   [](const Container& c, u16 k) { return c.key < k; });
+        return it != theContainers.end() && it->key == key ? &*it : nullptr;
+    }
+
+    const RoaringBitmap::Container* RoaringBitmap::find(u16 key) const {
+        return const_cast<RoaringBitmap*>(this)->find(key);
+    }
+
+    void RoaringBitmap::to_bitset(Container& c) {
+        c.words.assign(ROARING_BITSET_WORDS, 0);
+        for (u16 v : c.values) {
+            c.words[v >> 6] |= 1ULL << (v & 63);
+        }
+        c.values.clear();
+        c.values.shrink_to_fit();
+        c.bitset = true;
+    }
+
+    void RoaringBitmap::to_array(Container& c) {
+        c.values.clear();
+        c.values.reserve(c.card);
+        for (u32 w = 0; w < ROARING_BITSET_WORDS; w++) {
+            u64 word = c.words[w];
+            while (word != 0) {
+                c.values.push_back((u16)(w * 64 + __builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        }
+        c.words.clear();
+        c.words.shrink_to_fit();
+        c.bitset = false;
+    }
+
+    void RoaringBitmap::normalize(Container& c) {
+        if (c.bitset && c.card <= ROARING_ARRAY_MAX) {
+            to_array(c);
+        } else if (!c.bitset && c.values.size() > ROARING_ARRAY_MAX) {
+            to_bitset(c);
+        }
+    }
+
+    void RoaringBitmap::add(u32 pos) {
+        u16 key = (u16)(pos >> 16);
+        u16 low = (u16)(pos & 0xFFFF);
+        auto it = std::lower_bound(theContainers.begin(), theContainers.end(), key,
+                                   [](const Container& c, u16 k) { return c.key < k; });
+        if (it == theContainers.end() || it->key != key) {
+            Container c;
+            c.key = key;
+            it = theContainers.insert(it, std::move(c));
+        }
+
+        Container& c = *it;
+        if (c.bitset) {
+            if (!test_bit(c.words, low)) {
+                c.words[low >> 6] |= 1ULL << (low & 63);
+                c.card++;
+            }
+            return;
+        }
+        auto pos_it = std::lower_bound(c.values.begin(), c.values.end(), low);
+        if (pos_it == c.values.end() || *pos_it != low) {
+            c.values.insert(pos_it, low);
+            c.card++;
+            normalize(c);
+        }
+    }
+
+    bool RoaringBitmap::remove(u32 pos) {
+        Container* c = find((u16)(pos >> 16));
+        u16 low = (u16)(pos & 0xFFFF);
+        if (c == nullptr) {
+            return false;
+        }
+        if (c->bitset) {
+            if (!test_bit(c->words, low)) {
+                return false;
+            }
+            c->words[low >> 6] &= ~(1ULL << (low & 63));
+        } else {
+            auto it = std::lower_bound(c->values.begin(), c->values.end(), low);
+            if (it == c->values.end() || *it != low) {
+                return false;
+            }
+            c->values.erase(it);
+        }
+        c->card--;
+
+        if (c->card == 0) {
+            theContainers.erase(theContainers.begin() + (c - theContainers.data()));
+        } else {
+            normalize(*c);
+        }
+        return true;
+    }
+
+    bool RoaringBitmap::contains(u32 pos) const {
+        const Container* c = find((u16)(pos >> 16));
+        u16 low = (u16)(pos & 0xFFFF);
+        if (c == nullptr) {
+            return false;
+        }
+        if (c->bitset) {
+            return test_bit(c->words, low);
+        }
+        return std::binary_search(c->values.begin(), c->values.end(), low);
+    }
+
+    u64 RoaringBitmap::cardinality() const {
+        u64 total = 0;
+        for (const Container& c : theContainers) {
+            total += c.card;
+        }
+        return total;
+    }
+
+    RoaringBitmap& RoaringBitmap::operator&=(const RoaringBitmap& other) {
+        std::vector<Container> result;
+        size_t j = 0;
+        for (Container& a : theContainers) {
+            while (j < other.theContainers.size() && other.theContainers[j].key < a.key) {
+                j++;
+            }
+            if (j == other.theContainers.size()) {
+                break;
+            }
+            const Container& b = other.theContainers[j];
+            if (b.key != a.key) {
+                continue;
+            }
+
+            Container r;
+            r.key = a.key;
+            if (a.bitset && b.bitset) {
+                r.bitset = true;
+                r.words.resize(ROARING_BITSET_WORDS);
+                r.card = combine_words<WordOp::AND>(r.words.data(), a.words.data(), b.words.data());
+            } else if (!a.bitset && !b.bitset) {
+                std::set_intersection(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                                      std::back_inserter(r.values));
+                r.card = (u32)r.values.size();
+            } else {
+                const Container& arr = a.bitset ? b : a;
+                const Container& set = a.bitset ? a : b;
+                for (u16 v : arr.values) {
+                    if (test_bit(set.words, v)) {
+                        r.values.push_back(v);
+                    }
+                }
+                r.card = (u32)r.values.size();
+            }
+            if (r.card > 0) {
+                normalize(r);
+                result.push_back(std::move(r));
+            }
+        }
+        theContainers = std::move(result);
+        return *this;
+    }
+
+    RoaringBitmap& RoaringBitmap::operator|=(const RoaringBitmap& other) {
+        std::vector<Container> result;
+        result.reserve(theContainers.size() + other.theContainers.size());
+        size_t i = 0, j = 0;
+        while (i < theContainers.size() || j < other.theContainers.size()) {
+            if (j == other.theContainers.size() ||
+                (i < theContainers.size() && theContainers[i].key < other.theContainers[j].key)) {
+                result.push_back(std::move(theContainers[i++]));
+                continue;
+            }
+            if (i == theContainers.size() || other.theContainers[j].key < theContainers[i].key) {
+                result.push_back(other.theContainers[j++]);
+                continue;
+            }
+
+            Container& a = theContainers[i++];
+            const Container& b = other.theContainers[j++];
+            Container r;
+            r.key = a.key;
+            if (a.bitset && b.bitset) {
+                r.bitset = true;
+                r.words.resize(ROARING_BITSET_WORDS);
+                r.card = combine_words<WordOp::OR>(r.words.data(), a.words.data(), b.words.data());
+            } else if (!a.bitset && !b.bitset) {
+                std::set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                               std::back_inserter(r.values));
+                r.card = (u32)r.values.size();
+            } else {
+                const Container& arr = a.bitset ? b : a;
+                r = a.bitset ? std::move(a) : b;
+                for (u16 v : arr.values) {
+                    if (!test_bit(r.words, v)) {
+                        r.words[v >> 6] |= 1ULL << (v & 63);
+                        r.card++;
+                    }
+                }
+            }
+            normalize(r);
+            result.push_back(std::move(r));
+        }
+        theContainers = std::move(result);
+        return *this;
+    }
+
+    RoaringBitmap& RoaringBitmap::operator-=(const RoaringBitmap& other) {
+        std::vector<Container> result;
+        size_t j = 0;
+        for (Container& a : theContainers) {
+            while (j < other.theContainers.size() && other.theContainers[j].key < a.key) {
+                j++;
+            }
+            if (j == other.theContainers.size() || other.theContainers[j].key != a.key) {
+                result.push_back(std::move(a));
+                continue;
+            }
+
+            const Container& b = other.theContainers[j];
+            Container r;
+            r.key = a.key;
+            if (a.bitset && b.bitset) {
+                r.bitset = true;
+                r.words.resize(ROARING_BITSET_WORDS);
+                r.card = combine_words<WordOp::ANDNOT>(r.words.data(), a.words.data(), b.words.data());
+            } else if (!a.bitset) {
+                for (u16 v : a.values) {
+                    bool inB = b.bitset ? test_bit(b.words, v)
+                                        : std::binary_search(b.values.begin(), b.values.end(), v);
+                    if (!inB) {
+                        r.values.push_back(v);
+                    }
+                }
+                r.card = (u32)r.values.size();
+            } else {
+                r = std::move(a);
+                for (u16 v : b.values) {
+                    if (test_bit(r.words, v)) {
+                        r.words[v >> 6] &= ~(1ULL << (v & 63));
+                        r.card--;
+                    }
+                }
+            }
+            if (r.card > 0) {
+                normalize(r);
+                result.push_back(std::move(r));
+            }
+        }
+        theContainers = std::move(result);
+        return *this;
+    }
+
+    std::vector<u32> RoaringBitmap::to_vector() const {
+        std::vector<u32> out;
+        out.reserve(cardinality());
+        for (const Container& c : theContainers) {
+            u32 high = (u32)c.key << 16;
+            if (!c.bitset) {
+                for (u16 v : c.values) {
+                    out.push_back(high | v);
+                }
+                continue;
+            }
+            for (u32 w = 0; w < ROARING_BITSET_WORDS; w++) {
+                u64 word = c.words[w];
+                while (word != 0) {
+                    out.push_back(high | (w * 64 + __builtin_ctzll(word)));
+                    word &= word - 1;
+                }
+            }
+        }
+        return out;
+    }
+
+    // [num containers u32] then per container [key u16][bitset u8][pad u8][card u32][values or words]
+    void RoaringBitmap::serialize(std::vector<u8>& out) const {
+        auto append = [&](const void* src, size_t len) {
+            const u8* bytes = static_cast<const u8*>(src);
+            out.insert(out.end(), bytes, bytes + len);
+        };
+        u32 count = (u32)theContainers.size();
+        append(&count, sizeof(u32));
+        for (const Container& c : theContainers) {
+            u8 header[8] = {};
+            std::memcpy(header, &c.key, sizeof(u16));
+            header[2] = c.bitset ? 1 : 0;
+            std::memcpy(header + 4, &c.card, sizeof(u32));
+            append(header, sizeof(header));
+            if (c.bitset) {
+                append(c.words.data(), ROARING_BITSET_WORDS * sizeof(u64));
+            } else {
+                append(c.values.data(), c.values.size() * sizeof(u16));
+            }
+        }
+    }
+
+    size_t RoaringBitmap::deserialize(const u8* data, size_t size) {
+        theContainers.clear();
+        size_t offset = 0;
+        u32 count;
+        if (size < sizeof(u32)) {
+            return 0;
+        }
+        std::memcpy(&count, data, sizeof(u32));
+        offset += sizeof(u32);
+
+        for (u32 i = 0; i < count; i++) {
+            if (offset + 8 > size) {
+                return 0;
+            }
+            Container c;
+            std::memcpy(&c.key, data + offset, sizeof(u16));
+            c.bitset = data[offset + 2] != 0;
+            std::memcpy(&c.card, data + offset + 4, sizeof(u32));
+            offset += 8;
+
+            size_t len = c.bitset ? ROARING_BITSET_WORDS * sizeof(u64) : c.card * sizeof(u16);
+            if (offset + len > size) {
+                return 0;
+            }
+            if (c.bitset) {
+                c.words.resize(ROARING_BITSET_WORDS);
+                std::memcpy(c.words.data(), data + offset, len);
+            } else {
+                c.values.resize(c.card);
+                std::memcpy(c.values.data(), data + offset, len);
+            }
+            offset += len;
+            theContainers.push_back(std::move(c));
+        }
+        return offset;
+    }
+}
@@ -0,0 +1,203 @@
+#include "storage-manager/BitmapIndex.hpp"
+#include "page-manager/DbFile.hpp"
+
+#include <cstring>
+
+#define BITMAP_HEADER_SIZE (sizeof(u32) + sizeof(u32) + sizeof(u64) + sizeof(u64))
+#define BITMAP_LOG_RECORD_SIZE (sizeof(u8) + INDEX_KEY_SIZE + sizeof(u32))
+#define BITMAP_OP_ADD 1
+#define BITMAP_OP_REMOVE 2
+
+namespace DB {
+    BitmapIndex::BitmapIndex(const string& path, ColumnType keyType) :
+        thePath(path),
+        theKeyType(keyType)
+        {
+            DbFile& dbfile = DbFile::getInstance();
+            theFd = dbfile.get_filepath(path);
+            if (theFd == -1) {
+                theFd = dbfile.add_filepath(path);
+            }
+        }
+
+    u32 BitmapIndex::position(const RowId& rid) {
+        return (u32)(rid.pageId.page_num * SLOTS_PER_PAGE + rid.record_num);
+    }
+
+    RowId BitmapIndex::row_id(u32 pos) const {
+        return {{theHeapId, pos / SLOTS_PER_PAGE}, pos % SLOTS_PER_PAGE};
+    }
+
+    // [magic u32][key type u32][heap id u64][snapshot bytes u64]
+    // snapshot is [num values u32] then [key][bitmap] for each value
+    void BitmapIndex::write_snapshot() {
+        std::vector<u8> buffer(BITMAP_HEADER_SIZE);
+        u32 count = (u32)theBitmaps.size();
+        buffer.insert(buffer.end(), reinterpret_cast<u8*>(&count), reinterpret_cast<u8*>(&count) + sizeof(u32));
+        for (auto& [key, bitmap] : theBitmaps) {
+            buffer.insert(buffer.end(), key.bytes, key.bytes + INDEX_KEY_SIZE);
+            bitmap.serialize(buffer);
+        }
+
+        u32 magic = BITMAP_INDEX_MAGIC;
+        u32 keyType = (u32)theKeyType;
+        u64 snapshotSize = buffer.size() - BITMAP_HEADER_SIZE;
+        std::memcpy(buffer.data(), &magic, sizeof(u32));
+        std::memcpy(buffer.data() + 4, &keyType, sizeof(u32));
+        std::memcpy(buffer.data() + 8, &theHeapId, sizeof(u64));
+        std::memcpy(buffer.data() + 16, &snapshotSize, sizeof(u64));
+
+        DbFile& dbfile = DbFile::getInstance();
+        dbfile.truncate(0, theFd);
+        dbfile.write_at(0, buffer.data(), buffer.size(), theFd);
+        theLogEnd = buffer.size();
+        theLogRecords = 0;
+    }
+
+    void BitmapIndex::append_log(u8 op, const IndexKey& key, u32 pos) {
+        if (theLogRecords >= BITMAP_LOG_COMPACT) {
+            write_snapshot(); // already holds this change
+            return;
+        }
+        u8 record[BITMAP_LOG_RECORD_SIZE];
+        record[0] = op;
+        std::memcpy(record + 1, key.bytes, INDEX_KEY_SIZE);
+        std::memcpy(record + 1 + INDEX_KEY_SIZE, &pos, sizeof(u32));
+        DbFile::getInstance().write_at(theLogEnd, record, sizeof(record), theFd);
+        theLogEnd += sizeof(record);
+        theLogRecords++;
+    }
+
+    void BitmapIndex::apply(u8 op, const IndexKey& key, u32 pos) {
+        if (op == BITMAP_OP_ADD) {
+            theBitmaps[key].add(pos);
+            return;
+        }
+        auto it = theBitmaps.find(key);
+        if (it != theBitmaps.end() && it->second.remove(pos) && it->second.empty()) {
+            theBitmaps.erase(it);
+        }
+    }
+
+    void BitmapIndex::create() {
+        theBitmaps.clear();
+        write_snapshot();
+    }
+
+    bool BitmapIndex::open() {
+        DbFile& dbfile = DbFile::getInstance();
+        u8 header[BITMAP_HEADER_SIZE];
+        if (dbfile.read_at(0, header, sizeof(header), theFd) != (ssize_t)sizeof(header)) {
+            return false;
+        }
+        u32 magic;
+        u32 keyType;
+        u64 snapshotSize;
+        std::memcpy(&magic, header, sizeof(u32));
+        if (magic != BITMAP_INDEX_MAGIC) {
+            return false;
+        }
+        std::memcpy(&keyType, header + 4, sizeof(u32));
+        std::memcpy(&theHeapId, header + 8, sizeof(u64));
+        std::memcpy(&snapshotSize, header + 16, sizeof(u64));
+        theKeyType = (ColumnType)keyType;
+
+        std::vector<u8> snapshot(snapshotSize);
+        if (dbfile.read_at(BITMAP_HEADER_SIZE, snapshot.data(), snapshotSize, theFd) != (ssize_t)snapshotSize) {
+            return false;
+        }
+        theBitmaps.clear();
+        u32 count;
+        std::memcpy(&count, snapshot.data(), sizeof(u32));
+        size_t offset = sizeof(u32);
+        for (u32 i = 0; i < count; i++) {
+            IndexKey key;
+            std::memcpy(key.bytes, snapshot.data() + offset, INDEX_KEY_SIZE);
+            offset += INDEX_KEY_SIZE;
+            size_t used = theBitmaps[key].deserialize(snapshot.data() + offset, snapshot.size() - offset);
+            if (used == 0) {
+                return false;
+            }
+            offset += used;
+        }
+
+        // replay the changes logged after the snapshot
+        theLogEnd = BITMAP_HEADER_SIZE + snapshotSize;
+        theLogRecords = 0;
+        u8 records[BITMAP_LOG_RECORD_SIZE * 256];
+        while (true) {
+            ssize_t bytes = dbfile.read_at(theLogEnd, records, sizeof(records), theFd);
+            size_t whole = bytes > 0 ? (size_t)bytes / BITMAP_LOG_RECORD_SIZE : 0;
+            for (size_t i = 0; i < whole; i++) {
+                const u8* record = records + i * BITMAP_LOG_RECORD_SIZE;
+                IndexKey key;
+                u32 pos;
+                std::memcpy(key.bytes, record + 1, INDEX_KEY_SIZE);
+                std::memcpy(&pos, record + 1 + INDEX_KEY_SIZE, sizeof(u32));
+                apply(record[0], key, pos);
+            }
+            theLogEnd += whole * BITMAP_LOG_RECORD_SIZE;
+            theLogRecords += whole;
+            if (whole < 256) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    void BitmapIndex::bulk_build(std::vector<IndexEntry>& entries) {
+        theBitmaps.clear();
+        for (const IndexEntry& entry : entries) {
+            theHeapId = entry.rid.pageId.heapId;
+            theBitmaps[entry.key].add(position(entry.rid));
+        }
+        write_snapshot();
+    }
+
+    void BitmapIndex::insert(const IndexKey& key, const RowId& rid) {
+        theHeapId = rid.pageId.heapId;
+        u32 pos = position(rid);
+        apply(BITMAP_OP_ADD, key, pos);
+        append_log(BITMAP_OP_ADD, key, pos);
+    }
+
+    bool BitmapIndex::remove(const IndexKey& key, const RowId& rid) {
+        auto it = theBitmaps.find(key);
+        u32 pos = position(rid);
+        if (it == theBitmaps.end() || !it->second.contains(pos)) {
+            return false;
+        }
+        apply(BITMAP_OP_REMOVE, key, pos);
+        append_log(BITMAP_OP_REMOVE, key, pos);
+        return true;
+    }
+
+    std::vector<RowId> BitmapIndex::lookup(const IndexKey& key) const {
+        std::vector<RowId> rids;
+        auto it = theBitmaps.find(key);
+        if (it == theBitmaps.end()) {
+            return rids;
+        }
+        for (u32 pos : it->second.to_vector()) {
+            rids.push_back(row_id(pos));
+        }
+        return rids;
+    }
+
+    RoaringBitmap BitmapIndex::match(const std::optional<IndexKey>& low,
+                                     const std::optional<IndexKey>& high) const {
+        RoaringBitmap result;
+        auto it = low ? theBitmaps.lower_bound(*low) : theBitmaps.begin();
+        for (; it != theBitmaps.end(); ++it) {
+            if (high && compare_keys(it->first, *high) > 0) {
+                break;
+            }
+            result |= it->second;
+        }
+        return result;
+    }
+
+    RoaringBitmap BitmapIndex::all() const {
+        return match(std::nullopt, std::nullopt);
+    }
+}
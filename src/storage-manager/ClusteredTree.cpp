@@ -0,0 +1,387 @@
+#include "storage-manager/ClusteredTree.hpp"
+#include "page-manager/DbFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#define CLUSTERED_NODE_HEADER_SIZE (sizeof(u8) + sizeof(u8) + sizeof(u16) + sizeof(u32) + sizeof(u32))
+
+namespace DB {
+    // leaf records are [keylen u16][key][vallen u16][value], internal ones [keylen u16][key][child u32]
+    static size_t record_bytes(const ClusteredTree::Node& node, size_t i) {
+        return sizeof(u16) + node.keys[i].size() + (node.leaf ? sizeof(u16) + node.values[i].size() : sizeof(u32));
+    }
+
+    size_t ClusteredTree::Node::bytes() const {
+        size_t total = CLUSTERED_NODE_HEADER_SIZE;
+        for (size_t i = 0; i < keys.size(); i++) {
+            total += record_bytes(*this, i);
+        }
+        return total;
+    }
+
+    // first record of the right half, so both halves hold about the same bytes
+    static size_t split_point(const ClusteredTree::Node& node, size_t lowest, size_t highest) {
+        size_t half = node.bytes() / 2;
+        size_t used = CLUSTERED_NODE_HEADER_SIZE;
+        size_t mid = 0;
+        while (mid < node.keys.size() && used < half) {
+            used += record_bytes(node, mid++);
+        }
+        return std::clamp(mid, lowest, highest);
+    }
+
+    ClusteredTree::ClusteredTree(const string& name, bool create) :
+        thePath("database-files/heapfiles/" + name + ".clustered"),
+        theCache(CLUSTERED_CACHE_PAGES)
+        {
+            DbFile& dbfile = DbFile::getInstance();
+            if (dbfile.get_filepath(thePath) == -1) {
+                dbfile.add_filepath(thePath);
+            }
+            if (create) {
+                dbfile.truncate(0, dbfile.get_filepath(thePath));
+                theNumPages = 1;
+                theRoot = alloc_page();
+                theHeight = 1;
+                write_node(theRoot, Node());
+                write_header();
+                return;
+            }
+
+            Page page;
+            theCache.read(0, page, thePath);
+            const u8* data = reinterpret_cast<const u8*>(page.data);
+            u32 magic;
+            std::memcpy(&magic, data, sizeof(u32));
+            if (magic != CLUSTERED_MAGIC) {
+                throw std::runtime_error("Clustered table file is damaged: " + thePath);
+            }
+            std::memcpy(&theRoot, data + 4, sizeof(u32));
+            std::memcpy(&theNumPages, data + 8, sizeof(u32));
+            std::memcpy(&theHeight, data + 12, sizeof(u32));
+        }
+
+    ClusteredTree::Node ClusteredTree::read_node(u32 pageId) const {
+        Page page;
+        theCache.read(pageId, page, thePath);
+
+        Node node;
+        const u8* data = reinterpret_cast<const u8*>(page.data);
+        u16 count;
+        u32 firstChild;
+        node.leaf = data[0] != 0;
+        std::memcpy(&count, data + 2, sizeof(u16));
+        std::memcpy(&node.next, data + 4, sizeof(u32));
+        std::memcpy(&firstChild, data + 8, sizeof(u32));
+
+        const u8* ptr = data + CLUSTERED_NODE_HEADER_SIZE;
+        node.keys.resize(count);
+        if (node.leaf) {
+            node.values.resize(count);
+        } else {
+            node.children.resize(count + 1);
+            node.children[0] = firstChild;
+        }
+        for (u16 i = 0; i < count; i++) {
+            u16 len;
+            std::memcpy(&len, ptr, sizeof(u16));
+            node.keys[i].assign(reinterpret_cast<const char*>(ptr + sizeof(u16)), len);
+            ptr += sizeof(u16) + len;
+            if (node.leaf) {
+                std::memcpy(&len, ptr, sizeof(u16));
+                node.values[i].assign(ptr + sizeof(u16), ptr + sizeof(u16) + len);
+                ptr += sizeof(u16) + len;
+            } else {
+                std::memcpy(&node.children[i + 1], ptr, sizeof(u32));
+                ptr += sizeof(u32);
+            }
+        }
+        return node;
+    }
+
+    void ClusteredTree::write_node(u32 pageId, const Node& node) {
+        Page page(pageId);
+        page.valid_bit = true;
+        page.used_bytes = PAGE_DATA_SIZE;
+        page.clear();
+
+        u8* data = reinterpret_cast<u8*>(page.data);
+        u16 count = (u16)node.keys.size();
+        u32 firstChild = node.leaf ? CLUSTERED_NULL_PAGE : node.children[0];
+        data[0] = node.leaf ? 1 : 0;
+        std::memcpy(data + 2, &count, sizeof(u16));
+        std::memcpy(data + 4, &node.next, sizeof(u32));
+        std::memcpy(data + 8, &firstChild, sizeof(u32));
+
+        u8* ptr = data + CLUSTERED_NODE_HEADER_SIZE;
+        for (u16 i = 0; i < count; i++) {
+            u16 len = (u16)node.keys[i].size();
+            std::memcpy(ptr, &len, sizeof(u16));
+            std::memcpy(ptr + sizeof(u16), node.keys[i].data(), len);
+            ptr += sizeof(u16) + len;
+            if (node.leaf) {
+                len = (u16)node.values[i].size();
+                std::memcpy(ptr, &len, sizeof(u16));
+                std::memcpy(ptr + sizeof(u16), node.values[i].data(), len);
+                ptr += sizeof(u16) + len;
+            } else {
+                std::memcpy(ptr, &node.children[i + 1], sizeof(u32));
+                ptr += sizeof(u32);
+            }
+        }
+        theCache.write_through(page, thePath);
+    }
+
+    // page 0 is [magic u32][root u32][num_pages u32][height u32]
+    void ClusteredTree::write_header() {
+        Page page(0);
+        page.valid_bit = true;
+        page.used_bytes = 0;
+        page.clear();
+
+        u32 magic = CLUSTERED_MAGIC;
+        page.write_data(&magic, sizeof(u32));
+        page.write_data(&theRoot, sizeof(u32));
+        page.write_data(&theNumPages, sizeof(u32));
+        page.write_data(&theHeight, sizeof(u32));
+        theCache.write_through(page, thePath);
+    }
+
+    u32 ClusteredTree::find_leaf(const string& key) const {
+        u32 page = theRoot;
+        Node node = read_node(page);
+        while (!node.leaf) {
+            size_t idx = std::upper_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin();
+            page = node.children[idx];
+            node = read_node(page);
+        }
+        return page;
+    }
+
+    u32 ClusteredTree::first_leaf() const {
+        u32 page = theRoot;
+        Node node = read_node(page);
+        while (!node.leaf) {
+            page = node.children[0];
+            node = read_node(page);
+        }
+        return page;
+    }
+
+    bool ClusteredTree::insert_into(u32 pageId, const string& key, const std::vector<u8>& value,
+                                    string& sep, u32& newPage) {
+        Node node = read_node(pageId);
+
+        if (node.leaf) {
+            size_t pos = std::lower_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin();
+            if (pos < node.keys.size() && node.keys[pos] == key) {
+                node.values[pos] = value;
+            } else {
+                node.keys.insert(node.keys.begin() + pos, key);
+                node.values.insert(node.values.begin() + pos, value);
+            }
+            if (node.bytes() <= PAGE_DATA_SIZE) {
+                write_node(pageId, node);
+                return false;
+            }
+
+            size_t mid = split_point(node, 1, node.keys.size() - 1);
+            Node right;
+            right.keys.assign(node.keys.begin() + mid, node.keys.end());
+            right.values.assign(node.values.begin() + mid, node.values.end());
+            right.next = node.next;
+            node.keys.resize(mid);
+            node.values.resize(mid);
+            newPage = alloc_page();
+            node.next = newPage;
+            write_node(newPage, right);
+            write_node(pageId, node);
+            sep = right.keys[0];
+            return true;
+        }
+
+        size_t idx = std::upper_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin();
+        string childSep;
+        u32 childPage;
+        if (!insert_into(node.children[idx], key, value, childSep, childPage)) {
+            return false;
+        }
+
+        node.keys.insert(node.keys.begin() + idx, childSep);
+        node.children.insert(node.children.begin() + idx + 1, childPage);
+        if (node.bytes() <= PAGE_DATA_SIZE) {
+            write_node(pageId, node);
+            return false;
+        }
+
+        // the middle separator moves up instead of being copied
+        size_t mid = split_point(node, 1, node.keys.size() - 2);
+        Node right;
+        right.leaf = false;
+        sep = node.keys[mid];
+        right.keys.assign(node.keys.begin() + mid + 1, node.keys.end());
+        right.children.assign(node.children.begin() + mid + 1, node.children.end());
+        node.keys.resize(mid);
+        node.children.resize(mid + 1);
+        newPage = alloc_page();
+        write_node(newPage, right);
+        write_node(pageId, node);
+        return true;
+    }
+
+    bool ClusteredTree::remove(const string& key) {
+        u32 page = find_leaf(key);
+        Node leaf = read_node(page);
+        auto pos = std::lower_bound(leaf.keys.begin(), leaf.keys.end(), key);
+        if (pos == leaf.keys.end() || *pos != key) {
+            return false;
+        }
+        leaf.values.erase(leaf.values.begin() + (pos - leaf.keys.begin()));
+        leaf.keys.erase(pos);
+        write_node(page, leaf);
+        return true;
+    }
+
+    void ClusteredTree::write(const std::vector<KeyedWrite>& batch) {
+        // every record is checked first so a batch is never half applied
+        for (const KeyedWrite& w : batch) {
+            if (w.key.size() > CLUSTERED_MAX_KEY) {
+                throw std::runtime_error("Key is too large for a clustered table");
+            }
+            if (w.value && 2 * sizeof(u16) + w.key.size() + w.value->size() > CLUSTERED_MAX_RECORD) {
+                throw std::runtime_error("Row is too large for a clustered table");
+            }
+        }
+
+        u32 pages = theNumPages;
+        for (const KeyedWrite& w : batch) {
+            if (!w.value) {
+                remove(w.key);
+                continue;
+            }
+            string sep;
+            u32 newPage;
+            if (!insert_into(theRoot, w.key, *w.value, sep, newPage)) {
+                continue;
+            }
+            Node root;
+            root.leaf = false;
+            root.keys.push_back(sep);
+            root.children = {theRoot, newPage};
+            theRoot = alloc_page();
+            theHeight++;
+            write_node(theRoot, root);
+        }
+        if (theNumPages != pages) {
+            write_header();
+        }
+    }
+
+    std::optional<std::vector<u8>> ClusteredTree::get(const string& key) const {
+        Node leaf = read_node(find_leaf(key));
+        auto pos = std::lower_bound(leaf.keys.begin(), leaf.keys.end(), key);
+        if (pos == leaf.keys.end() || *pos != key) {
+            return std::nullopt;
+        }
+        return std::move(leaf.values[pos - leaf.keys.begin()]);
+    }
+
+    void ClusteredTree::scan(const std::optional<string>& low, const std::optional<string>& high,
+                             const std::function<bool(const string&, const std::vector<u8>&)>& visit) const {
+        Node leaf = read_node(low ? find_leaf(*low) : first_leaf());
+        size_t pos = low ? std::lower_bound(leaf.keys.begin(), leaf.keys.end(), *low) - leaf.keys.begin() : 0;
+        while (true) {
+            for (; pos < leaf.keys.size(); pos++) {
+                if (high && leaf.keys[pos] > *high) {
+                    return;
+                }
+                if (!visit(leaf.keys[pos], leaf.values[pos])) {
+                    return;
+                }
+            }
+            if (leaf.next == CLUSTERED_NULL_PAGE) {
+                return;
+            }
+            leaf = read_node(leaf.next);
+            pos = 0;
+        }
+    }
+
+    u64 ClusteredTree::compact_all() {
+        std::vector<std::pair<string, std::vector<u8>>> rows;
+        scan(std::nullopt, std::nullopt, [&](const string& key, const std::vector<u8>& value) {
+            rows.push_back({key, value});
+            return true;
+        });
+        build(rows);
+        return rows.size();
+    }
+
+    // leaves are filled to PAGE_FILL so the first inserts don't split every page,
+    // and written in key order so each one's sibling is the next page
+    void ClusteredTree::build(const std::vector<std::pair<string, std::vector<u8>>>& rows) {
+        DbFile& dbfile = DbFile::getInstance();
+        theCache.invalidate(thePath);
+        dbfile.truncate(0, dbfile.get_filepath(thePath));
+        theNumPages = 1;
+
+        const size_t fill = PAGE_DATA_SIZE * PAGE_FILL / 100;
+        std::vector<Node> leaves(1);
+        for (const auto& [key, value] : rows) {
+            Node& leaf = leaves.back();
+            if (!leaf.keys.empty() && leaf.bytes() + 2 * sizeof(u16) + key.size() + value.size() > fill) {
+                leaves.emplace_back();
+            }
+            leaves.back().keys.push_back(key);
+            leaves.back().values.push_back(value);
+        }
+
+        std::vector<u32> level;
+        std::vector<string> firsts;
+        for (size_t i = 0; i < leaves.size(); i++) {
+            u32 page = alloc_page();
+            leaves[i].next = i + 1 < leaves.size() ? page + 1 : CLUSTERED_NULL_PAGE;
+            write_node(page, leaves[i]);
+            level.push_back(page);
+            firsts.push_back(leaves[i].keys.empty() ? string() : leaves[i].keys[0]);
+        }
+        theHeight = 1;
+
+        while (level.size() > 1) {
+            std::vector<u32> parents;
+            std::vector<string> parentFirsts;
+            size_t c = 0;
+            while (c < level.size()) {
+                Node node;
+                node.leaf = false;
+                node.children.push_back(level[c]);
+                parentFirsts.push_back(firsts[c]);
+                c++;
+                // at least two children a node, so every level shrinks
+                while (c < level.size() &&
+                       (node.children.size() < 2 ||
+                        node.bytes() + sizeof(u16) + firsts[c].size() + sizeof(u32) <= fill)) {
+                    node.keys.push_back(firsts[c]);
+                    node.children.push_back(level[c]);
+                    c++;
+                }
+                u32 page = alloc_page();
+                write_node(page, node);
+                parents.push_back(page);
+            }
+            level = std::move(parents);
+            firsts = std::move(parentFirsts);
+            theHeight++;
+        }
+
+        theRoot = level[0];
+        write_header();
+    }
+
+    void ClusteredTree::drop() {
+        theCache.invalidate(thePath);
+        DbFile::getInstance().remove_filepath(thePath);
+    }
+}
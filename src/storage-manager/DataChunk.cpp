@@ -0,0 +1,210 @@
+#include "storage-manager/DataChunk.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DB {
+    size_t ColumnVector::width(Kind kind) {
+        switch (kind) {
+            case INT:    return sizeof(int);
+            case FLOAT:  return sizeof(float);
+            case BOOL:   return sizeof(bool);
+            case INT64:  return sizeof(int64_t);
+            case DOUBLE: return sizeof(double);
+            default:     return 0;
+        }
+    }
+
+    void ColumnVector::reset() {
+        theKind = UNTYPED;
+        theSize = 0;
+        theData.clear();
+        theValues.clear();
+        theNulls.clear();
+    }
+
+    // the nulls appended while the column was untyped get zero values of the kind
+    void ColumnVector::set_kind(Kind kind) {
+        theKind = kind;
+        if (kind == STRING) {
+            theValues.resize(theSize);
+        } else {
+            theData.assign(theSize * width(kind), 0);
+        }
+    }
+
+    void ColumnVector::promote() {
+        std::vector<datatype> values;
+        values.reserve(theSize + 1);
+        for (size_t i = 0; i < theSize; i++) {
+            values.push_back(get(i));
+        }
+        theValues = std::move(values);
+        theData.clear();
+        theKind = MIXED;
+    }
+
+    void ColumnVector::append(const datatype& val) {
+        if (val.is_null()) {
+            append_null();
+            return;
+        }
+        Kind tag = static_cast<Kind>(val.index());
+        if (theKind == UNTYPED) {
+            set_kind(tag);
+        } else if (theKind != tag && theKind != MIXED) {
+            promote();
+        }
+
+        if (theKind == STRING || theKind == MIXED) {
+            theValues.push_back(val);
+        } else {
+            val.visit([&](auto v) {
+                if constexpr (!std::is_same_v<decltype(v), std::string_view>) {
+                    size_t at = theData.size();
+                    theData.resize(at + sizeof(v));
+                    std::memcpy(theData.data() + at, &v, sizeof(v));
+                }
+            });
+        }
+        theSize++;
+    }
+
+    void ColumnVector::append_null() {
+        if (theNulls.size() <= theSize / 64) {
+            theNulls.resize(theSize / 64 + 1, 0);
+        }
+        theNulls[theSize / 64] |= (u64)1 << (theSize % 64);
+
+        if (theKind == STRING || theKind == MIXED) {
+            theValues.emplace_back();
+        } else if (theKind != UNTYPED) {
+            theData.resize(theData.size() + width(theKind), 0);
+        }
+        theSize++;
+    }
+
+    // a null reads as the int 0 a missing value always has
+    datatype ColumnVector::get(size_t row) const {
+        if (is_null(row)) {
+            return datatype();
+        }
+        switch (theKind) {
+            case INT:    return data<int>()[row];
+            case FLOAT:  return data<float>()[row];
+            case BOOL:   return data<bool>()[row];
+            case INT64:  return data<int64_t>()[row];
+            case DOUBLE: return data<double>()[row];
+            case STRING:
+            case MIXED:  return theValues[row];
+            default:     return datatype();
+        }
+    }
+
+    void DataChunk::reset(size_t numCols) {
+        theColumns.resize(numCols);
+        for (ColumnVector& column : theColumns) {
+            column.reset();
+        }
+        theIds.clear();
+        theSelection.clear();
+        theSelected = false;
+        theCount = 0;
+    }
+
+    void DataChunk::append_values(const Row& row, size_t first) {
+        for (size_t i = 0; i < row.values.size(); i++) {
+            size_t col = first + i;
+            while (col >= theColumns.size()) {
+                theColumns.emplace_back();
+                for (size_t r = 0; r < theCount; r++) {
+                    theColumns.back().append_null();
+                }
+            }
+            theColumns[col].append(row.values[i]);
+        }
+    }
+
+    void DataChunk::finish_row(const RowId& id) {
+        for (ColumnVector& column : theColumns) {
+            if (column.size() == theCount) {
+                column.append_null();
+            }
+        }
+        theIds.push_back(id);
+        theCount++;
+    }
+
+    void DataChunk::append_row(const Row& row) {
+        append_values(row, 0);
+        finish_row(row.id);
+    }
+
+    void DataChunk::append_joined(const Row& left, const Row& right, size_t rightFirst) {
+        append_values(left, 0);
+        append_values(right, rightFirst);
+        finish_row(RowId{});
+    }
+
+    void DataChunk::select(std::vector<u32> rows) {
+        theSelection = std::move(rows);
+        theSelected = true;
+    }
+
+    // a range past the last selected row is cut short
+    void DataChunk::slice(size_t offset, size_t n) {
+        offset = std::min(offset, selected());
+        n = std::min(n, selected() - offset);
+        if (!theSelected) {
+            theSelection.clear();
+            for (size_t i = offset; i < offset + n; i++) {
+                theSelection.push_back((u32)i);
+            }
+            theSelected = true;
+            return;
+        }
+        theSelection.erase(theSelection.begin() + offset + n, theSelection.end());
+        theSelection.erase(theSelection.begin(), theSelection.begin() + offset);
+    }
+
+    // a column picked once is moved, only repeated ones are copied
+    void DataChunk::project(const std::vector<size_t>& cols) {
+        std::vector<size_t> uses(theColumns.size(), 0);
+        for (size_t col : cols) {
+            if (col < theColumns.size()) {
+                uses[col]++;
+            }
+        }
+
+        std::vector<ColumnVector> out;
+        out.reserve(cols.size());
+        for (size_t col : cols) {
+            if (col >= theColumns.size()) {
+                out.emplace_back();
+                for (size_t r = 0; r < theCount; r++) {
+                    out.back().append_null();
+                }
+            } else if (--uses[col] == 0) {
+                out.push_back(std::move(theColumns[col]));
+            } else {
+                out.push_back(theColumns[col]);
+            }
+        }
+        theColumns = std::move(out);
+    }
+
+    Row* DataChunk::to_row(u32 row, QueryArena* arena, bool allColumns) const {
+        size_t numValues = theColumns.size();
+        while (!allColumns && numValues > 0 && theColumns[numValues - 1].is_null(row)) {
+            numValues--;
+        }
+        RowValues values = make_row_values(arena, numValues);
+        for (size_t col = 0; col < numValues; col++) {
+            const ColumnVector& column = theColumns[col];
+            values.push_back(column.is_null(row) ? datatype::null() : column.get(row));
+        }
+        Row* out = create_row(arena, static_cast<int>(numValues), std::move(values));
+        out->id = theIds[row];
+        return out;
+    }
+}
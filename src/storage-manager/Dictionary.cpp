@@ -0,0 +1,104 @@
+#include "storage-manager/Dictionary.hpp"
+#include "page-manager/DbFile.hpp"
+
+#include <cstring>
+
+namespace DB {
+    int StringDictionary::lookup(const string& val) const {
+        auto it = theCodes.find(val);
+        if (it == theCodes.end()) {
+            return DICT_NO_CODE;
+        }
+        return it->second;
+    }
+
+    int StringDictionary::insert(const string& val) {
+        int code = lookup(val);
+        if (code != DICT_NO_CODE) {
+            return code;
+        }
+        if (full()) {
+            return DICT_NO_CODE;
+        }
+        u16 newCode = (u16)theValues.size();
+        theValues.push_back(val);
+        theCodes.emplace(val, newCode);
+        return newCode;
+    }
+
+    void SegmentDictionary::open(const string& path) {
+        thePath = path;
+        theColumns.clear();
+        theEndOffset = 0;
+
+        DbFile& dbfile = DbFile::getInstance();
+        theFd = dbfile.get_filepath(path);
+        if (theFd == -1) {
+            theFd = dbfile.add_filepath(path);
+        }
+
+        // replay the append log, entries were written in code order
+        std::vector<u8> contents;
+        u8 chunk[4096];
+        ssize_t bytes_read;
+        while ((bytes_read = dbfile.read_at(theEndOffset, chunk, sizeof(chunk), theFd)) > 0) {
+            contents.insert(contents.end(), chunk, chunk + bytes_read);
+            theEndOffset += bytes_read;
+        }
+
+        size_t offset = 0;
+        while (offset + sizeof(u8) + sizeof(u16) <= contents.size()) {
+            u8 col = contents[offset];
+            u16 len;
+            std::memcpy(&len, contents.data() + offset + sizeof(u8), sizeof(u16));
+            offset += sizeof(u8) + sizeof(u16);
+            if (offset + len > contents.size()) {
+                break; // torn tail from a crash mid-append
+            }
+            theColumns[col].insert(string(reinterpret_cast<char*>(contents.data() + offset), len));
+            offset += len;
+        }
+        theEndOffset = offset;
+    }
+
+    int SegmentDictionary::encode(u8 col, const string& val) {
+        StringDictionary& dict = theColumns[col];
+        int code = dict.lookup(val);
+        if (code != DICT_NO_CODE || dict.full() || val.size() > UINT16_MAX) {
+            return code;
+        }
+        code = dict.insert(val);
+
+        if (theFd >= 0) {
+            std::vector<u8> entry(sizeof(u8) + sizeof(u16) + val.size());
+            u16 len = (u16)val.size();
+            entry[0] = col;
+            std::memcpy(entry.data() + sizeof(u8), &len, sizeof(u16));
+            std::memcpy(entry.data() + sizeof(u8) + sizeof(u16), val.data(), val.size());
+            DbFile::getInstance().write_at(theEndOffset, entry.data(), entry.size(), theFd);
+            theEndOffset += entry.size();
+        }
+        return code;
+    }
+
+    int SegmentDictionary::lookup(u8 col, const string& val) const {
+        auto it = theColumns.find(col);
+        if (it == theColumns.end()) {
+            return DICT_NO_CODE;
+        }
+        return it->second.lookup(val);
+    }
+
+    const string* SegmentDictionary::decode(u8 col, u16 code) const {
+        auto it = theColumns.find(col);
+        if (it == theColumns.end() || code >= it->second.size()) {
+            return nullptr;
+        }
+        return &it->second.decode(code);
+    }
+
+    size_t SegmentDictionary::num_entries(u8 col) const {
+        auto it = theColumns.find(col);
+        return it == theColumns.end() ? 0 : it->second.size();
+    }
+}
@@ -0,0 +1,316 @@
+#include "storage-manager/HashIndex.hpp"
+#include "page-manager/DbFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#define HASH_BUCKET_HEADER_SIZE (sizeof(u32) + sizeof(u16) + sizeof(u16) + sizeof(u32))
+#define HASH_BUCKET_CAPACITY ((PAGE_DATA_SIZE - HASH_BUCKET_HEADER_SIZE) / sizeof(IndexEntry))
+#define HASH_DIR_PER_PAGE (PAGE_DATA_SIZE / sizeof(u32))
+#define HASH_HEADER_SIZE (6 * sizeof(u32))
+#define HASH_INDEX_MAX_DEPTH 19 // largest directory whose page ids fit in the header
+
+namespace DB {
+    HashIndex::HashIndex(const string& path, ColumnType keyType, PageCache& cache) :
+        thePath(path),
+        theKeyType(keyType),
+        theCache(cache)
+        {
+            DbFile& dbfile = DbFile::getInstance();
+            if (dbfile.get_filepath(path) == -1) {
+                dbfile.add_filepath(path);
+            }
+        }
+
+    HashIndex::Bucket HashIndex::read_bucket(u32 pageId) const {
+        Bucket bucket;
+        Page page;
+        u32 current = pageId;
+        while (current != HASH_INDEX_NULL_PAGE) {
+            theCache.read(current, page, thePath);
+            const u8* data = reinterpret_cast<const u8*>(page.data);
+            u16 count;
+            if (current == pageId) {
+                std::memcpy(&bucket.localDepth, data, sizeof(u32));
+            }
+            std::memcpy(&count, data + 4, sizeof(u16));
+
+            size_t start = bucket.entries.size();
+            bucket.entries.resize(start + count);
+            std::memcpy(bucket.entries.data() + start, data + HASH_BUCKET_HEADER_SIZE, count * sizeof(IndexEntry));
+            bucket.pages.push_back(current);
+            std::memcpy(&current, data + 8, sizeof(u32));
+        }
+        return bucket;
+    }
+
+    u32 HashIndex::alloc_page() {
+        if (theFreeHead != HASH_INDEX_NULL_PAGE) {
+            u32 pageId = theFreeHead;
+            Page page;
+            theCache.read(pageId, page, thePath);
+            std::memcpy(&theFreeHead, page.data, sizeof(u32));
+            return pageId;
+        }
+        return theNumPages++;
+    }
+
+    void HashIndex::free_page(u32 pageId) {
+        Page page(pageId);
+        page.valid_bit = true;
+        page.used_bytes = 0;
+        page.clear();
+        page.write_data(&theFreeHead, sizeof(u32));
+        theCache.write_through(page, thePath);
+        theFreeHead = pageId;
+    }
+
+    // Spreads the entries over the bucket's pages, growing the chain if needed.
+    // Pages no longer needed leave the chain for the free list.
+    void HashIndex::write_bucket(Bucket& bucket) {
+        size_t numPages = std::max<size_t>(1, (bucket.entries.size() + HASH_BUCKET_CAPACITY - 1) / HASH_BUCKET_CAPACITY);
+        while (bucket.pages.size() < numPages) {
+            bucket.pages.push_back(alloc_page());
+        }
+        for (size_t i = numPages; i < bucket.pages.size(); i++) {
+            free_page(bucket.pages[i]);
+        }
+        bucket.pages.resize(numPages);
+
+        for (size_t i = 0; i < numPages; i++) {
+            Page page(bucket.pages[i]);
+            page.valid_bit = true;
+            page.used_bytes = PAGE_DATA_SIZE;
+            page.clear();
+
+            size_t start = i * HASH_BUCKET_CAPACITY;
+            u16 count = (u16)std::min(bucket.entries.size() - std::min(start, bucket.entries.size()),
+                                      (size_t)HASH_BUCKET_CAPACITY);
+            u32 next = i + 1 < numPages ? bucket.pages[i + 1] : HASH_INDEX_NULL_PAGE;
+            u8* data = reinterpret_cast<u8*>(page.data);
+            std::memcpy(data, &bucket.localDepth, sizeof(u32));
+            std::memcpy(data + 4, &count, sizeof(u16));
+            std::memcpy(data + 8, &next, sizeof(u32));
+            std::memcpy(data + HASH_BUCKET_HEADER_SIZE, bucket.entries.data() + start, count * sizeof(IndexEntry));
+            theCache.write_through(page, thePath);
+        }
+    }
+
+    void HashIndex::write_directory() {
+        size_t needed = (theDirectory.size() + HASH_DIR_PER_PAGE - 1) / HASH_DIR_PER_PAGE;
+        while (theDirectoryPages.size() < needed) {
+            theDirectoryPages.push_back(alloc_page());
+        }
+        for (size_t i = 0; i < needed; i++) {
+            write_directory_page(i);
+        }
+        write_header();
+    }
+
+    void HashIndex::write_directory_page(size_t i) {
+        Page page(theDirectoryPages[i]);
+        page.valid_bit = true;
+        page.used_bytes = 0;
+        page.clear();
+        size_t start = i * HASH_DIR_PER_PAGE;
+        size_t count = std::min(theDirectory.size() - start, (size_t)HASH_DIR_PER_PAGE);
+        page.write_data(theDirectory.data() + start, count * sizeof(u32));
+        theCache.write_through(page, thePath);
+    }
+
+    // page 0 is [magic u32][global depth u32][num_pages u32][key type u32][free head u32]
+    // [num dir pages u32][dir page ids u32...]
+    void HashIndex::write_header() {
+        Page header(0);
+        header.valid_bit = true;
+        header.used_bytes = 0;
+        header.clear();
+        u32 magic = HASH_INDEX_MAGIC;
+        u32 keyType = (u32)theKeyType;
+        u32 numDirPages = (u32)theDirectoryPages.size();
+        header.write_data(&magic, sizeof(u32));
+        header.write_data(&theGlobalDepth, sizeof(u32));
+        header.write_data(&theNumPages, sizeof(u32));
+        header.write_data(&keyType, sizeof(u32));
+        header.write_data(&theFreeHead, sizeof(u32));
+        header.write_data(&numDirPages, sizeof(u32));
+        header.write_data(theDirectoryPages.data(), numDirPages * sizeof(u32));
+        theCache.write_through(header, thePath);
+    }
+
+    void HashIndex::create() {
+        DbFile& dbfile = DbFile::getInstance();
+        dbfile.truncate(0, dbfile.get_filepath(thePath));
+
+        theNumPages = 1;
+        theGlobalDepth = 0;
+        theFreeHead = HASH_INDEX_NULL_PAGE;
+        theDirectoryPages.clear();
+
+        Bucket bucket;
+        bucket.pages.push_back(alloc_page());
+        write_bucket(bucket);
+        theDirectory.assign(1, bucket.pages[0]);
+        write_directory();
+    }
+
+    bool HashIndex::open() {
+        Page page;
+        theCache.read(0, page, thePath);
+
+        const u8* data = reinterpret_cast<const u8*>(page.data);
+        u32 header[6];
+        std::memcpy(header, data, sizeof(header));
+        if (header[0] != HASH_INDEX_MAGIC) {
+            return false;
+        }
+        theGlobalDepth = header[1];
+        theNumPages = header[2];
+        theKeyType = (ColumnType)header[3];
+        theFreeHead = header[4];
+        theDirectoryPages.resize(header[5]);
+        std::memcpy(theDirectoryPages.data(), data + HASH_HEADER_SIZE, header[5] * sizeof(u32));
+
+        theDirectory.resize((size_t)1 << theGlobalDepth);
+        for (size_t i = 0; i < theDirectoryPages.size(); i++) {
+            theCache.read(theDirectoryPages[i], page, thePath);
+            size_t start = i * HASH_DIR_PER_PAGE;
+            size_t count = std::min(theDirectory.size() - start, (size_t)HASH_DIR_PER_PAGE);
+            std::memcpy(theDirectory.data() + start, page.data, count * sizeof(u32));
+        }
+        return true;
+    }
+
+    void HashIndex::bulk_build(std::vector<IndexEntry>& entries) {
+        create();
+        for (const IndexEntry& entry : entries) {
+            insert(entry.key, entry.rid);
+        }
+    }
+
+    void HashIndex::split_bucket(u32 dirIdx) {
+        u32 oldPage = theDirectory[dirIdx];
+        Bucket low = read_bucket(oldPage);
+
+        bool doubled = low.localDepth == theGlobalDepth;
+        if (doubled) {
+            // every bucket gets a second directory slot, only this one splits
+            size_t size = theDirectory.size();
+            for (size_t i = 0; i < size; i++) {
+                theDirectory.push_back(theDirectory[i]);
+            }
+            theGlobalDepth++;
+        }
+
+        u64 bit = (u64)1 << low.localDepth;
+        Bucket high;
+        high.localDepth = low.localDepth + 1;
+        high.pages.push_back(alloc_page());
+        low.localDepth++;
+
+        std::vector<IndexEntry> keep;
+        for (const IndexEntry& entry : low.entries) {
+            if (hash_index_key(entry.key) & bit) {
+                high.entries.push_back(entry);
+            } else {
+                keep.push_back(entry);
+            }
+        }
+        low.entries = std::move(keep);
+
+        // without doubling only the directory pages holding the moved slots change
+        std::vector<size_t> changed;
+        for (size_t i = 0; i < theDirectory.size(); i++) {
+            if (theDirectory[i] == oldPage && (i & bit)) {
+                theDirectory[i] = high.pages[0];
+                size_t dirPage = i / HASH_DIR_PER_PAGE;
+                if (changed.empty() || changed.back() != dirPage) {
+                    changed.push_back(dirPage);
+                }
+            }
+        }
+        write_bucket(low);
+        write_bucket(high);
+        if (doubled) {
+            write_directory();
+            return;
+        }
+        for (size_t dirPage : changed) {
+            write_directory_page(dirPage);
+        }
+    }
+
+    void HashIndex::insert(const IndexKey& key, const RowId& rid) {
+        u64 h = hash_index_key(key);
+        u32 pagesBefore = theNumPages;
+        u32 freeBefore = theFreeHead;
+        u32 depthBefore = theGlobalDepth;
+        while (true) {
+            u32 dirIdx = (u32)(h & (((u64)1 << theGlobalDepth) - 1));
+            Bucket bucket = read_bucket(theDirectory[dirIdx]);
+
+            // Splitting can't separate entries that share a hash. A full bucket
+            // only splits if at least half a page of it hashes apart from its
+            // largest group of duplicates, otherwise the entry overflows.
+            bool splittable = false;
+            if (bucket.entries.size() >= HASH_BUCKET_CAPACITY && bucket.localDepth < HASH_INDEX_MAX_DEPTH) {
+                std::vector<u64> hashes;
+                hashes.reserve(bucket.entries.size() + 1);
+                for (const IndexEntry& entry : bucket.entries) {
+                    hashes.push_back(hash_index_key(entry.key));
+                }
+                hashes.push_back(h);
+                std::sort(hashes.begin(), hashes.end());
+
+                size_t largest = 0;
+                for (size_t i = 0, run = 0; i < hashes.size(); i++) {
+                    run = (i > 0 && hashes[i] == hashes[i - 1]) ? run + 1 : 1;
+                    largest = std::max(largest, run);
+                }
+                splittable = hashes.size() - largest >= HASH_BUCKET_CAPACITY / 2;
+            }
+
+            if (!splittable) {
+                bucket.entries.push_back({key, rid});
+                write_bucket(bucket);
+                // splits and chain growth take pages from the file or the free list
+                if (theNumPages != pagesBefore || theFreeHead != freeBefore ||
+                    theGlobalDepth != depthBefore) {
+                    write_header();
+                }
+                return;
+            }
+            split_bucket(dirIdx);
+        }
+    }
+
+    bool HashIndex::remove(const IndexKey& key, const RowId& rid) {
+        u64 h = hash_index_key(key);
+        Bucket bucket = read_bucket(theDirectory[h & (((u64)1 << theGlobalDepth) - 1)]);
+        for (auto it = bucket.entries.begin(); it != bucket.entries.end(); ++it) {
+            if (compare_keys(it->key, key) == 0 && same_row(it->rid, rid)) {
+                bucket.entries.erase(it);
+                u32 freeBefore = theFreeHead;
+                write_bucket(bucket);
+                if (theFreeHead != freeBefore) {
+                    write_header(); // the chain shrank
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<RowId> HashIndex::lookup(const IndexKey& key) const {
+        u64 h = hash_index_key(key);
+        Bucket bucket = read_bucket(theDirectory[h & (((u64)1 << theGlobalDepth) - 1)]);
+
+        std::vector<RowId> rids;
+        for (const IndexEntry& entry : bucket.entries) {
+            if (compare_keys(entry.key, key) == 0) {
+                rids.push_back(entry.rid);
+            }
+        }
+        return rids;
+    }
+}
@@ -1,53 +1,64 @@
 #include "storage-manager/HeapFile.hpp"
 #include "page-manager/DbFile.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 #include <unistd.h>
 
 namespace DB {
 
-static size_t serialize_row(Row *row, u8 *buffer, size_t buffer_size);
-static Row *deserialize_row(u8 *buffer, size_t size);
 
+static HeapFile_Metadata new_heapfile_metadata(const string &identifier,
+                                               u64 heap_id, u64 table_id) {
+  HeapFile_Metadata metadata;
+  memset(&metadata, 0, sizeof(metadata));
+  metadata.magic = HEAPFILE_MAGIC;
+  metadata.version = HEAPFILE_VERSION;
+  metadata.header_size = sizeof(HeapFile_Metadata);
+  metadata.page_size = PAGE_DATA_SIZE;
+  metadata.directory_page = 0;
+  metadata.heap_id = heap_id;
+  metadata.table_id = table_id;
+  metadata.next_heapfile = 0x8;
+  strncpy(metadata.identifier, identifier.c_str(),
+          HEAPFILE_IDENTIFIER_SIZE - 1);
+  return metadata;
+}
+
+// if_missing creates the file, otherwise the header is left for
+// read_heapfile_from_disk to load
 HeapFile::HeapFile(int table_id, string tablename, bool if_missing)
-    : metadata{tablename + "_heapfile_1",
-               (u64)3,
-               (u64)table_id,
-               (u64)0,
-               (u64)0,
-               (u8)0x8},
-      num_heapfiles(0) {
-  DbFile dbfile = DbFile::getInstance();
+    : metadata(new_heapfile_metadata(tablename + "_heapfile_1", 3, table_id)),
+      num_heapfiles(0), free_slots(1, 0), fsm_hint(1) {
+  DbFile &dbfile = DbFile::getInstance();
   if (if_missing) {
     std::cout << "Heapfile does not exist\n";
   }
-  int heapFd =
-      dbfile.add_filepath("database-files/heapfiles/" + tablename + ".db");
+  string filepath = "database-files/heapfiles/" + tablename + ".db";
+  int heapFd = dbfile.get_filepath(filepath);
+  if (heapFd == -1) {
+    heapFd = dbfile.add_filepath(filepath);
+  }
   heap_fd = heapFd;
-  u8 *write_buffer = to_bytes(&metadata);
-  dbfile.write_at(0, write_buffer, metadata.size, heapFd);
-  delete[] write_buffer;
-
-  // Fill rest of page with page entries
-  size_t remaining_bytes = PAGE_DATA_SIZE - metadata.size;
-  off_t entry_offset = metadata.size;
-  u8 buffer[sizeof(HeapPageEntry)];
-  u64 page_id = 1;
-  page_id = 0x12345678;
-  u32 init_size = 1;
-  memcpy(buffer + sizeof(u64), &init_size, sizeof(init_size));
-  int num_pages = 0;
-  while (remaining_bytes >= sizeof(HeapPageEntry)) {
-    memcpy(buffer, &page_id, sizeof(page_id));
-    ++page_id;
-    std::cout << "entry offset = " << entry_offset << std::endl;
-    dbfile.write_at(entry_offset, buffer, sizeof(HeapPageEntry), heapFd);
-    entry_offset += sizeof(HeapPageEntry);
-    remaining_bytes -= sizeof(HeapPageEntry);
-    num_pages++;
-  }
-  std::cout << "There are " << num_pages << " # of pages on the first page \n";
+  dictionary.open("database-files/heapfiles/" + tablename + ".dict");
+  overflow.open("database-files/heapfiles/" + tablename + ".toast");
+  zones.open("database-files/heapfiles/" + tablename + ".zone");
+  if (!if_missing) {
+    return;
+  }
+
+  // header followed by an empty page directory, written in one go
+  u8 page[PAGE_DATA_SIZE];
+  memset(page, 0, PAGE_DATA_SIZE);
+  memcpy(page, &metadata, sizeof(metadata));
+  dbfile.write_at(0, page, PAGE_DATA_SIZE, heapFd);
+
+  std::cout << "There are " << directory_capacity(this)
+            << " # of pages on the first page \n";
 }
 HeapFile *create_heapfile(string tablename) {
   HeapFile *heapfile = new HeapFile(1, tablename, true);
@@ -55,53 +66,93 @@ HeapFile *create_heapfile(string tablename) {
 }
 
 void print_heapfile_metadata(HeapFile *heapfile) {
-  DbFile dbfile = DbFile::getInstance();
-  int i = 0;
-  off_t offset = 0;
+  DbFile &dbfile = DbFile::getInstance();
+  u8 page[PAGE_DATA_SIZE];
+  memset(page, 0, PAGE_DATA_SIZE);
+  dbfile.read_at(0, page, PAGE_DATA_SIZE, heapfile->heap_fd);
   HeapFile_Metadata read_metadata;
-  read_metadata.size = heapfile->metadata.size;
-
-  char str_buffer[heapfile->metadata.identifier.size() + 1];
-  dbfile.read_at(offset, &str_buffer, heapfile->metadata.identifier.size() + 1,
-                 heapfile->heap_fd);
-  read_metadata.identifier.assign(str_buffer,
-                                  heapfile->metadata.identifier.size() + 1);
-  offset += heapfile->metadata.identifier.size() + 1;
-
-  dbfile.read_at(offset, &read_metadata.heap_id,
-                 sizeof(heapfile->metadata.heap_id), heapfile->heap_fd);
-  offset += sizeof(read_metadata.heap_id);
-
-  dbfile.read_at(offset, &read_metadata.table_id,
-                 sizeof(heapfile->metadata.table_id), heapfile->heap_fd);
-  offset += sizeof(read_metadata.table_id);
+  memcpy(&read_metadata, page, sizeof(read_metadata));
 
   std::cout << "Heapfile Metadata: \n";
   std::cout << "  identifier = " << read_metadata.identifier << std::endl;
+  std::cout << "  version = " << read_metadata.version << std::endl;
   std::cout << "  heap id = " << read_metadata.heap_id << std::endl;
   std::cout << "  table id = " << read_metadata.table_id << std::endl;
-
-  // print all the pageId capacity pairs
-  size_t remaining_bytes = PAGE_DATA_SIZE - read_metadata.size;
-  offset = read_metadata.size;
-
-  int num = 1;
-  while (remaining_bytes >= sizeof(HeapPageEntry)) {
-    HeapPageEntry entry;
-    dbfile.read_at(offset, &entry, sizeof(HeapPageEntry), heapfile->heap_fd);
-    offset += sizeof(HeapPageEntry);
-    remaining_bytes -= sizeof(HeapPageEntry);
+  std::cout << "  pages = " << read_metadata.num_pages << std::endl;
+  std::cout << "  records = " << read_metadata.num_records << std::endl;
+
+  // print the pageId capacity pairs of every page in use
+  u64 num_entries =
+      std::min<u64>(heapfile->metadata.num_pages, directory_capacity(heapfile));
+  const HeapPageEntry *entries =
+      reinterpret_cast<const HeapPageEntry *>(page + read_metadata.header_size);
+  for (u64 num = 1; num <= num_entries; num++) {
+    const HeapPageEntry &entry = entries[num - 1];
     std::cout << "Row Entry " << num << "-> page id = " << entry.page_id
               << "\t\tfree space (B) = " << entry.free_space << std::endl;
-    num++;
   }
 }
 
-static size_t serialize_row(Row *row, u8 *buffer, size_t buffer_size) {
+// encoded size of one value (without its type tag) when stored inline
+static size_t inline_value_size(const datatype &val, int dict_code) {
+  switch (val.index()) {
+  case 0:
+    return sizeof(int);
+  case 1:
+    return sizeof(float);
+  case 2:
+    return dict_code != DICT_NO_CODE
+               ? sizeof(u16)
+               : sizeof(u16) + val.get<string>().size();
+  case 3:
+    return sizeof(bool);
+  case 4:
+    return sizeof(int64_t);
+  case 5:
+    return sizeof(double);
+  }
+  return 0;
+}
+
+size_t serialize_row(HeapFile *heapfile, Row *row, u8 *buffer,
+                     size_t buffer_size) {
   if (row == NULL || buffer == NULL) {
     return 0;
   }
 
+  // short strings get dictionary codes, then the largest remaining strings
+  // move out of line until the row fits its slot
+  std::vector<int> dict_codes(row->numCols, DICT_NO_CODE);
+  std::vector<bool> toast(row->numCols, false);
+  size_t row_size = ROW_HEADER_SIZE;
+  for (size_t i = 0; i < row->numCols; i++) {
+    if (heapfile != NULL && row->values[i].index() == 2) {
+      std::string_view val = row->values[i].get<string>();
+      if (val.size() <= DICT_MAX_VALUE_LEN) {
+        dict_codes[i] = heapfile->dictionary.encode((u8)i, string(val));
+      }
+    }
+    row_size += sizeof(u8) + inline_value_size(row->values[i], dict_codes[i]);
+  }
+
+  while (row_size > buffer_size) {
+    int largest = -1;
+    size_t largest_len = TOAST_POINTER_SIZE;
+    for (size_t i = 0; i < row->numCols; i++) {
+      if (row->values[i].index() == 2 && dict_codes[i] == DICT_NO_CODE &&
+          !toast[i] && row->values[i].get<string>().size() > largest_len) {
+        largest = (int)i;
+        largest_len = row->values[i].get<string>().size();
+      }
+    }
+    if (largest < 0 || heapfile == NULL) {
+      return 0; // too many columns to fit a slot even with everything toasted
+    }
+    toast[largest] = true;
+    row_size -= sizeof(u16) + largest_len;
+    row_size += TOAST_POINTER_SIZE;
+  }
+
   size_t offset = 0;
   u8 valid_marker = 1;
   memcpy(buffer + offset, &valid_marker, sizeof(u8));
@@ -110,27 +161,32 @@ static size_t serialize_row(Row *row, u8 *buffer, size_t buffer_size) {
   memcpy(buffer + offset, &row->numCols, sizeof(u8));
   offset += sizeof(u8);
 
-  for (size_t i = 0; i < row->numCols && offset < buffer_size; i++) {
+  for (size_t i = 0; i < row->numCols; i++) {
     u8 type_tag = (u8)row->values[i].index();
+    if (dict_codes[i] != DICT_NO_CODE) {
+      type_tag = ROW_TAG_DICT_STRING;
+    } else if (toast[i]) {
+      type_tag = ROW_TAG_TOAST_STRING;
+    }
     memcpy(buffer + offset, &type_tag, sizeof(u8));
     offset += sizeof(u8);
 
     // encodes the column type since they are variant type
-    switch (row->values[i].index()) {
+    switch (type_tag) {
     case 0: {
-      int val = std::get<int>(row->values[i]);
+      int val = row->values[i].get<int>();
       memcpy(buffer + offset, &val, sizeof(int));
       offset += sizeof(int);
       break;
     }
     case 1: {
-      float val = std::get<float>(row->values[i]);
+      float val = row->values[i].get<float>();
       memcpy(buffer + offset, &val, sizeof(float));
       offset += sizeof(float);
       break;
     }
     case 2: {
-      string val = std::get<string>(row->values[i]);
+      std::string_view val = row->values[i].get<string>();
       u16 len = (u16)val.size();
       memcpy(buffer + offset, &len, sizeof(u16));
       offset += sizeof(u16);
@@ -139,30 +195,50 @@ static size_t serialize_row(Row *row, u8 *buffer, size_t buffer_size) {
       break;
     }
     case 3: {
-      bool val = std::get<bool>(row->values[i]);
+      bool val = row->values[i].get<bool>();
       memcpy(buffer + offset, &val, sizeof(bool));
       offset += sizeof(bool);
       break;
     }
     case 4: {
-      int64_t val = std::get<int64_t>(row->values[i]);
+      int64_t val = row->values[i].get<int64_t>();
       memcpy(buffer + offset, &val, sizeof(int64_t));
       offset += sizeof(int64_t);
       break;
     }
     case 5: {
-      double val = std::get<double>(row->values[i]);
+      double val = row->values[i].get<double>();
       memcpy(buffer + offset, &val, sizeof(double));
       offset += sizeof(double);
       break;
     }
+    case ROW_TAG_DICT_STRING: {
+      u16 code = (u16)dict_codes[i];
+      memcpy(buffer + offset, &code, sizeof(u16));
+      offset += sizeof(u16);
+      break;
+    }
+    case ROW_TAG_TOAST_STRING: {
+      // [total len u32][first page u32][prefix, TOAST_PREFIX_SIZE bytes]
+      std::string_view val = row->values[i].get<string>();
+      u32 len = (u32)val.size();
+      u32 first_page = heapfile->overflow.write_value(string(val));
+      memcpy(buffer + offset, &len, sizeof(u32));
+      offset += sizeof(u32);
+      memcpy(buffer + offset, &first_page, sizeof(u32));
+      offset += sizeof(u32);
+      memcpy(buffer + offset, val.data(), TOAST_PREFIX_SIZE);
+      offset += TOAST_PREFIX_SIZE;
+      break;
+    }
     }
   }
 
   return offset;
 }
 
-static Row *deserialize_row(u8 *buffer, size_t size) {
+Row *deserialize_row(HeapFile *heapfile, u8 *buffer, size_t size,
+                     QueryArena *arena, const std::vector<bool> *columns) {
   if (buffer == NULL || size < ROW_HEADER_SIZE) {
     return NULL;
   }
@@ -180,8 +256,7 @@ static Row *deserialize_row(u8 *buffer, size_t size) {
   memcpy(&num_cols, buffer + offset, sizeof(u8));
   offset += sizeof(u8);
 
-  std::vector<datatype> values;
-  values.reserve(num_cols);
+  RowValues values = make_row_values(arena, num_cols);
 
   for (u8 i = 0; i < num_cols && offset < size; i++) {
     u8 type_tag;
@@ -207,7 +282,7 @@ static Row *deserialize_row(u8 *buffer, size_t size) {
       u16 len;
       memcpy(&len, buffer + offset, sizeof(u16));
       offset += sizeof(u16);
-      string val((char *)(buffer + offset), len);
+      std::string_view val((char *)(buffer + offset), len);
       offset += len;
       values.push_back(val);
       break;
@@ -233,18 +308,48 @@ static Row *deserialize_row(u8 *buffer, size_t size) {
       values.push_back(val);
       break;
     }
+    case ROW_TAG_DICT_STRING: {
+      u16 code;
+      memcpy(&code, buffer + offset, sizeof(u16));
+      offset += sizeof(u16);
+      const string *val =
+          heapfile != NULL ? heapfile->dictionary.decode(i, code) : NULL;
+      values.push_back(val != NULL ? datatype(*val) : datatype(""));
+      break;
+    }
+    case ROW_TAG_TOAST_STRING: {
+      u32 len, first_page;
+      memcpy(&len, buffer + offset, sizeof(u32));
+      offset += sizeof(u32);
+      memcpy(&first_page, buffer + offset, sizeof(u32));
+      offset += sizeof(u32);
+      bool needed = columns == NULL || columns->empty() ||
+                    (i < columns->size() && (*columns)[i]);
+      if (needed && heapfile != NULL) {
+        values.push_back(heapfile->overflow.read_value(first_page, len));
+      } else {
+        values.push_back(std::string_view((char *)(buffer + offset), TOAST_PREFIX_SIZE));
+      }
+      offset += TOAST_PREFIX_SIZE;
+      break;
+    }
     }
   }
 
-  Row *row = new Row(num_cols, std::move(values));
-  return row;
+  return create_row(arena, num_cols, std::move(values));
 }
 
-Row *get_row(HeapFile *heapfile, RowId rid) {
+Row *get_row(HeapFile *heapfile, RowId rid, QueryArena *arena) {
   if (heapfile == NULL) {
     return NULL;
   }
 
+  std::shared_lock lock(heapfile->latch);
+  Row *cached = heapfile->row_cache.get(rid, arena);
+  if (cached != NULL) {
+    return cached;
+  }
+
   DbFile &dbfile = DbFile::getInstance();
   u8 buffer[SLOT_SIZE];
   off_t slot_off = GET_SLOT_OFFSET((u32)rid.pageId.page_num, rid.record_num);
@@ -255,7 +360,73 @@ Row *get_row(HeapFile *heapfile, RowId rid) {
     return NULL;
   }
 
-  return deserialize_row(buffer, SLOT_SIZE);
+  Row *row = deserialize_row(heapfile, buffer, SLOT_SIZE, arena);
+  if (row != NULL) {
+    row->id = rid;
+    // still under the latch, so no writer can change the slot before the row is cached
+    heapfile->row_cache.put(rid, *row);
+  }
+  return row;
+}
+
+size_t directory_capacity(HeapFile *heapfile) {
+  return (PAGE_DATA_SIZE - heapfile->metadata.header_size) /
+         sizeof(HeapPageEntry);
+}
+
+// persists the free space of one page into the page directory on page 0
+static void write_directory_entry(HeapFile *heapfile, u32 page_num) {
+  if (page_num == 0 || page_num > directory_capacity(heapfile)) {
+    return; // past the directory, rebuilt from the pages on open
+  }
+  HeapPageEntry entry;
+  entry.page_id = page_num <= heapfile->metadata.num_pages ? page_num : 0;
+  entry.free_space =
+      entry.page_id == 0 ? 0 : (u64)heapfile->free_slots[page_num] * SLOT_SIZE;
+  off_t offset = heapfile->metadata.header_size +
+                 (off_t)(page_num - 1) * sizeof(HeapPageEntry);
+  DbFile::getInstance().write_at(offset, &entry, sizeof(HeapPageEntry),
+                                 heapfile->heap_fd);
+}
+
+void write_heapfile_metadata(HeapFile *heapfile) {
+  DbFile::getInstance().write_at(0, &heapfile->metadata,
+                                 sizeof(HeapFile_Metadata), heapfile->heap_fd);
+}
+
+static u32 count_free_slots(const u8 *page) {
+  u32 free = 0;
+  for (u64 slot = 0; slot < SLOTS_PER_PAGE; slot++) {
+    if (page[slot * SLOT_SIZE] == 0) {
+      free++;
+    }
+  }
+  return free;
+}
+
+// first page at or after the hint with a free slot, appending one if needed
+static u32 find_free_page(HeapFile *heapfile, u32 hint) {
+  u64 num_pages = heapfile->metadata.num_pages;
+  if (hint >= 1 && hint <= num_pages && heapfile->free_slots[hint] > 0) {
+    return hint;
+  }
+  for (u32 page = heapfile->fsm_hint; page <= num_pages; page++) {
+    if (heapfile->free_slots[page] > 0) {
+      heapfile->fsm_hint = page;
+      return page;
+    }
+  }
+
+  // pages are always written whole so later page reads never come up short
+  u8 empty_page[PAGE_DATA_SIZE];
+  memset(empty_page, 0, PAGE_DATA_SIZE);
+  u32 page = (u32)++heapfile->metadata.num_pages;
+  DbFile::getInstance().write_at(GET_PAGE_OFFSET(page), empty_page,
+                                 PAGE_DATA_SIZE, heapfile->heap_fd);
+  heapfile->free_slots.push_back(SLOTS_PER_PAGE);
+  heapfile->fsm_hint = page;
+  write_heapfile_metadata(heapfile);
+  return page;
 }
 
 RowId insert_row(HeapFile *heapfile, Row *row, u32 page_num) {
@@ -268,46 +439,37 @@ RowId insert_row(HeapFile *heapfile, Row *row, u32 page_num) {
     return rid;
   }
 
+  std::unique_lock lock(heapfile->latch);
   DbFile &dbfile = DbFile::getInstance();
 
-  if (page_num == 0) {
-    page_num = 1;
-  }
-
   u8 buffer[SLOT_SIZE];
   memset(buffer, 0, SLOT_SIZE);
-
-  off_t page_start = GET_PAGE_OFFSET(page_num);
-  u64 slot_num = 0;
-  bool found_slot = false;
-
-  for (u64 i = 0; i < SLOTS_PER_PAGE; i++) {
-    off_t slot_off = page_start + (i * SLOT_SIZE);
-    u8 valid_marker = 0;
-    dbfile.read_at(slot_off, &valid_marker, sizeof(u8), heapfile->heap_fd);
-
-    if (valid_marker == 0) {
-      slot_num = i;
-      found_slot = true;
-      break;
-    }
-  }
-
-  if (!found_slot) {
-    page_num++;
-    slot_num = 0;
-  }
-
-  memset(buffer, 0, SLOT_SIZE);
-  size_t row_size = serialize_row(row, buffer, SLOT_SIZE);
+  size_t row_size = serialize_row(heapfile, row, buffer, SLOT_SIZE);
 
   if (row_size == 0) {
     return rid;
   }
 
+  page_num = find_free_page(heapfile, page_num);
+  u64 slot_num = 0;
+  if (heapfile->free_slots[page_num] < SLOTS_PER_PAGE) {
+    u8 page[PAGE_DATA_SIZE];
+    dbfile.read_at(GET_PAGE_OFFSET(page_num), page, PAGE_DATA_SIZE,
+                   heapfile->heap_fd);
+    while (slot_num < SLOTS_PER_PAGE && page[slot_num * SLOT_SIZE] != 0) {
+      slot_num++;
+    }
+  }
+
   off_t write_off = GET_SLOT_OFFSET(page_num, slot_num);
   dbfile.write_at(write_off, buffer, SLOT_SIZE, heapfile->heap_fd);
 
+  if (heapfile->free_slots[page_num] == SLOTS_PER_PAGE) {
+    heapfile->zones.reset(page_num); // rows deleted earlier no longer count
+  }
+  heapfile->zones.add_row(page_num, row);
+  heapfile->free_slots[page_num]--;
+  write_directory_entry(heapfile, page_num);
   heapfile->metadata.num_records++;
 
   rid.pageId.heapId = heapfile->metadata.heap_id;
@@ -317,6 +479,67 @@ RowId insert_row(HeapFile *heapfile, Row *row, u32 page_num) {
   return rid;
 }
 
+// returns the offset of column col inside an encoded slot, or 0 if it is missing
+static size_t find_column(u8 *buffer, size_t size, u8 col) {
+  size_t offset = sizeof(u8);
+  u8 num_cols = buffer[offset];
+  offset += sizeof(u8);
+  if (col >= num_cols) {
+    return 0;
+  }
+
+  for (u8 i = 0; i < col && offset < size; i++) {
+    u8 type_tag = buffer[offset];
+    offset += sizeof(u8);
+    switch (type_tag) {
+    case 0:
+      offset += sizeof(int);
+      break;
+    case 1:
+      offset += sizeof(float);
+      break;
+    case 2: {
+      u16 len;
+      memcpy(&len, buffer + offset, sizeof(u16));
+      offset += sizeof(u16) + len;
+      break;
+    }
+    case 3:
+      offset += sizeof(bool);
+      break;
+    case 4:
+      offset += sizeof(int64_t);
+      break;
+    case 5:
+      offset += sizeof(double);
+      break;
+    case ROW_TAG_DICT_STRING:
+      offset += sizeof(u16);
+      break;
+    case ROW_TAG_TOAST_STRING:
+      offset += TOAST_POINTER_SIZE;
+      break;
+    }
+  }
+  return offset < size ? offset : 0;
+}
+
+// returns every out of line value referenced by an encoded slot to the overflow free list
+static void free_overflow_values(HeapFile *heapfile, u8 *buffer, size_t size) {
+  u8 num_cols = buffer[sizeof(u8)];
+  for (u8 col = 0; col < num_cols; col++) {
+    size_t offset = find_column(buffer, size, col);
+    if (offset == 0) {
+      break;
+    }
+    if (buffer[offset] == ROW_TAG_TOAST_STRING) {
+      u32 first_page;
+      memcpy(&first_page, buffer + offset + sizeof(u8) + sizeof(u32), sizeof(u32));
+      heapfile->overflow.free_value(first_page);
+    }
+  }
+}
+
 RowId delete_row(HeapFile *heapfile, RowId rid) {
   RowId result = {};
   result.pageId.heapId = 0;
@@ -327,8 +550,18 @@ RowId delete_row(HeapFile *heapfile, RowId rid) {
     return result;
   }
 
+  std::unique_lock lock(heapfile->latch);
   DbFile &dbfile = DbFile::getInstance();
-  off_t slot_off = GET_SLOT_OFFSET((u32)rid.pageId.page_num, rid.record_num);
+  u32 page_num = (u32)rid.pageId.page_num;
+  off_t slot_off = GET_SLOT_OFFSET(page_num, rid.record_num);
+
+  u8 buffer[SLOT_SIZE];
+  if (dbfile.read_at(slot_off, buffer, SLOT_SIZE, heapfile->heap_fd) <= 0 ||
+      buffer[0] == 0) {
+    return result; // already free
+  }
+  free_overflow_values(heapfile, buffer, SLOT_SIZE);
+  heapfile->row_cache.invalidate(rid);
 
   u8 zero_marker = 0;
   dbfile.write_at(slot_off, &zero_marker, sizeof(u8), heapfile->heap_fd);
@@ -336,6 +569,13 @@ RowId delete_row(HeapFile *heapfile, RowId rid) {
   if (heapfile->metadata.num_records > 0) {
     heapfile->metadata.num_records--;
   }
+  if (page_num <= heapfile->metadata.num_pages) {
+    heapfile->free_slots[page_num]++;
+    write_directory_entry(heapfile, page_num);
+    if (page_num < heapfile->fsm_hint) {
+      heapfile->fsm_hint = page_num;
+    }
+  }
 
   result = rid;
   return result;
@@ -364,54 +604,93 @@ HeapFile *get_heapfile_by_rowid(const RowId &rid) {
   return NULL;
 }
 
-static HeapFile *read_heapfile_from_disk(const string &filepath, int heap_num) {
+// rebuilds the in memory free space map and record count from the page
+// directory on the page 0 already read by the caller, only pages past the
+// directory's capacity are read to count their free slots
+static void load_free_space_map(HeapFile *heapfile, const u8 *header_page) {
   DbFile &dbfile = DbFile::getInstance();
-  int fd = dbfile.add_filepath(filepath);
-  if (fd < 0) {
-    return NULL;
-  }
+  u64 num_pages = heapfile->metadata.num_pages;
+  heapfile->free_slots.assign(num_pages + 1, 0);
+  heapfile->fsm_hint = 1;
 
-  char id_buffer[256];
-  off_t offset = 0;
-  ssize_t bytes_read = dbfile.read_at(offset, id_buffer, sizeof(id_buffer), fd);
-  if (bytes_read <= 0) {
-    return NULL;
+  u64 in_directory = std::min<u64>(num_pages, directory_capacity(heapfile));
+  const u8 *directory = header_page + heapfile->metadata.header_size;
+  for (u64 page = 1; page <= in_directory; page++) {
+    HeapPageEntry entry;
+    memcpy(&entry, directory + (page - 1) * sizeof(HeapPageEntry),
+           sizeof(HeapPageEntry));
+    heapfile->free_slots[page] = (u16)(entry.free_space / SLOT_SIZE);
   }
 
-  size_t id_len = strlen(id_buffer);
-  offset = id_len + 1;
-
-  HeapFile *heapfile = new HeapFile(0, "", false);
-  heapfile->heap_fd = fd;
-  heapfile->metadata.identifier = string(id_buffer, id_len);
+  u8 page_buf[PAGE_DATA_SIZE];
+  for (u64 page = in_directory + 1; page <= num_pages; page++) {
+    if (dbfile.read_at(GET_PAGE_OFFSET(page), page_buf, PAGE_DATA_SIZE,
+                       heapfile->heap_fd) == PAGE_DATA_SIZE) {
+      heapfile->free_slots[page] = (u16)count_free_slots(page_buf);
+    } else {
+      heapfile->free_slots[page] = SLOTS_PER_PAGE;
+    }
+  }
 
-  dbfile.read_at(offset, &heapfile->metadata.heap_id,
-                 sizeof(heapfile->metadata.heap_id), fd);
-  offset += sizeof(heapfile->metadata.heap_id);
+  // the header's record count only moves in memory, the directory is
+  // written on every insert and delete, so the live rows are counted here
+  heapfile->metadata.num_records = 0;
+  for (u64 page = 1; page <= num_pages; page++) {
+    heapfile->metadata.num_records += SLOTS_PER_PAGE - heapfile->free_slots[page];
+  }
+}
 
-  dbfile.read_at(offset, &heapfile->metadata.table_id,
-                 sizeof(heapfile->metadata.table_id), fd);
-  offset += sizeof(heapfile->metadata.table_id);
+// name is the file name without ".db". Reads page 0 once for both the
+// header and the page directory
+static HeapFile *read_heapfile_from_disk(const string &name) {
+  DbFile &dbfile = DbFile::getInstance();
+  string filepath = "database-files/heapfiles/" + name + ".db";
+  int fd = dbfile.get_filepath(filepath);
+  if (fd == -1) {
+    fd = dbfile.add_filepath(filepath);
+  }
+  if (fd < 0) {
+    return NULL;
+  }
 
-  dbfile.read_at(offset, &heapfile->metadata.num_pages,
-                 sizeof(heapfile->metadata.num_pages), fd);
-  offset += sizeof(heapfile->metadata.num_pages);
+  u8 page[PAGE_DATA_SIZE];
+  memset(page, 0, PAGE_DATA_SIZE);
+  ssize_t bytes_read = dbfile.read_at(0, page, PAGE_DATA_SIZE, fd);
+  if (bytes_read < (ssize_t)sizeof(HeapFile_Metadata)) {
+    return NULL;
+  }
+  HeapFile_Metadata metadata;
+  memcpy(&metadata, page, sizeof(metadata));
+  if (metadata.magic != HEAPFILE_MAGIC) {
+    return NULL;
+  }
+  if (metadata.version != HEAPFILE_VERSION ||
+      metadata.header_size != sizeof(HeapFile_Metadata) ||
+      metadata.page_size != PAGE_DATA_SIZE) {
+    throw std::runtime_error("Unsupported heapfile format: " + filepath);
+  }
 
-  dbfile.read_at(offset, &heapfile->metadata.num_records,
-                 sizeof(heapfile->metadata.num_records), fd);
-  offset += sizeof(heapfile->metadata.num_records);
+  HeapFile *heapfile = new HeapFile((int)metadata.table_id, name, false);
+  heapfile->metadata = metadata;
+  load_free_space_map(heapfile, page);
+  return heapfile;
+}
 
-  dbfile.read_at(offset, &heapfile->metadata.next_heapfile,
-                 sizeof(heapfile->metadata.next_heapfile), fd);
+HeapFile *open_heapfile(const string &tablename) {
+  return read_heapfile_from_disk(tablename);
+}
 
-  return heapfile;
+void delete_heapfile(const string &tablename) {
+  DbFile &dbfile = DbFile::getInstance();
+  string base = "database-files/heapfiles/" + tablename;
+  for (const char *ext : {".db", ".dict", ".toast", ".zone"}) {
+    dbfile.remove_filepath(base + ext);
+  }
 }
 
 void load_heapfile_registry(const string &tablename) {
   int heap_num = 1;
-  string filepath = "database-files/heapfiles/" + tablename + ".db";
-
-  HeapFile *heapfile = read_heapfile_from_disk(filepath, heap_num);
+  HeapFile *heapfile = read_heapfile_from_disk(tablename);
   while (heapfile != NULL) {
     register_heapfile(heapfile);
 
@@ -420,50 +699,467 @@ void load_heapfile_registry(const string &tablename) {
     }
 
     heap_num++;
-    filepath = "database-files/heapfiles/" + tablename + "_" +
-               std::to_string(heap_num) + ".db";
-    heapfile = read_heapfile_from_disk(filepath, heap_num);
+    heapfile =
+        read_heapfile_from_disk(tablename + "_" + std::to_string(heap_num));
   }
 }
 
-std::vector<Row *> scan_heap(HeapFile *heapfile) {
-  std::vector<Row *> rows;
+// visit order for a batch of row ids, grouped by page so each page is read
+// and written once
+static std::vector<size_t> order_by_page(const std::vector<RowId> &rids) {
+  std::vector<size_t> order(rids.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (rids[a].pageId.page_num != rids[b].pageId.page_num) {
+      return rids[a].pageId.page_num < rids[b].pageId.page_num;
+    }
+    return rids[a].record_num < rids[b].record_num;
+  });
+  return order;
+}
+
+std::vector<size_t> update_rows(HeapFile *heapfile,
+                                const std::vector<RowId> &rids,
+                                const std::vector<Row *> &rows) {
+  std::vector<size_t> applied;
+  if (heapfile == NULL || rids.size() != rows.size()) {
+    return applied;
+  }
+
+  std::unique_lock lock(heapfile->latch);
+  DbFile &dbfile = DbFile::getInstance();
 
+  // Slots are fixed size and serialize_row moves big strings out of line
+  // until the row fits, so the new version always goes back into the same
+  // slot. The row id never changes, which keeps indexes on unchanged
+  // columns valid without touching them. Every new version is encoded before
+  // any slot is written, a row that can't be encoded fails the whole update
+  std::vector<u8> encoded(rows.size() * SLOT_SIZE, 0);
+  for (size_t idx = 0; idx < rows.size(); idx++) {
+    if (serialize_row(heapfile, rows[idx], encoded.data() + idx * SLOT_SIZE,
+                      SLOT_SIZE) == 0) {
+      for (size_t done = 0; done < idx; done++) {
+        free_overflow_values(heapfile, encoded.data() + done * SLOT_SIZE,
+                             SLOT_SIZE);
+      }
+      throw std::runtime_error("Updated row does not fit in a heap slot");
+    }
+  }
+
+  u8 page[PAGE_DATA_SIZE];
+  u32 loaded = 0;
+  bool dirty = false;
+  for (size_t idx : order_by_page(rids)) {
+    u8 *buffer = encoded.data() + idx * SLOT_SIZE;
+    u32 page_num = (u32)rids[idx].pageId.page_num;
+    u64 slot_num = rids[idx].record_num;
+    if (page_num == 0 || page_num > heapfile->metadata.num_pages ||
+        slot_num >= SLOTS_PER_PAGE) {
+      free_overflow_values(heapfile, buffer, SLOT_SIZE);
+      continue;
+    }
+
+    if (page_num != loaded) {
+      if (dirty) {
+        dbfile.write_at(GET_PAGE_OFFSET(loaded), page, PAGE_DATA_SIZE,
+                        heapfile->heap_fd);
+        dirty = false;
+      }
+      dbfile.read_at(GET_PAGE_OFFSET(page_num), page, PAGE_DATA_SIZE,
+                     heapfile->heap_fd);
+      loaded = page_num;
+    }
+
+    u8 *slot = page + slot_num * SLOT_SIZE;
+    if (slot[0] == 0) {
+      free_overflow_values(heapfile, buffer, SLOT_SIZE);
+      continue; // deleted since it was read
+    }
+
+    free_overflow_values(heapfile, slot, SLOT_SIZE);
+    memcpy(slot, buffer, SLOT_SIZE);
+    heapfile->row_cache.invalidate(rids[idx]);
+    heapfile->zones.add_row(page_num, rows[idx]);
+    dirty = true;
+    applied.push_back(idx);
+  }
+
+  if (dirty) {
+    dbfile.write_at(GET_PAGE_OFFSET(loaded), page, PAGE_DATA_SIZE,
+                    heapfile->heap_fd);
+  }
+  return applied;
+}
+
+size_t delete_rows(HeapFile *heapfile, const std::vector<RowId> &rids) {
   if (heapfile == NULL) {
-    return rows;
+    return 0;
   }
 
+  std::unique_lock lock(heapfile->latch);
   DbFile &dbfile = DbFile::getInstance();
-  u8 buffer[SLOT_SIZE];
+  u8 page[PAGE_DATA_SIZE];
+  u32 loaded = 0;
+  size_t deleted = 0;
+
+  auto flush = [&]() {
+    if (loaded != 0) {
+      dbfile.write_at(GET_PAGE_OFFSET(loaded), page, PAGE_DATA_SIZE,
+                      heapfile->heap_fd);
+      write_directory_entry(heapfile, loaded);
+    }
+  };
+
+  for (size_t idx : order_by_page(rids)) {
+    u32 page_num = (u32)rids[idx].pageId.page_num;
+    u64 slot_num = rids[idx].record_num;
+    if (page_num == 0 || page_num > heapfile->metadata.num_pages ||
+        slot_num >= SLOTS_PER_PAGE) {
+      continue;
+    }
+
+    if (page_num != loaded) {
+      flush();
+      dbfile.read_at(GET_PAGE_OFFSET(page_num), page, PAGE_DATA_SIZE,
+                     heapfile->heap_fd);
+      loaded = page_num;
+    }
+
+    u8 *slot = page + slot_num * SLOT_SIZE;
+    if (slot[0] == 0) {
+      continue;
+    }
+    free_overflow_values(heapfile, slot, SLOT_SIZE);
+    slot[0] = 0;
+    heapfile->row_cache.invalidate(rids[idx]);
+    heapfile->free_slots[page_num]++;
+    if (heapfile->metadata.num_records > 0) {
+      heapfile->metadata.num_records--;
+    }
+    if (page_num < heapfile->fsm_hint) {
+      heapfile->fsm_hint = page_num;
+    }
+    deleted++;
+  }
+  flush();
+
+  return deleted;
+}
+
+// predicate values resolved to this segment's dictionary codes
+struct ResolvedPredicate {
+  const StringPredicate *pred;
+  std::vector<int> codes;
+};
+
+static bool slot_matches(HeapFile *heapfile, u8 *buffer, size_t size,
+                         const std::vector<ResolvedPredicate> &preds) {
+  for (const ResolvedPredicate &rp : preds) {
+    size_t offset = find_column(buffer, size, rp.pred->col);
+    bool found = false;
+    if (offset != 0) {
+      u8 type_tag = buffer[offset];
+      offset += sizeof(u8);
+      if (type_tag == ROW_TAG_DICT_STRING) {
+        u16 code;
+        memcpy(&code, buffer + offset, sizeof(u16));
+        for (int c : rp.codes) {
+          if (c == code) {
+            found = true;
+            break;
+          }
+        }
+      } else if (type_tag == 2) {
+        u16 len;
+        memcpy(&len, buffer + offset, sizeof(u16));
+        const char *data = (const char *)(buffer + offset + sizeof(u16));
+        for (const string &v : rp.pred->values) {
+          if (v.size() == len && memcmp(v.data(), data, len) == 0) {
+            found = true;
+            break;
+          }
+        }
+      } else if (type_tag == ROW_TAG_TOAST_STRING) {
+        // the prefix rules out most values before the chain is read
+        u32 len, first_page;
+        memcpy(&len, buffer + offset, sizeof(u32));
+        memcpy(&first_page, buffer + offset + sizeof(u32), sizeof(u32));
+        const char *prefix = (const char *)(buffer + offset + 2 * sizeof(u32));
+        for (const string &v : rp.pred->values) {
+          if (v.size() == len &&
+              memcmp(v.data(), prefix, TOAST_PREFIX_SIZE) == 0 &&
+              heapfile->overflow.read_value(first_page, len) == v) {
+            found = true;
+            break;
+          }
+        }
+      }
+    }
+    if (found == rp.pred->negate) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<Row *> scan_heap(HeapFile *heapfile, QueryArena *arena,
+                             const HeapScanOptions *opts) {
+  HeapCursor cursor;
+  return scan_heap_next(heapfile, cursor, SIZE_MAX, arena, opts);
+}
 
-  u32 max_pages = 100;
-  for (u32 page_num = 1; page_num < max_pages; page_num++) {
-    bool page_empty = true;
+std::vector<Row *> scan_heap_next(HeapFile *heapfile, HeapCursor &cursor,
+                                  size_t max_rows, QueryArena *arena,
+                                  const HeapScanOptions *opts) {
+  std::vector<Row *> rows;
 
-    for (u64 slot_num = 0; slot_num < SLOTS_PER_PAGE; slot_num++) {
-      off_t slot_off = GET_SLOT_OFFSET(page_num, slot_num);
-      ssize_t bytes_read =
-          dbfile.read_at(slot_off, buffer, SLOT_SIZE, heapfile->heap_fd);
+  if (heapfile == NULL || cursor.done) {
+    return rows;
+  }
 
-      if (bytes_read <= 0) {
-        continue;
+  std::vector<ResolvedPredicate> resolved;
+  const std::vector<bool> *columns = NULL;
+  if (opts != NULL) {
+    columns = &opts->columns;
+    for (const StringPredicate &p : opts->predicates) {
+      ResolvedPredicate rp{&p, {}};
+      for (const string &v : p.values) {
+        int code = heapfile->dictionary.lookup(p.col, v);
+        if (code != DICT_NO_CODE) {
+          rp.codes.push_back(code);
+        }
       }
+      resolved.push_back(std::move(rp));
+    }
+  }
+
+  std::shared_lock lock(heapfile->latch);
+  if (!cursor.started) {
+    cursor.started = true;
+    cursor.epoch = heapfile->vacuum_epoch;
+  } else if (cursor.epoch != heapfile->vacuum_epoch) {
+    throw std::runtime_error("Heapfile was vacuumed during the scan");
+  }
+  DbFile &dbfile = DbFile::getInstance();
+  u8 page[PAGE_DATA_SIZE];
+
+  const std::vector<u32> *listed =
+      opts != NULL && opts->pages ? &*opts->pages : NULL;
+  u64 num_visits = listed ? listed->size() : heapfile->metadata.num_pages;
+  for (; cursor.visit < num_visits; cursor.visit++, cursor.slot = 0) {
+    u32 page_num = listed ? (*listed)[cursor.visit] : (u32)(cursor.visit + 1);
+    if (page_num == 0 || page_num > heapfile->metadata.num_pages) {
+      continue;
+    }
+    if (heapfile->free_slots[page_num] == SLOTS_PER_PAGE) {
+      continue; // nothing live, skip the read
+    }
+    if (opts != NULL && !opts->ranges.empty() &&
+        !heapfile->zones.may_match(page_num, opts->ranges)) {
+      continue; // no row on the page can be in range
+    }
+    ssize_t bytes_read = dbfile.read_at(GET_PAGE_OFFSET(page_num), page,
+                                        PAGE_DATA_SIZE, heapfile->heap_fd);
+    if (bytes_read <= 0) {
+      continue;
+    }
 
+    for (; cursor.slot < SLOTS_PER_PAGE; cursor.slot++) {
+      if (rows.size() >= max_rows) {
+        return rows; // the page is read again from this slot next time
+      }
+      u8 *buffer = page + cursor.slot * SLOT_SIZE;
+      if ((ssize_t)((cursor.slot + 1) * SLOT_SIZE) > bytes_read) {
+        break;
+      }
       if (buffer[0] != 0) {
-        page_empty = false;
-        Row *row = deserialize_row(buffer, SLOT_SIZE);
+        if (!resolved.empty() &&
+            !slot_matches(heapfile, buffer, SLOT_SIZE, resolved)) {
+          continue;
+        }
+        Row *row = deserialize_row(heapfile, buffer, SLOT_SIZE, arena, columns);
         if (row != NULL) {
+          row->id = {{heapfile->metadata.heap_id, page_num}, cursor.slot};
           rows.push_back(row);
         }
       }
     }
+  }
+
+  cursor.done = true;
+  return rows;
+}
+
+void scan_heap_slots(HeapFile *heapfile,
+                     const std::function<void(const RowId &, const u8 *)> &visit) {
+  if (heapfile == NULL) {
+    return;
+  }
 
-    if (page_empty && page_num > 1) {
+  std::shared_lock lock(heapfile->latch);
+  DbFile &dbfile = DbFile::getInstance();
+  u8 page[PAGE_DATA_SIZE];
+  for (u32 page_num = 1; page_num <= heapfile->metadata.num_pages; page_num++) {
+    if (heapfile->free_slots[page_num] == SLOTS_PER_PAGE) {
+      continue;
+    }
+    if (dbfile.read_at(GET_PAGE_OFFSET(page_num), page, PAGE_DATA_SIZE,
+                       heapfile->heap_fd) <= 0) {
       break;
     }
+    for (u64 slot = 0; slot < SLOTS_PER_PAGE; slot++) {
+      const u8 *data = page + slot * SLOT_SIZE;
+      if (data[0] != 0) {
+        visit({{heapfile->metadata.heap_id, page_num}, slot}, data);
+      }
+    }
   }
+}
 
-  return rows;
+VacuumStats vacuum_heap(HeapFile *heapfile, const VacuumOptions &opts) {
+  VacuumStats stats = {};
+  if (heapfile == NULL) {
+    return stats;
+  }
+
+  DbFile &dbfile = DbFile::getInstance();
+  u8 front_page[PAGE_DATA_SIZE];
+  u8 back_page[PAGE_DATA_SIZE];
+
+  {
+    std::shared_lock lock(heapfile->latch);
+    stats.pages_before = heapfile->metadata.num_pages;
+  }
+
+  // Move rows from the last pages into holes in the first pages so the tail
+  // empties out. The latch is only held for one batch of pages at a time.
+  u32 front = 1;
+  bool done = false;
+  while (!done) {
+    {
+      std::unique_lock lock(heapfile->latch);
+      u32 back = (u32)heapfile->metadata.num_pages;
+      u32 loaded_front = 0;
+      u64 moved_before = stats.rows_moved;
+
+      for (u32 batch = 0; batch < opts.pages_per_batch; batch++) {
+        while (back > front && heapfile->free_slots[back] == SLOTS_PER_PAGE) {
+          back--;
+        }
+        while (front < back && heapfile->free_slots[front] == 0) {
+          front++;
+        }
+        if (front >= back) {
+          done = true;
+          break;
+        }
+
+        dbfile.read_at(GET_PAGE_OFFSET(back), back_page, PAGE_DATA_SIZE,
+                       heapfile->heap_fd);
+        std::vector<u32> filled; // front pages that took rows from this one
+        for (u64 slot = 0; slot < SLOTS_PER_PAGE && front < back; slot++) {
+          u8 *src = back_page + slot * SLOT_SIZE;
+          if (src[0] == 0) {
+            continue;
+          }
+          if (loaded_front != front) {
+            dbfile.read_at(GET_PAGE_OFFSET(front), front_page, PAGE_DATA_SIZE,
+                           heapfile->heap_fd);
+            loaded_front = front;
+          }
+          u64 dst = 0;
+          while (dst < SLOTS_PER_PAGE && front_page[dst * SLOT_SIZE] != 0) {
+            dst++;
+          }
+          if (dst == SLOTS_PER_PAGE) {
+            // the free space map is out of step with the page, stop here
+            // rather than move rows onto pages it can't account for
+            done = true;
+            break;
+          }
+          memcpy(front_page + dst * SLOT_SIZE, src, SLOT_SIZE);
+          src[0] = 0;
+          if (filled.empty() || filled.back() != front) {
+            filled.push_back(front);
+          }
+          heapfile->free_slots[front]--;
+          heapfile->free_slots[back]++;
+          stats.rows_moved++;
+
+          RowId from = {{heapfile->metadata.heap_id, back}, slot};
+          heapfile->row_cache.invalidate(from);
+          if (opts.on_move) {
+            RowId to = {{heapfile->metadata.heap_id, front}, dst};
+            Row *row = deserialize_row(heapfile, front_page + dst * SLOT_SIZE,
+                                       SLOT_SIZE);
+            if (row != NULL) {
+              opts.on_move(*row, from, to);
+              delete row;
+            }
+          }
+
+          if (heapfile->free_slots[front] == 0) {
+            dbfile.write_at(GET_PAGE_OFFSET(front), front_page, PAGE_DATA_SIZE,
+                            heapfile->heap_fd);
+            write_directory_entry(heapfile, front);
+            front++;
+            while (front < back && heapfile->free_slots[front] == 0) {
+              front++;
+            }
+          }
+        }
+        if (loaded_front != 0 && heapfile->free_slots[loaded_front] > 0) {
+          dbfile.write_at(GET_PAGE_OFFSET(loaded_front), front_page,
+                          PAGE_DATA_SIZE, heapfile->heap_fd);
+          write_directory_entry(heapfile, loaded_front);
+        }
+        loaded_front = 0;
+        for (u32 page : filled) {
+          heapfile->zones.merge(page, back);
+        }
+        if (heapfile->free_slots[back] == SLOTS_PER_PAGE) {
+          heapfile->zones.reset(back);
+        }
+        dbfile.write_at(GET_PAGE_OFFSET(back), back_page, PAGE_DATA_SIZE,
+                        heapfile->heap_fd);
+        write_directory_entry(heapfile, back);
+        stats.pages_compacted++;
+        if (done) {
+          break;
+        }
+      }
+      if (stats.rows_moved != moved_before) {
+        heapfile->vacuum_epoch++;
+      }
+    }
+    if (!done && opts.pause.count() > 0) {
+      std::this_thread::sleep_for(opts.pause);
+    }
+  }
+
+  // give trailing empty pages back to the filesystem
+  std::unique_lock lock(heapfile->latch);
+  u64 old_pages = heapfile->metadata.num_pages;
+  while (heapfile->metadata.num_pages > 0 &&
+         heapfile->free_slots[heapfile->metadata.num_pages] == SLOTS_PER_PAGE) {
+    heapfile->metadata.num_pages--;
+    heapfile->free_slots.pop_back();
+  }
+  if (heapfile->metadata.num_pages < old_pages) {
+    for (u64 page = heapfile->metadata.num_pages + 1; page <= old_pages; page++) {
+      write_directory_entry(heapfile, (u32)page);
+    }
+    dbfile.truncate(GET_PAGE_OFFSET(heapfile->metadata.num_pages + 1),
+                    heapfile->heap_fd);
+    heapfile->zones.truncate((u32)heapfile->metadata.num_pages);
+    write_heapfile_metadata(heapfile);
+  }
+  heapfile->fsm_hint = 1;
+  stats.pages_truncated = old_pages - heapfile->metadata.num_pages;
+  stats.pages_after = heapfile->metadata.num_pages;
+  return stats;
 }
 
 } // namespace DB
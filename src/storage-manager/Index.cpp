@@ -0,0 +1,99 @@
+#include "storage-manager/Index.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DB {
+    static void store_be(u64 val, u8* out) {
+        for (int i = 7; i >= 0; i--) {
+            out[i] = (u8)(val & 0xFF);
+            val >>= 8;
+        }
+    }
+
+    static double numeric_value(const datatype& val) {
+        return val.visit([](auto&& v) -> double {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                return 0;
+            } else {
+                return static_cast<double>(v);
+            }
+        });
+    }
+
+    IndexKey make_index_key(const datatype& val, ColumnType type) {
+        IndexKey key;
+        std::memset(key.bytes, 0, INDEX_KEY_SIZE);
+
+        switch (type) {
+            case ColumnType::FLOAT:
+            case ColumnType::DOUBLE: {
+                // flip the sign bit of positives and every bit of negatives
+                double d = numeric_value(val);
+                if (d == 0) d = 0; // -0.0 and 0.0 get the same key
+                u64 bits;
+                std::memcpy(&bits, &d, sizeof(u64));
+                bits = (bits >> 63) ? ~bits : bits | (1ULL << 63);
+                store_be(bits, key.bytes);
+                break;
+            }
+            case ColumnType::STRING: {
+                if (val.holds<string>()) {
+                    std::string_view s = val.get<string>();
+                    std::memcpy(key.bytes, s.data(), std::min(s.size(), (size_t)INDEX_KEY_SIZE));
+                }
+                break;
+            }
+            default: {
+                int64_t i = val.holds<int64_t>() ? val.get<int64_t>()
+                                                                 : static_cast<int64_t>(numeric_value(val));
+                store_be((u64)i ^ (1ULL << 63), key.bytes);
+                break;
+            }
+        }
+        return key;
+    }
+
+    int compare_keys(const IndexKey& a, const IndexKey& b) {
+        return std::memcmp(a.bytes, b.bytes, INDEX_KEY_SIZE);
+    }
+
+    // FNV-1a over the key, finished with a 64 bit mixer so the low bits hash
+    // directories and hash partitioning use depend on every byte
+    u64 hash_index_key(const IndexKey& key) {
+        u64 h = 14695981039346656037ULL;
+        for (size_t i = 0; i < INDEX_KEY_SIZE; i++) {
+            h ^= key.bytes[i];
+            h *= 1099511628211ULL;
+        }
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    bool same_row(const RowId& a, const RowId& b) {
+        return a.pageId.page_num == b.pageId.page_num && a.record_num == b.record_num;
+    }
+
+    bool entry_less(const IndexEntry& a, const IndexEntry& b) {
+        int cmp = compare_keys(a.key, b.key);
+        if (cmp != 0) {
+            return cmp < 0;
+        }
+        if (a.rid.pageId.page_num != b.rid.pageId.page_num) {
+            return a.rid.pageId.page_num < b.rid.pageId.page_num;
+        }
+        return a.rid.record_num < b.rid.record_num;
+    }
+
+    std::vector<std::vector<RowId>> Index::lookup_many(const std::vector<IndexKey>& keys) const {
+        std::vector<std::vector<RowId>> found;
+        found.reserve(keys.size());
+        for (const IndexKey& key : keys) {
+            found.push_back(lookup(key));
+        }
+        return found;
+    }
+}
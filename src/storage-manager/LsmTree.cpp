@@ -0,0 +1,896 @@
+#include "storage-manager/LsmTree.hpp"
+#include "page-manager/DbFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <queue>
+#include <stdexcept>
+
+#define LSM_MANIFEST_VERSION 1
+#define LSM_FOOTER_SIZE (sizeof(u64) + sizeof(u64) + sizeof(u32) + sizeof(u32))
+#define LSM_OP_PUT 1
+#define LSM_OP_DELETE 2
+
+namespace DB {
+    static void put(std::vector<u8>& out, const void* data, size_t size) {
+        const u8* bytes = static_cast<const u8*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    // [op u8][key len u16][key][value len u32][value], for log records and run entries alike
+    static void put_entry(std::vector<u8>& out, const string& key, bool deleted, const std::vector<u8>& value) {
+        u8 op = deleted ? LSM_OP_DELETE : LSM_OP_PUT;
+        u16 keyLen = (u16)key.size();
+        u32 valueLen = (u32)value.size();
+        put(out, &op, sizeof(op));
+        put(out, &keyLen, sizeof(keyLen));
+        put(out, key.data(), keyLen);
+        put(out, &valueLen, sizeof(valueLen));
+        put(out, value.data(), valueLen);
+    }
+
+    // false once the rest is too short to hold an entry, a torn log tail ends like that
+    static bool get_entry(const u8* data, size_t size, size_t& offset, string& key, LsmEntry& entry) {
+        if (offset + sizeof(u8) + sizeof(u16) > size) {
+            return false;
+        }
+        u8 op = data[offset];
+        u16 keyLen;
+        std::memcpy(&keyLen, data + offset + 1, sizeof(u16));
+        size_t pos = offset + 1 + sizeof(u16);
+        if ((op != LSM_OP_PUT && op != LSM_OP_DELETE) || pos + keyLen + sizeof(u32) > size) {
+            return false;
+        }
+        key.assign(reinterpret_cast<const char*>(data + pos), keyLen);
+        pos += keyLen;
+        u32 valueLen;
+        std::memcpy(&valueLen, data + pos, sizeof(u32));
+        pos += sizeof(u32);
+        if (pos + valueLen > size) {
+            return false;
+        }
+        entry.deleted = op == LSM_OP_DELETE;
+        entry.value.assign(data + pos, data + pos + valueLen);
+        offset = pos + valueLen;
+        return true;
+    }
+
+    static std::vector<u8> read_file(const string& path, int fd, off_t offset, size_t size) {
+        std::vector<u8> buffer(size);
+        if (size > 0 && DbFile::getInstance().read_at(offset, buffer.data(), size, fd) != (ssize_t)size) {
+            throw std::runtime_error("Could not read " + path);
+        }
+        return buffer;
+    }
+
+    static int open_file(const string& path) {
+        DbFile& dbfile = DbFile::getInstance();
+        int fd = dbfile.get_filepath(path);
+        if (fd == -1) {
+            fd = dbfile.add_filepath(path);
+        }
+        return fd;
+    }
+
+    // FNV-1a, finished with the splitmix64 mixer so nearby keys spread out
+    static u64 hash_key(std::string_view key) {
+        u64 h = 0xcbf29ce484222325ULL;
+        for (char c : key) {
+            h = (h ^ (u8)c) * 0x100000001b3ULL;
+        }
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    BloomFilter::BloomFilter(size_t numKeys, u32 bitsPerKey) {
+        size_t bits = std::max<size_t>(64, numKeys * bitsPerKey);
+        theBits.assign((bits + 63) / 64, 0);
+        // k = bits per key * ln 2 minimizes false positives
+        theProbes = std::clamp<u32>((u32)(bitsPerKey * 0.69), 1, 30);
+    }
+
+    // double hashing, k probes from one 64 bit hash
+    void BloomFilter::add(std::string_view key) {
+        u64 h = hash_key(key);
+        u64 delta = (h >> 17) | (h << 47);
+        u64 bits = theBits.size() * 64;
+        for (u32 i = 0; i < theProbes; i++) {
+            u64 bit = h % bits;
+            theBits[bit / 64] |= 1ULL << (bit % 64);
+            h += delta;
+        }
+    }
+
+    bool BloomFilter::may_contain(std::string_view key) const {
+        if (theBits.empty()) {
+            return true;
+        }
+        u64 h = hash_key(key);
+        u64 delta = (h >> 17) | (h << 47);
+        u64 bits = theBits.size() * 64;
+        for (u32 i = 0; i < theProbes; i++) {
+            u64 bit = h % bits;
+            if ((theBits[bit / 64] & (1ULL << (bit % 64))) == 0) {
+                return false;
+            }
+            h += delta;
+        }
+        return true;
+    }
+
+    // [probes u32][words u32][words]
+    void BloomFilter::serialize(std::vector<u8>& out) const {
+        u32 words = (u32)theBits.size();
+        put(out, &theProbes, sizeof(theProbes));
+        put(out, &words, sizeof(words));
+        put(out, theBits.data(), words * sizeof(u64));
+    }
+
+    size_t BloomFilter::deserialize(const u8* data, size_t size) {
+        u32 words;
+        if (size < 2 * sizeof(u32)) {
+            return 0;
+        }
+        std::memcpy(&theProbes, data, sizeof(u32));
+        std::memcpy(&words, data + sizeof(u32), sizeof(u32));
+        size_t used = 2 * sizeof(u32) + (size_t)words * sizeof(u64);
+        if (used > size) {
+            return 0;
+        }
+        theBits.resize(words);
+        std::memcpy(theBits.data(), data + 2 * sizeof(u32), words * sizeof(u64));
+        return used;
+    }
+
+    // One input of a merge, positioned on its smallest key not yet returned
+    class LsmCursor {
+        public:
+            virtual ~LsmCursor() = default;
+            virtual bool            valid() const = 0;
+            virtual const string&   key() const = 0;
+            virtual const LsmEntry& entry() const = 0;
+            virtual void            next() = 0;
+    };
+
+    class MemtableCursor : public LsmCursor {
+        public:
+            MemtableCursor(const LsmMemtable& memtable, const std::optional<string>& low) :
+                theIt(low ? memtable.lower_bound(*low) : memtable.begin()),
+                theEnd(memtable.end())
+                {}
+
+            bool            valid() const override { return theIt != theEnd; }
+            const string&   key() const override { return theIt->first; }
+            const LsmEntry& entry() const override { return theIt->second; }
+            void            next() override { ++theIt; }
+
+        private:
+            LsmMemtable::const_iterator theIt;
+            LsmMemtable::const_iterator theEnd;
+    };
+
+    // Reads a run one block at a time
+    class RunCursor : public LsmCursor {
+        public:
+            RunCursor(std::shared_ptr<LsmRun> run, const std::optional<string>& low) :
+                theRun(std::move(run))
+                {
+                    size_t block = 0;
+                    if (low) {
+                        auto it = std::upper_bound(theRun->blockKeys.begin(), theRun->blockKeys.end(), *low);
+                        block = it == theRun->blockKeys.begin() ? 0 : (it - theRun->blockKeys.begin()) - 1;
+                    }
+                    load(block);
+                    while (valid() && low && key() < *low) {
+                        next();
+                    }
+                }
+
+            bool            valid() const override { return thePos < theEntries.size(); }
+            const string&   key() const override { return theEntries[thePos].first; }
+            const LsmEntry& entry() const override { return theEntries[thePos].second; }
+            void            next() override {
+                if (++thePos == theEntries.size()) {
+                    load(theBlock + 1);
+                }
+            }
+
+        private:
+            std::shared_ptr<LsmRun>                         theRun;
+            size_t                                          theBlock = 0;
+            size_t                                          thePos = 0;
+            std::vector<std::pair<string, LsmEntry>>        theEntries;
+
+            void load(size_t block) {
+                theBlock = block;
+                thePos = 0;
+                theEntries.clear();
+                if (block >= theRun->blockKeys.size()) {
+                    return;
+                }
+                u64 start = theRun->blockOffsets[block];
+                std::vector<u8> data = read_file(theRun->path, theRun->fd, start,
+                                                 theRun->blockOffsets[block + 1] - start);
+                size_t offset = 0;
+                string key;
+                LsmEntry entry;
+                while (get_entry(data.data(), data.size(), offset, key, entry)) {
+                    theEntries.emplace_back(key, entry);
+                }
+            }
+    };
+
+    // Visits every key in the cursors up to high once, with the entry of the
+    // first cursor that has it, until visit returns false. Cursors go newest first
+    static void merge_cursors(std::vector<std::unique_ptr<LsmCursor>>& cursors, const std::optional<string>& high,
+                              const std::function<bool(const string&, const LsmEntry&)>& visit) {
+        auto later = [&](size_t a, size_t b) {
+            int cmp = cursors[a]->key().compare(cursors[b]->key());
+            return cmp != 0 ? cmp > 0 : a > b;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+        for (size_t i = 0; i < cursors.size(); i++) {
+            if (cursors[i]->valid()) {
+                heap.push(i);
+            }
+        }
+
+        string last;
+        bool any = false;
+        while (!heap.empty()) {
+            size_t i = heap.top();
+            heap.pop();
+            const string& key = cursors[i]->key();
+            if (high && key > *high) {
+                continue; // this cursor is done, the others still have to reach the bound
+            }
+            if (!any || key != last) {
+                if (!visit(key, cursors[i]->entry())) {
+                    return;
+                }
+                last = key;
+                any = true;
+            }
+            cursors[i]->next();
+            if (cursors[i]->valid()) {
+                heap.push(i);
+            }
+        }
+    }
+
+    // finds key in one run, reading the single block that can hold it
+    static bool search_run(const LsmRun& run, const string& key, LsmEntry& out) {
+        if (key < run.smallest || key > run.largest || !run.bloom.may_contain(key)) {
+            return false;
+        }
+        auto it = std::upper_bound(run.blockKeys.begin(), run.blockKeys.end(), key);
+        if (it == run.blockKeys.begin()) {
+            return false;
+        }
+        size_t block = (it - run.blockKeys.begin()) - 1;
+        u64 start = run.blockOffsets[block];
+        std::vector<u8> data = read_file(run.path, run.fd, start, run.blockOffsets[block + 1] - start);
+        size_t offset = 0;
+        string found;
+        while (get_entry(data.data(), data.size(), offset, found, out)) {
+            if (found == key) {
+                return true;
+            }
+            if (found > key) {
+                break;
+            }
+        }
+        return false;
+    }
+
+    LsmTree::LsmTree(const string& name, bool create) :
+        theName(name),
+        theLevels(LSM_MAX_LEVELS)
+        {
+            if (create) {
+                remove_files();
+            }
+            if (!read_manifest()) {
+                write_manifest();
+            }
+            replay_logs();
+            theWorker = std::thread(&LsmTree::background, this);
+        }
+
+    LsmTree::~LsmTree() {
+        stop_worker();
+    }
+
+    void LsmTree::stop_worker() {
+        {
+            std::unique_lock lock(theLatch);
+            theStop = true;
+        }
+        theWork.notify_all();
+        if (theWorker.joinable()) {
+            theWorker.join();
+        }
+    }
+
+    string LsmTree::file_path(const string& suffix) const {
+        return "database-files/lsm/" + theName + "." + suffix;
+    }
+
+    string LsmTree::log_path(u64 number) const {
+        return file_path(std::to_string(number) + ".log");
+    }
+
+    string LsmTree::run_path(u64 id) const {
+        return file_path(std::to_string(id) + ".run");
+    }
+
+    void LsmTree::open_log(u64 number) {
+        string path = log_path(number);
+        theLogFd = open_file(path);
+        theLogNumber = number;
+        theLogEnd = (off_t)std::filesystem::file_size(path);
+    }
+
+    // every log from the oldest one not flushed yet, a torn record at the end of the last is cut off
+    void LsmTree::replay_logs() {
+        u64 number = theOldestLog;
+        while (std::filesystem::exists(log_path(number + 1))) {
+            number++;
+        }
+        for (u64 n = theOldestLog; n <= number; n++) {
+            string path = log_path(n);
+            if (!std::filesystem::exists(path)) {
+                continue;
+            }
+            int fd = open_file(path);
+            std::vector<u8> data = read_file(path, fd, 0, std::filesystem::file_size(path));
+            size_t offset = 0;
+            string key;
+            LsmEntry entry;
+            while (get_entry(data.data(), data.size(), offset, key, entry)) {
+                theMemtableBytes += key.size() + entry.value.size();
+                theMemtable[key] = std::move(entry);
+            }
+            if (n == number && offset < data.size()) {
+                DbFile::getInstance().truncate(offset, fd);
+            }
+        }
+        open_log(number);
+    }
+
+    // [magic u32][version u32][next run id u64][oldest log u64][runs u32] then [level u32][id u64] per run
+    void LsmTree::write_manifest() {
+        std::vector<u8> buffer;
+        u32 magic = LSM_MANIFEST_MAGIC;
+        u32 version = LSM_MANIFEST_VERSION;
+        u32 numRuns = 0;
+        for (const auto& level : theLevels) {
+            numRuns += (u32)level.size();
+        }
+        put(buffer, &magic, sizeof(magic));
+        put(buffer, &version, sizeof(version));
+        put(buffer, &theNextRunId, sizeof(theNextRunId));
+        put(buffer, &theOldestLog, sizeof(theOldestLog));
+        put(buffer, &numRuns, sizeof(numRuns));
+        for (const auto& level : theLevels) {
+            for (const auto& run : level) {
+                put(buffer, &run->level, sizeof(run->level));
+                put(buffer, &run->id, sizeof(run->id));
+            }
+        }
+
+        // callers remove the logs and runs it no longer names right after, so the new manifest
+        // has to be on disk first and a crash must never leave a torn one
+        DbFile::getInstance().replace_file(file_path("manifest"), buffer.data(), buffer.size());
+    }
+
+    bool LsmTree::read_manifest() {
+        string path = file_path("manifest");
+        if (!std::filesystem::exists(path) || std::filesystem::file_size(path) == 0) {
+            return false;
+        }
+        std::vector<u8> data = read_file(path, open_file(path), 0, std::filesystem::file_size(path));
+        const size_t headerSize = 2 * sizeof(u32) + 2 * sizeof(u64) + sizeof(u32);
+        u32 magic, version, numRuns;
+        if (data.size() < headerSize) {
+            throw std::runtime_error("LSM manifest is malformed: " + path);
+        }
+        std::memcpy(&magic, data.data(), sizeof(u32));
+        std::memcpy(&version, data.data() + 4, sizeof(u32));
+        if (magic != LSM_MANIFEST_MAGIC || version != LSM_MANIFEST_VERSION) {
+            throw std::runtime_error("Unsupported LSM manifest format: " + path);
+        }
+        std::memcpy(&theNextRunId, data.data() + 8, sizeof(u64));
+        std::memcpy(&theOldestLog, data.data() + 16, sizeof(u64));
+        std::memcpy(&numRuns, data.data() + 24, sizeof(u32));
+        if (data.size() < headerSize + (size_t)numRuns * (sizeof(u32) + sizeof(u64))) {
+            throw std::runtime_error("LSM manifest is malformed: " + path);
+        }
+
+        size_t offset = headerSize;
+        for (u32 i = 0; i < numRuns; i++) {
+            u32 level;
+            u64 id;
+            std::memcpy(&level, data.data() + offset, sizeof(u32));
+            std::memcpy(&id, data.data() + offset + sizeof(u32), sizeof(u64));
+            offset += sizeof(u32) + sizeof(u64);
+            if (level >= LSM_MAX_LEVELS) {
+                throw std::runtime_error("LSM manifest is malformed: " + path);
+            }
+            theLevels[level].push_back(open_run(id, level));
+        }
+        return true;
+    }
+
+    void LsmTree::remove_files() {
+        std::error_code ec;
+        std::filesystem::path dir("database-files/lsm");
+        string prefix = theName + ".";
+        std::vector<string> paths;
+        for (const auto& file : std::filesystem::directory_iterator(dir, ec)) {
+            string filename = file.path().filename().string();
+            if (filename.compare(0, prefix.size(), prefix) == 0) {
+                paths.push_back(file.path().string());
+            }
+        }
+        for (const string& path : paths) {
+            DbFile::getInstance().remove_filepath(path);
+        }
+    }
+
+    // [blocks][index][bloom][footer]. The index is [blocks u32] then [key len u16][key][offset u64]
+    // per block, the end of the last block as u64 and [len u16][largest key]. The footer is
+    // [index offset u64][entries u64][magic u32][pad u32]
+    std::shared_ptr<LsmRun> LsmTree::open_run(u64 id, u32 level) {
+        auto run = std::make_shared<LsmRun>();
+        run->id = id;
+        run->level = level;
+        run->path = run_path(id);
+        run->fd = open_file(run->path);
+        run->bytes = std::filesystem::file_size(run->path);
+        if (run->bytes < LSM_FOOTER_SIZE) {
+            throw std::runtime_error("LSM run is malformed: " + run->path);
+        }
+
+        std::vector<u8> footer = read_file(run->path, run->fd, run->bytes - LSM_FOOTER_SIZE, LSM_FOOTER_SIZE);
+        u64 indexOffset;
+        u32 magic;
+        std::memcpy(&indexOffset, footer.data(), sizeof(u64));
+        std::memcpy(&run->entries, footer.data() + 8, sizeof(u64));
+        std::memcpy(&magic, footer.data() + 16, sizeof(u32));
+        if (magic != LSM_RUN_MAGIC || indexOffset > run->bytes - LSM_FOOTER_SIZE) {
+            throw std::runtime_error("LSM run is malformed: " + run->path);
+        }
+
+        // the index and bloom filter come in one read
+        std::vector<u8> tail = read_file(run->path, run->fd, indexOffset, run->bytes - LSM_FOOTER_SIZE - indexOffset);
+        auto need = [&](size_t offset, size_t size) {
+            if (offset + size > tail.size()) {
+                throw std::runtime_error("LSM run is malformed: " + run->path);
+            }
+        };
+        size_t offset = 0;
+        u32 blocks;
+        need(offset, sizeof(u32));
+        std::memcpy(&blocks, tail.data(), sizeof(u32));
+        offset += sizeof(u32);
+        auto getKey = [&]() {
+            u16 len;
+            need(offset, sizeof(u16));
+            std::memcpy(&len, tail.data() + offset, sizeof(u16));
+            offset += sizeof(u16);
+            need(offset, len);
+            string key(reinterpret_cast<const char*>(tail.data() + offset), len);
+            offset += len;
+            return key;
+        };
+        for (u32 i = 0; i < blocks; i++) {
+            run->blockKeys.push_back(getKey());
+            u64 blockOffset;
+            need(offset, sizeof(u64));
+            std::memcpy(&blockOffset, tail.data() + offset, sizeof(u64));
+            offset += sizeof(u64);
+            run->blockOffsets.push_back(blockOffset);
+        }
+        u64 end;
+        need(offset, sizeof(u64));
+        std::memcpy(&end, tail.data() + offset, sizeof(u64));
+        offset += sizeof(u64);
+        run->blockOffsets.push_back(end);
+        run->largest = getKey();
+        run->smallest = blocks > 0 ? run->blockKeys[0] : string();
+        if (run->bloom.deserialize(tail.data() + offset, tail.size() - offset) == 0) {
+            throw std::runtime_error("LSM run is malformed: " + run->path);
+        }
+        return run;
+    }
+
+    // Merges the memtable (newest) and inputs (newest first) into new runs of level, a new one
+    // is started once a run passes maxRunBytes. Runs are built in memory and written in one go
+    std::vector<std::shared_ptr<LsmRun>> LsmTree::write_runs(std::vector<std::shared_ptr<LsmRun>>& inputs,
+                                                             const LsmMemtable* memtable, u32 level,
+                                                             bool dropTombstones, u64 maxRunBytes) {
+        std::vector<std::unique_ptr<LsmCursor>> cursors;
+        if (memtable != nullptr) {
+            cursors.push_back(std::make_unique<MemtableCursor>(*memtable, std::nullopt));
+        }
+        for (auto& run : inputs) {
+            cursors.push_back(std::make_unique<RunCursor>(run, std::nullopt));
+        }
+
+        std::vector<std::shared_ptr<LsmRun>> outputs;
+        std::vector<u8> buffer;
+        std::vector<string> keys;
+        std::shared_ptr<LsmRun> run;
+
+        auto finish = [&]() {
+            run->blockOffsets.push_back(buffer.size());
+            run->largest = keys.back();
+            run->bloom = BloomFilter(keys.size(), LSM_BLOOM_BITS_PER_KEY);
+            for (const string& key : keys) {
+                run->bloom.add(key);
+            }
+
+            u64 indexOffset = buffer.size();
+            u32 blocks = (u32)run->blockKeys.size();
+            put(buffer, &blocks, sizeof(blocks));
+            for (u32 i = 0; i < blocks; i++) {
+                u16 len = (u16)run->blockKeys[i].size();
+                put(buffer, &len, sizeof(len));
+                put(buffer, run->blockKeys[i].data(), len);
+                put(buffer, &run->blockOffsets[i], sizeof(u64));
+            }
+            put(buffer, &run->blockOffsets.back(), sizeof(u64));
+            u16 len = (u16)run->largest.size();
+            put(buffer, &len, sizeof(len));
+            put(buffer, run->largest.data(), len);
+            run->bloom.serialize(buffer);
+            u32 magic = LSM_RUN_MAGIC;
+            u32 pad = 0;
+            put(buffer, &indexOffset, sizeof(indexOffset));
+            put(buffer, &run->entries, sizeof(run->entries));
+            put(buffer, &magic, sizeof(magic));
+            put(buffer, &pad, sizeof(pad));
+
+            run->fd = open_file(run->path);
+            DbFile& dbfile = DbFile::getInstance();
+            dbfile.truncate(0, run->fd);
+            if (dbfile.write_at(0, buffer.data(), buffer.size(), run->fd) != (ssize_t)buffer.size() ||
+                dbfile.sync(run->fd) != 0) {
+                throw std::runtime_error("Could not write " + run->path);
+            }
+            run->bytes = buffer.size();
+            outputs.push_back(std::move(run));
+            run = nullptr;
+            buffer.clear();
+            keys.clear();
+        };
+
+        size_t blockStart = 0;
+        merge_cursors(cursors, std::nullopt, [&](const string& key, const LsmEntry& entry) {
+            if (entry.deleted && dropTombstones) {
+                return true; // nothing older is left for the tombstone to hide
+            }
+            if (!run) {
+                run = std::make_shared<LsmRun>();
+                run->id = theNextRunId++;
+                run->level = level;
+                run->path = run_path(run->id);
+                run->smallest = key;
+                blockStart = 0;
+            }
+            if (run->blockKeys.empty() || buffer.size() - blockStart >= LSM_BLOCK_BYTES) {
+                blockStart = buffer.size();
+                run->blockKeys.push_back(key);
+                run->blockOffsets.push_back(blockStart);
+            }
+            put_entry(buffer, key, entry.deleted, entry.value);
+            keys.push_back(key);
+            run->entries++;
+            if (buffer.size() >= maxRunBytes) {
+                finish();
+            }
+            return true;
+        });
+        if (run) {
+            finish();
+        }
+        return outputs;
+    }
+
+    u64 LsmTree::level_target(u32 level) const {
+        u64 target = LSM_L1_BYTES;
+        for (u32 i = 1; i < level; i++) {
+            target *= LSM_LEVEL_FANOUT;
+        }
+        return target;
+    }
+
+    u64 LsmTree::level_bytes(u32 level) const {
+        u64 bytes = 0;
+        for (const auto& run : theLevels[level]) {
+            bytes += run->bytes;
+        }
+        return bytes;
+    }
+
+    size_t LsmTree::num_runs(u32 level) const {
+        std::shared_lock lock(theLatch);
+        return theLevels[level].size();
+    }
+
+    // the level to merge into the one below it, -1 if every level is within its size
+    int LsmTree::pick_compaction() const {
+        if (theLevels[0].size() >= LSM_L0_RUNS) {
+            return 0;
+        }
+        for (u32 level = 1; level + 1 < LSM_MAX_LEVELS; level++) {
+            if (level_bytes(level) > level_target(level)) {
+                return (int)level;
+            }
+        }
+        return -1;
+    }
+
+    bool LsmTree::work_due() const {
+        return theImmutable != nullptr || pick_compaction() >= 0;
+    }
+
+    void LsmTree::background() {
+        std::unique_lock lock(theLatch);
+        while (true) {
+            theWork.wait(lock, [&]() { return theStop || (!theBusy && work_due()); });
+            if (theStop) {
+                return;
+            }
+            theBusy = true;
+            bool flush = theImmutable != nullptr;
+            int level = flush ? -1 : pick_compaction();
+            lock.unlock();
+            if (flush) {
+                flush_immutable();
+            } else {
+                compact((u32)level);
+            }
+            lock.lock();
+            theBusy = false;
+            theIdle.notify_all();
+        }
+    }
+
+    // the memtable becomes immutable and gets a new log, the worker writes it out
+    void LsmTree::rotate_memtable() {
+        theImmutable = std::make_shared<const LsmMemtable>(std::move(theMemtable));
+        theMemtable.clear();
+        theMemtableBytes = 0;
+        open_log(theLogNumber + 1);
+        theWork.notify_one();
+    }
+
+    void LsmTree::flush_immutable() {
+        std::shared_ptr<const LsmMemtable> memtable;
+        {
+            std::shared_lock lock(theLatch);
+            memtable = theImmutable;
+        }
+        if (!memtable) {
+            return;
+        }
+        std::vector<std::shared_ptr<LsmRun>> none;
+        std::vector<std::shared_ptr<LsmRun>> runs = write_runs(none, memtable.get(), 0, false, UINT64_MAX);
+
+        std::unique_lock lock(theLatch);
+        for (auto& run : runs) {
+            theLevels[0].insert(theLevels[0].begin(), run);
+        }
+        theImmutable.reset();
+        // the logs before the memtable's own only held what was just written out
+        u64 oldest = theOldestLog;
+        theOldestLog = theLogNumber;
+        write_manifest();
+        for (u64 n = oldest; n < theLogNumber; n++) {
+            DbFile::getInstance().remove_filepath(log_path(n));
+        }
+        theFlushed.notify_all();
+    }
+
+    // Merges the runs of level that overlap the chosen ones with the overlapping runs of the
+    // level below. All of L0 goes at once since its runs overlap, otherwise the oldest run
+    void LsmTree::compact(u32 level) {
+        std::vector<std::shared_ptr<LsmRun>> inputs;
+        bool bottom = true;
+        {
+            std::shared_lock lock(theLatch);
+            if (level == 0) {
+                inputs = theLevels[0];
+            } else {
+                auto oldest = std::min_element(theLevels[level].begin(), theLevels[level].end(),
+                    [](const auto& a, const auto& b) { return a->id < b->id; });
+                inputs.push_back(*oldest);
+            }
+            string smallest = inputs[0]->smallest;
+            string largest = inputs[0]->largest;
+            for (const auto& run : inputs) {
+                smallest = std::min(smallest, run->smallest);
+                largest = std::max(largest, run->largest);
+            }
+            for (const auto& run : theLevels[level + 1]) {
+                if (run->largest >= smallest && run->smallest <= largest) {
+                    inputs.push_back(run);
+                }
+            }
+            for (u32 below = level + 2; below < LSM_MAX_LEVELS; below++) {
+                bottom = bottom && theLevels[below].empty();
+            }
+        }
+
+        std::vector<std::shared_ptr<LsmRun>> outputs = write_runs(inputs, nullptr, level + 1, bottom, LSM_RUN_BYTES);
+
+        std::unique_lock lock(theLatch);
+        for (const auto& run : inputs) {
+            auto& runs = theLevels[run->level];
+            runs.erase(std::find(runs.begin(), runs.end(), run));
+        }
+        auto& target = theLevels[level + 1];
+        target.insert(target.end(), outputs.begin(), outputs.end());
+        std::sort(target.begin(), target.end(), [](const auto& a, const auto& b) { return a->smallest < b->smallest; });
+        write_manifest();
+        for (const auto& run : inputs) {
+            DbFile::getInstance().remove_filepath(run->path);
+        }
+    }
+
+    u64 LsmTree::compact_all() {
+        std::unique_lock lock(theLatch);
+        theIdle.wait(lock, [&]() { return !theBusy; });
+        theBusy = true;
+        if (!theImmutable && !theMemtable.empty()) {
+            rotate_memtable();
+        }
+        // an immutable memtable left from before goes first, then the rest of the writes
+        for (int i = 0; i < 2 && theImmutable; i++) {
+            lock.unlock();
+            flush_immutable();
+            lock.lock();
+            if (!theMemtable.empty()) {
+                rotate_memtable();
+            }
+        }
+
+        std::vector<std::shared_ptr<LsmRun>> inputs;
+        u32 bottom = 1;
+        for (u32 level = 0; level < LSM_MAX_LEVELS; level++) {
+            inputs.insert(inputs.end(), theLevels[level].begin(), theLevels[level].end());
+            if (!theLevels[level].empty()) {
+                bottom = std::max(bottom, level);
+            }
+        }
+        lock.unlock();
+        std::vector<std::shared_ptr<LsmRun>> outputs = write_runs(inputs, nullptr, bottom, true, LSM_RUN_BYTES);
+
+        lock.lock();
+        for (auto& level : theLevels) {
+            level.clear();
+        }
+        theLevels[bottom] = outputs;
+        write_manifest();
+        for (const auto& run : inputs) {
+            DbFile::getInstance().remove_filepath(run->path);
+        }
+        theBusy = false;
+        theIdle.notify_all();
+        theWork.notify_one();
+
+        u64 live = 0;
+        for (const auto& run : outputs) {
+            live += run->entries;
+        }
+        return live;
+    }
+
+    void LsmTree::wait_idle() {
+        std::unique_lock lock(theLatch);
+        theIdle.wait(lock, [&]() { return !theBusy && !work_due(); });
+    }
+
+    void LsmTree::drop() {
+        stop_worker();
+        std::unique_lock lock(theLatch);
+        for (auto& level : theLevels) {
+            level.clear();
+        }
+        theImmutable.reset();
+        theMemtable.clear();
+        remove_files();
+    }
+
+    void LsmTree::write(const std::vector<KeyedWrite>& batch) {
+        static const std::vector<u8> none;
+        std::vector<u8> record;
+        for (const KeyedWrite& w : batch) {
+            put_entry(record, w.key, !w.value, w.value ? *w.value : none);
+        }
+
+        std::unique_lock lock(theLatch);
+        // a full memtable waits for the one before it to be written out
+        theFlushed.wait(lock, [&]() { return theMemtableBytes < LSM_MEMTABLE_BYTES || !theImmutable; });
+        if (theMemtableBytes >= LSM_MEMTABLE_BYTES) {
+            rotate_memtable();
+        }
+
+        if (DbFile::getInstance().write_at(theLogEnd, record.data(), record.size(), theLogFd) != (ssize_t)record.size()) {
+            throw std::runtime_error("Could not write " + log_path(theLogNumber));
+        }
+        theLogEnd += record.size();
+        for (const KeyedWrite& w : batch) {
+            LsmEntry& entry = theMemtable[w.key];
+            theMemtableBytes += w.key.size() + (w.value ? w.value->size() : 0);
+            entry.deleted = !w.value;
+            entry.value = w.value ? *w.value : std::vector<u8>();
+        }
+        if (theMemtableBytes >= LSM_MEMTABLE_BYTES && !theImmutable) {
+            rotate_memtable();
+        }
+    }
+
+    std::optional<std::vector<u8>> LsmTree::get(const string& key) const {
+        std::shared_lock lock(theLatch);
+        auto found = [](const LsmEntry& entry) -> std::optional<std::vector<u8>> {
+            if (entry.deleted) {
+                return std::nullopt;
+            }
+            return entry.value;
+        };
+
+        auto it = theMemtable.find(key);
+        if (it != theMemtable.end()) {
+            return found(it->second);
+        }
+        if (theImmutable) {
+            it = theImmutable->find(key);
+            if (it != theImmutable->end()) {
+                return found(it->second);
+            }
+        }
+
+        LsmEntry entry;
+        for (const auto& run : theLevels[0]) {
+            if (search_run(*run, key, entry)) {
+                return found(entry);
+            }
+        }
+        // below L0 only one run per level can hold the key
+        for (u32 level = 1; level < LSM_MAX_LEVELS; level++) {
+            const auto& runs = theLevels[level];
+            auto run = std::lower_bound(runs.begin(), runs.end(), key,
+                [](const std::shared_ptr<LsmRun>& r, const string& k) { return r->largest < k; });
+            if (run != runs.end() && search_run(**run, key, entry)) {
+                return found(entry);
+            }
+        }
+        return std::nullopt;
+    }
+
+    void LsmTree::scan(const std::optional<string>& low, const std::optional<string>& high,
+                       const std::function<bool(const string&, const std::vector<u8>&)>& visit) const {
+        std::shared_lock lock(theLatch);
+        std::vector<std::unique_ptr<LsmCursor>> cursors;
+        cursors.push_back(std::make_unique<MemtableCursor>(theMemtable, low));
+        if (theImmutable) {
+            cursors.push_back(std::make_unique<MemtableCursor>(*theImmutable, low));
+        }
+        for (const auto& level : theLevels) {
+            for (const auto& run : level) {
+                if ((low && run->largest < *low) || (high && run->smallest > *high)) {
+                    continue;
+                }
+                cursors.push_back(std::make_unique<RunCursor>(run, low));
+            }
+        }
+        merge_cursors(cursors, high, [&](const string& key, const LsmEntry& entry) {
+            return entry.deleted || visit(key, entry.value);
+        });
+    }
+}
@@ -0,0 +1,103 @@
+#include "storage-manager/Overflow.hpp"
+#include "page-manager/DbFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DB {
+    void OverflowFile::open(const string& path) {
+        DbFile& dbfile = DbFile::getInstance();
+        theFd = dbfile.get_filepath(path);
+        if (theFd == -1) {
+            theFd = dbfile.add_filepath(path);
+        }
+
+        u32 header[2];
+        if (dbfile.read_at(0, header, sizeof(header), theFd) == sizeof(header)) {
+            theNumPages = header[0];
+            theFreeHead = header[1];
+        } else {
+            theNumPages = 1;
+            theFreeHead = OVERFLOW_NULL_PAGE;
+            write_header();
+        }
+    }
+
+    void OverflowFile::write_header() {
+        u32 header[2] = {theNumPages, theFreeHead};
+        DbFile::getInstance().write_at(0, header, sizeof(header), theFd);
+    }
+
+    u32 OverflowFile::alloc_page() {
+        if (theFreeHead != OVERFLOW_NULL_PAGE) {
+            u32 page = theFreeHead;
+            DbFile::getInstance().read_at((off_t)page * OVERFLOW_PAGE_SIZE, &theFreeHead,
+                                          sizeof(u32), theFd);
+            return page;
+        }
+        return theNumPages++;
+    }
+
+    u32 OverflowFile::write_value(const string& val) {
+        DbFile& dbfile = DbFile::getInstance();
+        u8 page[OVERFLOW_PAGE_SIZE];
+
+        u32 first = alloc_page();
+        u32 current = first;
+        size_t offset = 0;
+        do {
+            u32 used = (u32)std::min(val.size() - offset, (size_t)OVERFLOW_PAGE_PAYLOAD);
+            u32 next = offset + used < val.size() ? alloc_page() : OVERFLOW_NULL_PAGE;
+
+            std::memset(page, 0, OVERFLOW_PAGE_SIZE);
+            std::memcpy(page, &next, sizeof(u32));
+            std::memcpy(page + sizeof(u32), &used, sizeof(u32));
+            std::memcpy(page + OVERFLOW_PAGE_HEADER_SIZE, val.data() + offset, used);
+            dbfile.write_at((off_t)current * OVERFLOW_PAGE_SIZE, page, OVERFLOW_PAGE_SIZE, theFd);
+
+            offset += used;
+            current = next;
+        } while (current != OVERFLOW_NULL_PAGE);
+
+        write_header();
+        return first;
+    }
+
+    string OverflowFile::read_value(u32 firstPage, u32 length) const {
+        DbFile& dbfile = DbFile::getInstance();
+        string val;
+        val.reserve(length);
+
+        u8 page[OVERFLOW_PAGE_SIZE];
+        u32 current = firstPage;
+        while (current != OVERFLOW_NULL_PAGE && val.size() < length) {
+            if (dbfile.read_at((off_t)current * OVERFLOW_PAGE_SIZE, page, OVERFLOW_PAGE_SIZE, theFd) <= 0) {
+                break;
+            }
+            u32 used;
+            std::memcpy(&current, page, sizeof(u32));
+            std::memcpy(&used, page + sizeof(u32), sizeof(u32));
+            used = std::min(used, (u32)OVERFLOW_PAGE_PAYLOAD);
+            val.append(reinterpret_cast<char*>(page + OVERFLOW_PAGE_HEADER_SIZE), used);
+        }
+        return val;
+    }
+
+    void OverflowFile::free_value(u32 firstPage) {
+        if (firstPage == OVERFLOW_NULL_PAGE) {
+            return;
+        }
+        DbFile& dbfile = DbFile::getInstance();
+
+        // walk to the tail of the chain and splice the whole chain onto the free list
+        u32 tail = firstPage;
+        u32 next;
+        while (dbfile.read_at((off_t)tail * OVERFLOW_PAGE_SIZE, &next, sizeof(u32), theFd) == sizeof(u32) &&
+               next != OVERFLOW_NULL_PAGE) {
+            tail = next;
+        }
+        dbfile.write_at((off_t)tail * OVERFLOW_PAGE_SIZE, &theFreeHead, sizeof(u32), theFd);
+        theFreeHead = firstPage;
+        write_header();
+    }
+}
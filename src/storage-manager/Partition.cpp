@@ -0,0 +1,172 @@
+#include "storage-manager/Partition.hpp"
+#include "storage-manager/Statistics.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DB {
+    string PartitionSpec::table_name(const string& parent, size_t i) const {
+        return parent + "_" + partitions[i].name;
+    }
+
+    int PartitionSpec::route(const datatype& key) const {
+        if (partitions.empty()) {
+            return -1;
+        }
+        IndexKey k = make_index_key(key, keyType);
+        if (method == PartitionMethod::HASH) {
+            return (int)(hash_index_key(k) % partitions.size());
+        }
+        for (size_t i = 0; i < partitions.size(); i++) {
+            if (!partitions[i].upper || compare_keys(k, make_index_key(*partitions[i].upper, keyType)) < 0) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    std::vector<size_t> PartitionSpec::prune(const std::optional<datatype>& low,
+                                             const std::optional<datatype>& high) const {
+        std::vector<size_t> keep;
+        if (method == PartitionMethod::HASH) {
+            // hashing scatters a range over every partition, only a single key narrows it
+            if (low && high && compare_keys(make_index_key(*low, keyType), make_index_key(*high, keyType)) == 0) {
+                return prune(std::vector<datatype>{*low});
+            }
+            for (size_t i = 0; i < partitions.size(); i++) {
+                keep.push_back(i);
+            }
+            return keep;
+        }
+
+        // partition i holds [upper of i-1, upper of i)
+        for (size_t i = 0; i < partitions.size(); i++) {
+            const std::optional<datatype>& upper = partitions[i].upper;
+            if (low && upper &&
+                compare_keys(make_index_key(*low, keyType), make_index_key(*upper, keyType)) >= 0) {
+                continue;
+            }
+            if (high && i > 0 && partitions[i - 1].upper &&
+                compare_keys(make_index_key(*high, keyType), make_index_key(*partitions[i - 1].upper, keyType)) < 0) {
+                continue;
+            }
+            keep.push_back(i);
+        }
+        return keep;
+    }
+
+    std::vector<size_t> PartitionSpec::prune(const std::vector<datatype>& keys) const {
+        std::vector<size_t> keep;
+        for (const datatype& key : keys) {
+            int i = route(key);
+            if (i >= 0) {
+                keep.push_back((size_t)i);
+            }
+        }
+        std::sort(keep.begin(), keep.end());
+        keep.erase(std::unique(keep.begin(), keep.end()), keep.end());
+        return keep;
+    }
+
+    static void put(std::vector<u8>& out, const void* data, size_t size) {
+        const u8* bytes = static_cast<const u8*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    static void put_string(std::vector<u8>& out, const string& s) {
+        u16 len = (u16)s.size();
+        put(out, &len, sizeof(len));
+        put(out, s.data(), len);
+    }
+
+    template <typename T>
+    static bool get(const u8* data, size_t size, size_t& offset, T& out) {
+        if (offset + sizeof(T) > size) {
+            return false;
+        }
+        std::memcpy(&out, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    static bool get_string(const u8* data, size_t size, size_t& offset, string& out) {
+        u16 len;
+        if (!get(data, size, offset, len) || offset + len > size) {
+            return false;
+        }
+        out.assign(reinterpret_cast<const char*>(data + offset), len);
+        offset += len;
+        return true;
+    }
+
+    // [method u8][key type u8][column][num partitions u16] then [name][has bound u8][bound]
+    // per partition, [num indexes u16] then [name][column][type u8][unique u8] per index
+    void PartitionSpec::serialize(std::vector<u8>& out) const {
+        u8 m = (u8)method;
+        u8 type = (u8)keyType;
+        put(out, &m, sizeof(m));
+        put(out, &type, sizeof(type));
+        put_string(out, column);
+        u16 count = (u16)partitions.size();
+        put(out, &count, sizeof(count));
+        for (const PartitionDef& p : partitions) {
+            put_string(out, p.name);
+            u8 hasBound = p.upper ? 1 : 0;
+            put(out, &hasBound, sizeof(hasBound));
+            if (p.upper) {
+                serialize_value(out, *p.upper);
+            }
+        }
+        u16 numIndexes = (u16)indexes.size();
+        put(out, &numIndexes, sizeof(numIndexes));
+        for (const IndexDef& def : indexes) {
+            put_string(out, def.name);
+            put_string(out, def.column);
+            u8 indexType = (u8)def.type;
+            u8 unique = def.unique ? 1 : 0;
+            put(out, &indexType, sizeof(indexType));
+            put(out, &unique, sizeof(unique));
+        }
+    }
+
+    size_t PartitionSpec::deserialize(const u8* data, size_t size) {
+        size_t offset = 0;
+        u8 m, type;
+        u16 count;
+        if (!get(data, size, offset, m) || !get(data, size, offset, type) ||
+            !get_string(data, size, offset, column) || !get(data, size, offset, count)) {
+            return 0;
+        }
+        method = (PartitionMethod)m;
+        keyType = (ColumnType)type;
+        partitions.assign(count, PartitionDef{});
+        for (PartitionDef& p : partitions) {
+            u8 hasBound;
+            if (!get_string(data, size, offset, p.name) || !get(data, size, offset, hasBound)) {
+                return 0;
+            }
+            if (hasBound) {
+                datatype bound;
+                if (!deserialize_value(data, size, offset, bound)) {
+                    return 0;
+                }
+                p.upper = bound;
+            }
+        }
+        u16 numIndexes;
+        if (!get(data, size, offset, numIndexes)) {
+            return 0;
+        }
+        indexes.assign(numIndexes, IndexDef{});
+        for (IndexDef& def : indexes) {
+            u8 indexType, unique;
+            if (!get_string(data, size, offset, def.name) || !get_string(data, size, offset, def.column) ||
+                !get(data, size, offset, indexType) || !get(data, size, offset, unique)) {
+                return 0;
+            }
+            def.type = (IndexType)indexType;
+            def.unique = unique != 0;
+        }
+        return offset;
+    }
+}
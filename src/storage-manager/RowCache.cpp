@@ -0,0 +1,131 @@
+#include "storage-manager/RowCache.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#define ROW_CACHE_MAX_COUNT 15 // counters saturate like 4 bit ones
+
+namespace DB {
+    // splitmix64 finalizer, row ids of one page differ in a few low bits only
+    static u64 mix(u64 x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // the shard is picked by the top bits so the sketch indices below use the others
+    static size_t shard_index(u64 hash) {
+        return (hash >> 56) % ROW_CACHE_SHARDS;
+    }
+
+    static u64 sketch_index(u64 hash, u32 row, u64 mask) {
+        u64 step = (hash >> 32) | 1;
+        return row * (mask + 1) + ((hash + row * step) & mask);
+    }
+
+    void RowCache::Shard::count(u64 hash, u64 resetAfter) {
+        for (u32 row = 0; row < ROW_CACHE_SKETCH_DEPTH; row++) {
+            u8& counter = sketch[sketch_index(hash, row, sketchMask)];
+            if (counter < ROW_CACHE_MAX_COUNT) {
+                counter++;
+            }
+        }
+        if (++samples >= resetAfter) {
+            for (u8& counter : sketch) {
+                counter >>= 1;
+            }
+            samples = 0;
+        }
+    }
+
+    u8 RowCache::Shard::frequency(u64 hash) const {
+        u8 freq = ROW_CACHE_MAX_COUNT;
+        for (u32 row = 0; row < ROW_CACHE_SKETCH_DEPTH; row++) {
+            freq = std::min(freq, sketch[sketch_index(hash, row, sketchMask)]);
+        }
+        return freq;
+    }
+
+    RowCache::RowCache(size_t capacity) :
+        theShardCapacity(std::max<size_t>(1, capacity / ROW_CACHE_SHARDS)),
+        theShards(new Shard[ROW_CACHE_SHARDS])
+        {
+            // about four counters a cached row keeps collisions rare
+            u64 width = std::bit_ceil<u64>(std::max<u64>(64, theShardCapacity * 4));
+            for (size_t i = 0; i < ROW_CACHE_SHARDS; i++) {
+                theShards[i].sketch.assign(width * ROW_CACHE_SKETCH_DEPTH, 0);
+                theShards[i].sketchMask = width - 1;
+            }
+        }
+
+    Row* RowCache::get(const RowId& rid, QueryArena* arena) {
+        u64 key = row_key(rid);
+        u64 hash = mix(key);
+        Shard& s = theShards[shard_index(hash)];
+        std::lock_guard lock(s.lock);
+        s.count(hash, theShardCapacity * ROW_CACHE_SAMPLE_FACTOR);
+
+        auto it = s.map.find(key);
+        if (it == s.map.end()) {
+            theMisses.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        theHits.fetch_add(1, std::memory_order_relaxed);
+
+        const Entry& entry = *it->second;
+        RowValues values = make_row_values(arena, entry.values.size());
+        values.assign(entry.values.begin(), entry.values.end());
+        Row* row = create_row(arena, entry.numCols, std::move(values));
+        row->id = rid;
+        return row;
+    }
+
+    void RowCache::put(const RowId& rid, const Row& row) {
+        u64 key = row_key(rid);
+        u64 hash = mix(key);
+        Shard& s = theShards[shard_index(hash)];
+        std::lock_guard lock(s.lock);
+
+        auto it = s.map.find(key);
+        if (it != s.map.end()) {
+            it->second->numCols = row.numCols;
+            it->second->values.assign(row.values.begin(), row.values.end());
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            return;
+        }
+        if (s.lru.size() >= theShardCapacity) {
+            // TinyLFU, the newcomer has to be wanted more than the row it replaces
+            const Entry& victim = s.lru.back();
+            if (s.frequency(hash) <= s.frequency(mix(victim.key))) {
+                return;
+            }
+            s.map.erase(victim.key);
+            s.lru.pop_back();
+        }
+        s.lru.push_front({key, row.numCols, std::vector<datatype>(row.values.begin(), row.values.end())});
+        s.map[key] = s.lru.begin();
+    }
+
+    void RowCache::invalidate(const RowId& rid) {
+        u64 key = row_key(rid);
+        Shard& s = theShards[shard_index(mix(key))];
+        std::lock_guard lock(s.lock);
+        auto it = s.map.find(key);
+        if (it != s.map.end()) {
+            s.lru.erase(it->second);
+            s.map.erase(it);
+        }
+    }
+
+    void RowCache::clear() {
+        for (size_t i = 0; i < ROW_CACHE_SHARDS; i++) {
+            std::lock_guard lock(theShards[i].lock);
+            theShards[i].lru.clear();
+            theShards[i].map.clear();
+        }
+    }
+}
@@ -0,0 +1,363 @@
+#include "storage-manager/Statistics.hpp"
+#include "storage-manager/HeapFile.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+
+namespace DB {
+    // FNV-1a over the value's bytes, finished with a 64 bit mixer so every bit
+    // of the hash depends on every byte of the value
+    static u64 hash_value(const datatype& val) {
+        u64 h = 14695981039346656037ULL ^ val.index();
+        auto mix_bytes = [&](const void* data, size_t size) {
+            const u8* bytes = static_cast<const u8*>(data);
+            for (size_t i = 0; i < size; i++) {
+                h = (h ^ bytes[i]) * 1099511628211ULL;
+            }
+        };
+        val.visit([&](auto&& v) {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                mix_bytes(v.data(), v.size());
+            } else {
+                mix_bytes(&v, sizeof(T));
+            }
+        });
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    HyperLogLog::HyperLogLog() : theRegisters(HLL_REGISTERS, 0) {}
+
+    void HyperLogLog::add(const datatype& val) {
+        u64 h = hash_value(val);
+        u32 reg = (u32)(h >> (64 - HLL_PRECISION));
+        u64 rest = h << HLL_PRECISION;
+        u8 rank = rest == 0 ? (u8)(64 - HLL_PRECISION + 1) : (u8)(std::countl_zero(rest) + 1);
+        if (rank > theRegisters[reg]) {
+            theRegisters[reg] = rank;
+        }
+    }
+
+    void HyperLogLog::merge(const HyperLogLog& other) {
+        for (size_t i = 0; i < theRegisters.size(); i++) {
+            theRegisters[i] = std::max(theRegisters[i], other.theRegisters[i]);
+        }
+    }
+
+    double HyperLogLog::estimate() const {
+        const double m = HLL_REGISTERS;
+        double sum = 0;
+        u32 zeros = 0;
+        for (u8 reg : theRegisters) {
+            sum += std::ldexp(1.0, -reg);
+            zeros += reg == 0;
+        }
+        double alpha = 0.7213 / (1 + 1.079 / m);
+        double e = alpha * m * m / sum;
+        if (e <= 2.5 * m && zeros > 0) {
+            e = m * std::log(m / zeros); // linear counting is better while registers are empty
+        }
+        return e;
+    }
+
+    double ColumnStats::distinct() const {
+        return std::max(ndv, sketch.estimate());
+    }
+
+    void TableStats::observe_insert(const Row* row) {
+        row_count++;
+        modified++;
+        for (size_t col = 0; col < columns.size() && col < row->values.size(); col++) {
+            columns[col].sketch.add(row->values[col]);
+        }
+    }
+
+    void TableStats::observe_change(u64 rows, bool deleted) {
+        modified += rows;
+        if (deleted) {
+            row_count -= std::min(row_count, rows);
+        }
+    }
+
+    bool TableStats::stale() const {
+        return modified > ANALYZE_THRESHOLD_ROWS + ANALYZE_THRESHOLD_FRACTION * row_count;
+    }
+
+    static void put(std::vector<u8>& out, const void* data, size_t size) {
+        const u8* bytes = static_cast<const u8*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    // [variant index u8] then the value, strings as [len u32][bytes]
+    void serialize_value(std::vector<u8>& out, const datatype& val) {
+        u8 tag = (u8)val.index();
+        put(out, &tag, sizeof(tag));
+        val.visit([&](auto&& v) {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                u32 len = (u32)v.size();
+                put(out, &len, sizeof(len));
+                put(out, v.data(), len);
+            } else {
+                put(out, &v, sizeof(T));
+            }
+        });
+    }
+
+    template <typename T>
+    static bool get(const u8* data, size_t size, size_t& offset, T& out) {
+        if (offset + sizeof(T) > size) {
+            return false;
+        }
+        std::memcpy(&out, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    template <typename T>
+    static bool get_as(const u8* data, size_t size, size_t& offset, datatype& out) {
+        T v;
+        if (!get(data, size, offset, v)) {
+            return false;
+        }
+        out = v;
+        return true;
+    }
+
+    bool deserialize_value(const u8* data, size_t size, size_t& offset, datatype& out) {
+        u8 tag;
+        if (!get(data, size, offset, tag)) {
+            return false;
+        }
+        switch (tag) {
+            case 0: return get_as<int>(data, size, offset, out);
+            case 1: return get_as<float>(data, size, offset, out);
+            case 2: {
+                u32 len;
+                if (!get(data, size, offset, len) || offset + len > size) {
+                    return false;
+                }
+                out = string(reinterpret_cast<const char*>(data + offset), len);
+                offset += len;
+                return true;
+            }
+            case 3: return get_as<bool>(data, size, offset, out);
+            case 4: return get_as<int64_t>(data, size, offset, out);
+            case 5: return get_as<double>(data, size, offset, out);
+        }
+        return false;
+    }
+
+    // [row count][page count][sampled pages][sampled rows][modified] as u64, [num columns u16],
+    // then per column [null frac f64][ndv f64][num mcv u16] [value][freq f64] per mcv,
+    // [num bounds u16] [value] per bound, [HLL_REGISTERS registers]
+    void TableStats::serialize(std::vector<u8>& out) const {
+        put(out, &row_count, sizeof(row_count));
+        put(out, &page_count, sizeof(page_count));
+        put(out, &sampled_pages, sizeof(sampled_pages));
+        put(out, &sampled_rows, sizeof(sampled_rows));
+        put(out, &modified, sizeof(modified));
+        u16 numCols = (u16)columns.size();
+        put(out, &numCols, sizeof(numCols));
+        for (const ColumnStats& col : columns) {
+            put(out, &col.null_frac, sizeof(col.null_frac));
+            put(out, &col.ndv, sizeof(col.ndv));
+            u16 numMcv = (u16)col.mcv.size();
+            put(out, &numMcv, sizeof(numMcv));
+            for (size_t i = 0; i < col.mcv.size(); i++) {
+                serialize_value(out, col.mcv[i]);
+                put(out, &col.mcv_freq[i], sizeof(double));
+            }
+            u16 numBounds = (u16)col.histogram.size();
+            put(out, &numBounds, sizeof(numBounds));
+            for (const datatype& bound : col.histogram) {
+                serialize_value(out, bound);
+            }
+            put(out, col.sketch.registers().data(), HLL_REGISTERS);
+        }
+    }
+
+    size_t TableStats::deserialize(const u8* data, size_t size) {
+        size_t offset = 0;
+        u16 numCols;
+        if (!get(data, size, offset, row_count) || !get(data, size, offset, page_count) ||
+            !get(data, size, offset, sampled_pages) || !get(data, size, offset, sampled_rows) ||
+            !get(data, size, offset, modified) || !get(data, size, offset, numCols)) {
+            return 0;
+        }
+        columns.assign(numCols, ColumnStats{});
+        for (ColumnStats& col : columns) {
+            u16 numMcv;
+            if (!get(data, size, offset, col.null_frac) || !get(data, size, offset, col.ndv) ||
+                !get(data, size, offset, numMcv)) {
+                return 0;
+            }
+            col.mcv.resize(numMcv);
+            col.mcv_freq.resize(numMcv);
+            for (u16 i = 0; i < numMcv; i++) {
+                if (!deserialize_value(data, size, offset, col.mcv[i]) || !get(data, size, offset, col.mcv_freq[i])) {
+                    return 0;
+                }
+            }
+            u16 numBounds;
+            if (!get(data, size, offset, numBounds)) {
+                return 0;
+            }
+            col.histogram.resize(numBounds);
+            for (u16 i = 0; i < numBounds; i++) {
+                if (!deserialize_value(data, size, offset, col.histogram[i])) {
+                    return 0;
+                }
+            }
+            if (offset + HLL_REGISTERS > size) {
+                return 0;
+            }
+            std::memcpy(col.sketch.registers().data(), data + offset, HLL_REGISTERS);
+            offset += HLL_REGISTERS;
+        }
+        return offset;
+    }
+
+    static void analyze_column(ColumnStats& stats, const std::vector<Row*>& rows, size_t col,
+                               u64 tableRows, bool wholeTable) {
+        std::map<datatype, u64> counts;
+        u64 nulls = 0;
+        for (Row* row : rows) {
+            if (col >= row->numCols || col >= row->values.size()) {
+                nulls++;
+                continue;
+            }
+            counts[row->values[col]]++;
+            stats.sketch.add(row->values[col]);
+        }
+        u64 sampled = rows.size();
+        u64 nonNull = sampled - nulls;
+        stats.null_frac = sampled == 0 ? 0 : (double)nulls / sampled;
+        if (nonNull == 0) {
+            return;
+        }
+
+        // distinct values: exact when every row was read, otherwise the Haas-Stokes
+        // (Duj1) estimator, which scales up by how many sampled values were seen once
+        double d = (double)counts.size();
+        if (wholeTable) {
+            stats.ndv = d;
+        } else {
+            double n = (double)nonNull;
+            double total = std::max(n, (1 - stats.null_frac) * tableRows);
+            double f1 = 0;
+            for (auto& [val, count] : counts) {
+                f1 += count == 1;
+            }
+            stats.ndv = std::clamp(n * d / (n - f1 + f1 * n / total), d, total);
+        }
+
+        // most common values: everything when there are few, otherwise the values
+        // that are clearly more common than average
+        std::vector<std::pair<u64, const datatype*>> byCount;
+        for (auto& [val, count] : counts) {
+            byCount.push_back({count, &val});
+        }
+        std::stable_sort(byCount.begin(), byCount.end(),
+                         [](auto& a, auto& b) { return a.first > b.first; });
+        double average = (double)nonNull / counts.size();
+        bool keepAll = wholeTable && counts.size() <= STATS_MCV_COUNT;
+        std::map<datatype, u64> rest = counts;
+        for (auto& [count, val] : byCount) {
+            if (stats.mcv.size() >= STATS_MCV_COUNT || (!keepAll && (count < 2 || count <= 1.25 * average))) {
+                break;
+            }
+            stats.mcv.push_back(*val);
+            stats.mcv_freq.push_back((double)count / sampled);
+            rest.erase(*val);
+        }
+
+        // equi-depth bounds over the rest, bucket i ends at the i/B quantile
+        u64 remaining = 0;
+        for (auto& [val, count] : rest) {
+            remaining += count;
+        }
+        if (rest.size() < 2) {
+            return;
+        }
+        u64 buckets = std::min<u64>(STATS_HISTOGRAM_BUCKETS, remaining - 1);
+        auto it = rest.begin();
+        u64 seen = it->second; // rows up to and including it
+        stats.histogram.push_back(it->first);
+        for (u64 b = 1; b <= buckets; b++) {
+            u64 target = b * (remaining - 1) / buckets + 1;
+            while (seen < target) {
+                ++it;
+                seen += it->second;
+            }
+            if (!(it->first == stats.histogram.back())) {
+                stats.histogram.push_back(it->first);
+            }
+        }
+    }
+
+    TableStats analyze_heap(HeapFile* heapfile, const Schema& schema, u32 samplePages) {
+        TableStats stats;
+        stats.columns.resize(schema.columns.size());
+        if (heapfile == NULL) {
+            return stats;
+        }
+
+        // live pages and rows come from the free space map, no page has to be read
+        std::vector<u32> live;
+        {
+            std::shared_lock lock(heapfile->latch);
+            stats.page_count = heapfile->metadata.num_pages;
+            for (u32 page = 1; page <= heapfile->metadata.num_pages; page++) {
+                if (heapfile->free_slots[page] < SLOTS_PER_PAGE) {
+                    live.push_back(page);
+                    stats.row_count += SLOTS_PER_PAGE - heapfile->free_slots[page];
+                }
+            }
+        }
+
+        bool wholeTable = live.size() <= samplePages;
+        if (!wholeTable) {
+            // partial Fisher-Yates, the first samplePages entries are a uniform pick
+            std::mt19937_64 rng(std::random_device{}());
+            for (u32 i = 0; i < samplePages; i++) {
+                std::swap(live[i], live[i + rng() % (live.size() - i)]);
+            }
+            live.resize(samplePages);
+            std::sort(live.begin(), live.end());
+        }
+
+        HeapScanOptions opts;
+        opts.pages = live;
+        QueryArena arena;
+        std::vector<Row*> rows = scan_heap(heapfile, &arena, &opts);
+        stats.sampled_pages = live.size();
+        stats.sampled_rows = rows.size();
+
+        for (size_t col = 0; col < stats.columns.size(); col++) {
+            analyze_column(stats.columns[col], rows, col, stats.row_count, wholeTable);
+        }
+        return stats;
+    }
+
+    TableStats analyze_rows(const std::vector<Row*>& rows, const Schema& schema) {
+        TableStats stats;
+        stats.columns.resize(schema.columns.size());
+        stats.row_count = rows.size();
+        stats.sampled_rows = rows.size();
+        for (size_t col = 0; col < stats.columns.size(); col++) {
+            analyze_column(stats.columns[col], rows, col, stats.row_count, true);
+        }
+        return stats;
+    }
+}
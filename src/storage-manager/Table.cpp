@@ -1,10 +1,34 @@
 #include "storage-manager/Table.hpp"
+#include "storage-manager/LsmTree.hpp"
+#include "storage-manager/ClusteredTree.hpp"
 #include "page-manager/DbFile.hpp"
 
 #include <sys/fcntl.h>
+#include <algorithm>
 #include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
 
 namespace DB {
+    const char* engine_name(TableEngine engine) {
+        switch (engine) {
+            case TableEngine::LSM: return "LSM";
+            case TableEngine::CLUSTERED: return "clustered";
+            default: return "heap";
+        }
+    }
+
+    std::unique_ptr<KeyedStore> make_keyed_store(const string& name, TableEngine engine, bool create) {
+        if (engine == TableEngine::LSM) {
+            return std::make_unique<LsmTree>(name, create);
+        }
+        if (engine == TableEngine::CLUSTERED) {
+            return std::make_unique<ClusteredTree>(name, create);
+        }
+        throw std::runtime_error("Heap tables have no keyed store: " + name);
+    }
+
     Table::Table(const string& name,
             Schema& schema,
             HeapFile& heapfile,
@@ -15,144 +39,659 @@ namespace DB {
         theSchema(schema),
         theHeapFile(&heapfile),
         thePageCache(pageCache)
+        {
+            create_key_indexes();
+        }
+
+    Table::Table(const string& name,
+            Schema& schema,
+            HeapFile& heapfile,
+            const std::vector<IndexDef>& indexes
+            ) :
+        theFileName(name),
+        thePath("db/table/"+name),
+        theSchema(schema),
+        theHeapFile(&heapfile),
+        thePageCache(nullptr)
+        {
+            for (const IndexDef& def : indexes) {
+                int col = column_index(def.column);
+                std::unique_ptr<Index> impl = make_index(def.name, col, def.type);
+                if (!impl->open()) {
+                    std::vector<IndexEntry> entries;
+                    QueryArena arena;
+                    for (Row* row : scan(&arena)) {
+                        entries.push_back({make_index_key(row->values[col], theSchema.columns[col].type), row->id});
+                    }
+                    impl->bulk_build(entries);
+                }
+
+                auto index = std::make_unique<TableIndex>();
+                index->name = def.name;
+                index->column = col;
+                index->type = def.type;
+                index->unique = def.unique;
+                index->impl = std::move(impl);
+                theIndexes.push_back(std::move(index));
+            }
+        }
+
+    Table::Table(const string& name, Schema& schema) :
+        theFileName(name),
+        thePath("db/table/"+name),
+        theSchema(schema),
+        theHeapFile(nullptr),
+        thePageCache(nullptr)
         {}
 
-    std::vector<Row*> Table::scan() const {
+    Table::Table(const string& name, Schema& schema, TableEngine engine, std::unique_ptr<KeyedStore> store) :
+        theFileName(name),
+        thePath("db/table/"+name),
+        theSchema(schema),
+        theHeapFile(nullptr),
+        thePageCache(nullptr),
+        theEngine(engine),
+        theStore(std::move(store))
+        {
+            for (size_t i = 0; i < theSchema.columns.size(); i++) {
+                if (theSchema.columns[i].is_primary_key) {
+                    theKeyColumn = static_cast<int>(i);
+                }
+            }
+            if (theKeyColumn < 0) {
+                throw std::runtime_error(string(engine_name(engine)) + " table " + name + " needs a PRIMARY KEY");
+            }
+        }
+
+    std::vector<Row*> Table::scan(QueryArena* arena, const HeapScanOptions* opts) const {
+        if (theStore) {
+            return store_scan(arena, opts);
+        }
         if (theHeapFile != nullptr) {
-            return scan_heap(theHeapFile);
+            return scan_heap(theHeapFile, arena, opts);
         }
         return std::vector<Row*>();
     }
 
-    RowId Table::insert_row() {
-        RowId rid;
-        rid.pageId.heapId = 0;
-        rid.pageId.page_num = 0;
-        rid.record_num = 0;
-        return rid;
+    std::vector<Row*> Table::scan_next(TableCursor& cursor, size_t maxRows, QueryArena* arena,
+                                       const HeapScanOptions* opts) const {
+        if (theStore) {
+            return store_scan(arena, opts, &cursor, maxRows);
+        }
+        if (theHeapFile != nullptr) {
+            return scan_heap_next(theHeapFile, cursor.heap, maxRows, arena, opts);
+        }
+        return std::vector<Row*>();
     }
 
-    RowId Table::insert_row(Row* row) {
-        RowId rid = {};
-        rid.pageId.heapId = 0;
-        rid.pageId.page_num = 0;
-        rid.record_num = 0;
+    static string key_string(const datatype& val) {
+        std::ostringstream out;
+        val.visit([&](auto&& v) {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                out << "'" << v << "'";
+            } else {
+                out << v;
+            }
+        });
+        return out.str();
+    }
 
-        if (theHeapFile == nullptr || row == nullptr) {
-            return rid;
+    // numeric keys are the first 8 bytes of their index key, which compare as
+    // bytes in value order, strings are their own bytes
+    string Table::store_key(const datatype& val) const {
+        ColumnType type = theSchema.columns[theKeyColumn].type;
+        if (type == ColumnType::STRING) {
+            return val.holds<string>() ? string(val.get<string>()) : string();
         }
+        IndexKey key = make_index_key(val, type);
+        return string(reinterpret_cast<const char*>(key.bytes), sizeof(u64));
+    }
 
-        DbFile& dbfile = DbFile::getInstance();
-        string filepath = "database-files/heapfiles/" + theFileName + ".db";
+    // [num values u16] then every value as serialize_value writes it
+    static std::vector<u8> store_value(const Row* row) {
+        std::vector<u8> out;
+        u16 count = static_cast<u16>(row->values.size());
+        out.insert(out.end(), reinterpret_cast<const u8*>(&count), reinterpret_cast<const u8*>(&count) + sizeof(count));
+        for (const datatype& val : row->values) {
+            serialize_value(out, val);
+        }
+        return out;
+    }
+
+    Row* Table::stored_row(const std::vector<u8>& value, QueryArena* arena) const {
+        u16 count;
+        if (value.size() < sizeof(count)) {
+            throw std::runtime_error("Malformed row in table " + theFileName);
+        }
+        std::memcpy(&count, value.data(), sizeof(count));
+        size_t offset = sizeof(count);
+        RowValues values = make_row_values(arena, count);
+        for (u16 i = 0; i < count; i++) {
+            datatype val;
+            if (!deserialize_value(value.data(), value.size(), offset, val)) {
+                throw std::runtime_error("Malformed row in table " + theFileName);
+            }
+            values.push_back(std::move(val));
+        }
+        return create_row(arena, count, std::move(values));
+    }
+
+    // ranges on the key bound the scan, an equal low and high is a single get.
+    // String predicates are applied here since the filter hands them over
+    // a cursor picks up after the last key it returned
+    std::vector<Row*> Table::store_scan(QueryArena* arena, const HeapScanOptions* opts,
+                                        TableCursor* cursor, size_t maxRows) const {
+        std::vector<Row*> rows;
+        if (cursor != nullptr && cursor->done) {
+            return rows;
+        }
+
+        std::optional<string> low, high;
+        if (opts != nullptr) {
+            for (const ZoneRange& range : opts->ranges) {
+                if (range.col != theKeyColumn) {
+                    continue;
+                }
+                if (range.low) {
+                    string key = store_key(*range.low);
+                    if (!low || key > *low) low = key;
+                }
+                if (range.high) {
+                    string key = store_key(*range.high);
+                    if (!high || key < *high) high = key;
+                }
+            }
+        }
+        const std::optional<string>* after = cursor != nullptr ? &cursor->after : nullptr;
+        if (after != nullptr && *after && (!low || **after > *low)) {
+            low = **after;
+        }
+
+        bool stopped = false;
+        auto visit = [&](const string& key, const std::vector<u8>& value) {
+            if (after != nullptr && *after && key == **after) {
+                return true;
+            }
+            if (rows.size() >= maxRows) {
+                stopped = true;
+                return false;
+            }
+            if (cursor != nullptr) {
+                cursor->after = key;
+            }
+            Row* row = stored_row(value, arena);
+            if (opts != nullptr) {
+                for (const StringPredicate& pred : opts->predicates) {
+                    const datatype& val = row->values[pred.col];
+                    bool found = val.holds<string>() &&
+                                 std::find(pred.values.begin(), pred.values.end(), val.get<string>()) != pred.values.end();
+                    if (found == pred.negate) {
+                        if (arena == nullptr) delete row;
+                        return true;
+                    }
+                }
+            }
+            rows.push_back(row);
+            return true;
+        };
+
+        if (low && high && *low > *high) {
+            // nothing in range
+        } else if (low && high && *low == *high) {
+            std::optional<std::vector<u8>> value = theStore->get(*low);
+            if (value) {
+                visit(*low, *value);
+            }
+        } else {
+            theStore->scan(low, high, visit);
+        }
+        if (cursor != nullptr && !stopped) {
+            cursor->done = true;
+        }
+        return rows;
+    }
+
+    Row* Table::find_row(const datatype& key, QueryArena* arena) const {
+        if (theStore) {
+            std::optional<std::vector<u8>> value = theStore->get(store_key(key));
+            return value ? stored_row(*value, arena) : nullptr;
+        }
+        for (auto& index : theIndexes) {
+            if (!index->unique || !theSchema.columns[index->column].is_primary_key) {
+                continue;
+            }
+            for (const RowId& rid : index->impl->lookup(make_index_key(key, theSchema.columns[index->column].type))) {
+                Row* row = get_row(theHeapFile, rid, arena);
+                if (row != nullptr && row->values[index->column] == key) {
+                    return row;
+                }
+            }
+            return nullptr;
+        }
+        // no primary key index, the heap has to be read
+        for (Row* row : scan(arena)) {
+            for (size_t col = 0; col < theSchema.columns.size(); col++) {
+                if (theSchema.columns[col].is_primary_key && row->values[col] == key) {
+                    return row;
+                }
+            }
+        }
+        return nullptr;
+    }
 
-        u32 page_num = 1;  // Start from page 1 (page 0 is metadata)
+    // the key is the row's only unique column, every key in rows must be new
+    // unless it belongs to a row in replacing, which is being rewritten
+    void Table::store_check_unique(const std::vector<Row*>& rows, const std::vector<Row*>& replacing) const {
+        std::unordered_set<string> replaced;
+        for (Row* row : replacing) {
+            replaced.insert(store_key(row->values[theKeyColumn]));
+        }
+        std::unordered_set<string> seen;
+        for (Row* row : rows) {
+            const datatype& val = row->values[theKeyColumn];
+            string key = store_key(val);
+            if (!seen.insert(key).second || (!replaced.count(key) && theStore->get(key))) {
+                throw std::runtime_error("Duplicate key violates unique constraint " + theFileName + "_pkey: " +
+                                         theSchema.columns[theKeyColumn].name + " = " + key_string(val));
+            }
+        }
+    }
+
+    // pages of every index go through one cache
+    static PageCache& index_page_cache() {
+        static PageCache cache(INDEX_CACHE_PAGES);
+        return cache;
+    }
 
-        // Check if page is in cache first
+    size_t Table::update_rows(const std::vector<Row*>& oldRows, const std::vector<Row*>& newRows) {
+        if (theStore) {
+            store_check_unique(newRows, oldRows);
+            // a row whose key changed leaves a tombstone behind, written first
+            // so a new row taking over that key isn't deleted with it
+            std::vector<KeyedWrite> batch;
+            for (size_t i = 0; i < oldRows.size(); i++) {
+                string oldKey = store_key(oldRows[i]->values[theKeyColumn]);
+                if (oldKey != store_key(newRows[i]->values[theKeyColumn])) {
+                    batch.push_back({oldKey, std::nullopt});
+                }
+            }
+            for (size_t i = 0; i < oldRows.size(); i++) {
+                batch.push_back({store_key(newRows[i]->values[theKeyColumn]), store_value(newRows[i])});
+            }
+            theStore->write(batch);
+            if (theStats) {
+                theStats->observe_change(oldRows.size(), false);
+            }
+            return oldRows.size();
+        }
+        if (theHeapFile == nullptr) {
+            return 0;
+        }
+        std::vector<RowId> rids;
+        rids.reserve(oldRows.size());
+        for (Row* row : oldRows) {
+            rids.push_back(row->id);
+        }
+        check_unique(newRows, rids);
+        // rows deleted since they were read are skipped, only the rest change
+        std::vector<size_t> applied = DB::update_rows(theHeapFile, rids, newRows);
+        if (theStats) {
+            theStats->observe_change(applied.size(), false);
+            for (size_t i : applied) {
+                for (size_t col = 0; col < theStats->columns.size() && col < newRows[i]->values.size(); col++) {
+                    theStats->columns[col].sketch.add(newRows[i]->values[col]);
+                }
+            }
+        }
+
+        // rows keep their id, so only indexes on changed columns need new entries
+        for (auto& index : theIndexes) {
+            ColumnType type = theSchema.columns[index->column].type;
+            for (size_t i : applied) {
+                const datatype& oldVal = oldRows[i]->values[index->column];
+                const datatype& newVal = newRows[i]->values[index->column];
+                if (oldVal == newVal) {
+                    continue;
+                }
+                index->impl->remove(make_index_key(oldVal, type), rids[i]);
+                index->impl->insert(make_index_key(newVal, type), rids[i]);
+            }
+        }
+        return applied.size();
+    }
+
+    size_t Table::delete_rows(const std::vector<Row*>& rows) {
+        if (theStore) {
+            std::vector<KeyedWrite> batch;
+            batch.reserve(rows.size());
+            for (Row* row : rows) {
+                batch.push_back({store_key(row->values[theKeyColumn]), std::nullopt});
+            }
+            theStore->write(batch);
+            if (theStats) {
+                theStats->observe_change(rows.size(), true);
+            }
+            return rows.size();
+        }
+        if (theHeapFile == nullptr) {
+            return 0;
+        }
+        std::vector<RowId> rids;
+        rids.reserve(rows.size());
+        for (Row* row : rows) {
+            rids.push_back(row->id);
+        }
+        size_t deleted = DB::delete_rows(theHeapFile, rids);
+        if (theStats) {
+            theStats->observe_change(deleted, true);
+        }
+
+        for (auto& index : theIndexes) {
+            ColumnType type = theSchema.columns[index->column].type;
+            for (Row* row : rows) {
+                index->impl->remove(make_index_key(row->values[index->column], type), row->id);
+            }
+        }
+        return deleted;
+    }
+
+    VacuumStats Table::vacuum() {
+        if (theStore) {
+            // compaction is what reclaims the space of overwritten and deleted rows
+            VacuumStats stats = {};
+            stats.rows_moved = theStore->compact_all();
+            return stats;
+        }
+        VacuumOptions opts;
+        if (!theIndexes.empty()) {
+            opts.on_move = [this](const Row& row, const RowId& from, const RowId& to) {
+                for (auto& index : theIndexes) {
+                    IndexKey key = make_index_key(row.values[index->column],
+                                                  theSchema.columns[index->column].type);
+                    index->impl->remove(key, from);
+                    index->impl->insert(key, to);
+                }
+            };
+        }
+        return vacuum_heap(theHeapFile, opts);
+    }
+
+    int Table::column_index(const string& column) const {
+        int col = -1;
+        for (size_t i = 0; i < theSchema.columns.size(); i++) {
+            if (theSchema.columns[i].name == column) {
+                col = static_cast<int>(i);
+            }
+        }
+        if (col < 0) {
+            throw std::runtime_error("Column not found: " + column);
+        }
+        return col;
+    }
+
+    static string index_path(const string& name, IndexType type) {
+        const char* ext = type == IndexType::HASH ? ".hidx" : type == IndexType::BITMAP ? ".bmp" : ".idx";
+        return "database-files/indexes/" + name + ext;
+    }
+
+    std::unique_ptr<Index> Table::make_index(const string& name, int column, IndexType type) {
+        ColumnType keyType = theSchema.columns[column].type;
+        string path = index_path(name, type);
+        if (type == IndexType::HASH) {
+            return std::make_unique<HashIndex>(path, keyType, index_page_cache());
+        } else if (type == IndexType::BITMAP) {
+            return std::make_unique<BitmapIndex>(path, keyType);
+        }
+        return std::make_unique<BPlusTree>(path, keyType, index_page_cache());
+    }
+
+    void Table::drop() {
+        DbFile& dbfile = DbFile::getInstance();
+        for (auto& index : theIndexes) {
+            string path = index_path(index->name, index->type);
+            index_page_cache().invalidate(path);
+            dbfile.remove_filepath(path);
+        }
+        theIndexes.clear();
+        if (theStore) {
+            theStore->drop();
+            theStore.reset();
+        }
         if (thePageCache != nullptr) {
-            Page buffer;
-            buffer.id = page_num;
-            Page& cachedPage = thePageCache->read(page_num, buffer, filepath);
+            thePageCache->invalidate("database-files/heapfiles/" + theFileName + ".db");
+        }
+        if (theHeapFile != nullptr) {
+            delete_heapfile(theFileName);
+        }
+    }
 
-            // Find a free slot in the cached page
-            u64 slot_num = 0;
-            bool found_slot = false;
+    Index* Table::create_index(const string& name, const string& column, IndexType type) {
+        int col = column_index(column);
+        if (theStore) {
+            throw std::runtime_error("Secondary indexes are not supported on " + string(engine_name(theEngine)) + " table " + theFileName);
+        }
+        for (auto& index : theIndexes) {
+            if (index->name == name) {
+                throw std::runtime_error("Index already exists: " + name);
+            }
+        }
+
+        auto index = std::make_unique<TableIndex>();
+        index->name = name;
+        index->column = col;
+        index->type = type;
+        index->impl = make_index(name, col, type);
+
+        // bulk load whatever the table already holds
+        std::vector<IndexEntry> entries;
+        QueryArena arena;
+        for (Row* row : scan(&arena)) {
+            entries.push_back({make_index_key(row->values[col], theSchema.columns[col].type), row->id});
+        }
+        index->impl->bulk_build(entries);
+
+        theIndexes.push_back(std::move(index));
+        return theIndexes.back()->impl.get();
+    }
+
+    const TableStats& Table::analyze(u32 samplePages) {
+        if (theStore) {
+            // there are no heap pages to sample, the whole store is read
+            QueryArena arena;
+            theStats = analyze_rows(store_scan(&arena, nullptr), theSchema);
+            return *theStats;
+        }
+        theStats = analyze_heap(theHeapFile, theSchema, samplePages);
+        return *theStats;
+    }
+
+    std::vector<IndexDef> Table::index_defs() const {
+        std::vector<IndexDef> defs;
+        for (auto& index : theIndexes) {
+            defs.push_back({index->name, theSchema.columns[index->column].name, index->type, index->unique});
+        }
+        return defs;
+    }
+
+    BPlusTree* Table::get_btree(int column) const {
+        for (auto& index : theIndexes) {
+            if (index->column == column && index->type == IndexType::BTREE) {
+                return static_cast<BPlusTree*>(index->impl.get());
+            }
+        }
+        return nullptr;
+    }
+
+    HashIndex* Table::get_hash_index(int column) const {
+        for (auto& index : theIndexes) {
+            if (index->column == column && index->type == IndexType::HASH) {
+                return static_cast<HashIndex*>(index->impl.get());
+            }
+        }
+        return nullptr;
+    }
 
-            for (u64 i = 0; i < SLOTS_PER_PAGE; i++) {
-                u8* slot_data = reinterpret_cast<u8*>(cachedPage.data) + (i * SLOT_SIZE);
-                if (slot_data[0] == 0) {  // Check valid marker
-                    slot_num = i;
-                    found_slot = true;
-                    break;
+    // every PRIMARY KEY or UNIQUE column gets a B+tree so a duplicate is found
+    // with one probe instead of a scan, named like postgres names them
+    void Table::create_key_indexes() {
+        for (size_t i = 0; i < theSchema.columns.size(); i++) {
+            const SchemaCol& col = theSchema.columns[i];
+            if (!col.is_primary_key && !col.is_unique) {
+                continue;
+            }
+            string name = col.is_primary_key ? theFileName + "_pkey" : theFileName + "_" + col.name + "_key";
+            create_index(name, col.name);
+            theIndexes.back()->unique = true;
+        }
+    }
+
+    void Table::check_unique(const std::vector<Row*>& rows, const std::vector<RowId>& replacing) const {
+        std::unordered_set<u64> replaced;
+        for (const RowId& rid : replacing) {
+            replaced.insert(((u64)rid.pageId.page_num << 16) | rid.record_num);
+        }
+
+        for (auto& index : theIndexes) {
+            if (!index->unique) {
+                continue;
+            }
+            int col = index->column;
+            ColumnType type = theSchema.columns[col].type;
+            // only strings can be longer than a key, other keys hold the whole value
+            auto same_value = [&](const datatype& a, const datatype& b) {
+                return type != ColumnType::STRING || a == b;
+            };
+            auto conflict = [&](const datatype& val) {
+                return std::runtime_error("Duplicate key violates unique constraint " + index->name + ": " +
+                                          theSchema.columns[col].name + " = " + key_string(val));
+            };
+
+            // probing in key order lets the tree reuse the leaf it just read
+            std::vector<std::pair<IndexKey, Row*>> probes;
+            probes.reserve(rows.size());
+            for (Row* row : rows) {
+                probes.push_back({make_index_key(row->values[col], type), row});
+            }
+            std::sort(probes.begin(), probes.end(), [](const auto& a, const auto& b) {
+                return compare_keys(a.first, b.first) < 0;
+            });
+
+            // long strings share a key when their prefixes match, so equal string
+            // keys only conflict when the full values are equal too
+            for (size_t i = 0; i < probes.size(); i++) {
+                for (size_t j = i + 1; j < probes.size() && compare_keys(probes[i].first, probes[j].first) == 0; j++) {
+                    if (same_value(probes[i].second->values[col], probes[j].second->values[col])) {
+                        throw conflict(probes[i].second->values[col]);
+                    }
                 }
             }
 
-            if (found_slot) {
-                // Serialize the row
-                u8 row_buffer[SLOT_SIZE];
-                std::memset(row_buffer, 0, SLOT_SIZE);
-
-                // Serialize row: valid marker + numCols + values
-                size_t offset = 0;
-                u8 valid_marker = 1;
-                std::memcpy(row_buffer + offset, &valid_marker, sizeof(u8));
-                offset += sizeof(u8);
-                std::memcpy(row_buffer + offset, &row->numCols, sizeof(u8));
-                offset += sizeof(u8);
-
-                for (size_t i = 0; i < row->numCols && offset < SLOT_SIZE; i++) {
-                    u8 type_tag = (u8)row->values[i].index();
-                    std::memcpy(row_buffer + offset, &type_tag, sizeof(u8));
-                    offset += sizeof(u8);
-
-                    switch (row->values[i].index()) {
-                        case 0: { // int
-                            int val = std::get<int>(row->values[i]);
-                            std::memcpy(row_buffer + offset, &val, sizeof(int));
-                            offset += sizeof(int);
-                            break;
-                        }
-                        case 1: { // float
-                            float val = std::get<float>(row->values[i]);
-                            std::memcpy(row_buffer + offset, &val, sizeof(float));
-                            offset += sizeof(float);
-                            break;
-                        }
-                        case 2: { // string
-                            string val = std::get<string>(row->values[i]);
-                            u16 len = (u16)val.size();
-                            std::memcpy(row_buffer + offset, &len, sizeof(u16));
-                            offset += sizeof(u16);
-                            std::memcpy(row_buffer + offset, val.data(), len);
-                            offset += len;
-                            break;
-                        }
-                        case 3: { // bool
-                            bool val = std::get<bool>(row->values[i]);
-                            std::memcpy(row_buffer + offset, &val, sizeof(bool));
-                            offset += sizeof(bool);
-                            break;
-                        }
-                        case 4: { // int64_t
-                            int64_t val = std::get<int64_t>(row->values[i]);
-                            std::memcpy(row_buffer + offset, &val, sizeof(int64_t));
-                            offset += sizeof(int64_t);
-                            break;
-                        }
-                        case 5: { // double
-                            double val = std::get<double>(row->values[i]);
-                            std::memcpy(row_buffer + offset, &val, sizeof(double));
-                            offset += sizeof(double);
-                            break;
-                        }
+            std::vector<IndexKey> keys;
+            keys.reserve(probes.size());
+            for (auto& probe : probes) {
+                keys.push_back(probe.first);
+            }
+            std::vector<std::vector<RowId>> found = index->impl->lookup_many(keys);
+
+            QueryArena arena;
+            for (size_t i = 0; i < probes.size(); i++) {
+                for (const RowId& rid : found[i]) {
+                    if (replaced.count(((u64)rid.pageId.page_num << 16) | rid.record_num)) {
+                        continue;
+                    }
+                    if (type != ColumnType::STRING) {
+                        throw conflict(probes[i].second->values[col]);
+                    }
+                    Row* existing = get_row(theHeapFile, rid, &arena);
+                    if (existing != nullptr && existing->values[col] == probes[i].second->values[col]) {
+                        throw conflict(probes[i].second->values[col]);
                     }
                 }
+            }
+        }
+    }
 
-                // Copy serialized row into cached page
-                u8* slot_data = reinterpret_cast<u8*>(cachedPage.data) + (slot_num * SLOT_SIZE);
-                std::memcpy(slot_data, row_buffer, SLOT_SIZE);
-                cachedPage.dirty_bit = true;
+    BitmapIndex* Table::get_bitmap_index(int column) const {
+        for (auto& index : theIndexes) {
+            if (index->column == column && index->type == IndexType::BITMAP) {
+                return static_cast<BitmapIndex*>(index->impl.get());
+            }
+        }
+        return nullptr;
+    }
 
-                // Write through to disk
-                thePageCache->write_through(cachedPage, filepath);
+    void Table::index_row(Row* row, const RowId& rid) {
+        if (rid.pageId.page_num == 0) {
+            return; // insert failed
+        }
+        for (auto& index : theIndexes) {
+            index->impl->insert(make_index_key(row->values[index->column],
+                                               theSchema.columns[index->column].type), rid);
+        }
+    }
 
-                theHeapFile->metadata.num_records++;
+    RowId Table::insert_row() {
+        RowId rid;
+        rid.pageId.heapId = 0;
+        rid.pageId.page_num = 0;
+        rid.record_num = 0;
+        return rid;
+    }
 
-                rid.pageId.heapId = theHeapFile->metadata.heap_id;
-                rid.pageId.page_num = page_num;
-                rid.record_num = slot_num;
-                return rid;
+    RowId Table::insert_row(Row* row) {
+        if (theStore) {
+            return row != nullptr ? insert_rows({row}).front() : insert_row();
+        }
+        if (row != nullptr) {
+            check_unique({row});
+        }
+        return store_row(row);
+    }
+
+    std::vector<RowId> Table::insert_rows(const std::vector<Row*>& rows) {
+        if (theStore) {
+            store_check_unique(rows);
+            std::vector<KeyedWrite> batch;
+            batch.reserve(rows.size());
+            for (Row* row : rows) {
+                batch.push_back({store_key(row->values[theKeyColumn]), store_value(row)});
+            }
+            theStore->write(batch);
+            // rows kept by key have no location, page 1 only marks them stored
+            RowId stored = {};
+            stored.pageId.page_num = 1;
+            for (Row* row : rows) {
+                if (theStats) {
+                    theStats->observe_insert(row);
+                }
             }
+            return std::vector<RowId>(rows.size(), stored);
+        }
+        check_unique(rows);
+        std::vector<RowId> rids;
+        rids.reserve(rows.size());
+        for (Row* row : rows) {
+            rids.push_back(store_row(row));
         }
+        return rids;
+    }
 
-        // Fallback to direct HeapFile insert if no cache or no slot found
-        return DB::insert_row(theHeapFile, row, 0);
+    // a page 0 row id means the row wasn't stored, it was too large for a slot
+    RowId Table::store_row(Row* row) {
+        RowId rid = DB::insert_row(theHeapFile, row, 0);
+        index_row(row, rid);
+        if (theStats && rid.pageId.page_num != 0) {
+            theStats->observe_insert(row);
+        }
+        return rid;
     }
 
     Row* Table::read_row() {
         return nullptr;
     }
 
-    Row* Table::read_row(const RowId& rid) {
+    Row* Table::read_row(const RowId& rid, QueryArena* arena) {
         HeapFile* heapfile = get_heapfile_by_rowid(rid);
         if (heapfile == nullptr) {
             heapfile = theHeapFile;
@@ -161,6 +700,11 @@ namespace DB {
             return nullptr;
         }
 
+        // hot rows come back decoded
+        if (Row* cached = heapfile->row_cache.get(rid, arena)) {
+            return cached;
+        }
+
         string filepath = "database-files/heapfiles/" + theFileName + ".db";
         u32 page_num = (u32)rid.pageId.page_num;
         u64 slot_num = rid.record_num;
@@ -178,75 +722,11 @@ namespace DB {
             if (slot_data[0] == 0) {  // Check valid marker
                 return nullptr;
             }
-
-            size_t offset = 0;
-            offset += sizeof(u8);  // Skip valid marker
-
-            u8 num_cols;
-            std::memcpy(&num_cols, slot_data + offset, sizeof(u8));
-            offset += sizeof(u8);
-
-            std::vector<datatype> values;
-            values.reserve(num_cols);
-
-            for (u8 i = 0; i < num_cols && offset < SLOT_SIZE; i++) {
-                u8 type_tag;
-                std::memcpy(&type_tag, slot_data + offset, sizeof(u8));
-                offset += sizeof(u8);
-
-                switch (type_tag) {
-                    case 0: { // int
-                        int val;
-                        std::memcpy(&val, slot_data + offset, sizeof(int));
-                        offset += sizeof(int);
-                        values.push_back(val);
-                        break;
-                    }
-                    case 1: { // float
-                        float val;
-                        std::memcpy(&val, slot_data + offset, sizeof(float));
-                        offset += sizeof(float);
-                        values.push_back(val);
-                        break;
-                    }
-                    case 2: { // string
-                        u16 len;
-                        std::memcpy(&len, slot_data + offset, sizeof(u16));
-                        offset += sizeof(u16);
-                        string val(reinterpret_cast<char*>(slot_data + offset), len);
-                        offset += len;
-                        values.push_back(val);
-                        break;
-                    }
-                    case 3: { // bool
-                        bool val;
-                        std::memcpy(&val, slot_data + offset, sizeof(bool));
-                        offset += sizeof(bool);
-                        values.push_back(val);
-                        break;
-                    }
-                    case 4: { // int64_t
-                        int64_t val;
-                        std::memcpy(&val, slot_data + offset, sizeof(int64_t));
-                        offset += sizeof(int64_t);
-                        values.push_back(val);
-                        break;
-                    }
-                    case 5: { // double
-                        double val;
-                        std::memcpy(&val, slot_data + offset, sizeof(double));
-                        offset += sizeof(double);
-                        values.push_back(val);
-                        break;
-                    }
-                }
-            }
-
-            return new Row(num_cols, std::move(values));
+            return deserialize_row(heapfile, slot_data, SLOT_SIZE, arena);
         }
 
         // Fallback to direct HeapFile read if no cache
-        return get_row(heapfile, rid);
+        return get_row(heapfile, rid, arena);
     }
 
     u64 Table::read(u64 pageNum, u16 rowNum) {
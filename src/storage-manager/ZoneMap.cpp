@@ -0,0 +1,182 @@
+#include "storage-manager/ZoneMap.hpp"
+#include "page-manager/DbFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DB {
+    void ZoneMap::open(const string& path) {
+        DbFile& dbfile = DbFile::getInstance();
+        theFd = dbfile.get_filepath(path);
+        if (theFd == -1) {
+            theFd = dbfile.add_filepath(path);
+        }
+
+        theZones.assign(1, PageZone{});
+        PageZone buffer[64];
+        off_t offset = sizeof(PageZone);
+        while (true) {
+            ssize_t bytes = dbfile.read_at(offset, buffer, sizeof(buffer), theFd);
+            if (bytes <= 0) {
+                break;
+            }
+            size_t count = (size_t)bytes / sizeof(PageZone);
+            theZones.insert(theZones.end(), buffer, buffer + count);
+            if (bytes < (ssize_t)sizeof(buffer)) {
+                break;
+            }
+            offset += bytes;
+        }
+    }
+
+    u64 ZoneMap::zone_key(const datatype& val, u8& kind) {
+        if (val.holds<string>()) {
+            kind = ZONE_KIND_STRING;
+            std::string_view s = val.get<string>();
+            u64 key = 0;
+            for (size_t i = 0; i < sizeof(u64); i++) {
+                key = (key << 8) | (i < s.size() ? (u8)s[i] : 0);
+            }
+            return key;
+        }
+
+        kind = (u8)(ZONE_KIND_NUMBER + val.index());
+        double d = val.visit([](auto&& v) -> double {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                return 0;
+            } else {
+                return static_cast<double>(v);
+            }
+        });
+        if (d == 0) d = 0; // -0.0 and 0.0 get the same key
+        u64 bits;
+        std::memcpy(&bits, &d, sizeof(u64));
+        return (bits >> 63) ? ~bits : bits | (1ULL << 63);
+    }
+
+    PageZone& ZoneMap::zone(u32 page) {
+        if (page >= theZones.size()) {
+            theZones.resize(page + 1, PageZone{});
+        }
+        return theZones[page];
+    }
+
+    void ZoneMap::write_zone(u32 page) {
+        DbFile::getInstance().write_at((off_t)page * sizeof(PageZone), &theZones[page],
+                                       sizeof(PageZone), theFd);
+    }
+
+    void ZoneMap::add_row(u32 page, const Row* row) {
+        PageZone& z = zone(page);
+        bool changed = z.rows == 0;
+        z.rows++;
+
+        for (u32 col = 0; col < ZONE_MAX_COLUMNS; col++) {
+            ColumnZone& cz = z.columns[col];
+            if (col >= row->numCols || col >= row->values.size()) {
+                cz.null_count++;
+                continue;
+            }
+            u8 kind;
+            u64 key = zone_key(row->values[col], kind);
+            if (cz.kind == ZONE_KIND_EMPTY) {
+                cz.kind = kind;
+                cz.min = key;
+                cz.max = key;
+                changed = true;
+            } else if (cz.kind != kind && cz.kind != ZONE_KIND_MIXED) {
+                cz.kind = ZONE_KIND_MIXED;
+                changed = true;
+            } else if (key < cz.min) {
+                cz.min = key;
+                changed = true;
+            } else if (key > cz.max) {
+                cz.max = key;
+                changed = true;
+            }
+        }
+
+        // counts alone aren't worth a write, only the bounds decide what gets skipped
+        if (changed) {
+            write_zone(page);
+        }
+    }
+
+    void ZoneMap::merge(u32 dst, u32 src) {
+        PageZone from = zone(src);
+        PageZone& to = zone(dst);
+        if (from.rows == 0 || to.rows == 0) {
+            to.rows = 0; // one side is unknown, so is the result
+            write_zone(dst);
+            return;
+        }
+
+        to.rows += from.rows;
+        for (u32 col = 0; col < ZONE_MAX_COLUMNS; col++) {
+            ColumnZone& a = to.columns[col];
+            const ColumnZone& b = from.columns[col];
+            u16 nulls = a.null_count + b.null_count;
+            if (b.kind != ZONE_KIND_EMPTY) {
+                if (a.kind == ZONE_KIND_EMPTY) {
+                    a = b;
+                } else if (a.kind != b.kind) {
+                    a.kind = ZONE_KIND_MIXED;
+                } else {
+                    a.min = std::min(a.min, b.min);
+                    a.max = std::max(a.max, b.max);
+                }
+            }
+            a.null_count = nulls;
+        }
+        write_zone(dst);
+    }
+
+    void ZoneMap::reset(u32 page) {
+        PageZone& z = zone(page);
+        std::memset(&z, 0, sizeof(PageZone));
+        write_zone(page);
+    }
+
+    void ZoneMap::truncate(u32 numPages) {
+        if (theZones.size() > numPages + 1) {
+            theZones.resize(numPages + 1);
+        }
+        DbFile::getInstance().truncate((off_t)(numPages + 1) * sizeof(PageZone), theFd);
+    }
+
+    bool ZoneMap::may_match(u32 page, const std::vector<ZoneRange>& ranges) const {
+        if (page >= theZones.size() || theZones[page].rows == 0) {
+            return true;
+        }
+        const PageZone& z = theZones[page];
+
+        for (const ZoneRange& range : ranges) {
+            if (range.col >= ZONE_MAX_COLUMNS) {
+                continue;
+            }
+            const ColumnZone& cz = z.columns[range.col];
+            if (cz.kind == ZONE_KIND_EMPTY) {
+                return false; // only nulls, which never satisfy a comparison
+            }
+            if (cz.kind == ZONE_KIND_MIXED) {
+                continue;
+            }
+
+            u8 kind;
+            if (range.low) {
+                u64 low = zone_key(*range.low, kind);
+                if (kind == cz.kind && cz.max < low) {
+                    return false;
+                }
+            }
+            if (range.high) {
+                u64 high = zone_key(*range.high, kind);
+                if (kind == cz.kind && cz.min > high) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
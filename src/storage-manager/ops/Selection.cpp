@@ -1,9 +1,89 @@
 #include "storage-manager/ops/Selection.hpp"
+#include "storage-manager/ops/SelectionKernels.hpp"
 
 #include <iostream>
 
 namespace DB {
-    Selection::Selection(StorageOps* child, CondFn cond) : childOp(child), condition(cond) {}
+    // runs the kernel for a column of type T, false if value is of another type
+    template <typename T>
+    static bool kernel_select(const ColumnVector& column, size_t n, CompareOp op, const datatype& value,
+                              std::vector<u32>& keep) {
+        if (!value.holds<T>()) {
+            return false;
+        }
+        keep.resize(n);
+        keep.resize(select_values(column.data<T>(), n, op, value.get<T>(), keep.data()));
+        return true;
+    }
+
+    void select_compare(DataChunk& chunk, size_t col, CompareOp op, const datatype& value) {
+        size_t n = chunk.count();
+        if (chunk.selected() == 0) {
+            return;
+        }
+        // a column no row has is null everywhere, and a comparison with a null is false
+        if (col >= chunk.num_cols()) {
+            chunk.select({});
+            return;
+        }
+
+        const ColumnVector& column = chunk.column(col);
+        std::vector<u32> keep;
+        bool packed = false;
+        switch (column.kind()) {
+            case ColumnVector::INT:    packed = kernel_select<int>(column, n, op, value, keep); break;
+            case ColumnVector::INT64:  packed = kernel_select<int64_t>(column, n, op, value, keep); break;
+            case ColumnVector::FLOAT:  packed = kernel_select<float>(column, n, op, value, keep); break;
+            case ColumnVector::DOUBLE: packed = kernel_select<double>(column, n, op, value, keep); break;
+            default: break;
+        }
+
+        if (!packed) {
+            for (size_t i = 0; i < chunk.selected(); i++) {
+                u32 row = chunk.row(i);
+                if (!column.is_null(row) && compare_values(op, column.get(row), value)) {
+                    keep.push_back(row);
+                }
+            }
+            chunk.select(std::move(keep));
+            return;
+        }
+
+        // the kernel saw a zero of the column's type where a row is null, the
+        // null itself matches nothing
+        if (column.has_nulls()) {
+            std::vector<u32> fixed;
+            size_t j = 0;
+            for (u32 row = 0; row < n; row++) {
+                bool hit = j < keep.size() && keep[j] == row;
+                j += hit;
+                if (hit && !column.is_null(row)) {
+                    fixed.push_back(row);
+                }
+            }
+            keep = std::move(fixed);
+        }
+
+        // the kernel ran over every row, only those already selected stay
+        if (chunk.selected() < n) {
+            std::vector<u32> both;
+            size_t j = 0;
+            for (size_t i = 0; i < chunk.selected(); i++) {
+                u32 row = chunk.row(i);
+                while (j < keep.size() && keep[j] < row) {
+                    j++;
+                }
+                if (j < keep.size() && keep[j] == row) {
+                    both.push_back(row);
+                }
+            }
+            keep = std::move(both);
+        }
+        chunk.select(std::move(keep));
+    }
+
+    Selection::Selection(StorageOpsPtr child, size_t col, string cond, datatype value) :
+        childOp(std::move(child)), column(col), condition(condfn_generator(cond)), op(compare_op(cond)), value(value) {}
     void Selection::open() {
         childOp->open();
     }
@@ -11,16 +91,31 @@ namespace DB {
         childOp->close();
     }
 
-    std::vector<Row*> NaiveSelection::next() {
-        std::vector<Row*> result;
-        auto batch_rows = childOp->next();
-        int i = 0;
-        for(Row* r : batch_rows) {
-            if(i < 10) {
-                result.push_back(r);
+    bool NaiveSelection::next(DataChunk& out) {
+        while (childOp->next(out)) {
+            std::vector<u32> keep;
+            for (size_t i = 0; i < out.selected(); i++) {
+                u32 row = out.row(i);
+                if (column < out.num_cols() && !out.is_null(column, row) &&
+                    condition(out.get(column, row), value)) {
+                    keep.push_back(row);
+                }
+            }
+            if (!keep.empty()) {
+                out.select(std::move(keep));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool VectorizedSelection::next(DataChunk& out) {
+        while (childOp->next(out)) {
+            select_compare(out, column, op, value);
+            if (out.selected() > 0) {
+                return true;
             }
-            i++;
         }
-        return result;
+        return false;
     }
 }
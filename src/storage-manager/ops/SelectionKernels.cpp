@@ -0,0 +1,269 @@
+#include "storage-manager/ops/SelectionKernels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SELECTION_X86
+#endif
+
+namespace DB {
+    template <CompareOp Op, typename T>
+    static inline bool compare(T a, T b) {
+        if constexpr (Op == CompareOp::EQ) return a == b;
+        else if constexpr (Op == CompareOp::NE) return a != b;
+        else if constexpr (Op == CompareOp::LT) return a < b;
+        else if constexpr (Op == CompareOp::LE) return a <= b;
+        else if constexpr (Op == CompareOp::GT) return a > b;
+        else return a >= b;
+    }
+
+    // every position is written and only kept ones advance k, so there is no branch
+    // to mispredict. k never passes i, the writes stay inside the first n positions
+    template <CompareOp Op, typename T>
+    static size_t scalar_select(const T* data, size_t from, size_t n, T value, u32* sel, size_t k) {
+        for (size_t i = from; i < n; i++) {
+            sel[k] = (u32)i;
+            k += compare<Op>(data[i], value);
+        }
+        return k;
+    }
+
+#ifdef SELECTION_X86
+    // for every mask of 8 lanes the lanes whose bit is set, packed to the front
+    alignas(32) static constexpr std::array<std::array<u32, 8>, 256> COMPRESS_LANES = [] {
+        std::array<std::array<u32, 8>, 256> lanes{};
+        for (u32 mask = 0; mask < 256; mask++) {
+            u32 k = 0;
+            for (u32 lane = 0; lane < 8; lane++) {
+                if ((mask >> lane) & 1) {
+                    lanes[mask][k++] = lane;
+                }
+            }
+        }
+        return lanes;
+    }();
+
+    // integers only compare for equal and greater, the other operators swap the
+    // operands or negate the result
+    template <CompareOp Op>
+    static constexpr bool NEGATED = Op == CompareOp::NE || Op == CompareOp::LE || Op == CompareOp::GE;
+
+    template <CompareOp Op>
+    static constexpr int AVX_PREDICATE =
+        Op == CompareOp::EQ ? _CMP_EQ_OQ :
+        Op == CompareOp::NE ? _CMP_NEQ_UQ :
+        Op == CompareOp::LT ? _CMP_LT_OQ :
+        Op == CompareOp::LE ? _CMP_LE_OQ :
+        Op == CompareOp::GT ? _CMP_GT_OQ : _CMP_GE_OQ;
+
+    // --- AVX2, 8 values a step ---
+
+    __attribute__((target("avx2"))) static inline __m256i avx2_broadcast(int v) { return _mm256_set1_epi32(v); }
+    __attribute__((target("avx2"))) static inline __m256i avx2_broadcast(int64_t v) { return _mm256_set1_epi64x(v); }
+    __attribute__((target("avx2"))) static inline __m256 avx2_broadcast(float v) { return _mm256_set1_ps(v); }
+    __attribute__((target("avx2"))) static inline __m256d avx2_broadcast(double v) { return _mm256_set1_pd(v); }
+
+    template <CompareOp Op>
+    __attribute__((target("avx2"))) static inline u32 avx2_mask(const int* p, __m256i c) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)p);
+        __m256i m;
+        if constexpr (Op == CompareOp::EQ || Op == CompareOp::NE) m = _mm256_cmpeq_epi32(x, c);
+        else if constexpr (Op == CompareOp::GT || Op == CompareOp::LE) m = _mm256_cmpgt_epi32(x, c);
+        else m = _mm256_cmpgt_epi32(c, x);
+        u32 bits = (u32)_mm256_movemask_ps(_mm256_castsi256_ps(m));
+        return NEGATED<Op> ? bits ^ 0xFF : bits;
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("avx2"))) static inline u32 avx2_mask4(const int64_t* p, __m256i c) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)p);
+        __m256i m;
+        if constexpr (Op == CompareOp::EQ || Op == CompareOp::NE) m = _mm256_cmpeq_epi64(x, c);
+        else if constexpr (Op == CompareOp::GT || Op == CompareOp::LE) m = _mm256_cmpgt_epi64(x, c);
+        else m = _mm256_cmpgt_epi64(c, x);
+        u32 bits = (u32)_mm256_movemask_pd(_mm256_castsi256_pd(m));
+        return NEGATED<Op> ? bits ^ 0xF : bits;
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("avx2"))) static inline u32 avx2_mask(const int64_t* p, __m256i c) {
+        return avx2_mask4<Op>(p, c) | avx2_mask4<Op>(p + 4, c) << 4;
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("avx2"))) static inline u32 avx2_mask(const float* p, __m256 c) {
+        return (u32)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p), c, AVX_PREDICATE<Op>));
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("avx2"))) static inline u32 avx2_mask(const double* p, __m256d c) {
+        u32 lo = (u32)_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p), c, AVX_PREDICATE<Op>));
+        u32 hi = (u32)_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p + 4), c, AVX_PREDICATE<Op>));
+        return lo | hi << 4;
+    }
+
+    // the positions of the kept lanes are packed with one table lookup and
+    // stored 8 at a time, k then moves on by the number kept
+    template <CompareOp Op, typename T>
+    __attribute__((target("avx2,popcnt"))) static size_t avx2_select(const T* data, size_t n, T value, u32* sel) {
+        auto c = avx2_broadcast(value);
+        size_t k = 0;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            u32 bits = avx2_mask<Op>(data + i, c);
+            __m256i lanes = _mm256_load_si256((const __m256i*)COMPRESS_LANES[bits].data());
+            _mm256_storeu_si256((__m256i*)(sel + k), _mm256_add_epi32(lanes, _mm256_set1_epi32((int)i)));
+            k += std::popcount(bits);
+        }
+        return scalar_select<Op>(data, i, n, value, sel, k);
+    }
+
+    // --- SSE4.2, 4 values a step ---
+
+    __attribute__((target("sse4.2"))) static inline __m128i sse_broadcast(int v) { return _mm_set1_epi32(v); }
+    __attribute__((target("sse4.2"))) static inline __m128i sse_broadcast(int64_t v) { return _mm_set1_epi64x(v); }
+    __attribute__((target("sse4.2"))) static inline __m128 sse_broadcast(float v) { return _mm_set1_ps(v); }
+    __attribute__((target("sse4.2"))) static inline __m128d sse_broadcast(double v) { return _mm_set1_pd(v); }
+
+    template <CompareOp Op>
+    __attribute__((target("sse4.2"))) static inline u32 sse_mask(const int* p, __m128i c) {
+        __m128i x = _mm_loadu_si128((const __m128i*)p);
+        __m128i m;
+        if constexpr (Op == CompareOp::EQ || Op == CompareOp::NE) m = _mm_cmpeq_epi32(x, c);
+        else if constexpr (Op == CompareOp::GT || Op == CompareOp::LE) m = _mm_cmpgt_epi32(x, c);
+        else m = _mm_cmpgt_epi32(c, x);
+        u32 bits = (u32)_mm_movemask_ps(_mm_castsi128_ps(m));
+        return NEGATED<Op> ? bits ^ 0xF : bits;
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("sse4.2"))) static inline u32 sse_mask2(const int64_t* p, __m128i c) {
+        __m128i x = _mm_loadu_si128((const __m128i*)p);
+        __m128i m;
+        if constexpr (Op == CompareOp::EQ || Op == CompareOp::NE) m = _mm_cmpeq_epi64(x, c);
+        else if constexpr (Op == CompareOp::GT || Op == CompareOp::LE) m = _mm_cmpgt_epi64(x, c);
+        else m = _mm_cmpgt_epi64(c, x);
+        u32 bits = (u32)_mm_movemask_pd(_mm_castsi128_pd(m));
+        return NEGATED<Op> ? bits ^ 0x3 : bits;
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("sse4.2"))) static inline u32 sse_mask(const int64_t* p, __m128i c) {
+        return sse_mask2<Op>(p, c) | sse_mask2<Op>(p + 2, c) << 2;
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("sse4.2"))) static inline __m128 sse_compare(__m128 x, __m128 c) {
+        if constexpr (Op == CompareOp::EQ) return _mm_cmpeq_ps(x, c);
+        else if constexpr (Op == CompareOp::NE) return _mm_cmpneq_ps(x, c);
+        else if constexpr (Op == CompareOp::LT) return _mm_cmplt_ps(x, c);
+        else if constexpr (Op == CompareOp::LE) return _mm_cmple_ps(x, c);
+        else if constexpr (Op == CompareOp::GT) return _mm_cmpgt_ps(x, c);
+        else return _mm_cmpge_ps(x, c);
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("sse4.2"))) static inline __m128d sse_compare(__m128d x, __m128d c) {
+        if constexpr (Op == CompareOp::EQ) return _mm_cmpeq_pd(x, c);
+        else if constexpr (Op == CompareOp::NE) return _mm_cmpneq_pd(x, c);
+        else if constexpr (Op == CompareOp::LT) return _mm_cmplt_pd(x, c);
+        else if constexpr (Op == CompareOp::LE) return _mm_cmple_pd(x, c);
+        else if constexpr (Op == CompareOp::GT) return _mm_cmpgt_pd(x, c);
+        else return _mm_cmpge_pd(x, c);
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("sse4.2"))) static inline u32 sse_mask(const float* p, __m128 c) {
+        return (u32)_mm_movemask_ps(sse_compare<Op>(_mm_loadu_ps(p), c));
+    }
+
+    template <CompareOp Op>
+    __attribute__((target("sse4.2"))) static inline u32 sse_mask(const double* p, __m128d c) {
+        u32 lo = (u32)_mm_movemask_pd(sse_compare<Op>(_mm_loadu_pd(p), c));
+        u32 hi = (u32)_mm_movemask_pd(sse_compare<Op>(_mm_loadu_pd(p + 2), c));
+        return lo | hi << 2;
+    }
+
+    template <CompareOp Op, typename T>
+    __attribute__((target("sse4.2,popcnt"))) static size_t sse_select(const T* data, size_t n, T value, u32* sel) {
+        auto c = sse_broadcast(value);
+        size_t k = 0;
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            u32 bits = sse_mask<Op>(data + i, c);
+            __m128i lanes = _mm_load_si128((const __m128i*)COMPRESS_LANES[bits].data());
+            _mm_storeu_si128((__m128i*)(sel + k), _mm_add_epi32(lanes, _mm_set1_epi32((int)i)));
+            k += std::popcount(bits);
+        }
+        return scalar_select<Op>(data, i, n, value, sel, k);
+    }
+#endif
+
+    static SelectionIsa best_isa() {
+#ifdef SELECTION_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+            return SelectionIsa::AVX2;
+        }
+        if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+            return SelectionIsa::SSE42;
+        }
+#endif
+        return SelectionIsa::SCALAR;
+    }
+
+    static std::atomic<SelectionIsa> theIsa{best_isa()};
+
+    SelectionIsa selection_isa() {
+        return theIsa.load(std::memory_order_relaxed);
+    }
+
+    void set_selection_isa(SelectionIsa isa) {
+        theIsa.store(std::min(isa, best_isa()), std::memory_order_relaxed);
+    }
+
+    template <CompareOp Op, typename T>
+    static size_t select_op(const T* data, size_t n, T value, u32* sel) {
+#ifdef SELECTION_X86
+        switch (selection_isa()) {
+            case SelectionIsa::AVX2:  return avx2_select<Op>(data, n, value, sel);
+            case SelectionIsa::SSE42: return sse_select<Op>(data, n, value, sel);
+            default:                  break;
+        }
+#endif
+        return scalar_select<Op>(data, 0, n, value, sel, 0);
+    }
+
+    // the operator is picked once a call, so each kernel loop is specialized for it
+    template <typename T>
+    static size_t select_any(const T* data, size_t n, CompareOp op, T value, u32* sel) {
+        switch (op) {
+            case CompareOp::EQ: return select_op<CompareOp::EQ>(data, n, value, sel);
+            case CompareOp::NE: return select_op<CompareOp::NE>(data, n, value, sel);
+            case CompareOp::LT: return select_op<CompareOp::LT>(data, n, value, sel);
+            case CompareOp::LE: return select_op<CompareOp::LE>(data, n, value, sel);
+            case CompareOp::GT: return select_op<CompareOp::GT>(data, n, value, sel);
+            default:            return select_op<CompareOp::GE>(data, n, value, sel);
+        }
+    }
+
+    size_t select_values(const int* data, size_t n, CompareOp op, int value, u32* sel) {
+        return select_any(data, n, op, value, sel);
+    }
+
+    size_t select_values(const int64_t* data, size_t n, CompareOp op, int64_t value, u32* sel) {
+        return select_any(data, n, op, value, sel);
+    }
+
+    size_t select_values(const float* data, size_t n, CompareOp op, float value, u32* sel) {
+        return select_any(data, n, op, value, sel);
+    }
+
+    size_t select_values(const double* data, size_t n, CompareOp op, double value, u32* sel) {
+        return select_any(data, n, op, value, sel);
+    }
+}
@@ -1,7 +1,10 @@
 #include "storage-manager/ops/StorageOps.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <random>
+#include <shared_mutex>
 
 namespace DB {
     void StorageOps::print(std::vector<Row*>& rows) {
@@ -10,9 +13,9 @@ namespace DB {
         std::cout << std::string((colWidth+1) * numCols, '-') << "\n";
         for (Row* r : rows) {
             for(int i = 0; i < r->numCols; i++) {
-                std::visit([&](auto&& val) {
+                r->values[i].visit([&](auto&& val) {
                     std::cout << std::setw(colWidth) << std::left << val;
-                }, r->values[i]);
+                });
                 std::cout << "|";
             }
             std::cout<< std::endl;
@@ -21,14 +24,164 @@ namespace DB {
 
     }
 
-    SeqScan::SeqScan(const Table& table, size_t batchSize = 64) : table(table), batchSize(batchSize), cursor(0) {}
+    // copies a decoded batch into out, true when it had a row
+    static bool fill_chunk(DataChunk& out, const Table& table, const std::vector<Row*>& rows) {
+        out.reset(table.getSchema().columns.size());
+        for (Row* row : rows) {
+            out.append_row(*row);
+        }
+        return out.count() > 0;
+    }
+
+    SeqScan::SeqScan(const Table& table, size_t batchSize = CHUNK_CAPACITY) : table(table), batchSize(std::max<size_t>(batchSize, 1)) {}
     void SeqScan::open() {
-        cursor = 0;
+        cursor = TableCursor();
     }
-    std::vector<Row*> SeqScan::next() {
-        return table.scan();
+    bool SeqScan::next(DataChunk& out) {
+        scratch.release();
+        return fill_chunk(out, table, table.scan_next(cursor, batchSize, &scratch, &options));
     }
     void SeqScan::close() {
+        scratch.release();
         std::cout << "Closing Scan on Table";
     }
-}
\ No newline at end of file
+
+    IndexScan::IndexScan(const Table& table, const BPlusTree& index, std::optional<IndexKey> low,
+                         std::optional<IndexKey> high, size_t batchSize) :
+        table(table), index(index), low(low), high(high), batchSize(batchSize) {}
+    void IndexScan::open() {
+        it = low ? index.seek(*low) : index.begin();
+    }
+    bool IndexScan::next(DataChunk& out) {
+        scratch.release();
+        std::vector<Row*> rows;
+        HeapFile* heapfile = table.getHeapFile();
+        while (it.valid() && rows.size() < batchSize) {
+            if (high && compare_keys(it.key(), *high) > 0) {
+                break;
+            }
+            Row* row = get_row(heapfile, it.rid(), &scratch);
+            if (row != nullptr) {
+                rows.push_back(row);
+            }
+            it.next();
+        }
+        return fill_chunk(out, table, rows);
+    }
+    void IndexScan::close() {
+        scratch.release();
+    }
+
+    HashIndexLookup::HashIndexLookup(const Table& table, const HashIndex& index, IndexKey key,
+                                     size_t batchSize) :
+        table(table), index(index), key(key), cursor(0), batchSize(batchSize) {}
+    void HashIndexLookup::open() {
+        rids = index.lookup(key);
+        cursor = 0;
+    }
+    bool HashIndexLookup::next(DataChunk& out) {
+        scratch.release();
+        std::vector<Row*> rows;
+        HeapFile* heapfile = table.getHeapFile();
+        while (cursor < rids.size() && rows.size() < batchSize) {
+            Row* row = get_row(heapfile, rids[cursor++], &scratch);
+            if (row != nullptr) {
+                rows.push_back(row);
+            }
+        }
+        return fill_chunk(out, table, rows);
+    }
+    void HashIndexLookup::close() {
+        scratch.release();
+    }
+
+    BitmapScan::BitmapScan(const Table& table, RoaringBitmap rows, size_t batchSize) :
+        table(table), rows(std::move(rows)), cursor(0), batchSize(batchSize) {}
+    void BitmapScan::open() {
+        positions = rows.to_vector();
+        cursor = 0;
+    }
+    bool BitmapScan::next(DataChunk& out) {
+        scratch.release();
+        std::vector<Row*> batch;
+        HeapFile* heapfile = table.getHeapFile();
+        while (cursor < positions.size() && batch.size() < batchSize) {
+            u32 pos = positions[cursor++];
+            RowId rid = {{heapfile->metadata.heap_id, pos / SLOTS_PER_PAGE}, pos % SLOTS_PER_PAGE};
+            Row* row = get_row(heapfile, rid, &scratch);
+            if (row != nullptr) {
+                batch.push_back(row);
+            }
+        }
+        return fill_chunk(out, table, batch);
+    }
+    void BitmapScan::close() {
+        scratch.release();
+    }
+
+    static_assert(SLOTS_PER_PAGE <= 32, "SampleScan keeps a page's picked slots in a u32");
+
+    SampleScan::SampleScan(const Table& table, SampleMethod method, double percent,
+                           std::optional<u64> seed, size_t batchSize) :
+        table(table), method(method), fraction(percent / 100), seed(seed), cursor(0),
+        batchSize(batchSize) {}
+    void SampleScan::open() {
+        pages.clear();
+        slots.clear();
+        cursor = 0;
+        HeapFile* heapfile = table.getHeapFile();
+        if (heapfile == nullptr || fraction <= 0) {
+            return;
+        }
+
+        // gaps between picks are geometric, so picking costs one draw per pick
+        // rather than one per page or row
+        std::mt19937_64 rng(seed ? *seed : std::random_device{}());
+        std::geometric_distribution<u64> geometric(fraction < 1 ? fraction : 0.5);
+        auto gap = [&](std::mt19937_64& g) -> u64 { return fraction < 1 ? geometric(g) : 0; };
+        std::shared_lock lock(heapfile->latch);
+        u64 numPages = heapfile->metadata.num_pages;
+        if (method == SampleMethod::SYSTEM) {
+            for (u64 page = 1 + gap(rng); page <= numPages; page += 1 + gap(rng)) {
+                if (heapfile->free_slots[page] < SLOTS_PER_PAGE) {
+                    pages.push_back((u32)page);
+                }
+            }
+            return;
+        }
+
+        // positions of empty slots get picked too and are simply skipped, so every
+        // live row is still kept with the same probability
+        u64 end = (numPages + 1) * SLOTS_PER_PAGE;
+        for (u64 pos = SLOTS_PER_PAGE + gap(rng); pos < end; pos += 1 + gap(rng)) {
+            u32 page = (u32)(pos / SLOTS_PER_PAGE);
+            if (heapfile->free_slots[page] == SLOTS_PER_PAGE) {
+                continue;
+            }
+            if (pages.empty() || pages.back() != page) {
+                pages.push_back(page);
+                slots.push_back(0);
+            }
+            slots.back() |= 1u << (pos % SLOTS_PER_PAGE);
+        }
+    }
+    bool SampleScan::next(DataChunk& out) {
+        scratch.release();
+        std::vector<Row*> batch;
+        HeapFile* heapfile = table.getHeapFile();
+        HeapScanOptions opts;
+        while (cursor < pages.size() && batch.size() < batchSize) {
+            opts.pages = std::vector<u32>{pages[cursor]};
+            for (Row* row : scan_heap(heapfile, &scratch, &opts)) {
+                if (method == SampleMethod::SYSTEM || (slots[cursor] >> row->id.record_num) & 1) {
+                    batch.push_back(row);
+                }
+            }
+            cursor++;
+        }
+        return fill_chunk(out, table, batch);
+    }
+    void SampleScan::close() {
+        scratch.release();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "page-manager/DbFile.hpp"
+#include "query-executor/Catalog.hpp"
+#include "query-executor/QueryExecutor.hpp"
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <memory>
+
+// Runs SQL against a database in a directory named after the first test the
+// process runs. ctest starts every test in its own process, so tests running
+// in parallel never share files. DbFile is a singleton that keeps relative
+// paths, so tests run together from one binary share the directory and
+// should use their own table names.
+class DatabaseTest : public testing::Test {
+protected:
+  void SetUp() override {
+    static bool entered = false;
+    if (!entered) {
+      const testing::TestInfo* info =
+          testing::UnitTest::GetInstance()->current_test_info();
+      std::filesystem::path dir =
+          std::string(info->test_suite_name()) + "." + info->name();
+      std::filesystem::remove_all(dir);
+      std::filesystem::create_directory(dir);
+      std::filesystem::current_path(dir);
+      entered = true;
+    }
+    DB::DbFile::initialize(true);
+    open();
+  }
+
+  void TearDown() override { close(); }
+
+  void open() {
+    catalog = std::make_unique<DB::Catalog>();
+    executor = std::make_unique<DB::QueryExecutor>(*catalog);
+  }
+
+  void close() {
+    executor.reset();
+    catalog.reset();
+  }
+
+  // what a restart does, the catalog and every table are read back from disk
+  void reopen() {
+    close();
+    open();
+  }
+
+  DB::QueryResult run(const std::string& sql) {
+    DB::QueryResult result = executor->execute(sql);
+    EXPECT_TRUE(result.success) << sql << ": " << result.error_message;
+    return result;
+  }
+
+  size_t count(const std::string& sql) { return run(sql).rows.size(); }
+
+  std::unique_ptr<DB::Catalog> catalog;
+  std::unique_ptr<DB::QueryExecutor> executor;
+};
@@ -1,4 +1,4 @@
-#include "sql-compiler/QueryProcessor.hpp"
+#include "sql-compiler/Lexer.hpp"
 #include <gtest/gtest.h>
 #include <vector>
 
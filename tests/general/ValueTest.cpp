@@ -0,0 +1,102 @@
+#include "general/Types.hpp"
+#include "storage-manager/StorageStructs.hpp"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+static_assert(sizeof(Value) == 16);
+
+TEST(Value, HoldsEachTypeLikeTheVariantItReplaced) {
+  EXPECT_EQ(Value(1).index(), 0u);
+  EXPECT_EQ(Value(1.5f).index(), 1u);
+  EXPECT_EQ(Value("abc").index(), 2u);
+  EXPECT_EQ(Value(true).index(), 3u);
+  EXPECT_EQ(Value((int64_t)1 << 40).index(), 4u);
+  EXPECT_EQ(Value(2.5).index(), 5u);
+  EXPECT_EQ(Value().get<int>(), 0);
+
+  EXPECT_EQ(Value((int64_t)1 << 40).get<int64_t>(), (int64_t)1 << 40);
+  EXPECT_EQ(Value(2.5).get<double>(), 2.5);
+  EXPECT_TRUE(Value(2.5).holds<double>());
+  EXPECT_FALSE(Value(2.5).holds<float>());
+  EXPECT_THROW(Value(1).get<double>(), std::runtime_error);
+
+  std::string seen;
+  Value("hello").visit([&](auto v) {
+    if constexpr (std::is_same_v<decltype(v), std::string_view>) {
+      seen = std::string(v);
+    }
+  });
+  EXPECT_EQ(seen, "hello");
+}
+
+TEST(Value, StringsInlineAndOutOfLine) {
+  std::string shortText(VALUE_INLINE_CHARS, 's');
+  std::string longText(VALUE_INLINE_CHARS + 1, 'l');
+  EXPECT_EQ(Value(shortText).get<std::string>(), shortText);
+  EXPECT_EQ(Value(longText).get<std::string>(), longText);
+  EXPECT_EQ(Value("").get<std::string>(), "");
+
+  // copies of a long string share one buffer, which lives until the last copy goes
+  Value copy;
+  {
+    Value original(longText + "tail");
+    copy = original;
+    Value another(original);
+    EXPECT_EQ(another, original);
+  }
+  EXPECT_EQ(copy.get<std::string>(), longText + "tail");
+
+  Value moved(std::move(copy));
+  EXPECT_EQ(moved.get<std::string>(), longText + "tail");
+  EXPECT_EQ(copy.index(), 0u); // a moved from value is left holding 0
+
+  moved = moved;
+  EXPECT_EQ(moved.get<std::string>(), longText + "tail");
+  moved = Value(3);
+  EXPECT_EQ(moved, Value(3));
+}
+
+TEST(Value, ComparesByTypeThenValue) {
+  EXPECT_EQ(Value(3), Value(3));
+  EXPECT_NE(Value(3), Value(3.0));
+  EXPECT_LT(Value(2), Value(3));
+  EXPECT_LT(Value("apple"), Value("apricot"));
+  EXPECT_LT(Value(std::string(20, 'a')), Value(std::string(20, 'b')));
+  EXPECT_EQ(Value(std::string(20, 'a')), Value(std::string(20, 'a')));
+  // different types order by tag, as std::variant did
+  EXPECT_LT(Value(1000), Value(0.5f));
+  EXPECT_GE(Value(1.0), Value("z"));
+
+  std::vector<Value> values{Value("b"), Value(2), Value(1), Value("a")};
+  std::sort(values.begin(), values.end());
+  EXPECT_EQ(values, (std::vector<Value>{Value(1), Value(2), Value("a"), Value("b")}));
+}
+
+TEST(Value, RowsCopyWithoutLosingStrings) {
+  std::string longText(40, 'x');
+  Row* copy;
+  {
+    Row row(2, std::vector<datatype>{datatype(1), datatype(longText)});
+    copy = new Row(row);
+  }
+  EXPECT_EQ(copy->values[1].get<std::string>(), longText);
+  delete copy;
+}
+
+TEST(Value, NullEqualsOnlyNull) {
+  Value null = Value::null();
+  EXPECT_TRUE(null.is_null());
+  EXPECT_FALSE(Value(0).is_null());
+  EXPECT_EQ(null, Value::null());
+  EXPECT_NE(null, Value(0));
+  // anything that visits it sees the int 0 a missing value is
+  int seen = -1;
+  null.visit([&](auto v) {
+    if constexpr (std::is_same_v<decltype(v), int>) seen = v;
+  });
+  EXPECT_EQ(seen, 0);
+}
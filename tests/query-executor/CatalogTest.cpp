@@ -0,0 +1,77 @@
+#include "DatabaseTest.hpp"
+
+#include <fstream>
+
+using namespace DB;
+
+TEST_F(DatabaseTest, CatalogKeepsDefinitionsAcrossRestarts) {
+  run("CREATE TABLE CAT_USERS (ID INT PRIMARY KEY, NAME VARCHAR NOT NULL, SCORE DOUBLE, ACTIVE BOOL)");
+  run("CREATE INDEX CAT_USERS_SCORE ON CAT_USERS (SCORE)");
+  run("CREATE INDEX CAT_USERS_ACTIVE ON CAT_USERS USING BITMAP (ACTIVE)");
+  run("INSERT INTO CAT_USERS VALUES (1, 'ann', 2.5, TRUE), (2, 'bob', 1.5, FALSE)");
+  run("CREATE TABLE CAT_DROPPED (ID INT)");
+  run("DROP TABLE CAT_DROPPED");
+  reopen();
+
+  EXPECT_TRUE(catalog->hasTable("CAT_USERS"));
+  EXPECT_FALSE(catalog->hasTable("CAT_DROPPED"));
+  const CatalogEntry* entry = catalog->getEntry("CAT_USERS");
+  ASSERT_NE(entry, nullptr);
+  ASSERT_EQ(entry->schema.columns.size(), 4u);
+  EXPECT_EQ(entry->schema.columns[0].name, "ID");
+  EXPECT_TRUE(entry->schema.columns[0].is_primary_key);
+  EXPECT_EQ(entry->schema.columns[1].type, ColumnType::STRING);
+  EXPECT_FALSE(entry->schema.columns[1].nullable);
+  EXPECT_EQ(entry->schema.columns[2].type, ColumnType::DOUBLE);
+  EXPECT_EQ(entry->schema.columns[3].type, ColumnType::BOOL);
+
+  bool btree = false, bitmap = false;
+  for (const IndexDef& def : entry->indexes) {
+    btree = btree || (def.name == "CAT_USERS_SCORE" && def.type == IndexType::BTREE);
+    bitmap = bitmap || (def.name == "CAT_USERS_ACTIVE" && def.type == IndexType::BITMAP);
+  }
+  EXPECT_TRUE(btree);
+  EXPECT_TRUE(bitmap);
+
+  EXPECT_EQ(count("SELECT * FROM CAT_USERS WHERE SCORE > 2.0"), 1u);
+  EXPECT_FALSE(executor->execute("INSERT INTO CAT_USERS VALUES (1, 'dup', 0, FALSE)").success);
+}
+
+// past CATALOG_READAHEAD_PAGES the rest of the catalog takes a second read
+TEST_F(DatabaseTest, CatalogLargerThanTheReadahead) {
+  std::string columns;
+  for (int c = 0; c < 30; c++) {
+    columns += (c ? ", " : "") + std::string("A_FAIRLY_LONG_COLUMN_NAME_") + std::to_string(c) + " INT";
+  }
+  const int tables = 120;
+  for (int t = 0; t < tables; t++) {
+    run("CREATE TABLE CAT_WIDE_" + std::to_string(t) + " (" + columns + ")");
+  }
+  reopen();
+  for (int t = 0; t < tables; t++) {
+    const CatalogEntry* entry = catalog->getEntry("CAT_WIDE_" + std::to_string(t));
+    ASSERT_NE(entry, nullptr) << t;
+    EXPECT_EQ(entry->schema.columns.size(), 30u);
+  }
+  run("INSERT INTO CAT_WIDE_119 (A_FAIRLY_LONG_COLUMN_NAME_0) VALUES (7)");
+  EXPECT_EQ(count("SELECT * FROM CAT_WIDE_119"), 1u);
+}
+
+// a save that died mid-write leaves only database.db.tmp behind; the catalog
+// it was replacing must still load, and the next save replaces the leftover
+TEST_F(DatabaseTest, CatalogSurvivesATornSave) {
+  run("CREATE TABLE CAT_KEPT (ID INT)");
+  EXPECT_FALSE(std::filesystem::exists(CATALOG_PATH ".tmp"));
+  close();
+  {
+    std::ofstream torn(CATALOG_PATH ".tmp", std::ios::binary);
+    torn << "half a catalog";
+  }
+  open();
+  EXPECT_TRUE(catalog->hasTable("CAT_KEPT"));
+  run("CREATE TABLE CAT_AFTER (ID INT)");
+  EXPECT_FALSE(std::filesystem::exists(CATALOG_PATH ".tmp"));
+  reopen();
+  EXPECT_TRUE(catalog->hasTable("CAT_KEPT"));
+  EXPECT_TRUE(catalog->hasTable("CAT_AFTER"));
+}
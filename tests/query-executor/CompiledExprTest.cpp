@@ -0,0 +1,151 @@
+#include "query-executor/CompiledExpr.hpp"
+
+#include <gtest/gtest.h>
+#include <functional>
+#include <random>
+
+using namespace DB;
+
+namespace {
+
+using E = Expression;
+
+ExprPtr col(const string& name, const string& table = "") { return E::makeColumnRef(name, table); }
+ExprPtr lit(int64_t v) { return E::makeLiteralInt(v); }
+ExprPtr lit(const string& v) { return E::makeLiteralString(v); }
+ExprPtr bin(BinaryOp op, ExprPtr l, ExprPtr r) { return E::makeBinaryOp(op, std::move(l), std::move(r)); }
+
+ExprPtr in_list(ExprPtr val, std::vector<ExprPtr> items) {
+  auto e = std::make_shared<Expression>();
+  e->type = ExprType::IN_LIST;
+  e->children.push_back(std::move(val));
+  e->in_list = std::move(items);
+  return e;
+}
+
+Schema abc() {
+  Schema schema(3);
+  schema.add_col("A", ColumnType::INT);
+  schema.add_col("B", ColumnType::STRING);
+  schema.add_col("C", ColumnType::INT);
+  return schema;
+}
+
+Row make_row(int a, const string& b, int c) { return Row(3, std::vector<datatype>{a, b, c}); }
+
+} // namespace
+
+TEST(CompiledExpr, MatchesAReferenceOnRandomRows) {
+  Schema schema = abc();
+  // (A < 50 AND B = 'X') OR (NOT C >= 3 AND A IN (1, 2, 90))
+  ExprPtr expr = bin(BinaryOp::OR,
+                     bin(BinaryOp::AND, bin(BinaryOp::LT, col("A"), lit(50)), bin(BinaryOp::EQ, col("B"), lit("X"))),
+                     bin(BinaryOp::AND, E::makeUnaryOp(UnaryOp::NOT, bin(BinaryOp::GE, col("C"), lit(3))),
+                         in_list(col("A"), {lit(1), lit(2), lit(90)})));
+  auto reference = [](int a, const string& b, int c) {
+    return (a < 50 && b == "X") || (!(c >= 3) && (a == 1 || a == 2 || a == 90));
+  };
+
+  CompiledExpr compiled(expr, schema);
+  DataChunk chunk;
+  chunk.reset(3);
+  std::mt19937 rng(3);
+  std::vector<bool> expected;
+  for (int i = 0; i < 2000; i++) {
+    int a = (int)(rng() % 100);
+    string b = rng() % 2 ? "X" : "Y";
+    int c = (int)(rng() % 6);
+    Row row = make_row(a, b, c);
+    ASSERT_EQ(compiled.test(&row), reference(a, b, c)) << a << " " << b << " " << c;
+    chunk.append_row(row);
+    expected.push_back(reference(a, b, c));
+  }
+  // a chunk row gives what the row it came from gave
+  for (u32 i = 0; i < chunk.count(); i++) {
+    EXPECT_EQ(compiled.test(chunk, i), expected[i]);
+  }
+}
+
+TEST(CompiledExpr, KeepsTheTreeWalkersEdgeCases) {
+  Schema schema = abc();
+  Row row = make_row(5, "X", 7);
+
+  // a column the schema doesn't have is the int 0
+  EXPECT_TRUE(CompiledExpr(bin(BinaryOp::EQ, col("MISSING"), lit(0)), schema).test(&row));
+  // AND and OR treat non bools as false
+  EXPECT_FALSE(CompiledExpr(bin(BinaryOp::OR, col("A"), col("C")), schema).test(&row));
+  EXPECT_TRUE(CompiledExpr(E::makeUnaryOp(UnaryOp::NOT, col("A")), schema).test(&row));
+  // operators it can't evaluate are false
+  EXPECT_FALSE(CompiledExpr(bin(BinaryOp::ADD, col("A"), lit(1)), schema).test(&row));
+  EXPECT_FALSE(CompiledExpr(nullptr, schema).test(&row));
+
+  // evaluate returns the value itself, literals are converted once
+  EXPECT_EQ(CompiledExpr(col("B"), schema).evaluate(&row), datatype("X"));
+  EXPECT_EQ(CompiledExpr::literalValue(lit(12)), datatype(12));
+  EXPECT_EQ(CompiledExpr::literalValue(E::makeLiteralFloat(0.5)), datatype(0.5f));
+}
+
+TEST(CompiledExpr, NullsCompareFalseAndOnlyIsNullHoldsOfThem) {
+  Schema schema = abc();
+  // C is null, B is missing past the end of the row
+  Row nulls(3, std::vector<datatype>{datatype(5), datatype::null(), datatype::null()});
+  Row shortRow(1, std::vector<datatype>{datatype(5)});
+  DataChunk chunk;
+  chunk.reset(3);
+  chunk.append_row(nulls);
+  chunk.append_row(shortRow);
+
+  auto holds = [&](const ExprPtr& expr) {
+    CompiledExpr compiled(expr, schema);
+    bool row = compiled.test(&nulls);
+    EXPECT_EQ(compiled.test(&shortRow), row);
+    EXPECT_EQ(compiled.test(chunk, 0), row);
+    EXPECT_EQ(compiled.test(chunk, 1), row);
+    return row;
+  };
+  for (BinaryOp op : {BinaryOp::EQ, BinaryOp::NE, BinaryOp::LT, BinaryOp::GE}) {
+    EXPECT_FALSE(holds(bin(op, col("C"), lit(0))));
+    EXPECT_FALSE(holds(bin(op, lit(0), col("C"))));
+  }
+  EXPECT_FALSE(holds(bin(BinaryOp::EQ, col("C"), col("B"))));
+  EXPECT_FALSE(holds(bin(BinaryOp::EQ, col("A"), E::makeLiteralNull())));
+  EXPECT_FALSE(holds(in_list(col("C"), {lit(0), E::makeLiteralNull()})));
+  EXPECT_TRUE(holds(E::makeUnaryOp(UnaryOp::IS_NULL, col("C"))));
+  EXPECT_FALSE(holds(E::makeUnaryOp(UnaryOp::IS_NOT_NULL, col("C"))));
+  EXPECT_FALSE(holds(E::makeUnaryOp(UnaryOp::IS_NULL, col("A"))));
+  EXPECT_TRUE(holds(E::makeUnaryOp(UnaryOp::IS_NOT_NULL, col("A"))));
+  // NOT only sees that the comparison is not true
+  EXPECT_TRUE(holds(E::makeUnaryOp(UnaryOp::NOT, bin(BinaryOp::EQ, col("C"), lit(0)))));
+  EXPECT_TRUE(holds(bin(BinaryOp::OR, bin(BinaryOp::GT, col("C"), lit(1)),
+                        E::makeUnaryOp(UnaryOp::IS_NULL, col("B")))));
+
+  // unary minus negates, of a null it is null
+  EXPECT_TRUE(holds(bin(BinaryOp::EQ, E::makeUnaryOp(UnaryOp::MINUS, col("A")), lit(-5))));
+  EXPECT_TRUE(holds(E::makeUnaryOp(UnaryOp::IS_NULL, E::makeUnaryOp(UnaryOp::MINUS, col("C")))));
+  EXPECT_EQ(CompiledExpr(E::makeUnaryOp(UnaryOp::MINUS, E::makeLiteralFloat(0.5)), schema).evaluate(&nulls),
+            datatype(-0.5f));
+  EXPECT_TRUE(holds(bin(BinaryOp::EQ, E::makeUnaryOp(UnaryOp::PLUS, col("A")), lit(5))));
+}
+
+TEST(CompiledExpr, ResolvesQualifiedColumnsOfAJoin) {
+  Schema joined(4);
+  joined.add_col("L.ID", ColumnType::INT);
+  joined.add_col("L.V", ColumnType::INT);
+  joined.add_col("R.ID", ColumnType::INT);
+  joined.add_col("R.V", ColumnType::INT);
+  EXPECT_EQ(findColumn(joined, *col("ID", "R")), 2);
+  EXPECT_EQ(findColumn(joined, *col("ID")), 0);
+  EXPECT_EQ(findColumn(joined, *col("ID"), 1), 2);
+  EXPECT_EQ(findColumn(joined, *col("V", "X")), -1);
+
+  CompiledExpr on(bin(BinaryOp::EQ, col("ID", "L"), col("ID", "R")), joined);
+  Row left(2, std::vector<datatype>{datatype(4), datatype(1)});
+  Row match(2, std::vector<datatype>{datatype(4), datatype(2)});
+  Row other(2, std::vector<datatype>{datatype(5), datatype(2)});
+  EXPECT_TRUE(on.test(&left, &match, 2));
+  EXPECT_FALSE(on.test(&left, &other, 2));
+
+  // the pair form agrees with the joined row
+  Row combined(4, std::vector<datatype>{datatype(4), datatype(1), datatype(4), datatype(2)});
+  EXPECT_TRUE(on.test(&combined));
+}
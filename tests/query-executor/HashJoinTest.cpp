@@ -0,0 +1,134 @@
+#include "DatabaseTest.hpp"
+
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace DB;
+
+namespace {
+
+// right key -> how many rows of the join had it, -1 standing for a null key
+std::map<int, int> keys_at(const DB::QueryResult& result, size_t col) {
+  std::map<int, int> out;
+  for (Row* row : result.rows) {
+    const datatype& val = row->values[col];
+    out[val.is_null() ? -1 : val.get<int>()]++;
+  }
+  return out;
+}
+
+string printed(const DB::QueryResult& result) {
+  std::ostringstream out;
+  std::streambuf* old = std::cout.rdbuf(out.rdbuf());
+  result.print();
+  std::cout.rdbuf(old);
+  return out.str();
+}
+
+} // namespace
+
+class HashJoinTest : public DatabaseTest {
+protected:
+  // customers 1 to 4, orders of customers 2 to 5, customer 2 has two
+  void fill(const string& suffix) {
+    run("CREATE TABLE CUST" + suffix + " (ID INT, NAME STRING)");
+    run("CREATE TABLE ORD" + suffix + " (OID INT, CID INT)");
+    for (int id = 1; id <= 4; id++) {
+      run("INSERT INTO CUST" + suffix + " VALUES (" + std::to_string(id) + ", 'C" + std::to_string(id) + "')");
+    }
+    int oid = 10;
+    for (int cid : {2, 2, 3, 4, 5}) {
+      run("INSERT INTO ORD" + suffix + " VALUES (" + std::to_string(oid++) + ", " + std::to_string(cid) + ")");
+    }
+  }
+
+  string join(const string& type, const string& suffix) {
+    return "SELECT * FROM CUST" + suffix + " C " + type + " JOIN ORD" + suffix + " O ON C.ID = O.CID";
+  }
+};
+
+TEST_F(HashJoinTest, InnerJoinKeepsMatchingPairs) {
+  fill("_I");
+  DB::QueryResult result = run(join("INNER", "_I"));
+  ASSERT_EQ(result.rows.size(), 4u);
+  EXPECT_EQ(keys_at(result, 3), (std::map<int, int>{{2, 2}, {3, 1}, {4, 1}}));
+  for (Row* row : result.rows) {
+    ASSERT_EQ(row->values.size(), 4u);
+    EXPECT_EQ(row->values[0], row->values[3]);
+  }
+}
+
+TEST_F(HashJoinTest, LeftJoinPadsTheRightWithNulls) {
+  fill("_L");
+  DB::QueryResult result = run(join("LEFT", "_L"));
+  ASSERT_EQ(result.rows.size(), 5u);
+  // customer 1 has no order, the row keeps all four columns
+  EXPECT_EQ(keys_at(result, 3), (std::map<int, int>{{-1, 1}, {2, 2}, {3, 1}, {4, 1}}));
+  for (Row* row : result.rows) {
+    ASSERT_EQ(row->values.size(), 4u);
+    if (row->values[3].is_null()) {
+      EXPECT_EQ(row->values[0], datatype(1));
+      EXPECT_TRUE(row->values[2].is_null());
+    }
+  }
+  EXPECT_NE(printed(result).find("1 | C1 | NULL | NULL"), string::npos);
+}
+
+TEST_F(HashJoinTest, RightAndFullJoinsPadTheLeftWithNulls) {
+  fill("_R");
+  DB::QueryResult right = run(join("RIGHT", "_R"));
+  ASSERT_EQ(right.rows.size(), 5u);
+  // the order of customer 5 has no customer, its left side is null rather than 0
+  EXPECT_EQ(keys_at(right, 0), (std::map<int, int>{{-1, 1}, {2, 2}, {3, 1}, {4, 1}}));
+  EXPECT_NE(printed(right).find("NULL | NULL | 14 | 5"), string::npos);
+  EXPECT_EQ(printed(right).find("0 | 0 |"), string::npos);
+
+  DB::QueryResult full = run(join("FULL", "_R"));
+  ASSERT_EQ(full.rows.size(), 6u);
+  EXPECT_EQ(keys_at(full, 0), (std::map<int, int>{{-1, 1}, {1, 1}, {2, 2}, {3, 1}, {4, 1}}));
+  EXPECT_EQ(keys_at(full, 3), (std::map<int, int>{{-1, 1}, {2, 2}, {3, 1}, {4, 1}, {5, 1}}));
+}
+
+TEST_F(HashJoinTest, NullsOfAnOuterJoinMatchNothingAbove) {
+  fill("_N");
+  run("CREATE TABLE REGION_N (CID INT, REGION STRING)");
+  run("INSERT INTO REGION_N VALUES (0, 'ZERO')");
+  run("INSERT INTO REGION_N VALUES (2, 'EAST')");
+  // the null customer id of order 14 must not join the region of customer 0
+  DB::QueryResult result =
+      run("SELECT * FROM CUST_N C RIGHT JOIN ORD_N O ON C.ID = O.CID JOIN REGION_N R ON C.ID = R.CID");
+  EXPECT_EQ(keys_at(result, 0), (std::map<int, int>{{2, 2}}));
+}
+
+TEST_F(HashJoinTest, FiltersAboveAnOuterJoinTreatItsNullsAsNull) {
+  fill("_W");
+  const string left = join("LEFT", "_W");
+  // customer 1's null order id is neither 0 nor anything but 0
+  EXPECT_EQ(count(left + " WHERE O.OID = 0"), 0u);
+  EXPECT_EQ(count(left + " WHERE O.OID <> 0"), 4u);
+  EXPECT_EQ(count(left + " WHERE O.OID < 100"), 4u);
+  EXPECT_EQ(count(left + " WHERE O.OID IN (0, 10)"), 1u);
+
+  DB::QueryResult unmatched = run(left + " WHERE O.OID IS NULL");
+  ASSERT_EQ(unmatched.rows.size(), 1u);
+  EXPECT_EQ(unmatched.rows[0]->values[0], datatype(1));
+  EXPECT_EQ(count(left + " WHERE O.OID IS NOT NULL"), 4u);
+  EXPECT_EQ(count(join("FULL", "_W") + " WHERE C.ID IS NULL OR O.CID IS NULL"), 2u);
+}
+
+TEST_F(HashJoinTest, BothBuildSidesGiveTheSameRows) {
+  // the side that runs out first is hashed, so swapping sizes swaps the build side
+  run("CREATE TABLE BIG_J (K INT)");
+  run("CREATE TABLE SMALL_J (K INT)");
+  for (int i = 0; i < 3000; i++) {
+    run("INSERT INTO BIG_J VALUES (" + std::to_string(i % 500) + ")");
+  }
+  for (int i = 490; i < 510; i++) {
+    run("INSERT INTO SMALL_J VALUES (" + std::to_string(i) + ")");
+  }
+  EXPECT_EQ(count("SELECT * FROM BIG_J B JOIN SMALL_J S ON B.K = S.K"), 60u);
+  EXPECT_EQ(count("SELECT * FROM SMALL_J S JOIN BIG_J B ON B.K = S.K"), 60u);
+  EXPECT_EQ(count("SELECT * FROM SMALL_J S LEFT JOIN BIG_J B ON B.K = S.K"), 70u);
+  EXPECT_EQ(count("SELECT * FROM BIG_J B RIGHT JOIN SMALL_J S ON B.K = S.K"), 70u);
+}
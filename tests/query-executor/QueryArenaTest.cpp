@@ -0,0 +1,71 @@
+#include "DatabaseTest.hpp"
+#include "general/Arena.hpp"
+
+#include <sanitizer/lsan_interface.h>
+
+using namespace DB;
+
+class QueryArenaTest : public DatabaseTest {
+protected:
+  void SetUp() override {
+    DatabaseTest::SetUp();
+    run("CREATE TABLE ARENA_A (ID INT, NAME VARCHAR)");
+    run("CREATE TABLE ARENA_B (ID INT, SCORE INT)");
+    for (int i = 0; i < 50; i++) {
+      run("INSERT INTO ARENA_A VALUES (" + std::to_string(i) + ", 'row')");
+      run("INSERT INTO ARENA_B VALUES (" + std::to_string(i) + ", " + std::to_string(i * 10) + ")");
+    }
+  }
+
+  void TearDown() override {
+    run("DROP TABLE ARENA_A");
+    run("DROP TABLE ARENA_B");
+    DatabaseTest::TearDown();
+  }
+};
+
+TEST(QueryArena, MakeRunsDestructorsOnRelease) {
+  static int destroyed = 0;
+  struct Tracked {
+    ~Tracked() { destroyed++; }
+  };
+  QueryArena arena(1024);
+  for (int i = 0; i < 100; i++) {
+    arena.make<Tracked>();
+  }
+  EXPECT_GT(arena.bytes_used(), 0u);
+  arena.release();
+  EXPECT_EQ(destroyed, 100);
+  EXPECT_EQ(arena.bytes_used(), 0u);
+}
+
+TEST_F(QueryArenaTest, ResultRowsLiveInTheResultArena) {
+  QueryResult result = run("SELECT * FROM ARENA_A WHERE ID < 10");
+  ASSERT_EQ(result.rows.size(), 10u);
+  EXPECT_GT(result.memory_used(), 0u);
+
+  QueryResult copy = result;
+  result = QueryResult();
+  for (Row* row : copy.rows) {
+    EXPECT_LT(row->values[0].get<int>(), 10);
+  }
+}
+
+TEST_F(QueryArenaTest, MemoryLimitFailsTheQuery) {
+  executor->setQueryMemoryLimit(1);
+  QueryResult result = executor->execute("SELECT * FROM ARENA_A");
+  EXPECT_FALSE(result.success);
+  executor->setQueryMemoryLimit(0);
+  EXPECT_EQ(count("SELECT * FROM ARENA_A"), 50u);
+}
+
+// deleting the root of an operator tree frees every operator below it
+TEST_F(QueryArenaTest, OperatorTreesAreFreed) {
+  for (const char* sql : {"SELECT NAME FROM ARENA_A WHERE ID > 5 LIMIT 3",
+                          "SELECT * FROM ARENA_A JOIN ARENA_B ON ARENA_A.ID = ARENA_B.ID",
+                          "SELECT * FROM ARENA_A, ARENA_B WHERE SCORE < 30",
+                          "SELECT * FROM ARENA_A LEFT JOIN ARENA_B ON ARENA_A.ID = ARENA_B.SCORE"}) {
+    run(sql);
+  }
+  EXPECT_EQ(__lsan_do_recoverable_leak_check(), 0);
+}
@@ -0,0 +1,83 @@
+#include "DatabaseTest.hpp"
+
+#include <map>
+#include <set>
+
+using namespace DB;
+
+namespace {
+
+std::set<int> ids(const DB::QueryResult& result) {
+  std::set<int> out;
+  for (Row* row : result.rows) {
+    out.insert(row->values[0].get<int>());
+  }
+  return out;
+}
+
+} // namespace
+
+class TableSampleTest : public DatabaseTest {
+protected:
+  // 64 full pages, rows go to pages in insert order
+  void fill(const string& table) {
+    run("CREATE TABLE " + table + " (ID INT, V INT)");
+    for (int i = 0; i < 64 * SLOTS_PER_PAGE; i++) {
+      run("INSERT INTO " + table + " VALUES (" + std::to_string(i) + ", " + std::to_string(i % 10) + ")");
+    }
+  }
+};
+
+TEST_F(TableSampleTest, SystemReturnsWholePages) {
+  fill("SAMPLE_SYS");
+  EXPECT_EQ(count("SELECT * FROM SAMPLE_SYS TABLESAMPLE SYSTEM (100)"), 64u * SLOTS_PER_PAGE);
+  EXPECT_EQ(count("SELECT * FROM SAMPLE_SYS TABLESAMPLE SYSTEM (0)"), 0u);
+
+  std::set<int> sampled = ids(run("SELECT * FROM SAMPLE_SYS TABLESAMPLE SYSTEM (25) REPEATABLE (7)"));
+  EXPECT_GT(sampled.size(), 0u);
+  EXPECT_LT(sampled.size(), 64u * SLOTS_PER_PAGE);
+  std::map<int, int> perPage;
+  for (int id : sampled) {
+    perPage[id / SLOTS_PER_PAGE]++;
+  }
+  for (auto& [page, rows] : perPage) {
+    EXPECT_EQ(rows, SLOTS_PER_PAGE) << "page " << page << " was read in part";
+  }
+}
+
+TEST_F(TableSampleTest, RepeatableSeedsGiveTheSameSample) {
+  fill("SAMPLE_SEED");
+  string query = "SELECT * FROM SAMPLE_SEED TABLESAMPLE BERNOULLI (10) REPEATABLE (42)";
+  std::set<int> first = ids(run(query));
+  EXPECT_EQ(ids(run(query)), first);
+  EXPECT_NE(ids(run("SELECT * FROM SAMPLE_SEED TABLESAMPLE BERNOULLI (10) REPEATABLE (43)")), first);
+}
+
+TEST_F(TableSampleTest, BernoulliKeepsAboutTheRequestedFraction) {
+  fill("SAMPLE_BERN");
+  std::set<int> sampled = ids(run("SELECT * FROM SAMPLE_BERN TABLESAMPLE BERNOULLI (20) REPEATABLE (1)"));
+  // 2048 rows at 20% is about 410, well clear of four standard deviations
+  EXPECT_NEAR((double)sampled.size(), 0.2 * 64 * SLOTS_PER_PAGE, 80);
+
+  // rows are picked one by one, so most pages give only some of their rows
+  std::map<int, int> perPage;
+  for (int id : sampled) {
+    perPage[id / SLOTS_PER_PAGE]++;
+  }
+  int partial = 0;
+  for (auto& [page, rows] : perPage) {
+    partial += rows < SLOTS_PER_PAGE;
+  }
+  EXPECT_GT(partial, 32);
+
+  // predicates apply to the sample
+  for (Row* row : run("SELECT * FROM SAMPLE_BERN TABLESAMPLE BERNOULLI (20) WHERE V = 3").rows) {
+    EXPECT_EQ(row->values[1].get<int>(), 3);
+  }
+}
+
+TEST_F(TableSampleTest, RejectsBadPercentages) {
+  run("CREATE TABLE SAMPLE_BAD (ID INT)");
+  EXPECT_FALSE(executor->execute("SELECT * FROM SAMPLE_BAD TABLESAMPLE SYSTEM (150)").success);
+  EXPECT_FALSE(executor->execute("SELECT * FROM SAMPLE_BAD TABLESAMPLE RANDOM (10)").success);
+}
@@ -0,0 +1,88 @@
+#include "DatabaseTest.hpp"
+
+using namespace DB;
+
+class UpdateTest : public DatabaseTest {
+protected:
+  // a table with one index of each kind
+  void fill(const std::string& table) {
+    run("CREATE TABLE " + table + " (ID INT, GRP INT, TAG INT, NOTE VARCHAR)");
+    run("CREATE INDEX " + table + "_ID ON " + table + " (ID)");
+    run("CREATE INDEX " + table + "_GRP ON " + table + " USING HASH (GRP)");
+    run("CREATE INDEX " + table + "_TAG ON " + table + " USING BITMAP (TAG)");
+    for (int i = 0; i < 100; i++) {
+      run("INSERT INTO " + table + " VALUES (" + std::to_string(i) + ", " + std::to_string(i % 10) +
+          ", " + std::to_string(i % 4) + ", 'n')");
+    }
+  }
+};
+
+TEST_F(UpdateTest, UpdatesThroughEachIndex) {
+  fill("UPD_PLAN");
+  EXPECT_EQ(run("UPDATE UPD_PLAN SET NOTE = 'range' WHERE ID >= 10 AND ID < 20").rows_affected, 10);
+  EXPECT_EQ(run("UPDATE UPD_PLAN SET NOTE = 'hashed' WHERE GRP = 3").rows_affected, 10);
+  EXPECT_EQ(run("UPDATE UPD_PLAN SET NOTE = 'bitmap' WHERE TAG = 2 AND ID > 50").rows_affected, 12);
+  EXPECT_EQ(run("UPDATE UPD_PLAN SET ID = ID WHERE ID = 1000").rows_affected, 0);
+
+  EXPECT_EQ(count("SELECT * FROM UPD_PLAN WHERE NOTE = 'range'"), 9u); // 13 became 'hashed'
+  EXPECT_EQ(count("SELECT * FROM UPD_PLAN WHERE NOTE = 'hashed'"), 10u);
+  EXPECT_EQ(count("SELECT * FROM UPD_PLAN WHERE NOTE = 'bitmap'"), 12u);
+
+  // an indexed column moves to new index entries
+  run("UPDATE UPD_PLAN SET GRP = 42 WHERE ID = 7");
+  EXPECT_EQ(count("SELECT * FROM UPD_PLAN WHERE GRP = 42"), 1u);
+  EXPECT_EQ(count("SELECT * FROM UPD_PLAN WHERE GRP = 7"), 9u);
+}
+
+TEST_F(UpdateTest, DeletesThroughEachIndex) {
+  fill("UPD_DELETE");
+  EXPECT_EQ(run("DELETE FROM UPD_DELETE WHERE ID < 5").rows_affected, 5);
+  EXPECT_EQ(run("DELETE FROM UPD_DELETE WHERE GRP = 9").rows_affected, 10);
+  EXPECT_EQ(run("DELETE FROM UPD_DELETE WHERE TAG = 0").rows_affected, 23);
+  EXPECT_EQ(count("SELECT * FROM UPD_DELETE"), 62u);
+}
+
+// one row that no longer fits its slot fails the statement, and no row changes
+TEST_F(UpdateTest, RowTooLargeLeavesEveryRowUnchanged) {
+  run("CREATE TABLE UPD_WIDE (ID INT, A VARCHAR, B VARCHAR, C VARCHAR, D VARCHAR, E VARCHAR, "
+      "F INT, G INT, H INT, I INT, J INT, K INT)");
+  std::string longValue(40, 'x');
+  run("INSERT INTO UPD_WIDE VALUES (1, 'a', 'b', 'c', 'd', 'e', 0, 0, 0, 0, 0, 0)");
+  run("INSERT INTO UPD_WIDE VALUES (2, 'a', 'b', '" + longValue + "', '" + longValue + "', '" + longValue +
+      "', 0, 0, 0, 0, 0, 0)");
+  ASSERT_EQ(count("SELECT * FROM UPD_WIDE"), 2u);
+
+  QueryResult result = executor->execute("UPDATE UPD_WIDE SET A = '" + longValue + "'");
+  EXPECT_FALSE(result.success);
+  EXPECT_EQ(count("SELECT * FROM UPD_WIDE WHERE A = 'a'"), 2u);
+
+  // the row that fits can still be updated on its own
+  EXPECT_EQ(run("UPDATE UPD_WIDE SET A = '" + longValue + "' WHERE ID = 1").rows_affected, 1);
+}
+
+// a row deleted after it was read isn't updated, and gets no index entries
+TEST_F(UpdateTest, RowsDeletedSinceTheReadAreSkipped) {
+  fill("UPD_GONE");
+  Table* table = catalog->getTable("UPD_GONE");
+  QueryArena arena;
+  std::vector<Row*> rows;
+  for (Row* row : table->scan(&arena)) {
+    if (row->values[0].get<int>() < 2) {
+      rows.push_back(row);
+    }
+  }
+  ASSERT_EQ(rows.size(), 2u);
+  ASSERT_EQ(table->delete_rows({rows[0]}), 1u);
+
+  std::vector<std::unique_ptr<Row>> owned;
+  std::vector<Row*> updated;
+  for (Row* row : rows) {
+    owned.emplace_back(create_row(4, {datatype(row->values[0].get<int>() + 500), datatype(77),
+                                      datatype(3), datatype(std::string("n"))}));
+    updated.push_back(owned.back().get());
+  }
+  EXPECT_EQ(table->update_rows(rows, updated), 1u);
+  EXPECT_EQ(count("SELECT * FROM UPD_GONE WHERE GRP = 77"), 1u);
+  EXPECT_EQ(count("SELECT * FROM UPD_GONE WHERE ID >= 500"), 1u);
+  EXPECT_EQ(count("SELECT * FROM UPD_GONE"), 99u);
+}
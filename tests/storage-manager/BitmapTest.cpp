@@ -0,0 +1,130 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/Bitmap.hpp"
+#include "storage-manager/BitmapIndex.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+
+using namespace DB;
+
+namespace {
+
+// sparse values in one container, a dense run in another so both layouts are used
+void fill(RoaringBitmap& bitmap, std::set<u32>& reference, u32 seed) {
+  std::mt19937 rng(seed);
+  for (int i = 0; i < 3000; i++) {
+    u32 pos = rng() % 65536;
+    bitmap.add(pos);
+    reference.insert(pos);
+  }
+  for (u32 pos = 65536; pos < 65536 + 20000; pos += 1 + rng() % 2) {
+    bitmap.add(pos);
+    reference.insert(pos);
+  }
+}
+
+std::vector<u32> as_vector(const std::set<u32>& s) { return std::vector<u32>(s.begin(), s.end()); }
+
+} // namespace
+
+TEST(RoaringBitmap, SetOperationsMatchAReferenceSet) {
+  RoaringBitmap a, b;
+  std::set<u32> ra, rb;
+  fill(a, ra, 1);
+  fill(b, rb, 2);
+  EXPECT_EQ(a.cardinality(), ra.size());
+  EXPECT_EQ(a.to_vector(), as_vector(ra));
+
+  std::set<u32> expected;
+  RoaringBitmap both = a;
+  both &= b;
+  std::set_intersection(ra.begin(), ra.end(), rb.begin(), rb.end(), std::inserter(expected, expected.end()));
+  EXPECT_EQ(both.to_vector(), as_vector(expected));
+
+  expected.clear();
+  RoaringBitmap either = a;
+  either |= b;
+  std::set_union(ra.begin(), ra.end(), rb.begin(), rb.end(), std::inserter(expected, expected.end()));
+  EXPECT_EQ(either.to_vector(), as_vector(expected));
+
+  expected.clear();
+  RoaringBitmap onlyA = a;
+  onlyA -= b;
+  std::set_difference(ra.begin(), ra.end(), rb.begin(), rb.end(), std::inserter(expected, expected.end()));
+  EXPECT_EQ(onlyA.to_vector(), as_vector(expected));
+}
+
+TEST(RoaringBitmap, RemoveAndSerialize) {
+  RoaringBitmap bitmap;
+  std::set<u32> reference;
+  fill(bitmap, reference, 3);
+  u32 first = *reference.begin();
+  EXPECT_TRUE(bitmap.remove(first));
+  EXPECT_FALSE(bitmap.remove(first));
+  reference.erase(first);
+  EXPECT_FALSE(bitmap.contains(first));
+
+  std::vector<u8> bytes;
+  bitmap.serialize(bytes);
+  RoaringBitmap copy;
+  EXPECT_EQ(copy.deserialize(bytes.data(), bytes.size()), bytes.size());
+  EXPECT_EQ(copy.to_vector(), as_vector(reference));
+  EXPECT_EQ(RoaringBitmap().deserialize(bytes.data(), bytes.size() / 2), 0u);
+}
+
+TEST_F(DatabaseTest, BitmapIndexReplaysItsLog) {
+  string path = "database-files/indexes/bitmap_log.bidx";
+  auto key = [](int v) { return make_index_key(datatype(v), ColumnType::INT); };
+  auto rid = [](u32 page, u64 slot) { return RowId{{1, page}, slot}; };
+  {
+    BitmapIndex index(path, ColumnType::INT);
+    index.create();
+    for (u32 page = 1; page <= 10; page++) {
+      for (u64 slot = 0; slot < SLOTS_PER_PAGE; slot++) {
+        index.insert(key((int)(slot % 3)), rid(page, slot));
+      }
+    }
+    EXPECT_TRUE(index.remove(key(0), rid(1, 0)));
+  }
+  BitmapIndex index(path, ColumnType::INT);
+  ASSERT_TRUE(index.open());
+  EXPECT_EQ(index.num_values(), 3u);
+  u64 perValue[3] = {};
+  for (u64 slot = 0; slot < SLOTS_PER_PAGE; slot++) {
+    perValue[slot % 3] += 10;
+  }
+  EXPECT_EQ(index.match(key(1), key(2)).cardinality(), perValue[1] + perValue[2]);
+  EXPECT_EQ(index.all().cardinality(), 10u * SLOTS_PER_PAGE - 1);
+  EXPECT_EQ(index.lookup(key(0)).size(), perValue[0] - 1);
+}
+
+TEST_F(DatabaseTest, BitmapPredicatesMatchAPlainScan) {
+  run("CREATE TABLE BITMAP_PLAIN (ID INT, COLOR INT, SIZE INT)");
+  run("CREATE TABLE BITMAP_INDEXED (ID INT, COLOR INT, SIZE INT)");
+  run("CREATE INDEX BITMAP_COLOR ON BITMAP_INDEXED USING BITMAP (COLOR)");
+  run("CREATE INDEX BITMAP_SIZE ON BITMAP_INDEXED USING BITMAP (SIZE)");
+  run("CREATE INDEX BITMAP_ID ON BITMAP_INDEXED (ID)");
+  for (int i = 0; i < 400; i++) {
+    std::string values = " VALUES (" + std::to_string(i) + ", " + std::to_string(i % 5) + ", " +
+                         std::to_string(i % 3) + ")";
+    run("INSERT INTO BITMAP_PLAIN" + values);
+    run("INSERT INTO BITMAP_INDEXED" + values);
+  }
+  run("DELETE FROM BITMAP_PLAIN WHERE ID < 40");
+  run("DELETE FROM BITMAP_INDEXED WHERE ID < 40");
+
+  for (const char* where : {"COLOR = 2", "COLOR <> 2", "COLOR IN (1, 3)", "COLOR > 2 AND SIZE = 1",
+                            "COLOR = 0 OR SIZE = 2", "NOT (COLOR = 4)", "COLOR <= 1 AND ID > 200",
+                            "COLOR = 9",
+                            // literals of another type compare by type and can't use the bitmaps
+                            "COLOR = 2.0", "COLOR < 2.5", "COLOR <> 2.5", "COLOR IN (1, 3.0)",
+                            "NOT (COLOR > 1.5)", "COLOR = 2 OR SIZE < 0.5", "COLOR >= 3 AND SIZE = 1.0",
+                            // an equality the B+tree can't key leaves the plan to the bitmaps
+                            "ID = 45 AND COLOR = 0", "ID = 45.0 AND COLOR = 0", "ID = 45.0 OR COLOR = 0"}) {
+    EXPECT_EQ(count(std::string("SELECT * FROM BITMAP_INDEXED WHERE ") + where),
+              count(std::string("SELECT * FROM BITMAP_PLAIN WHERE ") + where))
+        << where;
+  }
+}
@@ -0,0 +1,115 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/ClusteredTree.hpp"
+
+#include <cstdio>
+#include <map>
+
+using namespace DB;
+
+namespace {
+
+string key(int i) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "c%08d", i);
+  return buf;
+}
+
+std::vector<u8> row(int i) { return std::vector<u8>(40 + i % 60, (u8)(i % 251)); }
+
+std::vector<std::pair<string, std::vector<u8>>> scan_all(const ClusteredTree& tree, std::optional<string> low = {},
+                                                         std::optional<string> high = {}) {
+  std::vector<std::pair<string, std::vector<u8>>> rows;
+  tree.scan(low, high, [&](const string& k, const std::vector<u8>& v) {
+    rows.push_back({k, v});
+    return true;
+  });
+  return rows;
+}
+
+} // namespace
+
+TEST_F(DatabaseTest, ClusteredTreeKeepsRowsInKeyOrder) {
+  std::map<string, std::vector<u8>> expected;
+  {
+    ClusteredTree tree("clustered_order", true);
+    // random order, enough rows for leaves and internal nodes to split
+    std::vector<KeyedWrite> batch;
+    for (int i = 0; i < 5000; i++) {
+      int k = (i * 7919) % 5000;
+      batch.push_back({key(k), row(k)});
+      expected[key(k)] = row(k);
+    }
+    tree.write(batch);
+    EXPECT_GE(tree.height(), 2u);
+
+    // overwrites and deletes
+    tree.write({{key(10), row(999)}, {key(11), std::nullopt}, {key(12), std::nullopt}});
+    expected[key(10)] = row(999);
+    expected.erase(key(11));
+    expected.erase(key(12));
+
+    EXPECT_EQ(tree.get(key(10)), row(999));
+    EXPECT_FALSE(tree.get(key(11)));
+    EXPECT_EQ(tree.get(key(4999)), row(4999));
+
+    auto range = scan_all(tree, key(8), key(14));
+    ASSERT_EQ(range.size(), 5u);
+    EXPECT_EQ(range[0].first, key(8));
+    EXPECT_EQ(range[2].first, key(10));
+    EXPECT_EQ(range[3].first, key(13));
+
+    // oversized records are refused before the tree is touched
+    EXPECT_THROW(tree.write({{key(1), std::vector<u8>(CLUSTERED_MAX_RECORD, 0)}}), std::runtime_error);
+    EXPECT_EQ(tree.get(key(1)), row(1));
+  }
+
+  // a reopened tree reads its root from the header
+  ClusteredTree tree("clustered_order", false);
+  auto rows = scan_all(tree);
+  EXPECT_EQ(rows, (std::vector<std::pair<string, std::vector<u8>>>(expected.begin(), expected.end())));
+}
+
+TEST_F(DatabaseTest, ClusteredTreeCompactionShrinksTheFile) {
+  ClusteredTree tree("clustered_compact", true);
+  std::vector<KeyedWrite> batch;
+  for (int i = 0; i < 4000; i++) {
+    batch.push_back({key(i), row(i)});
+  }
+  tree.write(batch);
+  batch.clear();
+  for (int i = 0; i < 4000; i++) {
+    if (i % 10 != 0) {
+      batch.push_back({key(i), std::nullopt});
+    }
+  }
+  tree.write(batch);
+  u32 before = tree.num_pages();
+
+  EXPECT_EQ(tree.compact_all(), 400u);
+  EXPECT_LT(tree.num_pages(), before / 2);
+  auto rows = scan_all(tree);
+  ASSERT_EQ(rows.size(), 400u);
+  EXPECT_EQ(rows[1].first, key(10));
+  EXPECT_EQ(rows[1].second, row(10));
+  tree.drop();
+}
+
+TEST_F(DatabaseTest, ClusteredTablesReturnKeyRangesInOrder) {
+  run("CREATE TABLE ORDERS (ID INT PRIMARY KEY, CUSTOMER INT) CLUSTERED BY (ID)");
+  for (int i = 0; i < 400; i++) {
+    int id = (i * 61) % 400;
+    run("INSERT INTO ORDERS VALUES (" + std::to_string(id) + ", " + std::to_string(id / 10) + ")");
+  }
+  EXPECT_FALSE(executor->execute("INSERT INTO ORDERS VALUES (7, 0)").success);
+  run("DELETE FROM ORDERS WHERE ID = 105");
+
+  reopen();
+  DB::QueryResult range = run("SELECT * FROM ORDERS WHERE ID >= 100 AND ID < 120");
+  ASSERT_EQ(range.rows.size(), 19u);
+  // rows come off the leaves in key order
+  for (size_t i = 1; i < range.rows.size(); i++) {
+    EXPECT_LT(range.rows[i - 1]->values[0].get<int>(), range.rows[i]->values[0].get<int>());
+  }
+  EXPECT_EQ(count("SELECT * FROM ORDERS WHERE ID = 399"), 1u);
+  EXPECT_EQ(count("SELECT * FROM ORDERS"), 399u);
+}
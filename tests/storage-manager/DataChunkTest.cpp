@@ -0,0 +1,145 @@
+#include "storage-manager/DataChunk.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace DB;
+
+namespace {
+
+Row make_row(std::vector<datatype> values) {
+  int n = (int)values.size();
+  return Row(n, std::move(values));
+}
+
+} // namespace
+
+TEST(ColumnVector, PacksOneTypeAndTurnsMixedOnAnother) {
+  ColumnVector ints;
+  for (int i = 0; i < 100; i++) {
+    ints.append(i);
+  }
+  EXPECT_EQ(ints.kind(), ColumnVector::INT);
+  EXPECT_EQ(ints.data<int>()[42], 42);
+  EXPECT_FALSE(ints.has_nulls());
+
+  // nulls keep their place, so row i stays at index i
+  ColumnVector doubles;
+  doubles.append_null();
+  doubles.append(1.5);
+  doubles.append_null();
+  EXPECT_EQ(doubles.kind(), ColumnVector::DOUBLE);
+  EXPECT_EQ(doubles.size(), 3u);
+  EXPECT_TRUE(doubles.is_null(0));
+  EXPECT_FALSE(doubles.is_null(1));
+  EXPECT_TRUE(doubles.is_null(2));
+  EXPECT_EQ(doubles.data<double>()[1], 1.5);
+
+  // a second tag keeps every value as it came
+  doubles.append(2.5f);
+  EXPECT_EQ(doubles.kind(), ColumnVector::MIXED);
+  EXPECT_EQ(doubles.get(1), datatype(1.5));
+  EXPECT_EQ(doubles.get(3), datatype(2.5f));
+  EXPECT_TRUE(doubles.is_null(2));
+
+  ColumnVector strings;
+  strings.append("short");
+  strings.append(std::string(30, 'l'));
+  EXPECT_EQ(strings.kind(), ColumnVector::STRING);
+  EXPECT_EQ(strings.values()[1], datatype(std::string(30, 'l')));
+
+  strings.reset();
+  EXPECT_EQ(strings.size(), 0u);
+  EXPECT_EQ(strings.kind(), ColumnVector::UNTYPED);
+}
+
+TEST(DataChunk, SelectionNarrowsWithoutCopying) {
+  DataChunk chunk;
+  chunk.reset(2);
+  for (int i = 0; i < 10; i++) {
+    Row row = make_row({i, "v" + std::to_string(i)});
+    row.id = RowId{PageId{0, 1}, (u64)i};
+    chunk.append_row(row);
+  }
+  EXPECT_EQ(chunk.count(), 10u);
+  EXPECT_EQ(chunk.selected(), 10u);
+  EXPECT_EQ(chunk.row_id(4).record_num, 4u);
+
+  chunk.select({1, 3, 5, 7, 9});
+  EXPECT_EQ(chunk.count(), 10u);
+  ASSERT_EQ(chunk.selected(), 5u);
+  EXPECT_EQ(chunk.row(2), 5u);
+  EXPECT_EQ(chunk.get(0, chunk.row(2)), datatype(5));
+
+  // a slice counts selected rows, not positions
+  chunk.slice(1, 3);
+  ASSERT_EQ(chunk.selected(), 3u);
+  EXPECT_EQ(chunk.row(0), 3u);
+  EXPECT_EQ(chunk.row(2), 7u);
+
+  // slicing a chunk with no selection makes one, past the end is cut short
+  chunk.reset(1);
+  for (int i = 0; i < 10; i++) {
+    chunk.append_row(make_row({i}));
+  }
+  chunk.slice(8, 5);
+  EXPECT_EQ(chunk.selected(), 2u);
+  EXPECT_EQ(chunk.row(0), 8u);
+  chunk.slice(1, 10);
+  ASSERT_EQ(chunk.selected(), 1u);
+  EXPECT_EQ(chunk.row(0), 9u);
+}
+
+TEST(DataChunk, ProjectAndJoinRows) {
+  DataChunk chunk;
+  chunk.reset(0);
+  chunk.append_row(make_row({1, "a", 2.5}));
+  chunk.append_row(make_row({2, "b", 3.5}));
+  EXPECT_EQ(chunk.num_cols(), 3u); // wider rows add columns
+
+  chunk.project({2, 0, 0});
+  ASSERT_EQ(chunk.num_cols(), 3u);
+  EXPECT_EQ(chunk.get(0, 1), datatype(3.5));
+  EXPECT_EQ(chunk.get(1, 1), datatype(2));
+  EXPECT_EQ(chunk.get(2, 1), datatype(2));
+
+  // joined rows put the right side at its offset, whatever the left left unset is null
+  DataChunk joined;
+  joined.reset(4);
+  Row left = make_row({1});
+  Row right = make_row({"r", 9});
+  joined.append_joined(left, right, 2);
+  EXPECT_EQ(joined.get(0, 0), datatype(1));
+  EXPECT_TRUE(joined.is_null(1, 0));
+  EXPECT_EQ(joined.get(2, 0), datatype("r"));
+  EXPECT_EQ(joined.get(3, 0), datatype(9));
+
+  std::unique_ptr<Row> row(chunk.to_row(0));
+  ASSERT_EQ(row->values.size(), 3u);
+  EXPECT_EQ(row->values[0], datatype(2.5));
+}
+
+TEST(DataChunk, NullsSurviveToRows) {
+  DataChunk chunk;
+  chunk.reset(4);
+  Row left = make_row({1});
+  Row right = make_row({7});
+  chunk.append_joined(left, right, 2); // 1, null, 7, null
+
+  std::unique_ptr<Row> trimmed(chunk.to_row(0));
+  ASSERT_EQ(trimmed->values.size(), 3u);
+  EXPECT_TRUE(trimmed->values[1].is_null());
+  EXPECT_EQ(trimmed->values[2], datatype(7));
+
+  std::unique_ptr<Row> full(chunk.to_row(0, nullptr, true));
+  ASSERT_EQ(full->values.size(), 4u);
+  EXPECT_TRUE(full->values[3].is_null());
+
+  // and come back as nulls when the row goes into another chunk
+  DataChunk again;
+  again.reset(4);
+  again.append_row(*full);
+  EXPECT_TRUE(again.is_null(1, 0));
+  EXPECT_TRUE(again.is_null(3, 0));
+  EXPECT_EQ(again.column(2).kind(), ColumnVector::INT);
+  EXPECT_EQ(again.get(1, 0), datatype(0));
+}
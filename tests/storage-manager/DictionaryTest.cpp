@@ -0,0 +1,65 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/Dictionary.hpp"
+
+using namespace DB;
+
+TEST(StringDictionary, AssignsDenseCodes) {
+  StringDictionary dict;
+  EXPECT_EQ(dict.insert("a"), 0);
+  EXPECT_EQ(dict.insert("b"), 1);
+  EXPECT_EQ(dict.insert("a"), 0);
+  EXPECT_EQ(dict.lookup("b"), 1);
+  EXPECT_EQ(dict.lookup("c"), DICT_NO_CODE);
+  EXPECT_EQ(dict.decode(1), "b");
+}
+
+TEST(StringDictionary, StopsAtCapacity) {
+  StringDictionary dict;
+  for (int i = 0; i < DICT_MAX_ENTRIES; i++) {
+    ASSERT_NE(dict.insert(std::to_string(i)), DICT_NO_CODE);
+  }
+  EXPECT_TRUE(dict.full());
+  EXPECT_EQ(dict.insert("one more"), DICT_NO_CODE);
+  EXPECT_EQ(dict.lookup("17"), 17);
+}
+
+TEST_F(DatabaseTest, SegmentDictionaryReplaysItsFile) {
+  string path = "database-files/heapfiles/dictionary_test.dict";
+  int code;
+  {
+    SegmentDictionary dict;
+    dict.open(path);
+    dict.encode(0, "x");
+    code = dict.encode(1, "y");
+    EXPECT_EQ(dict.encode(1, "y"), code);
+  }
+  SegmentDictionary reopened;
+  reopened.open(path);
+  EXPECT_EQ(reopened.lookup(1, "y"), code);
+  ASSERT_NE(reopened.decode(1, code), nullptr);
+  EXPECT_EQ(*reopened.decode(1, code), "y");
+  EXPECT_EQ(reopened.num_entries(0), 1u);
+}
+
+TEST_F(DatabaseTest, EncodedColumnsFilterAndSurviveRestart) {
+  run("CREATE TABLE DICT_COLORS (ID INT, COLOR VARCHAR)");
+  const char* colors[] = {"red", "green", "blue"};
+  for (int i = 0; i < 90; i++) {
+    run("INSERT INTO DICT_COLORS VALUES (" + std::to_string(i) + ", '" + colors[i % 3] + "')");
+  }
+  // a value too long for the dictionary stays inline
+  run("INSERT INTO DICT_COLORS VALUES (90, 'a colour name well past the dictionary length limit')");
+
+  for (int pass = 0; pass < 2; pass++) {
+    EXPECT_EQ(count("SELECT * FROM DICT_COLORS WHERE COLOR = 'red'"), 30u);
+    EXPECT_EQ(count("SELECT * FROM DICT_COLORS WHERE COLOR <> 'red'"), 61u);
+    EXPECT_EQ(count("SELECT * FROM DICT_COLORS WHERE COLOR IN ('green', 'blue')"), 60u);
+    EXPECT_EQ(count("SELECT * FROM DICT_COLORS WHERE COLOR NOT IN ('green', 'blue')"), 31u);
+    EXPECT_EQ(count("SELECT * FROM DICT_COLORS WHERE COLOR = 'purple'"), 0u);
+
+    QueryResult rows = run("SELECT COLOR FROM DICT_COLORS WHERE ID = 90");
+    ASSERT_EQ(rows.rows.size(), 1u);
+    EXPECT_EQ(rows.rows[0]->values[0].get<string>(), "A COLOUR NAME WELL PAST THE DICTIONARY LENGTH LIMIT");
+    reopen();
+  }
+}
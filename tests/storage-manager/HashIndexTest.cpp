@@ -0,0 +1,84 @@
+#include "DatabaseTest.hpp"
+#include "page-manager/PageCache.hpp"
+#include "storage-manager/HashIndex.hpp"
+
+using namespace DB;
+
+namespace {
+
+RowId rid_of(int i) { return RowId{{1, (u64)i / 32 + 1}, (u64)i % 32}; }
+
+IndexKey key_of(int i) { return make_index_key(datatype(i), ColumnType::INT); }
+
+} // namespace
+
+TEST_F(DatabaseTest, HashIndexSplitsAndSurvivesReopen) {
+  string path = "database-files/indexes/hash_split.hidx";
+  u32 depth;
+  u32 pages;
+  {
+    PageCache cache(64);
+    HashIndex index(path, ColumnType::INT, cache);
+    index.create();
+    for (int i = 0; i < 5000; i++) {
+      index.insert(key_of(i), rid_of(i));
+    }
+    EXPECT_GT(index.global_depth(), 0u);
+    depth = index.global_depth();
+    pages = index.num_pages();
+  }
+  PageCache cache(64);
+  HashIndex index(path, ColumnType::INT, cache);
+  ASSERT_TRUE(index.open());
+  EXPECT_EQ(index.global_depth(), depth);
+  EXPECT_EQ(index.num_pages(), pages);
+  for (int i = 0; i < 5000; i += 7) {
+    std::vector<RowId> found = index.lookup(key_of(i));
+    ASSERT_EQ(found.size(), 1u) << i;
+    EXPECT_EQ(found[0].record_num, rid_of(i).record_num);
+  }
+  EXPECT_TRUE(index.lookup(key_of(5001)).empty());
+}
+
+// entries of one key can't be split apart, their chain shrinks and regrows
+// on the same pages
+TEST_F(DatabaseTest, HashIndexReusesFreedChainPages) {
+  string path = "database-files/indexes/hash_chain.hidx";
+  const int copies = 500;
+  u32 pages;
+  {
+    PageCache cache(64);
+    HashIndex index(path, ColumnType::INT, cache);
+    index.create();
+    for (int i = 0; i < copies; i++) {
+      index.insert(key_of(7), rid_of(i));
+    }
+    pages = index.num_pages();
+    for (int i = 0; i < copies; i++) {
+      ASSERT_TRUE(index.remove(key_of(7), rid_of(i)));
+    }
+    EXPECT_TRUE(index.lookup(key_of(7)).empty());
+  }
+  // the free list is in the header
+  PageCache cache(64);
+  HashIndex index(path, ColumnType::INT, cache);
+  ASSERT_TRUE(index.open());
+  for (int i = 0; i < copies; i++) {
+    index.insert(key_of(9), rid_of(i));
+  }
+  EXPECT_EQ(index.num_pages(), pages);
+  EXPECT_EQ(index.lookup(key_of(9)).size(), (size_t)copies);
+}
+
+TEST_F(DatabaseTest, HashIndexedColumnThroughSql) {
+  run("CREATE TABLE HASH_ROWS (ID INT, GRP INT)");
+  run("CREATE INDEX HASH_ROWS_GRP ON HASH_ROWS USING HASH (GRP)");
+  for (int i = 0; i < 300; i++) {
+    run("INSERT INTO HASH_ROWS VALUES (" + std::to_string(i) + ", " + std::to_string(i % 7) + ")");
+  }
+  EXPECT_EQ(count("SELECT * FROM HASH_ROWS WHERE GRP = 3"), 43u);
+  run("DELETE FROM HASH_ROWS WHERE GRP = 3");
+  reopen();
+  EXPECT_EQ(count("SELECT * FROM HASH_ROWS WHERE GRP = 3"), 0u);
+  EXPECT_EQ(count("SELECT * FROM HASH_ROWS WHERE GRP = 4"), 43u);
+}
@@ -0,0 +1,55 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/HeapFile.hpp"
+
+#include <cstring>
+
+using namespace DB;
+
+TEST_F(DatabaseTest, HeapFileHeaderRoundTrips) {
+  HeapFile* heap = create_heapfile("HEAP_HEADER");
+  for (int i = 0; i < 2 * (int)SLOTS_PER_PAGE + 5; i++) {
+    Row row(2, std::vector<datatype>{datatype(i), datatype("value")});
+    insert_row(heap, &row, 0);
+  }
+  write_heapfile_metadata(heap);
+  HeapFile_Metadata written = heap->metadata;
+  std::vector<u16> freeSlots = heap->free_slots;
+  delete heap;
+
+  HeapFile* reopened = open_heapfile("HEAP_HEADER");
+  ASSERT_NE(reopened, nullptr);
+  EXPECT_EQ(reopened->metadata.magic, (u32)HEAPFILE_MAGIC);
+  EXPECT_EQ(reopened->metadata.version, HEAPFILE_VERSION);
+  EXPECT_EQ(reopened->metadata.page_size, (u32)PAGE_DATA_SIZE);
+  EXPECT_EQ(reopened->metadata.num_pages, 3u);
+  EXPECT_EQ(reopened->metadata.num_records, written.num_records);
+  EXPECT_EQ(std::memcmp(&reopened->metadata, &written, sizeof(written)), 0);
+  // the free space map comes from the directory in the same page
+  EXPECT_EQ(reopened->free_slots, freeSlots);
+  EXPECT_EQ(reopened->free_slots[3], SLOTS_PER_PAGE - 5);
+  std::vector<Row*> rows = scan_heap(reopened);
+  EXPECT_EQ(rows.size(), written.num_records);
+  for (Row* row : rows) {
+    delete row;
+  }
+  delete reopened;
+}
+
+TEST_F(DatabaseTest, HeapFileRejectsForeignHeaders) {
+  EXPECT_EQ(open_heapfile("HEAP_MISSING"), nullptr);
+
+  HeapFile* heap = create_heapfile("HEAP_FOREIGN");
+  int fd = heap->heap_fd;
+  delete heap;
+  DbFile& dbfile = DbFile::getInstance();
+
+  HeapFile_Metadata metadata;
+  dbfile.read_at(0, &metadata, sizeof(metadata), fd);
+  metadata.page_size = PAGE_DATA_SIZE * 2;
+  dbfile.write_at(0, &metadata, sizeof(metadata), fd);
+  EXPECT_THROW(open_heapfile("HEAP_FOREIGN"), std::runtime_error);
+
+  metadata.magic = 0;
+  dbfile.write_at(0, &metadata, sizeof(metadata), fd);
+  EXPECT_EQ(open_heapfile("HEAP_FOREIGN"), nullptr);
+}
@@ -0,0 +1,166 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/LsmTree.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+using namespace DB;
+
+namespace {
+
+string key(int i) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "k%08d", i);
+  return buf;
+}
+
+std::vector<u8> value(int i, size_t size = 8) { return std::vector<u8>(size, (u8)(i % 251)); }
+
+std::vector<string> keys_in(const LsmTree& tree, std::optional<string> low, std::optional<string> high) {
+  std::vector<string> keys;
+  tree.scan(low, high, [&](const string& k, const std::vector<u8>&) {
+    keys.push_back(k);
+    return true;
+  });
+  return keys;
+}
+
+} // namespace
+
+TEST(BloomFilter, NoFalseNegativesAndFewFalsePositives) {
+  BloomFilter bloom(2000, LSM_BLOOM_BITS_PER_KEY);
+  for (int i = 0; i < 2000; i++) {
+    bloom.add(key(i));
+  }
+  for (int i = 0; i < 2000; i++) {
+    EXPECT_TRUE(bloom.may_contain(key(i)));
+  }
+  int falsePositives = 0;
+  for (int i = 2000; i < 12000; i++) {
+    falsePositives += bloom.may_contain(key(i));
+  }
+  EXPECT_LT(falsePositives, 300); // about 1% expected
+
+  std::vector<u8> bytes;
+  bloom.serialize(bytes);
+  BloomFilter read;
+  EXPECT_EQ(read.deserialize(bytes.data(), bytes.size()), bytes.size());
+  EXPECT_TRUE(read.may_contain(key(5)));
+}
+
+TEST_F(DatabaseTest, LsmTreeReadsItsWritesBackInOrder) {
+  LsmTree tree("lsm_basic", true);
+  std::vector<KeyedWrite> batch;
+  for (int i = 0; i < 100; i++) {
+    batch.push_back({key(i), value(i)});
+  }
+  tree.write(batch);
+  // a later write of a key wins, an empty value deletes it
+  tree.write({{key(5), value(99)}, {key(6), std::nullopt}, {key(5), value(77)}});
+
+  EXPECT_EQ(tree.get(key(5)), value(77));
+  EXPECT_FALSE(tree.get(key(6)));
+  EXPECT_FALSE(tree.get("missing"));
+
+  std::vector<string> keys = keys_in(tree, key(3), key(8));
+  EXPECT_EQ(keys, (std::vector<string>{key(3), key(4), key(5), key(7), key(8)}));
+  EXPECT_EQ(keys_in(tree, std::nullopt, std::nullopt).size(), 99u);
+}
+
+TEST_F(DatabaseTest, LsmTreeFlushesCompactsAndRecovers) {
+  // a few memtables worth of random keys, so runs are flushed and compacted
+  std::map<string, std::vector<u8>> expected;
+  {
+    LsmTree tree("lsm_flush", true);
+    for (int round = 0; round < 6; round++) {
+      std::vector<KeyedWrite> batch;
+      for (int i = 0; i < 1000; i++) {
+        int k = (i * 7919 + round * 104729) % 5000;
+        batch.push_back({key(k), value(k + round, 1024)});
+        expected[key(k)] = value(k + round, 1024);
+      }
+      for (int i = round; i < 5000; i += 97) {
+        batch.push_back({key(i), std::nullopt});
+        expected.erase(key(i));
+      }
+      tree.write(batch);
+    }
+    tree.wait_idle();
+    size_t runs = 0;
+    for (u32 level = 0; level < LSM_MAX_LEVELS; level++) {
+      runs += tree.num_runs(level);
+    }
+    EXPECT_GT(runs, 0u);
+    EXPECT_EQ(tree.get(key(1)), expected.count(key(1)) ? std::optional(expected[key(1)]) : std::nullopt);
+    // the last memtable is only in the log when the tree closes
+    tree.write({{key(999999), value(1)}});
+    expected[key(999999)] = value(1);
+  }
+
+  // reopening reads the manifest and replays the logs
+  LsmTree tree("lsm_flush", false);
+  std::map<string, std::vector<u8>> found;
+  tree.scan(std::nullopt, std::nullopt, [&](const string& k, const std::vector<u8>& v) {
+    found[k] = v;
+    return true;
+  });
+  EXPECT_EQ(found.size(), expected.size());
+  EXPECT_TRUE(found == expected);
+
+  EXPECT_EQ(tree.compact_all(), expected.size());
+  for (u32 level = 0; level + 1 < LSM_MAX_LEVELS; level++) {
+    if (tree.num_runs(level + 1) > 0) {
+      EXPECT_EQ(tree.num_runs(level), 0u) << "level " << level << " should be merged down";
+    }
+  }
+  EXPECT_EQ(tree.get(key(999999)), value(1));
+  tree.drop();
+}
+
+// a flush that died while writing the manifest leaves only manifest.tmp behind,
+// the manifest it was replacing still names runs and logs that were kept
+TEST_F(DatabaseTest, LsmTreeIgnoresATornManifest) {
+  const string tmp = "database-files/lsm/lsm_manifest.manifest.tmp";
+  {
+    LsmTree tree("lsm_manifest", true);
+    std::vector<KeyedWrite> batch;
+    for (int i = 0; i < 5000; i++) {
+      batch.push_back({key(i), value(i, 1024)});
+    }
+    tree.write(batch);
+    tree.wait_idle();
+    EXPECT_GT(tree.num_runs(0), 0u);
+    EXPECT_FALSE(std::filesystem::exists(tmp));
+  }
+  {
+    std::ofstream torn(tmp, std::ios::binary);
+    torn << "half a manifest";
+  }
+
+  LsmTree tree("lsm_manifest", false);
+  EXPECT_EQ(keys_in(tree, std::nullopt, std::nullopt).size(), 5000u);
+  EXPECT_EQ(tree.get(key(4321)), value(4321, 1024));
+  tree.drop();
+  EXPECT_FALSE(std::filesystem::exists(tmp));
+}
+
+TEST_F(DatabaseTest, LsmTablesWorkThroughSql) {
+  run("CREATE TABLE TELEMETRY (ID INT PRIMARY KEY, V INT) ENGINE = LSM");
+  for (int i = 0; i < 300; i++) {
+    run("INSERT INTO TELEMETRY VALUES (" + std::to_string((i * 37) % 300) + ", " + std::to_string(i) + ")");
+  }
+  EXPECT_FALSE(executor->execute("INSERT INTO TELEMETRY VALUES (5, 0)").success);
+  run("UPDATE TELEMETRY SET V = 1000 WHERE ID < 10");
+  run("DELETE FROM TELEMETRY WHERE ID >= 290");
+
+  reopen();
+  EXPECT_EQ(count("SELECT * FROM TELEMETRY"), 290u);
+  EXPECT_EQ(count("SELECT * FROM TELEMETRY WHERE V = 1000"), 10u);
+  DB::QueryResult one = run("SELECT * FROM TELEMETRY WHERE ID = 42");
+  ASSERT_EQ(one.rows.size(), 1u);
+  EXPECT_EQ(one.rows[0]->values[0].get<int>(), 42);
+
+  // the engine needs a primary key to order rows by
+  EXPECT_FALSE(executor->execute("CREATE TABLE NO_KEY (V INT) ENGINE = LSM").success);
+}
@@ -0,0 +1,151 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/Partition.hpp"
+
+#include <filesystem>
+
+using namespace DB;
+
+namespace {
+
+PartitionSpec range_spec() {
+  PartitionSpec spec;
+  spec.method = PartitionMethod::RANGE;
+  spec.column = "TS";
+  spec.keyType = ColumnType::INT;
+  spec.partitions = {{"P1", datatype(100)}, {"P2", datatype(200)}, {"P3", std::nullopt}};
+  return spec;
+}
+
+std::vector<size_t> all(size_t n) {
+  std::vector<size_t> out;
+  for (size_t i = 0; i < n; i++) {
+    out.push_back(i);
+  }
+  return out;
+}
+
+} // namespace
+
+TEST(PartitionSpec, RangeRoutesAndPrunesByBound) {
+  PartitionSpec spec = range_spec();
+  EXPECT_EQ(spec.route(-5), 0);
+  EXPECT_EQ(spec.route(99), 0);
+  EXPECT_EQ(spec.route(100), 1);
+  EXPECT_EQ(spec.route(100000), 2);
+  EXPECT_EQ(spec.table_name("EVENTS", 1), "EVENTS_P2");
+
+  EXPECT_EQ(spec.prune(datatype(150), std::nullopt), (std::vector<size_t>{1, 2}));
+  EXPECT_EQ(spec.prune(std::nullopt, datatype(99)), (std::vector<size_t>{0}));
+  EXPECT_EQ(spec.prune(datatype(100), datatype(199)), (std::vector<size_t>{1}));
+  EXPECT_EQ(spec.prune(std::nullopt, std::nullopt), all(3));
+  EXPECT_EQ(spec.prune(std::vector<datatype>{5, 250, 7}), (std::vector<size_t>{0, 2}));
+
+  // without a MAXVALUE partition keys past the last bound have nowhere to go
+  spec.partitions.pop_back();
+  EXPECT_EQ(spec.route(500), -1);
+  EXPECT_TRUE(spec.prune(datatype(200), std::nullopt).empty());
+}
+
+TEST(PartitionSpec, HashOnlyPrunesOnKeys) {
+  PartitionSpec spec;
+  spec.method = PartitionMethod::HASH;
+  spec.column = "ID";
+  spec.keyType = ColumnType::INT;
+  spec.partitions = {{"P0", std::nullopt}, {"P1", std::nullopt}, {"P2", std::nullopt}, {"P3", std::nullopt}};
+
+  int key = spec.route(42);
+  ASSERT_GE(key, 0);
+  EXPECT_EQ(spec.route(42), key);
+  EXPECT_EQ(spec.prune(datatype(42), datatype(42)), (std::vector<size_t>{(size_t)key}));
+  EXPECT_EQ(spec.prune(datatype(1), datatype(1000)), all(4));
+}
+
+TEST(PartitionSpec, SerializeRoundTrips) {
+  PartitionSpec spec = range_spec();
+  std::vector<u8> bytes;
+  spec.serialize(bytes);
+  PartitionSpec read;
+  EXPECT_EQ(read.deserialize(bytes.data(), bytes.size()), bytes.size());
+  EXPECT_EQ(read.column, "TS");
+  ASSERT_EQ(read.partitions.size(), 3u);
+  EXPECT_EQ(read.partitions[1].name, "P2");
+  EXPECT_EQ(read.partitions[1].upper, std::optional<datatype>(200));
+  EXPECT_FALSE(read.partitions[2].upper);
+  EXPECT_EQ(read.deserialize(bytes.data(), bytes.size() - 1), 0u);
+}
+
+TEST_F(DatabaseTest, RangePartitionsRouteInsertsAndSkipPrunedFiles) {
+  run("CREATE TABLE EVENTS (TS INT, V INT) PARTITION BY RANGE (TS) "
+      "(PARTITION OLD VALUES LESS THAN (100), PARTITION MID VALUES LESS THAN (200), "
+      "PARTITION NEW VALUES LESS THAN (MAXVALUE))");
+  for (int ts = 0; ts < 300; ts += 5) {
+    run("INSERT INTO EVENTS VALUES (" + std::to_string(ts) + ", 1)");
+  }
+  EXPECT_EQ(count("SELECT * FROM EVENTS_OLD"), 20u);
+  EXPECT_EQ(count("SELECT * FROM EVENTS_MID"), 20u);
+  EXPECT_EQ(count("SELECT * FROM EVENTS_NEW"), 20u);
+  EXPECT_EQ(count("SELECT * FROM EVENTS"), 60u);
+
+  // a partition the WHERE clause rules out is never opened, so it doesn't
+  // matter that its heapfile is unreadable
+  reopen();
+  std::filesystem::resize_file("database-files/heapfiles/EVENTS_OLD.db", 0);
+  EXPECT_EQ(count("SELECT * FROM EVENTS WHERE TS >= 150"), 30u);
+  EXPECT_EQ(count("SELECT * FROM EVENTS WHERE TS = 255"), 1u);
+  EXPECT_FALSE(executor->execute("SELECT * FROM EVENTS WHERE TS < 50").success);
+}
+
+TEST_F(DatabaseTest, DroppingAPartitionDeletesItsFiles) {
+  run("CREATE TABLE LOGS (TS INT, V INT) PARTITION BY RANGE (TS) "
+      "(PARTITION A VALUES LESS THAN (10), PARTITION B VALUES LESS THAN (MAXVALUE))");
+  for (int ts = 0; ts < 20; ts++) {
+    run("INSERT INTO LOGS VALUES (" + std::to_string(ts) + ", " + std::to_string(ts) + ")");
+  }
+  ASSERT_TRUE(std::filesystem::exists("database-files/heapfiles/LOGS_A.db"));
+
+  run("ALTER TABLE LOGS DROP PARTITION A");
+  EXPECT_FALSE(std::filesystem::exists("database-files/heapfiles/LOGS_A.db"));
+  EXPECT_FALSE(catalog->hasTable("LOGS_A"));
+  EXPECT_EQ(count("SELECT * FROM LOGS"), 10u);
+
+  // keys of the dropped range now go to the next partition up
+  run("INSERT INTO LOGS VALUES (3, 3)");
+  EXPECT_EQ(count("SELECT * FROM LOGS_B WHERE TS = 3"), 1u);
+  EXPECT_FALSE(executor->execute("ALTER TABLE LOGS ADD PARTITION C VALUES LESS THAN (1000)").success);
+  EXPECT_FALSE(executor->execute("ALTER TABLE LOGS DROP PARTITION MISSING").success);
+}
+
+// the heap header's record count is not rewritten on every insert, the count
+// DROP PARTITION reports and the catalog records must still be the live rows
+TEST_F(DatabaseTest, DroppedPartitionReportsItsLiveRowsAfterARestart) {
+  run("CREATE TABLE LOGS (TS INT, V INT) PARTITION BY RANGE (TS) "
+      "(PARTITION A VALUES LESS THAN (10), PARTITION B VALUES LESS THAN (MAXVALUE))");
+  for (int ts = 0; ts < 20; ts++) {
+    run("INSERT INTO LOGS VALUES (" + std::to_string(ts) + ", " + std::to_string(ts) + ")");
+  }
+  run("DELETE FROM LOGS WHERE TS < 3");
+  reopen();
+
+  EXPECT_EQ(count("SELECT * FROM LOGS_B"), 10u); // opened from disk, recorded by the next save
+  EXPECT_EQ(run("ALTER TABLE LOGS DROP PARTITION A").rows_affected, 7);
+  const DB::CatalogEntry* entry = catalog->getEntry("LOGS_B");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->row_count, 10u);
+}
+
+TEST_F(DatabaseTest, HashPartitionsSpreadRows) {
+  run("CREATE TABLE USERS (ID INT PRIMARY KEY, V INT) PARTITION BY HASH (ID) PARTITIONS 4");
+  for (int id = 0; id < 200; id++) {
+    run("INSERT INTO USERS VALUES (" + std::to_string(id) + ", " + std::to_string(id) + ")");
+  }
+  size_t total = 0;
+  for (int p = 0; p < 4; p++) {
+    size_t rows = count("SELECT * FROM USERS_P" + std::to_string(p));
+    EXPECT_GT(rows, 20u);
+    total += rows;
+  }
+  EXPECT_EQ(total, 200u);
+  EXPECT_EQ(count("SELECT * FROM USERS WHERE ID = 77"), 1u);
+  // the key is unique within its partition, which is the only one it can be in
+  EXPECT_FALSE(executor->execute("INSERT INTO USERS VALUES (77, 0)").success);
+}
@@ -0,0 +1,100 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/HeapFile.hpp"
+#include "storage-manager/RowCache.hpp"
+
+#include <memory>
+
+using namespace DB;
+
+namespace {
+
+RowId rid(u64 page, u64 slot) { return RowId{PageId{0, page}, slot}; }
+
+Row make_row(int id) { return Row(2, std::vector<datatype>{datatype(id), datatype("row")}); }
+
+// looks the row up and caches it on a miss, like get_row does
+bool read_through(RowCache& cache, const RowId& id) {
+  std::unique_ptr<Row> cached(cache.get(id));
+  if (cached) {
+    return true;
+  }
+  Row row = make_row((int)id.record_num);
+  cache.put(id, row);
+  return false;
+}
+
+} // namespace
+
+TEST(RowCache, ReturnsCopiesUntilInvalidated) {
+  RowCache cache;
+  EXPECT_EQ(cache.get(rid(1, 2)), nullptr);
+  cache.put(rid(1, 2), make_row(7));
+
+  std::unique_ptr<Row> row(cache.get(rid(1, 2)));
+  ASSERT_NE(row, nullptr);
+  EXPECT_EQ(row->values[0], datatype(7));
+  EXPECT_EQ(row->id.pageId.page_num, 1u);
+  EXPECT_EQ(row->id.record_num, 2u);
+  EXPECT_EQ(cache.hits(), 1u);
+  EXPECT_EQ(cache.misses(), 1u);
+
+  // the same slot of another page is another row
+  EXPECT_EQ(cache.get(rid(2, 2)), nullptr);
+
+  cache.invalidate(rid(1, 2));
+  EXPECT_EQ(cache.get(rid(1, 2)), nullptr);
+
+  cache.put(rid(3, 0), make_row(1));
+  cache.clear();
+  EXPECT_EQ(cache.get(rid(3, 0)), nullptr);
+}
+
+TEST(RowCache, HotRowsSurviveAScan) {
+  RowCache cache(64);
+  for (int round = 0; round < 10; round++) {
+    for (u64 hot = 0; hot < 8; hot++) {
+      read_through(cache, rid(1, hot));
+    }
+  }
+  // a scan reads many rows once each, none of them more popular than the hot ones
+  for (u64 page = 100; page < 140; page++) {
+    for (u64 slot = 0; slot < SLOTS_PER_PAGE; slot++) {
+      read_through(cache, rid(page, slot));
+    }
+  }
+  for (u64 hot = 0; hot < 8; hot++) {
+    EXPECT_TRUE(read_through(cache, rid(1, hot))) << "hot row " << hot << " was evicted";
+  }
+
+  // never more rows than the capacity
+  size_t cached = 0;
+  for (u64 page = 100; page < 140; page++) {
+    for (u64 slot = 0; slot < SLOTS_PER_PAGE; slot++) {
+      cached += std::unique_ptr<Row>(cache.get(rid(page, slot))) != nullptr;
+    }
+  }
+  EXPECT_LE(cached + 8, 64u);
+}
+
+TEST_F(DatabaseTest, HeapWritesInvalidateCachedRows) {
+  HeapFile* heap = create_heapfile("ROW_CACHE");
+  Row original = make_row(1);
+  RowId id = insert_row(heap, &original, 0);
+
+  std::unique_ptr<Row> first(get_row(heap, id));
+  std::unique_ptr<Row> second(get_row(heap, id));
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(second->values[0], datatype(1));
+  EXPECT_EQ(heap->row_cache.hits(), 1u);
+
+  Row changed = make_row(2);
+  EXPECT_EQ(update_rows(heap, {id}, {&changed}).size(), 1u);
+  std::unique_ptr<Row> updated(get_row(heap, id));
+  ASSERT_NE(updated, nullptr);
+  EXPECT_EQ(updated->values[0], datatype(2));
+
+  delete_rows(heap, {id});
+  std::unique_ptr<Row> cached(heap->row_cache.get(id));
+  EXPECT_EQ(cached, nullptr);
+  delete heap;
+}
@@ -0,0 +1,154 @@
+#include "storage-manager/ops/Selection.hpp"
+#include "storage-manager/ops/SelectionKernels.hpp"
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <random>
+
+using namespace DB;
+
+namespace {
+
+const CompareOp kOps[] = {CompareOp::EQ, CompareOp::NE, CompareOp::LT,
+                          CompareOp::LE, CompareOp::GT, CompareOp::GE};
+
+template <typename T>
+std::vector<u32> reference(const std::vector<T>& data, CompareOp op, T value) {
+  std::vector<u32> out;
+  for (size_t i = 0; i < data.size(); i++) {
+    if (compare_values(op, data[i], value)) {
+      out.push_back((u32)i);
+    }
+  }
+  return out;
+}
+
+// odd lengths leave a tail after the last full vector
+template <typename T>
+void check_kernels(const std::vector<T>& data, const std::vector<T>& probes) {
+  SelectionIsa best = selection_isa();
+  for (SelectionIsa isa : {SelectionIsa::SCALAR, SelectionIsa::SSE42, SelectionIsa::AVX2}) {
+    set_selection_isa(isa);
+    for (size_t n : {data.size(), data.size() - 1, (size_t)7, (size_t)0}) {
+      std::vector<T> prefix(data.begin(), data.begin() + n);
+      for (CompareOp op : kOps) {
+        for (T value : probes) {
+          std::vector<u32> sel(n);
+          sel.resize(select_values(prefix.data(), n, op, value, sel.data()));
+          ASSERT_EQ(sel, reference(prefix, op, value))
+              << "isa " << (int)selection_isa() << " op " << (int)op << " n " << n;
+        }
+      }
+    }
+  }
+  set_selection_isa(best);
+}
+
+// hands out fixed chunks of one INT column
+class ChunkSource : public StorageOps {
+public:
+  explicit ChunkSource(std::vector<std::vector<int>> batches) : batches_(std::move(batches)) {}
+  void open() override { next_ = 0; }
+  bool next(DataChunk& out) override {
+    if (next_ == batches_.size()) return false;
+    out.reset(1);
+    for (int v : batches_[next_++]) {
+      Row row(1, std::vector<datatype>{v});
+      out.append_row(row);
+    }
+    return true;
+  }
+  void close() override {}
+
+private:
+  std::vector<std::vector<int>> batches_;
+  size_t next_ = 0;
+};
+
+} // namespace
+
+TEST(SelectionKernels, MatchScalarComparisonOnEveryIsa) {
+  std::mt19937 rng(5);
+  std::vector<int> ints(1001);
+  std::vector<int64_t> longs(1001);
+  std::vector<float> floats(1001);
+  std::vector<double> doubles(1001);
+  for (size_t i = 0; i < ints.size(); i++) {
+    ints[i] = (int)(rng() % 21) - 10;
+    longs[i] = ((int64_t)(rng() % 21) - 10) << 33;
+    floats[i] = (float)(rng() % 21) / 4 - 2.5f;
+    doubles[i] = (double)(rng() % 21) / 4 - 2.5;
+  }
+  ints[3] = std::numeric_limits<int>::min();
+  ints[4] = std::numeric_limits<int>::max();
+  longs[5] = std::numeric_limits<int64_t>::min();
+  // NaN compares false to everything but <>
+  floats[6] = std::nanf("");
+  doubles[7] = std::nan("");
+
+  check_kernels<int>(ints, {0, -10, 10, std::numeric_limits<int>::max()});
+  check_kernels<int64_t>(longs, {0, (int64_t)3 << 33, std::numeric_limits<int64_t>::min()});
+  check_kernels<float>(floats, {0.0f, -2.5f, 1.25f, std::nanf("")});
+  check_kernels<double>(doubles, {0.0, 2.5, -0.25, std::nan("")});
+}
+
+TEST(SelectionKernels, SelectCompareDropsNullsAndKeepsEarlierSelections) {
+  DataChunk chunk;
+  chunk.reset(2);
+  for (int i = 0; i < 20; i++) {
+    // column 1 is missing on every fifth row
+    std::vector<datatype> values{i};
+    if (i % 5 != 0) values.push_back(i);
+    Row row((int)values.size(), std::move(values));
+    chunk.append_row(row);
+  }
+
+  chunk.select({0, 2, 4, 5, 6, 8, 10, 12, 14, 15, 16});
+  select_compare(chunk, 1, CompareOp::LT, datatype(9));
+  // a null compares false, even though the kernel saw it as a 0 below 9
+  std::vector<u32> expected{2, 4, 6, 8};
+  ASSERT_EQ(chunk.selected(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(chunk.row(i), expected[i]);
+  }
+
+  // a value of another type goes through the generic comparison
+  select_compare(chunk, 1, CompareOp::EQ, datatype(4.0));
+  EXPECT_EQ(chunk.selected(), 0u);
+
+  // which drops nulls too
+  chunk.select({0, 1, 5, 6});
+  select_compare(chunk, 1, CompareOp::NE, datatype(4.0));
+  ASSERT_EQ(chunk.selected(), 2u);
+  EXPECT_EQ(chunk.row(0), 1u);
+  EXPECT_EQ(chunk.row(1), 6u);
+}
+
+TEST(SelectionKernels, VectorizedSelectionMatchesNaive) {
+  std::mt19937 rng(9);
+  std::vector<std::vector<int>> batches(5);
+  for (auto& batch : batches) {
+    batch.resize(300);
+    for (int& v : batch) v = (int)(rng() % 100);
+  }
+  batches[2].assign(50, 1000); // a batch with no match is skipped
+
+  for (string cond : {"=", "<>", "<", "<=", ">", ">="}) {
+    NaiveSelection naive(std::make_unique<ChunkSource>(batches), 0, cond, datatype(40));
+    VectorizedSelection vectorized(std::make_unique<ChunkSource>(batches), 0, cond, datatype(40));
+    naive.open();
+    vectorized.open();
+    std::vector<int> a, b;
+    DataChunk chunk;
+    while (naive.next(chunk)) {
+      for (size_t i = 0; i < chunk.selected(); i++) a.push_back(chunk.get(0, chunk.row(i)).get<int>());
+    }
+    while (vectorized.next(chunk)) {
+      EXPECT_GT(chunk.selected(), 0u);
+      for (size_t i = 0; i < chunk.selected(); i++) b.push_back(chunk.get(0, chunk.row(i)).get<int>());
+    }
+    EXPECT_EQ(a, b) << cond;
+    EXPECT_FALSE(a.empty()) << cond;
+  }
+}
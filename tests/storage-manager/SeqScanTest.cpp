@@ -0,0 +1,98 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/ops/StorageOps.hpp"
+
+#include <set>
+
+using namespace DB;
+
+namespace {
+
+// every id a scan returns, checking that no chunk is bigger than the batch
+std::vector<int> drain(StorageOps& scan, size_t batchSize, size_t& chunks) {
+  std::vector<int> ids;
+  DataChunk chunk;
+  chunks = 0;
+  while (scan.next(chunk)) {
+    EXPECT_GT(chunk.selected(), 0u);
+    EXPECT_LE(chunk.selected(), batchSize);
+    for (size_t i = 0; i < chunk.selected(); i++) {
+      ids.push_back(chunk.get(0, chunk.row(i)).get<int>());
+    }
+    chunks++;
+  }
+  // a finished scan stays finished
+  EXPECT_FALSE(scan.next(chunk));
+  return ids;
+}
+
+} // namespace
+
+TEST_F(DatabaseTest, SeqScanReturnsTheTableOneBatchAtATime) {
+  run("CREATE TABLE SCAN_HEAP (ID INT, NAME STRING)");
+  for (int i = 0; i < 1000; i++) {
+    run("INSERT INTO SCAN_HEAP VALUES (" + std::to_string(i) + ", 'N" + std::to_string(i) + "')");
+  }
+  Table* table = catalog->getTable("SCAN_HEAP");
+  SeqScan scan(*table, 64);
+  scan.open();
+  size_t chunks;
+  std::vector<int> ids = drain(scan, 64, chunks);
+  EXPECT_EQ(chunks, (1000u + 63) / 64);
+  EXPECT_EQ(ids.size(), 1000u);
+  EXPECT_EQ(std::set<int>(ids.begin(), ids.end()).size(), 1000u);
+
+  // opening again starts over
+  scan.open();
+  EXPECT_EQ(drain(scan, 64, chunks).size(), 1000u);
+  scan.close();
+}
+
+TEST_F(DatabaseTest, ScanNextResumesAfterWritesBetweenBatches) {
+  run("CREATE TABLE SCAN_CURSOR (ID INT)");
+  for (int i = 0; i < 100; i++) {
+    run("INSERT INTO SCAN_CURSOR VALUES (" + std::to_string(i) + ")");
+  }
+  Table* table = catalog->getTable("SCAN_CURSOR");
+  TableCursor cursor;
+  QueryArena arena;
+  std::vector<Row*> first = table->scan_next(cursor, 40, &arena);
+  EXPECT_EQ(first.size(), 40u);
+
+  // rows deleted behind the cursor don't show up again, the rest is read once
+  run("DELETE FROM SCAN_CURSOR WHERE ID < 10");
+  std::set<int> rest;
+  for (std::vector<Row*> batch; !(batch = table->scan_next(cursor, 40, &arena)).empty();) {
+    EXPECT_LE(batch.size(), 40u);
+    for (Row* row : batch) {
+      EXPECT_TRUE(rest.insert(row->values[0].get<int>()).second);
+    }
+  }
+  EXPECT_TRUE(cursor.heap.done);
+  EXPECT_EQ(rest.size(), 60u);
+  EXPECT_EQ(*rest.begin(), 40);
+}
+
+TEST_F(DatabaseTest, SeqScanFollowsTheKeyOfKeyedTables) {
+  run("CREATE TABLE SCAN_LSM (ID INT PRIMARY KEY, V INT) ENGINE = LSM");
+  for (int i = 0; i < 300; i++) {
+    run("INSERT INTO SCAN_LSM VALUES (" + std::to_string((i * 7) % 300) + ", 0)");
+  }
+  SeqScan scan(*catalog->getTable("SCAN_LSM"), 50);
+  scan.open();
+  size_t chunks;
+  std::vector<int> ids = drain(scan, 50, chunks);
+  EXPECT_EQ(chunks, 6u);
+  ASSERT_EQ(ids.size(), 300u);
+  for (int i = 0; i < 300; i++) {
+    EXPECT_EQ(ids[i], i);
+  }
+}
+
+TEST_F(DatabaseTest, SelectOverManyBatchesTerminates) {
+  run("CREATE TABLE SCAN_BIG (ID INT)");
+  for (int i = 0; i < CHUNK_CAPACITY * 2 + 10; i++) {
+    run("INSERT INTO SCAN_BIG VALUES (" + std::to_string(i) + ")");
+  }
+  EXPECT_EQ(count("SELECT * FROM SCAN_BIG"), CHUNK_CAPACITY * 2u + 10);
+  EXPECT_EQ(count("SELECT * FROM SCAN_BIG LIMIT 5"), 5u);
+}
@@ -0,0 +1,126 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/Statistics.hpp"
+#include "storage-manager/Table.hpp"
+
+#include <cmath>
+#include <memory>
+
+using namespace DB;
+
+namespace {
+
+Schema two_ints() {
+  Schema schema(2);
+  schema.add_col("ID", ColumnType::INT);
+  schema.add_col("V", ColumnType::INT);
+  return schema;
+}
+
+} // namespace
+
+TEST(HyperLogLog, EstimatesWithinAFewPercent) {
+  HyperLogLog sketch;
+  for (int i = 0; i < 50000; i++) {
+    sketch.add(i);
+    sketch.add(i); // repeats don't count
+  }
+  EXPECT_NEAR(sketch.estimate(), 50000, 50000 * 0.08);
+
+  // two halves merge to the whole
+  HyperLogLog low, high;
+  for (int i = 0; i < 2000; i++) {
+    (i < 1000 ? low : high).add(i);
+  }
+  low.merge(high);
+  EXPECT_NEAR(low.estimate(), 2000, 2000 * 0.08);
+}
+
+TEST(ColumnStats, SkewedValuesGoToMcvAndTheRestToTheHistogram) {
+  // value 7 is half the table, the rest are 1000 distinct values
+  std::vector<std::unique_ptr<Row>> owned;
+  std::vector<Row*> rows;
+  for (int i = 0; i < 2000; i++) {
+    int v = i % 2 == 0 ? 7 : 10000 + i;
+    owned.push_back(std::make_unique<Row>(2, std::vector<datatype>{i, v}));
+    rows.push_back(owned.back().get());
+  }
+  TableStats stats = analyze_rows(rows, two_ints());
+  ASSERT_EQ(stats.columns.size(), 2u);
+  EXPECT_EQ(stats.row_count, 2000u);
+
+  const ColumnStats& v = stats.columns[1];
+  EXPECT_EQ(v.null_frac, 0);
+  EXPECT_EQ(v.ndv, 1001); // every row was read, so the count is exact
+  ASSERT_FALSE(v.mcv.empty());
+  EXPECT_EQ(v.mcv[0], datatype(7));
+  EXPECT_DOUBLE_EQ(v.mcv_freq[0], 0.5);
+
+  // equi-depth bounds span the non-mcv values in order
+  ASSERT_GE(v.histogram.size(), 2u);
+  EXPECT_LE(v.histogram.size(), STATS_HISTOGRAM_BUCKETS + 1u);
+  EXPECT_EQ(v.histogram.front(), datatype(10001));
+  EXPECT_EQ(v.histogram.back(), datatype(11999));
+  for (size_t i = 1; i < v.histogram.size(); i++) {
+    EXPECT_LT(v.histogram[i - 1], v.histogram[i]);
+  }
+
+  // a unique column has no common values
+  EXPECT_TRUE(stats.columns[0].mcv.empty());
+  EXPECT_EQ(stats.columns[0].ndv, 2000);
+}
+
+TEST(TableStats, SerializeRoundTrips) {
+  std::vector<std::unique_ptr<Row>> owned;
+  std::vector<Row*> rows;
+  for (int i = 0; i < 300; i++) {
+    owned.push_back(std::make_unique<Row>(2, std::vector<datatype>{i, i % 5}));
+    rows.push_back(owned.back().get());
+  }
+  TableStats stats = analyze_rows(rows, two_ints());
+  stats.observe_change(3, false);
+
+  std::vector<u8> bytes;
+  stats.serialize(bytes);
+  TableStats read;
+  EXPECT_EQ(read.deserialize(bytes.data(), bytes.size()), bytes.size());
+  EXPECT_EQ(read.row_count, stats.row_count);
+  EXPECT_EQ(read.modified, 3u);
+  ASSERT_EQ(read.columns.size(), 2u);
+  EXPECT_EQ(read.columns[1].mcv, stats.columns[1].mcv);
+  EXPECT_EQ(read.columns[1].mcv_freq, stats.columns[1].mcv_freq);
+  EXPECT_EQ(read.columns[0].histogram, stats.columns[0].histogram);
+  EXPECT_EQ(read.columns[0].sketch.registers(), stats.columns[0].sketch.registers());
+
+  // a cut off record is rejected rather than read past
+  EXPECT_EQ(read.deserialize(bytes.data(), bytes.size() - 1), 0u);
+}
+
+TEST_F(DatabaseTest, AnalyzeIsSavedAndRefreshedAsRowsChange) {
+  run("CREATE TABLE STATS_T (ID INT, V INT)");
+  for (int i = 0; i < 200; i++) {
+    run("INSERT INTO STATS_T VALUES (" + std::to_string(i) + ", " + std::to_string(i % 4) + ")");
+  }
+  EXPECT_EQ(catalog->getTable("STATS_T")->statistics(), nullptr);
+
+  DB::QueryResult analyzed = run("ANALYZE STATS_T");
+  EXPECT_EQ(analyzed.rows_affected, 200u);
+
+  // statistics live in the catalog and come back after a restart
+  reopen();
+  const TableStats* stats = catalog->getTable("STATS_T")->statistics();
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->row_count, 200u);
+  ASSERT_EQ(stats->columns.size(), 2u);
+  EXPECT_EQ(stats->columns[1].ndv, 4);
+  EXPECT_EQ(stats->columns[1].mcv.size(), 4u);
+
+  // inserts are counted as they happen, past the threshold the table is analyzed again
+  for (int i = 200; i < 280; i++) {
+    run("INSERT INTO STATS_T VALUES (" + std::to_string(i) + ", " + std::to_string(100 + i) + ")");
+  }
+  stats = catalog->getTable("STATS_T")->statistics();
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->row_count, 280u);
+  EXPECT_FALSE(stats->stale());
+  EXPECT_GT(stats->columns[1].distinct(), 50);
+}
@@ -0,0 +1,90 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/TypedTable.hpp"
+
+#include <map>
+
+using namespace DB;
+
+namespace {
+
+// laid out like struct { int; double; bool; } with the double aligned to 8
+using Mixed = RowLayout<int, double, bool>;
+static_assert(Mixed::offsets[0] == 0 && Mixed::offsets[1] == 8 && Mixed::offsets[2] == 16);
+static_assert(Mixed::size == 24 && Mixed::align == 8);
+static_assert(Mixed::slot_offsets[0] == ROW_HEADER_SIZE + 1);
+static_assert(Mixed::slot_offsets[1] == ROW_HEADER_SIZE + 1 + sizeof(int) + 1);
+static_assert(Mixed::tags[1] == 5);
+static_assert(sizeof(TypedRow<int, double, bool>) == Mixed::size + sizeof(RowId));
+
+using Priced = TypedTable<int, double>;
+
+} // namespace
+
+TEST(TypedRow, ConvertsToAndFromRows) {
+  TypedRow<int, double, bool> record(7, 2.5, true);
+  EXPECT_EQ(record.get<0>(), 7);
+  EXPECT_EQ(record.get<1>(), 2.5);
+  EXPECT_TRUE(record.get<2>());
+  record.set<0>(8);
+
+  std::unique_ptr<Row> row(record.to_row());
+  ASSERT_EQ(row->values.size(), 3u);
+  EXPECT_EQ(row->values[0], datatype(8));
+  EXPECT_EQ(row->values[1], datatype(2.5));
+
+  // other numeric types are converted to the column's type
+  Row loose(3, std::vector<datatype>{datatype((int64_t)9), datatype(1.5f), datatype(true)});
+  auto back = TypedRow<int, double, bool>::from_row(loose);
+  EXPECT_EQ(back.get<0>(), 9);
+  EXPECT_EQ(back.get<1>(), 1.5);
+
+  Row text(3, std::vector<datatype>{datatype(1), datatype("no"), datatype(true)});
+  EXPECT_THROW((TypedRow<int, double, bool>::from_row(text)), std::runtime_error);
+  Row narrow(1, std::vector<datatype>{datatype(1)});
+  EXPECT_THROW((TypedRow<int, double, bool>::from_row(narrow)), std::runtime_error);
+}
+
+TEST_F(DatabaseTest, TypedTablesShareRowsWithSql) {
+  run("CREATE TABLE PRICES (ID INT PRIMARY KEY, PRICE DOUBLE)");
+  run("INSERT INTO PRICES VALUES (1, 10.5)");
+  run("INSERT INTO PRICES VALUES (2, 3)");
+
+  Priced prices(*catalog->getTable("PRICES"));
+  std::vector<RowId> ids = prices.insert({Priced::Record(3, 0.25), Priced::Record(4, 100.0)});
+  ASSERT_EQ(ids.size(), 2u);
+  // unique checks apply as they do for SQL, and nothing of a failed batch is written
+  EXPECT_THROW(prices.insert({Priced::Record(5, 1.0), Priced::Record(1, 1.0)}), std::runtime_error);
+
+  std::map<int, double> seen;
+  prices.scan([&](const Priced::Record& record) { seen[record.get<0>()] = record.get<1>(); });
+  EXPECT_EQ(seen, (std::map<int, double>{{1, 10.5}, {2, 3}, {3, 0.25}, {4, 100.0}}));
+
+  std::optional<Priced::Record> fetched = prices.get(ids[1]);
+  ASSERT_TRUE(fetched);
+  EXPECT_EQ(fetched->get<0>(), 4);
+
+  // typed inserts are ordinary rows to SQL
+  DB::QueryResult three = run("SELECT * FROM PRICES WHERE ID = 3");
+  ASSERT_EQ(three.rows.size(), 1u);
+  EXPECT_EQ(three.rows[0]->values[1], datatype(0.25));
+  EXPECT_EQ(count("SELECT * FROM PRICES WHERE ID > 2"), 2u);
+
+  // the column types are checked once, when the wrapper is made
+  EXPECT_THROW((TypedTable<int, int>(*catalog->getTable("PRICES"))), std::runtime_error);
+  EXPECT_THROW((TypedTable<int>(*catalog->getTable("PRICES"))), std::runtime_error);
+}
+
+TEST_F(DatabaseTest, TypedTablesScanOtherEngines) {
+  run("CREATE TABLE TYPED_LSM (ID INT PRIMARY KEY, PRICE DOUBLE) ENGINE = LSM");
+  Priced prices(*catalog->getTable("TYPED_LSM"));
+  std::vector<Priced::Record> records;
+  for (int i = 0; i < 50; i++) {
+    records.push_back(Priced::Record(49 - i, i * 0.5));
+  }
+  prices.insert(records);
+  std::vector<Priced::Record> scanned = prices.scan();
+  ASSERT_EQ(scanned.size(), 50u);
+  // keyed engines return rows by key
+  EXPECT_EQ(scanned[0].get<0>(), 0);
+  EXPECT_EQ(scanned[0].get<1>(), 49 * 0.5);
+}
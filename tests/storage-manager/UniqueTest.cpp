@@ -0,0 +1,35 @@
+#include "DatabaseTest.hpp"
+
+using namespace DB;
+
+TEST_F(DatabaseTest, DuplicateKeysFailTheWholeInsert) {
+  run("CREATE TABLE UNIQ_INSERT (ID INT PRIMARY KEY, EMAIL VARCHAR UNIQUE)");
+  run("INSERT INTO UNIQ_INSERT VALUES (1, 'a'), (2, 'b')");
+
+  EXPECT_FALSE(executor->execute("INSERT INTO UNIQ_INSERT VALUES (3, 'c'), (1, 'd')").success);
+  EXPECT_FALSE(executor->execute("INSERT INTO UNIQ_INSERT VALUES (4, 'b')").success);
+  EXPECT_FALSE(executor->execute("INSERT INTO UNIQ_INSERT VALUES (5, 'e'), (5, 'f')").success);
+  EXPECT_EQ(count("SELECT * FROM UNIQ_INSERT"), 2u);
+
+  // rows an UPDATE rewrites don't conflict with themselves
+  EXPECT_FALSE(executor->execute("UPDATE UNIQ_INSERT SET ID = 2 WHERE ID = 1").success);
+  EXPECT_EQ(run("UPDATE UNIQ_INSERT SET ID = ID WHERE ID < 10").rows_affected, 2);
+}
+
+// the key index is read back from disk, so a restart can't let a duplicate in
+TEST_F(DatabaseTest, DuplicateKeysRejectedAfterRestart) {
+  run("CREATE TABLE UNIQ_RESTART (ID INT PRIMARY KEY, V INT)");
+  for (int i = 1; i <= 800; i++) {
+    run("INSERT INTO UNIQ_RESTART VALUES (" + std::to_string(i) + ", 0)");
+    if (i == 400) reopen();
+  }
+  reopen();
+
+  for (int id : {1, 100, 400, 401, 800}) {
+    QueryResult result = executor->execute("INSERT INTO UNIQ_RESTART VALUES (" + std::to_string(id) + ", 1)");
+    EXPECT_FALSE(result.success) << id;
+  }
+  run("INSERT INTO UNIQ_RESTART VALUES (801, 1)");
+  EXPECT_EQ(count("SELECT * FROM UNIQ_RESTART"), 801u);
+  EXPECT_EQ(count("SELECT * FROM UNIQ_RESTART WHERE V = 1"), 1u);
+}
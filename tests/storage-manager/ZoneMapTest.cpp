@@ -0,0 +1,98 @@
+#include "DatabaseTest.hpp"
+#include "storage-manager/ZoneMap.hpp"
+
+using namespace DB;
+
+namespace {
+
+Row make_row(datatype a, datatype b) { return Row(2, std::vector<datatype>{a, b}); }
+
+ZoneRange range(u8 col, std::optional<datatype> low, std::optional<datatype> high) {
+  return ZoneRange{col, std::move(low), std::move(high)};
+}
+
+} // namespace
+
+TEST_F(DatabaseTest, ZoneMapSkipsPagesOutsideARange) {
+  string path = "database-files/heapfiles/zone_basic.zone";
+  {
+    ZoneMap zones;
+    zones.open(path);
+    for (int i = 1; i <= 10; i++) {
+      Row row = make_row(i, "apple");
+      zones.add_row(1, &row);
+    }
+    for (int i = 100; i <= 110; i++) {
+      Row row = make_row(i, "pear");
+      zones.add_row(2, &row);
+    }
+
+    EXPECT_TRUE(zones.may_match(1, {range(0, 5, 5)}));
+    EXPECT_FALSE(zones.may_match(2, {range(0, 5, 5)}));
+    EXPECT_FALSE(zones.may_match(1, {range(0, 50, 60)}));
+    EXPECT_FALSE(zones.may_match(2, {range(0, 50, 60)}));
+    EXPECT_TRUE(zones.may_match(2, {range(0, 105, std::nullopt)}));
+    EXPECT_FALSE(zones.may_match(1, {range(1, datatype("pear"), datatype("pear"))}));
+    // every range has to overlap
+    EXPECT_FALSE(zones.may_match(1, {range(0, 1, 10), range(1, datatype("zebra"), std::nullopt)}));
+
+    zones.merge(1, 2);
+    EXPECT_TRUE(zones.may_match(1, {range(0, 105, 105)}));
+    zones.reset(2);
+  }
+  // zones are read back from <table>.zone
+  ZoneMap reopened;
+  reopened.open(path);
+  EXPECT_TRUE(reopened.may_match(1, {range(0, 105, 105)}));
+  EXPECT_FALSE(reopened.may_match(1, {range(0, 200, std::nullopt)}));
+}
+
+TEST_F(DatabaseTest, RangeQueriesSeeUpdatedRows) {
+  run("CREATE TABLE ZONE_ROWS (ID INT, V INT)");
+  for (int i = 0; i < 320; i++) {
+    run("INSERT INTO ZONE_ROWS VALUES (" + std::to_string(i) + ", " + std::to_string(i) + ")");
+  }
+  EXPECT_EQ(count("SELECT * FROM ZONE_ROWS WHERE V >= 100 AND V < 110"), 10u);
+  EXPECT_EQ(count("SELECT * FROM ZONE_ROWS WHERE V > 1000"), 0u);
+
+  // an update widens the zone of its page
+  run("UPDATE ZONE_ROWS SET V = 5000 WHERE ID = 3");
+  run("DELETE FROM ZONE_ROWS WHERE ID = 105");
+  reopen();
+  EXPECT_EQ(count("SELECT * FROM ZONE_ROWS WHERE V > 1000"), 1u);
+  EXPECT_EQ(count("SELECT * FROM ZONE_ROWS WHERE V >= 100 AND V < 110"), 9u);
+  EXPECT_EQ(count("SELECT * FROM ZONE_ROWS WHERE V < 10"), 9u);
+}
+
+// values of different tags compare by tag, so a zone is only checked against a
+// range of its own tag
+TEST_F(DatabaseTest, ZonesOnlyCompareValuesOfOneTag) {
+  ZoneMap zones;
+  zones.open("database-files/heapfiles/zone_tags.zone");
+  for (int i = 10; i <= 20; i++) {
+    Row row = make_row(i, static_cast<float>(i) + 0.5f);
+    zones.add_row(1, &row);
+  }
+  EXPECT_FALSE(zones.may_match(1, {range(0, std::nullopt, 5)}));
+  EXPECT_TRUE(zones.may_match(1, {range(0, std::nullopt, 5.5f)}));
+  EXPECT_TRUE(zones.may_match(1, {range(0, 50.5f, std::nullopt)}));
+  EXPECT_FALSE(zones.may_match(1, {range(1, 50.5f, std::nullopt)}));
+  EXPECT_TRUE(zones.may_match(1, {range(1, 50, std::nullopt)}));
+
+  // a float in an int column makes the zone mixed
+  Row row = make_row(1.5f, 1.5f);
+  zones.add_row(1, &row);
+  EXPECT_TRUE(zones.may_match(1, {range(0, 100, std::nullopt)}));
+
+  // pushed down comparisons agree with the same comparison left to the filter
+  run("CREATE TABLE ZONE_TAGS (X INT, F FLOAT)");
+  for (int i = 0; i < 100; i++) {
+    run("INSERT INTO ZONE_TAGS VALUES (" + std::to_string(i) + ", " + std::to_string(i) + ".5)");
+  }
+  for (std::string test : {"X < 0.5", "X <= 10.5", "X > 50.5", "X = 10.0", "X < 10", "F < 10", "F > 10.0"}) {
+    EXPECT_EQ(count("SELECT * FROM ZONE_TAGS WHERE " + test),
+              count("SELECT * FROM ZONE_TAGS WHERE " + test + " OR " + test)) << test;
+  }
+  EXPECT_EQ(count("SELECT * FROM ZONE_TAGS WHERE X < 10"), 10u);
+  EXPECT_EQ(count("SELECT * FROM ZONE_TAGS WHERE F > 10.0"), 90u);
+}